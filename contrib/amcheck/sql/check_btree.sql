@@ -104,11 +104,26 @@ INSERT INTO toast_bug SELECT repeat('a', 2200);
 -- Should not get false positive report of corruption:
 SELECT bt_index_check('toasty', true);
 
+--
+-- Check that posting list tuples created by deduplication are verified,
+-- both after CREATE INDEX and after deduplication passes during inserts,
+-- and after VACUUM removes some of their heap TIDs
+--
+CREATE TABLE dedup_test_table (a int, b int);
+INSERT INTO dedup_test_table SELECT i % 10, i FROM generate_series(1, 5000) i;
+CREATE INDEX dedup_test_idx ON dedup_test_table (a);
+INSERT INTO dedup_test_table SELECT i % 10, i FROM generate_series(5001, 10000) i;
+SELECT bt_index_check('dedup_test_idx', true);
+DELETE FROM dedup_test_table WHERE b % 3 = 0;
+VACUUM dedup_test_table;
+SELECT bt_index_parent_check('dedup_test_idx', true, true);
+
 -- cleanup
 DROP TABLE bttest_a;
 DROP TABLE bttest_b;
 DROP TABLE bttest_multi;
 DROP TABLE delete_test_table;
 DROP TABLE toast_bug;
+DROP TABLE dedup_test_table;
 DROP OWNED BY regress_bttest_role; -- permissions
 DROP ROLE regress_bttest_role;
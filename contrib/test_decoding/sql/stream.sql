@@ -0,0 +1,61 @@
+-- predictability
+SET synchronous_commit = on;
+SET logical_decoding_work_mem = '64kB';
+
+SELECT 'init' FROM pg_create_logical_replication_slot('regression_slot', 'test_decoding');
+
+CREATE TABLE stream_test(data text);
+
+-- consume DDL
+SELECT data FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1');
+
+-- streaming test with sub-transaction
+BEGIN;
+SAVEPOINT s1;
+SELECT 'msg' FROM pg_logical_emit_message(true, 'test', repeat('a', 50));
+INSERT INTO stream_test SELECT repeat('a', 2000) || g.i FROM generate_series(1, 35) g(i);
+TRUNCATE table stream_test;
+ROLLBACK TO s1;
+INSERT INTO stream_test SELECT repeat('a', 10) || g.i FROM generate_series(1, 20) g(i);
+COMMIT;
+
+-- the subtransaction is streamed before it is rolled back, and the rest of
+-- the transaction is streamed at commit
+SELECT count(*) FILTER (WHERE data ~ 'opening a streamed block') > 1 AS several_blocks,
+       count(*) FILTER (WHERE data ~ 'streaming message') AS messages,
+       count(*) FILTER (WHERE data ~ 'aborting streamed') AS aborts,
+       count(*) FILTER (WHERE data ~ 'committing streamed transaction') AS commits,
+       count(*) FILTER (WHERE data ~ '^table ') AS not_streamed
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1');
+
+-- a large transaction is streamed in several blocks, and committed
+BEGIN;
+INSERT INTO stream_test SELECT repeat('a', 100) || g.i FROM generate_series(1, 2000) g(i);
+COMMIT;
+
+SELECT count(*) FILTER (WHERE data ~ 'opening a streamed block') > 1 AS several_blocks,
+       count(*) FILTER (WHERE data ~ 'streaming change') AS changes,
+       count(*) FILTER (WHERE data ~ 'committing streamed transaction') AS commits
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1');
+
+-- streamed changes of an aborted transaction are discarded
+BEGIN;
+INSERT INTO stream_test SELECT repeat('a', 100) || g.i FROM generate_series(1, 2000) g(i);
+ROLLBACK;
+
+SELECT count(*) FILTER (WHERE data ~ 'streaming change') > 0 AS streamed,
+       count(*) FILTER (WHERE data ~ 'aborting streamed') AS aborts,
+       count(*) FILTER (WHERE data ~ 'committing streamed transaction') AS commits
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1');
+
+-- without the option, the same transaction is decoded at commit
+BEGIN;
+INSERT INTO stream_test SELECT repeat('a', 100) || g.i FROM generate_series(1, 2000) g(i);
+COMMIT;
+
+SELECT count(*) FILTER (WHERE data ~ 'streaming') AS streamed,
+       count(*) FILTER (WHERE data ~ '^table public.stream_test: INSERT') AS inserts
+FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1');
+
+DROP TABLE stream_test;
+SELECT pg_drop_replication_slot('regression_slot');
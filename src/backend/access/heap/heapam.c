@@ -522,9 +522,11 @@ heapgettup(HeapScanDesc scan,
 				(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
 
 				table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
+														 scan->rs_parallelworkerdata,
 														 pbscan);
 
 				page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+														 scan->rs_parallelworkerdata,
 														 pbscan);
 
 				/* Other processes might have already finished the scan. */
@@ -722,6 +724,7 @@ heapgettup(HeapScanDesc scan,
 			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
 
 			page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+													 scan->rs_parallelworkerdata,
 													 pbscan);
 			finished = (page == InvalidBlockNumber);
 		}
@@ -836,9 +839,11 @@ heapgettup_pagemode(HeapScanDesc scan,
 				(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
 
 				table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
+														 scan->rs_parallelworkerdata,
 														 pbscan);
 
 				page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+														 scan->rs_parallelworkerdata,
 														 pbscan);
 
 				/* Other processes might have already finished the scan. */
@@ -1021,6 +1026,7 @@ heapgettup_pagemode(HeapScanDesc scan,
 			(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
 
 			page = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
+													 scan->rs_parallelworkerdata,
 													 pbscan);
 			finished = (page == InvalidBlockNumber);
 		}
@@ -1190,6 +1196,15 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 	/* we only need to set this up once */
 	scan->rs_ctup.t_tableOid = RelationGetRelid(relation);
 
+	/*
+	 * Allocate memory to keep track of page allocation for parallel workers
+	 * when doing a parallel scan.
+	 */
+	if (parallel_scan != NULL)
+		scan->rs_parallelworkerdata = palloc(sizeof(ParallelBlockTableScanWorkerData));
+	else
+		scan->rs_parallelworkerdata = NULL;
+
 	/*
 	 * we do this here instead of in initscan() because heap_rescan also calls
 	 * initscan() and we don't want to allocate memory again
@@ -1265,6 +1280,9 @@ heap_endscan(TableScanDesc sscan)
 	if (scan->rs_strategy != NULL)
 		FreeAccessStrategy(scan->rs_strategy);
 
+	if (scan->rs_parallelworkerdata != NULL)
+		pfree(scan->rs_parallelworkerdata);
+
 	if (scan->rs_base.rs_flags & SO_TEMP_SNAPSHOT)
 		UnregisterSnapshot(scan->rs_base.rs_snapshot);
 
@@ -1982,6 +2000,13 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 		{
 			xlrec.flags |= XLH_INSERT_CONTAINS_NEW_TUPLE;
 			bufflags |= REGBUF_KEEP_DATA;
+
+			/*
+			 * Let decoding know that the main table change that this toast
+			 * chunk belongs to is still to come.
+			 */
+			if (IsToastRelation(relation))
+				xlrec.flags |= XLH_INSERT_ON_TOAST_RELATION;
 		}
 
 		XLogBeginInsert();
@@ -8880,6 +8905,31 @@ heap_redo(XLogReaderState *record)
 	}
 }
 
+/*
+ * Can a redo worker replay this record?  As noted above, none of the heap
+ * rmgr's operations require conflict processing.  TRUNCATE references no
+ * blocks, so there's nothing to gain from it.
+ */
+bool
+heap_parallel_safe(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+
+	switch (info & XLOG_HEAP_OPMASK)
+	{
+		case XLOG_HEAP_INSERT:
+		case XLOG_HEAP_DELETE:
+		case XLOG_HEAP_UPDATE:
+		case XLOG_HEAP_HOT_UPDATE:
+		case XLOG_HEAP_CONFIRM:
+		case XLOG_HEAP_LOCK:
+		case XLOG_HEAP_INPLACE:
+			return true;
+		default:
+			return false;
+	}
+}
+
 void
 heap2_redo(XLogReaderState *record)
 {
@@ -190,6 +190,7 @@ typedef struct TransactionStateData
 	bool		didLogXid;		/* has xid been included in WAL record? */
 	int			parallelModeLevel;	/* Enter/ExitParallelMode counter */
 	bool		chain;			/* start a new block after this one */
+	bool		assigned;		/* assigned to top-level XID in WAL? */
 	struct TransactionStateData *parent;	/* back link to parent */
 } TransactionStateData;
 
@@ -4715,6 +4716,52 @@ IsSubTransaction(void)
 	return false;
 }
 
+/*
+ * IsSubTransactionAssignmentPending
+ *
+ * Returns true if the current subtransaction has an XID that hasn't yet been
+ * associated with its top-level transaction in WAL.  With wal_level=logical,
+ * the first WAL record written by a subtransaction carries the top-level XID,
+ * so that logical decoding can tell which transaction its changes belong to
+ * before the subtransaction commits.
+ */
+bool
+IsSubTransactionAssignmentPending(void)
+{
+	/* wal_level has to be logical */
+	if (!XLogLogicalInfoActive())
+		return false;
+
+	/* we need to be in a transaction state */
+	if (!IsTransactionState())
+		return false;
+
+	/* it has to be a subtransaction */
+	if (!IsSubTransaction())
+		return false;
+
+	/* the subtransaction has to have an XID assigned */
+	if (!TransactionIdIsValid(GetCurrentTransactionIdIfAny()))
+		return false;
+
+	/* and it should not be already 'assigned' */
+	return !CurrentTransactionState->assigned;
+}
+
+/*
+ * MarkSubTransactionAssigned
+ *
+ * Remember that the current subtransaction has been associated with its
+ * top-level transaction in WAL.
+ */
+void
+MarkSubTransactionAssigned(void)
+{
+	Assert(IsSubTransactionAssignmentPending());
+
+	CurrentTransactionState->assigned = true;
+}
+
 /*
  * StartSubTransaction
  *
@@ -34,6 +34,8 @@
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "access/xloginsert.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogredoworker.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
@@ -45,6 +47,8 @@
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "port/pg_bitutils.h"
+#include "portability/instr_time.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/startup.h"
 #include "postmaster/walwriter.h"
@@ -93,7 +97,7 @@ char	   *XLogArchiveCommand = NULL;
 bool		EnableHotStandby = false;
 bool		fullPageWrites = true;
 bool		wal_log_hints = false;
-bool		wal_compression = false;
+int			wal_compression = WAL_COMPRESSION_NONE;
 char	   *wal_consistency_checking_string = NULL;
 bool	   *wal_consistency_checking = NULL;
 bool		wal_init_zero = true;
@@ -112,11 +116,12 @@ bool		XLOG_DEBUG = false;
 int			wal_segment_size = DEFAULT_XLOG_SEG_SIZE;
 
 /*
- * Number of WAL insertion locks to use. A higher value allows more insertions
- * to happen concurrently, but adds some CPU overhead to flushing the WAL,
- * which needs to iterate all the locks.
+ * Number of WAL insertion locks to use (wal_insert_locks). A higher value
+ * allows more insertions to happen concurrently, but adds some CPU overhead
+ * to flushing the WAL, which needs to iterate all the locks. -1 means to
+ * choose a value based on the number of CPUs, see XLOGChooseNumInsertLocks().
  */
-#define NUM_XLOGINSERT_LOCKS  8
+int			wal_insert_locks = -1;
 
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
@@ -612,6 +617,22 @@ typedef struct XLogCtlData
 	 */
 	XLogwrtResult LogwrtResult;
 
+	/*
+	 * Head of the list of processes waiting for their WAL to be flushed by a
+	 * group leader.  See XLogFlushGroup().
+	 */
+	pg_atomic_uint32 flushGroupFirst;
+
+	/*
+	 * Group commit histograms, see GetXLogFlushHistogram().  Bucketed by the
+	 * duration of each group's write and fsync in microseconds, the time each
+	 * XLogFlush() call spent waiting in microseconds, and the number of
+	 * processes served by each group flush, respectively.
+	 */
+	pg_atomic_uint64 flushLatencyHist[XLOG_FLUSH_HIST_BUCKETS];
+	pg_atomic_uint64 waitLatencyHist[XLOG_FLUSH_HIST_BUCKETS];
+	pg_atomic_uint64 groupSizeHist[XLOG_FLUSH_HIST_BUCKETS];
+
 	/*
 	 * Latest initialized page in the cache (last byte position + 1).
 	 *
@@ -919,7 +940,6 @@ static bool read_backup_label(XLogRecPtr *checkPointLoc,
 							  bool *backupEndRequired, bool *backupFromStandby);
 static bool read_tablespace_map(List **tablespaces);
 
-static void rm_redo_error_callback(void *arg);
 static int	get_sync_bit(int method);
 
 static void CopyXLogRecordToWAL(int write_len, bool isLogSwitch,
@@ -1008,7 +1028,7 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
 	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * determined by wal_insert_locks. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1631,7 +1651,7 @@ WALInsertLockAcquire(void)
 	static int	lockToTry = -1;
 
 	if (lockToTry == -1)
-		lockToTry = MyProc->pgprocno % NUM_XLOGINSERT_LOCKS;
+		lockToTry = MyProc->pgprocno % wal_insert_locks;
 	MyLockNo = lockToTry;
 
 	/*
@@ -1649,7 +1669,7 @@ WALInsertLockAcquire(void)
 		 * than locks, it still helps to distribute the inserters evenly
 		 * across the locks.
 		 */
-		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+		lockToTry = (lockToTry + 1) % wal_insert_locks;
 	}
 }
 
@@ -1667,7 +1687,7 @@ WALInsertLockAcquireExclusive(void)
 	 * indicator is set to 0xFFFFFFFFFFFFFFFF, which is higher than any real
 	 * XLogRecPtr value, to make sure that no-one blocks waiting on those.
 	 */
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+	for (i = 0; i < wal_insert_locks - 1; i++)
 	{
 		LWLockAcquire(&WALInsertLocks[i].l.lock, LW_EXCLUSIVE);
 		LWLockUpdateVar(&WALInsertLocks[i].l.lock,
@@ -1693,7 +1713,7 @@ WALInsertLockRelease(void)
 	{
 		int			i;
 
-		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+		for (i = 0; i < wal_insert_locks; i++)
 			LWLockReleaseClearVar(&WALInsertLocks[i].l.lock,
 								  &WALInsertLocks[i].l.insertingAt,
 								  0);
@@ -1721,8 +1741,8 @@ WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
 		 * We use the last lock to mark our actual position, see comments in
 		 * WALInsertLockAcquireExclusive.
 		 */
-		LWLockUpdateVar(&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.lock,
-						&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.insertingAt,
+		LWLockUpdateVar(&WALInsertLocks[wal_insert_locks - 1].l.lock,
+						&WALInsertLocks[wal_insert_locks - 1].l.insertingAt,
 						insertingAt);
 	}
 	else
@@ -1789,7 +1809,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	 * out for any insertion that's still in progress.
 	 */
 	finishedUpto = reservedUpto;
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		XLogRecPtr	insertingat = InvalidXLogRecPtr;
 
@@ -2795,17 +2815,205 @@ UpdateMinRecoveryPoint(XLogRecPtr lsn, bool force)
 	LWLockRelease(ControlFileLock);
 }
 
+/*
+ * Count a value in one of the group commit histograms.
+ */
+static inline void
+XLogFlushHistAdd(pg_atomic_uint64 *hist, uint64 value)
+{
+	int			bucket = 0;
+
+	if (value > 0)
+		bucket = Min(pg_leftmost_one_pos64(value) + 1,
+					 XLOG_FLUSH_HIST_BUCKETS - 1);
+	pg_atomic_fetch_add_u64(&hist[bucket], 1);
+}
+
+/*
+ * Flush WAL up to at least 'upto', as a member of a flush group.
+ *
+ * We add ourselves to the list of processes waiting for a WAL flush.  The
+ * first process to add itself to an empty list becomes the group leader: it
+ * acquires WALWriteLock, detaches the list, and performs a single write and
+ * fsync that covers the requests of all members, then wakes them up.  While
+ * one leader is busy fsyncing, the next one is waiting for WALWriteLock and
+ * every process that arrives in the meantime joins its group, so under load
+ * the number of fsyncs issued is governed by how fast the device can fsync
+ * rather than by the commit rate.  This follows ProcArrayGroupClearXid().
+ *
+ * All insertions up to 'upto' must have finished already; the leader cannot
+ * wait for them on our behalf while holding WALWriteLock.  The caller must
+ * be in a critical section, so that an error in the leader cannot leave its
+ * followers asleep forever.
+ */
+static void
+XLogFlushGroup(XLogRecPtr upto)
+{
+	PGPROC	   *proc = MyProc;
+	uint32		nextidx = INVALID_PGPROCNO;
+	uint32		wakeidx;
+	uint64		nmembers = 1;
+	XLogwrtRqst WriteRqst;
+
+	Assert(CritSectionCount > 0);
+
+	/*
+	 * Add ourselves to the list of processes needing a WAL flush.  Without a
+	 * PGPROC, as in bootstrap mode, there's nobody to group with anyway.
+	 */
+	if (proc != NULL)
+	{
+		proc->walFlushGroupMember = true;
+		proc->walFlushGroupMemberLsn = upto;
+		nextidx = pg_atomic_read_u32(&XLogCtl->flushGroupFirst);
+		while (true)
+		{
+			pg_atomic_write_u32(&proc->walFlushGroupNext, nextidx);
+
+			if (pg_atomic_compare_exchange_u32(&XLogCtl->flushGroupFirst,
+											   &nextidx,
+											   (uint32) proc->pgprocno))
+				break;
+		}
+
+		/*
+		 * If the list was not empty, the leader will flush our WAL.  It is
+		 * impossible to have followers without a leader because the first
+		 * process that has added itself to the list will always have nextidx
+		 * as INVALID_PGPROCNO.
+		 */
+		if (nextidx != INVALID_PGPROCNO)
+		{
+			int			extraWaits = 0;
+
+			/* Sleep until the leader has flushed our WAL. */
+			pgstat_report_wait_start(WAIT_EVENT_WAL_FLUSH_GROUP);
+			for (;;)
+			{
+				/* acts as a read barrier */
+				PGSemaphoreLock(proc->sem);
+				if (!proc->walFlushGroupMember)
+					break;
+				extraWaits++;
+			}
+			pgstat_report_wait_end();
+
+			Assert(pg_atomic_read_u32(&proc->walFlushGroupNext) == INVALID_PGPROCNO);
+
+			/* Fix semaphore count for any absorbed wakeups */
+			while (extraWaits-- > 0)
+				PGSemaphoreUnlock(proc->sem);
+			return;
+		}
+	}
+
+	/* We are the leader.  Acquire the lock on behalf of everyone. */
+	LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
+
+	/*
+	 * Sleep before flush! By adding a delay here, we may give further
+	 * backends the opportunity to join the group; this can significantly
+	 * improve transaction throughput, at the risk of increasing transaction
+	 * latency.
+	 *
+	 * We do not sleep if enableFsync is not turned on, nor if there are fewer
+	 * than CommitSiblings other backends with active transactions.
+	 */
+	if (CommitDelay > 0 && enableFsync &&
+		MinimumActiveBackends(CommitSiblings))
+		pg_usleep(CommitDelay);
+
+	/*
+	 * Now detach the list of group members, saving a pointer to the head of
+	 * the list, and compute how far the group needs WAL flushed.  Trying to
+	 * pop elements one at a time could lead to an ABA problem.
+	 */
+	if (proc != NULL)
+	{
+		nextidx = pg_atomic_exchange_u32(&XLogCtl->flushGroupFirst,
+										 INVALID_PGPROCNO);
+		nmembers = 0;
+	}
+	wakeidx = nextidx;
+
+	while (nextidx != INVALID_PGPROCNO)
+	{
+		PGPROC	   *member = &ProcGlobal->allProcs[nextidx];
+
+		if (upto < member->walFlushGroupMemberLsn)
+			upto = member->walFlushGroupMemberLsn;
+		nmembers++;
+
+		/* Move to next proc in list. */
+		nextidx = pg_atomic_read_u32(&member->walFlushGroupNext);
+	}
+
+	/*
+	 * Try to write/flush later additions to XLOG as well.  It's generally not
+	 * safe to call WaitXLogInsertionsToFinish while holding WALWriteLock,
+	 * because an in-progress insertion might need to also grab WALWriteLock
+	 * to make progress.  But every member waited for the insertions up to its
+	 * own request to finish before joining the group, so this only moves
+	 * 'upto' further forward, without actually waiting for anyone.
+	 */
+	upto = WaitXLogInsertionsToFinish(upto);
+
+	LogwrtResult = XLogCtl->LogwrtResult;
+	if (LogwrtResult.Flush < upto)
+	{
+		instr_time	start_time;
+		instr_time	duration;
+
+		INSTR_TIME_SET_CURRENT(start_time);
+
+		WriteRqst.Write = upto;
+		WriteRqst.Flush = upto;
+		XLogWrite(WriteRqst, false);
+
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start_time);
+		XLogFlushHistAdd(XLogCtl->flushLatencyHist,
+						 INSTR_TIME_GET_MICROSEC(duration));
+		XLogFlushHistAdd(XLogCtl->groupSizeHist, nmembers);
+	}
+
+	/* We're done with the lock now. */
+	LWLockRelease(WALWriteLock);
+
+	/*
+	 * Now that we've released the lock, go back and wake everybody up.  We
+	 * don't do this under the lock so as to keep lock hold times to a
+	 * minimum.
+	 */
+	while (wakeidx != INVALID_PGPROCNO)
+	{
+		PGPROC	   *member = &ProcGlobal->allProcs[wakeidx];
+
+		wakeidx = pg_atomic_read_u32(&member->walFlushGroupNext);
+		pg_atomic_write_u32(&member->walFlushGroupNext, INVALID_PGPROCNO);
+
+		/* ensure all previous writes are visible before follower continues. */
+		pg_write_barrier();
+
+		member->walFlushGroupMember = false;
+
+		if (member != MyProc)
+			PGSemaphoreUnlock(member->sem);
+	}
+}
+
 /*
  * Ensure that all XLOG data through the given position is flushed to disk.
  *
  * NOTE: this differs from XLogWrite mainly in that the WALWriteLock is not
- * already held, and we try to avoid acquiring it if possible.
+ * already held, and we try to avoid acquiring it if possible: concurrent
+ * callers are batched into groups that are flushed by a single leader, see
+ * XLogFlushGroup().
  */
 void
 XLogFlush(XLogRecPtr record)
 {
 	XLogRecPtr	WriteRqstPtr;
-	XLogwrtRqst WriteRqst;
 
 	/*
 	 * During REDO, we are reading not writing WAL.  Therefore, instead of
@@ -2845,92 +3053,36 @@ XLogFlush(XLogRecPtr record)
 	/* initialize to given target; may increase below */
 	WriteRqstPtr = record;
 
-	/*
-	 * Now wait until we get the write lock, or someone else does the flush
-	 * for us.
-	 */
-	for (;;)
-	{
-		XLogRecPtr	insertpos;
-
-		/* read LogwrtResult and update local state */
-		SpinLockAcquire(&XLogCtl->info_lck);
-		if (WriteRqstPtr < XLogCtl->LogwrtRqst.Write)
-			WriteRqstPtr = XLogCtl->LogwrtRqst.Write;
-		LogwrtResult = XLogCtl->LogwrtResult;
-		SpinLockRelease(&XLogCtl->info_lck);
+	/* read LogwrtResult and update local state */
+	SpinLockAcquire(&XLogCtl->info_lck);
+	if (WriteRqstPtr < XLogCtl->LogwrtRqst.Write)
+		WriteRqstPtr = XLogCtl->LogwrtRqst.Write;
+	LogwrtResult = XLogCtl->LogwrtResult;
+	SpinLockRelease(&XLogCtl->info_lck);
 
-		/* done already? */
-		if (record <= LogwrtResult.Flush)
-			break;
+	if (record > LogwrtResult.Flush)
+	{
+		instr_time	start_time;
+		instr_time	duration;
 
-		/*
-		 * Before actually performing the write, wait for all in-flight
-		 * insertions to the pages we're about to write to finish.
-		 */
-		insertpos = WaitXLogInsertionsToFinish(WriteRqstPtr);
+		INSTR_TIME_SET_CURRENT(start_time);
 
 		/*
-		 * Try to get the write lock. If we can't get it immediately, wait
-		 * until it's released, and recheck if we still need to do the flush
-		 * or if the backend that held the lock did it for us already. This
-		 * helps to maintain a good rate of group committing when the system
-		 * is bottlenecked by the speed of fsyncing.
+		 * Before asking for the write, wait for all in-flight insertions to
+		 * the pages we're about to write to finish.  Then have our group
+		 * leader, possibly ourselves, write and flush them.
 		 */
-		if (!LWLockAcquireOrWait(WALWriteLock, LW_EXCLUSIVE))
-		{
-			/*
-			 * The lock is now free, but we didn't acquire it yet. Before we
-			 * do, loop back to check if someone else flushed the record for
-			 * us already.
-			 */
-			continue;
-		}
+		XLogFlushGroup(WaitXLogInsertionsToFinish(WriteRqstPtr));
 
-		/* Got the lock; recheck whether request is satisfied */
+		/* see how far the leader got */
+		SpinLockAcquire(&XLogCtl->info_lck);
 		LogwrtResult = XLogCtl->LogwrtResult;
-		if (record <= LogwrtResult.Flush)
-		{
-			LWLockRelease(WALWriteLock);
-			break;
-		}
-
-		/*
-		 * Sleep before flush! By adding a delay here, we may give further
-		 * backends the opportunity to join the backlog of group commit
-		 * followers; this can significantly improve transaction throughput,
-		 * at the risk of increasing transaction latency.
-		 *
-		 * We do not sleep if enableFsync is not turned on, nor if there are
-		 * fewer than CommitSiblings other backends with active transactions.
-		 */
-		if (CommitDelay > 0 && enableFsync &&
-			MinimumActiveBackends(CommitSiblings))
-		{
-			pg_usleep(CommitDelay);
-
-			/*
-			 * Re-check how far we can now flush the WAL. It's generally not
-			 * safe to call WaitXLogInsertionsToFinish while holding
-			 * WALWriteLock, because an in-progress insertion might need to
-			 * also grab WALWriteLock to make progress. But we know that all
-			 * the insertions up to insertpos have already finished, because
-			 * that's what the earlier WaitXLogInsertionsToFinish() returned.
-			 * We're only calling it again to allow insertpos to be moved
-			 * further forward, not to actually wait for anyone.
-			 */
-			insertpos = WaitXLogInsertionsToFinish(insertpos);
-		}
-
-		/* try to write/flush later additions to XLOG as well */
-		WriteRqst.Write = insertpos;
-		WriteRqst.Flush = insertpos;
-
-		XLogWrite(WriteRqst, false);
+		SpinLockRelease(&XLogCtl->info_lck);
 
-		LWLockRelease(WALWriteLock);
-		/* done */
-		break;
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start_time);
+		XLogFlushHistAdd(XLogCtl->waitLatencyHist,
+						 INSTR_TIME_GET_MICROSEC(duration));
 	}
 
 	END_CRIT_SECTION();
@@ -4868,6 +5020,56 @@ XLOGChooseNumBuffers(void)
 	return xbuffers;
 }
 
+/*
+ * Auto-tune the number of WAL insertion locks.
+ *
+ * With too few locks, inserters queue up behind each other on a machine with
+ * many CPUs; with too many, WaitXLogInsertionsToFinish() spends more time
+ * scanning them.  Use one lock per four CPUs, with the historical value of 8
+ * as a minimum.
+ */
+static int
+XLOGChooseNumInsertLocks(void)
+{
+	int			nlocks = 8;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	long		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncpus / 4 > nlocks)
+		nlocks = (int) Min(ncpus / 4, 128);
+#endif
+
+	return nlocks;
+}
+
+/*
+ * GUC check_hook for wal_insert_locks
+ */
+bool
+check_wal_insert_locks(int *newval, void **extra, GucSource source)
+{
+	/*
+	 * -1 indicates a request for auto-tune.  As with wal_buffers, leave the
+	 * boot_val alone until XLOGShmemSize is called.
+	 */
+	if (*newval == -1)
+	{
+		if (wal_insert_locks == -1)
+			return true;
+
+		*newval = XLOGChooseNumInsertLocks();
+	}
+
+	if (*newval == 0)
+	{
+		GUC_check_errdetail("\"wal_insert_locks\" must be -1 or at least 1.");
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * GUC check_hook for wal_buffers
  */
@@ -4946,11 +5148,22 @@ XLOGShmemSize(void)
 	}
 	Assert(XLOGbuffers > 0);
 
+	/* Likewise for wal_insert_locks */
+	if (wal_insert_locks == -1)
+	{
+		char		buf[32];
+
+		snprintf(buf, sizeof(buf), "%d", XLOGChooseNumInsertLocks());
+		SetConfigOption("wal_insert_locks", buf, PGC_POSTMASTER,
+						PGC_S_OVERRIDE);
+	}
+	Assert(wal_insert_locks > 0);
+
 	/* XLogCtl */
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
-	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), wal_insert_locks + 1));
 	/* xlblocks array */
 	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
@@ -5042,10 +5255,10 @@ XLOGShmemInit(void)
 		((uintptr_t) allocptr) % sizeof(WALInsertLockPadded);
 	WALInsertLocks = XLogCtl->Insert.WALInsertLocks =
 		(WALInsertLockPadded *) allocptr;
-	allocptr += sizeof(WALInsertLockPadded) * NUM_XLOGINSERT_LOCKS;
+	allocptr += sizeof(WALInsertLockPadded) * wal_insert_locks;
 
 	LWLockRegisterTranche(LWTRANCHE_WAL_INSERT, "wal_insert");
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		LWLockInitialize(&WALInsertLocks[i].l.lock, LWTRANCHE_WAL_INSERT);
 		WALInsertLocks[i].l.insertingAt = InvalidXLogRecPtr;
@@ -5071,6 +5284,13 @@ XLOGShmemInit(void)
 	XLogCtl->WalWriterSleeping = false;
 
 	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
+	pg_atomic_init_u32(&XLogCtl->flushGroupFirst, INVALID_PGPROCNO);
+	for (i = 0; i < XLOG_FLUSH_HIST_BUCKETS; i++)
+	{
+		pg_atomic_init_u64(&XLogCtl->flushLatencyHist[i], 0);
+		pg_atomic_init_u64(&XLogCtl->waitLatencyHist[i], 0);
+		pg_atomic_init_u64(&XLogCtl->groupSizeHist[i], 0);
+	}
 	SpinLockInit(&XLogCtl->info_lck);
 	SpinLockInit(&XLogCtl->ulsn_lck);
 	InitSharedLatch(&XLogCtl->recoveryWakeupLatch);
@@ -5315,7 +5535,9 @@ readRecoverySignalFile(void)
 	/*
 	 * Check for recovery signal files and if found, fsync them since they
 	 * represent server state information.  We don't sweat too much about the
-	 * possibility of fsync failure, however.
+	 * possibility of fsync failure, however.  Don't open them with
+	 * get_sync_bit(): it may ask for O_DIRECT, which not every file system
+	 * supports, and the explicit fsync is all we need anyway.
 	 *
 	 * If present, standby signal file takes precedence. If neither is present
 	 * then we won't enter archive recovery.
@@ -5324,7 +5546,7 @@ readRecoverySignalFile(void)
 	{
 		int			fd;
 
-		fd = BasicOpenFilePerm(STANDBY_SIGNAL_FILE, O_RDWR | PG_BINARY | get_sync_bit(sync_method),
+		fd = BasicOpenFilePerm(STANDBY_SIGNAL_FILE, O_RDWR | PG_BINARY,
 							   S_IRUSR | S_IWUSR);
 		if (fd >= 0)
 		{
@@ -5337,7 +5559,7 @@ readRecoverySignalFile(void)
 	{
 		int			fd;
 
-		fd = BasicOpenFilePerm(RECOVERY_SIGNAL_FILE, O_RDWR | PG_BINARY | get_sync_bit(sync_method),
+		fd = BasicOpenFilePerm(RECOVERY_SIGNAL_FILE, O_RDWR | PG_BINARY,
 							   S_IRUSR | S_IWUSR);
 		if (fd >= 0)
 		{
@@ -5921,6 +6143,9 @@ recoveryPausesHere(void)
 	if (!LocalHotStandbyActive)
 		return;
 
+	/* Let queries see everything replayed so far */
+	RedoWorkersWaitAll();
+
 	ereport(LOG,
 			(errmsg("recovery has paused"),
 			 errhint("Execute pg_wal_replay_resume() to continue.")));
@@ -6767,6 +6992,14 @@ StartupXLOG(void)
 		InRecovery = true;
 	}
 
+	/*
+	 * After a clean shutdown, reload the table and function statistics that
+	 * were saved then.  If we're going to perform recovery, they may be
+	 * invalid; pgstat_reset_all() below discards them.
+	 */
+	if (!InRecovery)
+		pgstat_restore_shared_stats();
+
 	/* REDO */
 	if (InRecovery)
 	{
@@ -7051,6 +7284,7 @@ StartupXLOG(void)
 		{
 			ErrorContextCallback errcallback;
 			TimestampTz xtime;
+			XLogPrefetcher *prefetcher = NULL;
 
 			InRedo = true;
 
@@ -7129,6 +7363,24 @@ StartupXLOG(void)
 						recoveryPausesHere();
 				}
 
+				/*
+				 * Peek ahead in the WAL and initiate reads of blocks that
+				 * upcoming records will need, if enabled.
+				 */
+				if (recovery_prefetch)
+				{
+					if (prefetcher == NULL)
+						prefetcher = XLogPrefetcherAllocate(ReadRecPtr,
+															xlogreader->seg.ws_tli);
+					XLogPrefetcherReadAhead(prefetcher, ReadRecPtr,
+											xlogreader->seg.ws_tli);
+				}
+				else if (prefetcher != NULL)
+				{
+					XLogPrefetcherFree(prefetcher);
+					prefetcher = NULL;
+				}
+
 				/* Setup error traceback support for ereport() */
 				errcallback.callback = rm_redo_error_callback;
 				errcallback.arg = (void *) xlogreader;
@@ -7201,8 +7453,12 @@ StartupXLOG(void)
 					TransactionIdIsValid(record->xl_xid))
 					RecordKnownAssignedTransactionIds(record->xl_xid);
 
-				/* Now apply the WAL record itself */
-				RmgrTable[record->xl_rmid].rm_redo(xlogreader);
+				/*
+				 * Now apply the WAL record itself, or have a redo worker do
+				 * it.
+				 */
+				if (!RedoWorkersDispatch(xlogreader))
+					RmgrTable[record->xl_rmid].rm_redo(xlogreader);
 
 				/*
 				 * After redo, check whether the backup pages associated with
@@ -7271,6 +7527,12 @@ StartupXLOG(void)
 				record = ReadRecord(xlogreader, InvalidXLogRecPtr, LOG, false);
 			} while (record != NULL);
 
+			if (prefetcher != NULL)
+				XLogPrefetcherFree(prefetcher);
+
+			/* Wait for redo workers to finish, and stop them */
+			RedoWorkersShutdown();
+
 			/*
 			 * end of main redo apply loop
 			 */
@@ -8287,7 +8549,7 @@ GetLastImportantRecPtr(void)
 	XLogRecPtr	res = InvalidXLogRecPtr;
 	int			i;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		XLogRecPtr	last_important;
 
@@ -10033,10 +10295,19 @@ static int
 get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
+	int			forced_o_direct_flag = 0;
+
+	/*
+	 * With io_direct = 'wal', the user has asked for WAL to bypass the kernel
+	 * cache whatever the sync method.  The walreceiver is still excluded, as
+	 * its writes aren't aligned (see below).
+	 */
+	if ((io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess())
+		forced_o_direct_flag = PG_O_DIRECT;
 
 	/* If fsync is disabled, never open in sync mode */
 	if (!enableFsync)
-		return 0;
+		return forced_o_direct_flag;
 
 	/*
 	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
@@ -10052,7 +10323,7 @@ get_sync_bit(int method)
 	 * after its written. Also, walreceiver performs unaligned writes, which
 	 * don't work with O_DIRECT, so it is required for correctness too.
 	 */
-	if (!XLogIsNeeded() && !AmWalReceiverProcess())
+	if ((!XLogIsNeeded() && !AmWalReceiverProcess()) || forced_o_direct_flag)
 		o_direct_flag = PG_O_DIRECT;
 
 	switch (method)
@@ -10066,7 +10337,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return forced_o_direct_flag;
 #ifdef OPEN_SYNC_FLAG
 		case SYNC_METHOD_OPEN:
 			return OPEN_SYNC_FLAG | o_direct_flag;
@@ -10720,6 +10991,25 @@ get_backup_status(void)
 	return sessionBackupState;
 }
 
+/*
+ * Is the system in backup mode, because of a backup started by any session?
+ *
+ * This is used by base backup connections that send files on behalf of a
+ * backup started in another session.
+ */
+bool
+BackupModeActive(void)
+{
+	bool		result;
+
+	WALInsertLockAcquire();
+	result = (XLogCtl->Insert.exclusiveBackupState != EXCLUSIVE_BACKUP_NONE ||
+			  XLogCtl->Insert.nonExclusiveBackups > 0);
+	WALInsertLockRelease();
+
+	return result;
+}
+
 /*
  * do_pg_stop_backup
  *
@@ -11200,6 +11490,40 @@ GetXLogInsertRecPtr(void)
 	return XLogBytePosToRecPtr(current_bytepos);
 }
 
+/*
+ * Get a snapshot of the group commit histograms.  Each output array must have
+ * room for XLOG_FLUSH_HIST_BUCKETS counters.
+ */
+void
+GetXLogFlushHistogram(uint64 *flush_latency, uint64 *wait_latency,
+					  uint64 *group_size)
+{
+	int			i;
+
+	for (i = 0; i < XLOG_FLUSH_HIST_BUCKETS; i++)
+	{
+		flush_latency[i] = pg_atomic_read_u64(&XLogCtl->flushLatencyHist[i]);
+		wait_latency[i] = pg_atomic_read_u64(&XLogCtl->waitLatencyHist[i]);
+		group_size[i] = pg_atomic_read_u64(&XLogCtl->groupSizeHist[i]);
+	}
+}
+
+/*
+ * Reset the group commit histograms.  Concurrent increments may survive.
+ */
+void
+ResetXLogFlushHistogram(void)
+{
+	int			i;
+
+	for (i = 0; i < XLOG_FLUSH_HIST_BUCKETS; i++)
+	{
+		pg_atomic_write_u64(&XLogCtl->flushLatencyHist[i], 0);
+		pg_atomic_write_u64(&XLogCtl->waitLatencyHist[i], 0);
+		pg_atomic_write_u64(&XLogCtl->groupSizeHist[i], 0);
+	}
+}
+
 /*
  * Get latest WAL write pointer
  */
@@ -11347,6 +11671,17 @@ read_backup_label(XLogRecPtr *checkPointLoc, bool *backupEndRequired,
 						tli_from_file, BACKUP_LABEL_FILE)));
 	}
 
+	/*
+	 * An incremental backup lacks the blocks that didn't change since the
+	 * backup it is based on, so it can't be started by itself.
+	 */
+	if (fscanf(lfp, "INCREMENTAL FROM LSN: %X/%X\n", &hi, &lo) == 2)
+		ereport(FATAL,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("file \"%s\" indicates an incremental backup",
+						BACKUP_LABEL_FILE),
+				 errhint("Use pg_combinebackup to reconstruct a full backup from it.")));
+
 	if (ferror(lfp) || FreeFile(lfp))
 		ereport(FATAL,
 				(errcode_for_file_access(),
@@ -11441,7 +11776,7 @@ read_tablespace_map(List **tablespaces)
 /*
  * Error context callback for errors occurring during rm_redo().
  */
-static void
+void
 rm_redo_error_callback(void *arg)
 {
 	XLogReaderState *record = (XLogReaderState *) arg;
@@ -0,0 +1,681 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching support for recovery.
+ *
+ * The startup process replays WAL records one at a time, and for each data
+ * block a record references it normally has to wait for a synchronous read
+ * if the block isn't already in shared buffers.  To avoid that stall, the
+ * prefetcher decodes WAL ahead of the replay position with a second
+ * XLogReader, looks up the blocks that upcoming records reference, and
+ * initiates asynchronous reads (posix_fadvise, via PrefetchSharedBuffer)
+ * for those that are not cached.  By the time replay reaches the record,
+ * the read has hopefully completed.
+ *
+ * The read-ahead is bounded by recovery_prefetch_distance bytes of WAL and
+ * by maintenance_io_concurrency I/Os in flight.  Since the kernel gives us
+ * no completion notification, an I/O is considered to be finished once
+ * replay has moved past the record that caused it to be issued.
+ *
+ * The prefetcher reads WAL files from pg_wal only, on the timeline that
+ * replay is currently reading, and never beyond what the WAL receiver has
+ * flushed.  Whenever it can't read further, it simply waits until replay
+ * catches up and tries again; it never affects replay's own WAL reading.
+ * Segments that are restored from the archive one at a time can therefore
+ * only be prefetched from once they've been copied into pg_wal.
+ *
+ * Blocks are not prefetched if the record carries a full page image or
+ * will initialize the page, since replay won't need to read them.  Nor are
+ * blocks of relations that don't exist yet, or that are too short, because
+ * replay is going to create or extend them.  Those relations are remembered
+ * and skipped until replay passes the record that we couldn't handle.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogprefetch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "catalog/pg_control.h"
+#include "catalog/storage_xlog.h"
+#include "commands/dbcommands_xlog.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "replication/walreceiver.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/timestamp.h"
+
+/*
+ * Forget what we know about relations once this many are remembered.  Sizes
+ * can be looked up again and expired filters are useless, so this just
+ * bounds memory use.
+ */
+#define XLOGPREFETCHER_MAX_RELATIONS 1024
+
+/* GUCs */
+bool		recovery_prefetch = false;
+int			recovery_prefetch_distance = 256 * 1024;
+
+/*
+ * What we know about a relation, or about a whole database if relNode is
+ * InvalidOid.
+ */
+typedef struct XLogPrefetcherRelation
+{
+	RelFileNode rnode;			/* hash key (must be first) */
+
+	/* Don't prefetch blocks until replay has passed this LSN */
+	XLogRecPtr	filter_until_replayed;
+
+	/* Size of each fork as last seen, or InvalidBlockNumber if not known */
+	BlockNumber nblocks[MAX_FORKNUM + 1];
+} XLogPrefetcherRelation;
+
+struct XLogPrefetcher
+{
+	/* Reader and current read position */
+	XLogReaderState *reader;
+	TimeLineID	tli;			/* timeline of the WAL files we read */
+	XLogRecPtr	next_read_lsn;	/* where to restart, or invalid to go on */
+	bool		have_record;	/* reader holds a record still to scan? */
+	int			next_block_id;	/* next block reference to scan in it */
+
+	/* Relations that are filtered or whose size we know */
+	HTAB	   *relations;
+	XLogRecPtr	replaying_lsn;	/* replay position as of last call */
+
+	/* The last block we looked at, to skip repeated references */
+	RelFileNode last_rnode;
+	ForkNumber	last_forknum;
+	BlockNumber last_blkno;
+
+	/* LSNs of records whose prefetches may still be in flight */
+	XLogRecPtr	inflight[MAX_IO_CONCURRENCY];
+	int			inflight_head;
+	int			inflight_count;
+
+	/* Last reset request we've acted on */
+	uint32		reset_request;
+};
+
+/*
+ * Statistics, shown in pg_stat_recovery_prefetch.  The counters are only
+ * written by the startup process.  Other processes ask it to reset them
+ * while recovery is in progress.
+ */
+typedef struct XLogPrefetchStats
+{
+	pg_atomic_uint64 reset_time;	/* time of last reset */
+	pg_atomic_uint32 reset_request; /* incremented to request a reset */
+	pg_atomic_uint64 prefetch;	/* prefetches initiated */
+	pg_atomic_uint64 hit;		/* blocks already in shared buffers */
+	pg_atomic_uint64 skip_init; /* blocks that redo will zero-initialize */
+	pg_atomic_uint64 skip_new;	/* blocks of missing or too short relations */
+	pg_atomic_uint64 skip_fpw;	/* blocks with a full page image */
+	pg_atomic_uint64 skip_rep;	/* repeated references to the same block */
+
+	/* Current values, not counters */
+	int			wal_distance;	/* WAL bytes decoded ahead of replay */
+	int			io_depth;		/* prefetches currently in flight */
+} XLogPrefetchStats;
+
+static XLogPrefetchStats *SharedStats = NULL;
+
+static int	XLogPrefetcherPageRead(XLogReaderState *reader,
+								   XLogRecPtr targetPagePtr, int reqLen,
+								   XLogRecPtr targetRecPtr, char *readBuf);
+static void XLogPrefetcherRestart(XLogPrefetcher *prefetcher,
+								  XLogRecPtr lsn);
+static void XLogPrefetcherTrim(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherFilter(XLogPrefetcher *prefetcher,
+								 RelFileNode rnode, XLogRecPtr lsn);
+static void XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher);
+static bool XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher,
+									 XLogRecPtr replaying_lsn);
+static void XLogPrefetcherResetStats(void);
+
+/*
+ * Counters are only ever incremented by the startup process, so there's no
+ * need for an atomic read-modify-write.
+ */
+static inline void
+XLogPrefetchIncrement(pg_atomic_uint64 *counter)
+{
+	Assert(AmStartupProcess() || !IsUnderPostmaster);
+	pg_atomic_write_u64(counter, pg_atomic_read_u64(counter) + 1);
+}
+
+/*
+ * Report shared-memory space needed by XLogPrefetchShmemInit.
+ */
+Size
+XLogPrefetchShmemSize(void)
+{
+	return sizeof(XLogPrefetchStats);
+}
+
+/*
+ * Initialize the shared-memory prefetch statistics.
+ */
+void
+XLogPrefetchShmemInit(void)
+{
+	bool		found;
+
+	SharedStats = (XLogPrefetchStats *)
+		ShmemInitStruct("XLogPrefetchStats",
+						XLogPrefetchShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		pg_atomic_init_u64(&SharedStats->reset_time, GetCurrentTimestamp());
+		pg_atomic_init_u32(&SharedStats->reset_request, 0);
+		pg_atomic_init_u64(&SharedStats->prefetch, 0);
+		pg_atomic_init_u64(&SharedStats->hit, 0);
+		pg_atomic_init_u64(&SharedStats->skip_init, 0);
+		pg_atomic_init_u64(&SharedStats->skip_new, 0);
+		pg_atomic_init_u64(&SharedStats->skip_fpw, 0);
+		pg_atomic_init_u64(&SharedStats->skip_rep, 0);
+		SharedStats->wal_distance = 0;
+		SharedStats->io_depth = 0;
+	}
+}
+
+/*
+ * Reset the prefetch statistics.  While recovery is in progress, the startup
+ * process does that the next time it looks ahead.
+ */
+void
+XLogPrefetchRequestReset(void)
+{
+	if (RecoveryInProgress())
+		pg_atomic_fetch_add_u32(&SharedStats->reset_request, 1);
+	else
+		XLogPrefetcherResetStats();
+}
+
+static void
+XLogPrefetcherResetStats(void)
+{
+	pg_atomic_write_u64(&SharedStats->reset_time, GetCurrentTimestamp());
+	pg_atomic_write_u64(&SharedStats->prefetch, 0);
+	pg_atomic_write_u64(&SharedStats->hit, 0);
+	pg_atomic_write_u64(&SharedStats->skip_init, 0);
+	pg_atomic_write_u64(&SharedStats->skip_new, 0);
+	pg_atomic_write_u64(&SharedStats->skip_fpw, 0);
+	pg_atomic_write_u64(&SharedStats->skip_rep, 0);
+}
+
+/*
+ * Create a prefetcher that starts decoding at the record at 'lsn', reading
+ * WAL files of timeline 'tli'.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(XLogRecPtr lsn, TimeLineID tli)
+{
+	XLogPrefetcher *prefetcher;
+	HASHCTL		hash_ctl;
+
+	prefetcher = palloc0(sizeof(XLogPrefetcher));
+	prefetcher->reader = XLogReaderAllocate(wal_segment_size, NULL,
+											XLogPrefetcherPageRead,
+											prefetcher);
+	if (prefetcher->reader == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	memset(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(RelFileNode);
+	hash_ctl.entrysize = sizeof(XLogPrefetcherRelation);
+	prefetcher->relations = hash_create("XLogPrefetcher relations",
+										XLOGPREFETCHER_MAX_RELATIONS,
+										&hash_ctl,
+										HASH_ELEM | HASH_BLOBS);
+
+	prefetcher->tli = tli;
+	prefetcher->next_read_lsn = lsn;
+	prefetcher->last_blkno = InvalidBlockNumber;
+	prefetcher->reset_request = pg_atomic_read_u32(&SharedStats->reset_request);
+
+	return prefetcher;
+}
+
+/*
+ * Destroy a prefetcher.
+ */
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	if (prefetcher->reader->seg.ws_file >= 0)
+		close(prefetcher->reader->seg.ws_file);
+	XLogReaderFree(prefetcher->reader);
+	hash_destroy(prefetcher->relations);
+	pfree(prefetcher);
+
+	SharedStats->wal_distance = 0;
+	SharedStats->io_depth = 0;
+}
+
+/*
+ * Called by the startup process before replaying the record at
+ * 'replaying_lsn', read from a file of timeline 'tli'.  Decodes ahead and
+ * initiates prefetches until we're far enough ahead or have enough I/Os in
+ * flight.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher, XLogRecPtr replaying_lsn,
+						TimeLineID tli)
+{
+	uint32		reset_request;
+
+	prefetcher->replaying_lsn = replaying_lsn;
+
+	reset_request = pg_atomic_read_u32(&SharedStats->reset_request);
+	if (reset_request != prefetcher->reset_request)
+	{
+		XLogPrefetcherResetStats();
+		prefetcher->reset_request = reset_request;
+	}
+
+	/* Forget about I/Os for records that have been replayed */
+	while (prefetcher->inflight_count > 0 &&
+		   prefetcher->inflight[prefetcher->inflight_head] < replaying_lsn)
+	{
+		prefetcher->inflight_head =
+			(prefetcher->inflight_head + 1) % MAX_IO_CONCURRENCY;
+		prefetcher->inflight_count--;
+	}
+
+	/*
+	 * If replay has moved to another timeline, start over from the current
+	 * position on that one.
+	 */
+	if (tli != prefetcher->tli)
+	{
+		prefetcher->tli = tli;
+		XLogPrefetcherRestart(prefetcher, replaying_lsn);
+	}
+
+	/*
+	 * If we stopped because the WAL wasn't available, wait for replay to
+	 * catch up before trying again.  Likewise, never look at records that
+	 * replay has already passed.
+	 */
+	if (!XLogRecPtrIsInvalid(prefetcher->next_read_lsn))
+	{
+		if (prefetcher->next_read_lsn > replaying_lsn)
+			goto done;
+		XLogPrefetcherRestart(prefetcher, replaying_lsn);
+	}
+	else if (prefetcher->reader->EndRecPtr <= replaying_lsn)
+		XLogPrefetcherRestart(prefetcher, replaying_lsn);
+
+	for (;;)
+	{
+		XLogRecord *record;
+		char	   *errormsg;
+
+		/* Finish scanning the record we had decoded, if any */
+		if (prefetcher->have_record &&
+			!XLogPrefetcherScanBlocks(prefetcher, replaying_lsn))
+			break;				/* too many I/Os in flight */
+
+		/* Are we far enough ahead? */
+		if (!XLogRecPtrIsInvalid(prefetcher->reader->EndRecPtr) &&
+			XLogRecPtrIsInvalid(prefetcher->next_read_lsn) &&
+			prefetcher->reader->EndRecPtr - replaying_lsn >=
+			recovery_prefetch_distance)
+			break;
+
+		record = XLogReadRecord(prefetcher->reader, prefetcher->next_read_lsn,
+								&errormsg);
+		if (record == NULL)
+		{
+			/*
+			 * We've run out of WAL that we can read for now.  Remember where
+			 * to restart.  The reader may have lost its position, so
+			 * restart with an explicit LSN.
+			 */
+			if (XLogRecPtrIsInvalid(prefetcher->next_read_lsn))
+				prefetcher->next_read_lsn = prefetcher->reader->EndRecPtr;
+			break;
+		}
+		prefetcher->next_read_lsn = InvalidXLogRecPtr;
+
+		XLogPrefetcherScanRecord(prefetcher);
+	}
+
+done:
+	if (XLogRecPtrIsInvalid(prefetcher->next_read_lsn) &&
+		prefetcher->reader->EndRecPtr > replaying_lsn)
+		SharedStats->wal_distance =
+			(int) Min(prefetcher->reader->EndRecPtr - replaying_lsn, INT_MAX);
+	else
+		SharedStats->wal_distance = 0;
+	SharedStats->io_depth = prefetcher->inflight_count;
+}
+
+/*
+ * Arrange for decoding to start over at the record at 'lsn'.
+ */
+static void
+XLogPrefetcherRestart(XLogPrefetcher *prefetcher, XLogRecPtr lsn)
+{
+	prefetcher->next_read_lsn = lsn;
+	prefetcher->have_record = false;
+}
+
+/*
+ * read_page callback for the prefetcher's reader.  Unlike the callback
+ * used for replay, this never waits and never fetches WAL from elsewhere.
+ */
+static int
+XLogPrefetcherPageRead(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	XLogSegNo	segno;
+	int			count = XLOG_BLCKSZ;
+	int			r;
+
+	/* While streaming, don't read beyond what's been flushed */
+	if (WalRcvStreaming())
+	{
+		XLogRecPtr	flushed = GetWalRcvWriteRecPtr(NULL, NULL);
+
+		if (targetPagePtr + reqLen > flushed)
+			return -1;
+		if (flushed - targetPagePtr < XLOG_BLCKSZ)
+			count = (int) (flushed - targetPagePtr);
+	}
+
+	XLByteToSeg(targetPagePtr, segno, wal_segment_size);
+	if (reader->seg.ws_file < 0 ||
+		reader->seg.ws_segno != segno ||
+		reader->seg.ws_tli != prefetcher->tli)
+	{
+		char		path[MAXPGPATH];
+
+		if (reader->seg.ws_file >= 0)
+			close(reader->seg.ws_file);
+
+		XLogFilePath(path, prefetcher->tli, segno, wal_segment_size);
+		reader->seg.ws_file = BasicOpenFile(path, O_RDONLY | PG_BINARY);
+		if (reader->seg.ws_file < 0)
+			return -1;
+		reader->seg.ws_segno = segno;
+		reader->seg.ws_tli = prefetcher->tli;
+	}
+
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	r = pg_pread(reader->seg.ws_file, readBuf, count,
+				 (off_t) XLogSegmentOffset(targetPagePtr, wal_segment_size));
+	pgstat_report_wait_end();
+
+	if (r != count)
+		return -1;
+
+	return count;
+}
+
+/*
+ * Make room in the relations table if it's full, by forgetting everything
+ * except filters that are still in effect.
+ */
+static void
+XLogPrefetcherTrim(XLogPrefetcher *prefetcher)
+{
+	HASH_SEQ_STATUS status;
+	XLogPrefetcherRelation *rel;
+
+	if (hash_get_num_entries(prefetcher->relations) <
+		XLOGPREFETCHER_MAX_RELATIONS)
+		return;
+
+	hash_seq_init(&status, prefetcher->relations);
+	while ((rel = hash_seq_search(&status)) != NULL)
+	{
+		if (rel->filter_until_replayed <= prefetcher->replaying_lsn)
+			hash_search(prefetcher->relations, &rel->rnode,
+						HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Don't prefetch blocks of 'rnode' until replay has passed 'lsn'.  If
+ * rnode.relNode is InvalidOid, this applies to the whole database.
+ */
+static void
+XLogPrefetcherFilter(XLogPrefetcher *prefetcher, RelFileNode rnode,
+					 XLogRecPtr lsn)
+{
+	XLogPrefetcherRelation *rel;
+	bool		found;
+	int			i;
+
+	XLogPrefetcherTrim(prefetcher);
+
+	rel = hash_search(prefetcher->relations, &rnode, HASH_ENTER, &found);
+	if (!found || rel->filter_until_replayed < lsn)
+		rel->filter_until_replayed = lsn;
+	for (i = 0; i <= MAX_FORKNUM; i++)
+		rel->nblocks[i] = InvalidBlockNumber;
+}
+
+/*
+ * Prepare to scan the block references of the record just decoded, and
+ * take note of records that create or truncate relations or databases.
+ */
+static void
+XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	uint8		rmid = XLogRecGetRmid(reader);
+	uint8		info = XLogRecGetInfo(reader) & ~XLR_INFO_MASK;
+
+	if (rmid == RM_SMGR_ID && info == XLOG_SMGR_CREATE)
+	{
+		xl_smgr_create *xlrec = (xl_smgr_create *) XLogRecGetData(reader);
+
+		XLogPrefetcherFilter(prefetcher, xlrec->rnode, reader->EndRecPtr);
+	}
+	else if (rmid == RM_SMGR_ID && info == XLOG_SMGR_TRUNCATE)
+	{
+		xl_smgr_truncate *xlrec = (xl_smgr_truncate *) XLogRecGetData(reader);
+
+		XLogPrefetcherFilter(prefetcher, xlrec->rnode, reader->EndRecPtr);
+	}
+	else if (rmid == RM_DBASE_ID && info == XLOG_DBASE_CREATE)
+	{
+		xl_dbase_create_rec *xlrec = (xl_dbase_create_rec *) XLogRecGetData(reader);
+		RelFileNode rnode;
+
+		rnode.spcNode = xlrec->tablespace_id;
+		rnode.dbNode = xlrec->db_id;
+		rnode.relNode = InvalidOid;
+		XLogPrefetcherFilter(prefetcher, rnode, reader->EndRecPtr);
+	}
+
+	prefetcher->have_record = true;
+	prefetcher->next_block_id = 0;
+}
+
+/*
+ * Initiate prefetches for the remaining block references of the current
+ * record.  Returns false if we had to stop because enough I/Os are in flight,
+ * true when the record is done.
+ */
+static bool
+XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher, XLogRecPtr replaying_lsn)
+{
+	XLogReaderState *reader = prefetcher->reader;
+
+	Assert(prefetcher->have_record);
+
+	/* Nothing to do for records that replay has already passed */
+	if (reader->EndRecPtr <= replaying_lsn)
+		prefetcher->next_block_id = reader->max_block_id + 1;
+
+	for (; prefetcher->next_block_id <= reader->max_block_id;
+		 prefetcher->next_block_id++)
+	{
+		DecodedBkpBlock *block = &reader->blocks[prefetcher->next_block_id];
+		XLogPrefetcherRelation *rel;
+		RelFileNode dbnode;
+		SMgrRelation reln;
+
+		if (!block->in_use)
+			continue;
+
+		if (prefetcher->inflight_count >=
+			Min(maintenance_io_concurrency, MAX_IO_CONCURRENCY))
+			return false;
+
+		/* Replay will restore or zero the page, so it won't read it */
+		if (block->has_image && block->apply_image)
+		{
+			XLogPrefetchIncrement(&SharedStats->skip_fpw);
+			continue;
+		}
+		if (block->flags & BKPBLOCK_WILL_INIT)
+		{
+			XLogPrefetchIncrement(&SharedStats->skip_init);
+			continue;
+		}
+
+		/* Records often touch the same block repeatedly */
+		if (RelFileNodeEquals(block->rnode, prefetcher->last_rnode) &&
+			block->forknum == prefetcher->last_forknum &&
+			block->blkno == prefetcher->last_blkno)
+		{
+			XLogPrefetchIncrement(&SharedStats->skip_rep);
+			continue;
+		}
+		prefetcher->last_rnode = block->rnode;
+		prefetcher->last_forknum = block->forknum;
+		prefetcher->last_blkno = block->blkno;
+
+		/* Is the database or relation being created or truncated? */
+		dbnode = block->rnode;
+		dbnode.relNode = InvalidOid;
+		rel = hash_search(prefetcher->relations, &dbnode, HASH_FIND, NULL);
+		if (rel != NULL && rel->filter_until_replayed > replaying_lsn)
+		{
+			XLogPrefetchIncrement(&SharedStats->skip_new);
+			continue;
+		}
+		rel = hash_search(prefetcher->relations, &block->rnode,
+						  HASH_FIND, NULL);
+		if (rel != NULL && rel->filter_until_replayed > replaying_lsn)
+		{
+			XLogPrefetchIncrement(&SharedStats->skip_new);
+			continue;
+		}
+
+		/*
+		 * Make sure the block exists, or the prefetch would fail.  The size
+		 * can only shrink by truncation, which we filter above, so a block
+		 * below the size we saw last time is known to be there.
+		 */
+		reln = smgropen(block->rnode, InvalidBackendId);
+		if (rel == NULL ||
+			rel->nblocks[block->forknum] == InvalidBlockNumber ||
+			block->blkno >= rel->nblocks[block->forknum])
+		{
+			BlockNumber nblocks;
+
+			if (!smgrexists(reln, block->forknum))
+			{
+				XLogPrefetcherFilter(prefetcher, block->rnode,
+									 reader->EndRecPtr);
+				XLogPrefetchIncrement(&SharedStats->skip_new);
+				continue;
+			}
+			nblocks = smgrnblocks(reln, block->forknum);
+			if (block->blkno >= nblocks)
+			{
+				/* Replay will extend the relation */
+				XLogPrefetcherFilter(prefetcher, block->rnode,
+									 reader->EndRecPtr);
+				XLogPrefetchIncrement(&SharedStats->skip_new);
+				continue;
+			}
+
+			if (rel == NULL)
+			{
+				int			i;
+
+				XLogPrefetcherTrim(prefetcher);
+				rel = hash_search(prefetcher->relations, &block->rnode,
+								  HASH_ENTER, NULL);
+				rel->filter_until_replayed = InvalidXLogRecPtr;
+				for (i = 0; i <= MAX_FORKNUM; i++)
+					rel->nblocks[i] = InvalidBlockNumber;
+			}
+			rel->nblocks[block->forknum] = nblocks;
+		}
+
+		if (PrefetchSharedBuffer(reln, block->forknum, block->blkno))
+		{
+			XLogPrefetchIncrement(&SharedStats->prefetch);
+			prefetcher->inflight[(prefetcher->inflight_head +
+								  prefetcher->inflight_count) %
+								 MAX_IO_CONCURRENCY] = reader->ReadRecPtr;
+			prefetcher->inflight_count++;
+		}
+		else
+			XLogPrefetchIncrement(&SharedStats->hit);
+	}
+
+	prefetcher->have_record = false;
+	return true;
+}
+
+/*
+ * SQL-callable function returning the contents of pg_stat_recovery_prefetch
+ */
+Datum
+pg_stat_get_recovery_prefetch(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_RECOVERY_PREFETCH_COLS 9
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_RECOVERY_PREFETCH_COLS];
+	bool		nulls[PG_STAT_GET_RECOVERY_PREFETCH_COLS];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	MemSet(nulls, 0, sizeof(nulls));
+
+	values[0] = TimestampTzGetDatum(pg_atomic_read_u64(&SharedStats->reset_time));
+	values[1] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->prefetch));
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->hit));
+	values[3] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->skip_init));
+	values[4] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->skip_new));
+	values[5] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->skip_fpw));
+	values[6] = Int64GetDatum(pg_atomic_read_u64(&SharedStats->skip_rep));
+	values[7] = Int32GetDatum(SharedStats->wal_distance);
+	values[8] = Int32GetDatum(SharedStats->io_depth);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
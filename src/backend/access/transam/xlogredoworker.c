@@ -0,0 +1,547 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogredoworker.c
+ *		Parallel replay of WAL records by redo workers.
+ *
+ * Once recovery has reached a consistent state, the startup process can
+ * hand records off to a set of background workers instead of replaying
+ * them itself.  Each record is sent to the worker chosen by hashing the
+ * blocks it references, so all changes to a given block are replayed by
+ * the same worker, in LSN order.  A record whose blocks hash to different
+ * workers can't be split up, so it's replayed by the startup process.
+ *
+ * Only records that a resource manager declares safe, by way of its
+ * rm_parallel_safe callback, are dispatched.  Everything else -- commit
+ * and abort records, relation creation, truncation and drops, records that
+ * resolve recovery conflicts, records of rmgrs that haven't opted in -- is
+ * an ordering barrier: the startup process waits until all workers have
+ * finished the records sent to them so far, and then replays the record
+ * itself.  Transactions therefore become visible to hot standby queries
+ * only after all of their changes have been replayed.
+ *
+ * Workers are only used after reaching consistency, so that a reference to
+ * a missing page is reported at once, as the startup process would, rather
+ * than remembered in a worker's private invalid-page table.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogredoworker.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogredoworker.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/startup.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/smgr.h"
+#include "tcop/tcopprot.h"
+#include "utils/hashutils.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+#define REDO_WORKER_MAGIC			0x52454457
+#define REDO_WORKER_KEY_SHARED		1
+#define REDO_WORKER_KEY_QUEUES		2
+
+/* Size of each worker's queue of records */
+#define REDO_WORKER_QUEUE_SIZE		(256 * 1024)
+
+/* GUCs */
+int			max_redo_workers = 0;
+
+bool		am_redo_worker = false;
+
+/*
+ * State shared between the startup process and the workers.
+ */
+typedef struct RedoWorkerShared
+{
+	int			nworkers;
+
+	/* Latch of the startup process, set when it's waiting for workers */
+	Latch	   *startup_latch;
+	pg_atomic_uint32 waiting;
+
+	/*
+	 * Incremented when the startup process replays a record that might
+	 * remove relation files, to make workers close their file descriptors.
+	 */
+	pg_atomic_uint64 smgr_generation;
+
+	/* Number of records each worker has replayed */
+	pg_atomic_uint64 applied[FLEXIBLE_ARRAY_MEMBER];
+} RedoWorkerShared;
+
+/*
+ * Header of each message sent to a worker.  The XLogRecord follows.
+ */
+typedef struct RedoWorkerMessage
+{
+	XLogRecPtr	ReadRecPtr;
+	XLogRecPtr	EndRecPtr;
+} RedoWorkerMessage;
+
+/* Startup process state */
+static bool redo_workers_disabled = false;
+static dsm_segment *redo_seg = NULL;
+static RedoWorkerShared *redo_shared = NULL;
+static BackgroundWorkerHandle **redo_handles = NULL;
+static shm_mq_handle **redo_queues = NULL;
+static uint64 *redo_dispatched = NULL;
+static bool redo_pending = false;
+
+static bool RedoWorkersStart(void);
+static bool RedoRecordDropsFiles(XLogReaderState *record);
+
+/*
+ * Launch the workers and set up their queues.  Returns false if none could
+ * be started, in which case we carry on replaying serially.
+ */
+static bool
+RedoWorkersStart(void)
+{
+	shm_toc_estimator e;
+	Size		segsize;
+	Size		sharedsize;
+	shm_toc    *toc;
+	char	   *queues;
+	BackgroundWorker worker;
+	int			nworkers;
+	int			i;
+
+	sharedsize = add_size(offsetof(RedoWorkerShared, applied),
+						  mul_size(max_redo_workers, sizeof(pg_atomic_uint64)));
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sharedsize);
+	shm_toc_estimate_chunk(&e, mul_size(max_redo_workers,
+										REDO_WORKER_QUEUE_SIZE));
+	shm_toc_estimate_keys(&e, 2);
+	segsize = shm_toc_estimate(&e);
+
+	redo_seg = dsm_create(segsize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (redo_seg == NULL)
+	{
+		ereport(LOG,
+				(errmsg("could not create shared memory segment for redo workers")));
+		return false;
+	}
+	dsm_pin_mapping(redo_seg);
+	toc = shm_toc_create(REDO_WORKER_MAGIC, dsm_segment_address(redo_seg),
+						 segsize);
+
+	redo_shared = shm_toc_allocate(toc, sharedsize);
+	redo_shared->nworkers = 0;
+	redo_shared->startup_latch = MyLatch;
+	pg_atomic_init_u32(&redo_shared->waiting, 0);
+	pg_atomic_init_u64(&redo_shared->smgr_generation, 0);
+	for (i = 0; i < max_redo_workers; i++)
+		pg_atomic_init_u64(&redo_shared->applied[i], 0);
+	shm_toc_insert(toc, REDO_WORKER_KEY_SHARED, redo_shared);
+
+	queues = shm_toc_allocate(toc, mul_size(max_redo_workers,
+											REDO_WORKER_QUEUE_SIZE));
+	shm_toc_insert(toc, REDO_WORKER_KEY_QUEUES, queues);
+
+	redo_handles = palloc0(sizeof(BackgroundWorkerHandle *) * max_redo_workers);
+	redo_queues = palloc0(sizeof(shm_mq_handle *) * max_redo_workers);
+	redo_dispatched = palloc0(sizeof(uint64) * max_redo_workers);
+
+	memset(&worker, 0, sizeof(worker));
+	snprintf(worker.bgw_type, BGW_MAXLEN, "redo worker");
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	sprintf(worker.bgw_library_name, "postgres");
+	sprintf(worker.bgw_function_name, "RedoWorkerMain");
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(redo_seg));
+	worker.bgw_notify_pid = MyProcPid;
+
+	/*
+	 * Workers are numbered consecutively from zero, so if we run out of
+	 * background worker slots, we just use fewer.
+	 */
+	for (nworkers = 0; nworkers < max_redo_workers; nworkers++)
+	{
+		shm_mq	   *mq;
+		pid_t		pid;
+
+		mq = shm_mq_create(queues + nworkers * REDO_WORKER_QUEUE_SIZE,
+						   REDO_WORKER_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+
+		snprintf(worker.bgw_name, BGW_MAXLEN, "redo worker %d", nworkers);
+		memcpy(worker.bgw_extra, &nworkers, sizeof(int));
+		if (!RegisterDynamicBackgroundWorker(&worker,
+											 &redo_handles[nworkers]))
+			break;
+		if (WaitForBackgroundWorkerStartup(redo_handles[nworkers],
+										   &pid) != BGWH_STARTED)
+		{
+			pfree(redo_handles[nworkers]);
+			redo_handles[nworkers] = NULL;
+			break;
+		}
+		redo_queues[nworkers] = shm_mq_attach(mq, redo_seg,
+											  redo_handles[nworkers]);
+	}
+
+	if (nworkers < max_redo_workers)
+		ereport(LOG,
+				(errmsg("started %d of %d redo workers",
+						nworkers, max_redo_workers),
+				 errhint("You might need to increase max_worker_processes.")));
+	else
+		ereport(DEBUG1,
+				(errmsg("started %d redo workers", nworkers)));
+
+	if (nworkers == 0)
+	{
+		dsm_detach(redo_seg);
+		redo_seg = NULL;
+		redo_shared = NULL;
+		return false;
+	}
+
+	redo_shared->nworkers = nworkers;
+	return true;
+}
+
+/*
+ * Could replaying this record remove relation files that workers might
+ * still have open?
+ */
+static bool
+RedoRecordDropsFiles(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+
+	switch (XLogRecGetRmid(record))
+	{
+		case RM_SMGR_ID:
+		case RM_DBASE_ID:
+		case RM_TBLSPC_ID:
+			return true;
+
+		case RM_XACT_ID:
+			if ((info & XLOG_XACT_OPMASK) == XLOG_XACT_COMMIT ||
+				(info & XLOG_XACT_OPMASK) == XLOG_XACT_COMMIT_PREPARED)
+			{
+				xl_xact_parsed_commit parsed;
+
+				ParseCommitRecord(info,
+								  (xl_xact_commit *) XLogRecGetData(record),
+								  &parsed);
+				return parsed.nrels > 0;
+			}
+			else if ((info & XLOG_XACT_OPMASK) == XLOG_XACT_ABORT ||
+					 (info & XLOG_XACT_OPMASK) == XLOG_XACT_ABORT_PREPARED)
+			{
+				xl_xact_parsed_abort parsed;
+
+				ParseAbortRecord(info,
+								 (xl_xact_abort *) XLogRecGetData(record),
+								 &parsed);
+				return parsed.nrels > 0;
+			}
+			return false;
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * Hand a record off to a redo worker, if possible.
+ *
+ * Returns true if a worker will replay the record.  Otherwise, waits for
+ * all workers to catch up and returns false; the caller must then replay
+ * the record itself.
+ */
+bool
+RedoWorkersDispatch(XLogReaderState *record)
+{
+	RmgrId		rmid = XLogRecGetRmid(record);
+	RedoWorkerMessage msg;
+	shm_mq_iovec iov[2];
+	shm_mq_result res;
+	int			worker = -1;
+	int			block_id;
+
+	if (max_redo_workers == 0 || redo_workers_disabled || !reachedConsistency)
+		return false;
+
+	/* Can this record be replayed by a worker, and if so, which? */
+	if (RmgrTable[rmid].rm_parallel_safe != NULL &&
+		(XLogRecGetInfo(record) & XLR_CHECK_CONSISTENCY) == 0 &&
+		RmgrTable[rmid].rm_parallel_safe(record))
+	{
+		if (redo_seg == NULL && !RedoWorkersStart())
+		{
+			redo_workers_disabled = true;
+			return false;
+		}
+
+		for (block_id = 0; block_id <= record->max_block_id; block_id++)
+		{
+			DecodedBkpBlock *block = &record->blocks[block_id];
+			uint32		hash;
+			int			w;
+
+			if (!block->in_use)
+				continue;
+
+			hash = hash_combine(hash_uint32(block->rnode.relNode),
+								hash_uint32(block->blkno));
+			hash = hash_combine(hash, hash_uint32(block->rnode.dbNode));
+			hash = hash_combine(hash, block->forknum);
+			w = hash % redo_shared->nworkers;
+
+			if (worker == -1)
+				worker = w;
+			else if (worker != w)
+			{
+				worker = -1;
+				break;
+			}
+		}
+	}
+
+	if (worker == -1)
+	{
+		/* Replay it serially, after everything dispatched before it */
+		RedoWorkersWaitAll();
+		if (redo_shared != NULL && RedoRecordDropsFiles(record))
+			pg_atomic_add_fetch_u64(&redo_shared->smgr_generation, 1);
+		return false;
+	}
+
+	msg.ReadRecPtr = record->ReadRecPtr;
+	msg.EndRecPtr = record->EndRecPtr;
+	iov[0].data = (char *) &msg;
+	iov[0].len = sizeof(msg);
+	iov[1].data = (char *) record->decoded_record;
+	iov[1].len = record->decoded_record->xl_tot_len;
+
+	res = shm_mq_sendv(redo_queues[worker], iov, 2, false);
+	if (res != SHM_MQ_SUCCESS)
+		ereport(FATAL,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("redo worker %d exited unexpectedly", worker)));
+
+	redo_dispatched[worker]++;
+	redo_pending = true;
+
+	return true;
+}
+
+/*
+ * Wait until the workers have replayed all the records sent to them.
+ */
+void
+RedoWorkersWaitAll(void)
+{
+	int			i;
+
+	if (!redo_pending)
+		return;
+
+	pg_atomic_write_u32(&redo_shared->waiting, 1);
+	pg_memory_barrier();
+
+	for (;;)
+	{
+		bool		done = true;
+
+		for (i = 0; i < redo_shared->nworkers; i++)
+		{
+			pid_t		pid;
+
+			if (pg_atomic_read_u64(&redo_shared->applied[i]) ==
+				redo_dispatched[i])
+				continue;
+
+			done = false;
+			if (GetBackgroundWorkerPid(redo_handles[i], &pid) != BGWH_STARTED)
+				ereport(FATAL,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+						 errmsg("redo worker %d exited unexpectedly", i)));
+		}
+		if (done)
+			break;
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+						 WAIT_EVENT_REDO_WORKER_BARRIER);
+		ResetLatch(MyLatch);
+		HandleStartupProcInterrupts();
+	}
+
+	pg_atomic_write_u32(&redo_shared->waiting, 0);
+	redo_pending = false;
+}
+
+/*
+ * Wait for outstanding work, then stop the workers.  Called at the end of
+ * recovery.
+ */
+void
+RedoWorkersShutdown(void)
+{
+	int			i;
+
+	if (redo_seg == NULL)
+		return;
+
+	RedoWorkersWaitAll();
+
+	/* Workers exit when they see that we've detached from their queues */
+	for (i = 0; i < redo_shared->nworkers; i++)
+		shm_mq_detach(redo_queues[i]);
+	for (i = 0; i < redo_shared->nworkers; i++)
+	{
+		WaitForBackgroundWorkerShutdown(redo_handles[i]);
+		pfree(redo_handles[i]);
+	}
+
+	dsm_detach(redo_seg);
+	redo_seg = NULL;
+	redo_shared = NULL;
+	pfree(redo_handles);
+	pfree(redo_queues);
+	pfree(redo_dispatched);
+}
+
+/*
+ * Main entry point for a redo worker.
+ */
+void
+RedoWorkerMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	RedoWorkerShared *shared;
+	char	   *queues;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	XLogReaderState *reader;
+	MemoryContext redo_context;
+	ErrorContextCallback errcallback;
+	uint64		smgr_generation = 0;
+	uint64		applied = 0;
+	int			worker;
+
+	/*
+	 * We stop when the startup process detaches from our queue, whether
+	 * it's because recovery has ended or because it's shutting down.
+	 * Exiting before that on SIGTERM would make recovery fail.
+	 */
+	pqsignal(SIGTERM, SIG_IGN);
+	BackgroundWorkerUnblockSignals();
+
+	memcpy(&worker, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(REDO_WORKER_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+	shared = shm_toc_lookup(toc, REDO_WORKER_KEY_SHARED, false);
+	queues = shm_toc_lookup(toc, REDO_WORKER_KEY_QUEUES, false);
+
+	mq = (shm_mq *) (queues + worker * REDO_WORKER_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* We replay records just like the startup process does */
+	am_redo_worker = true;
+	InRecovery = true;
+	reachedConsistency = true;
+
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "redo worker");
+	redo_context = AllocSetContextCreate(TopMemoryContext,
+										 "Redo worker",
+										 ALLOCSET_DEFAULT_SIZES);
+
+	reader = XLogReaderAllocate(wal_segment_size, NULL, NULL, NULL);
+	if (reader == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+
+	for (;;)
+	{
+		RedoWorkerMessage msg;
+		XLogRecord *record;
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+		char	   *errormsg;
+		MemoryContext oldcontext;
+
+		res = shm_mq_receive(mqh, &nbytes, &data, false);
+		if (res != SHM_MQ_SUCCESS)
+			break;
+
+		Assert(nbytes > sizeof(msg));
+		memcpy(&msg, data, sizeof(msg));
+		record = (XLogRecord *) ((char *) data + sizeof(msg));
+
+		/* Forget relations that the startup process may have dropped */
+		if (pg_atomic_read_u64(&shared->smgr_generation) != smgr_generation)
+		{
+			smgr_generation = pg_atomic_read_u64(&shared->smgr_generation);
+			smgrcloseall();
+		}
+
+		reader->ReadRecPtr = msg.ReadRecPtr;
+		reader->EndRecPtr = msg.EndRecPtr;
+		if (!DecodeXLogRecord(reader, record, &errormsg))
+			ereport(ERROR,
+					(errmsg_internal("could not decode WAL record at %X/%X: %s",
+									 (uint32) (msg.ReadRecPtr >> 32),
+									 (uint32) msg.ReadRecPtr,
+									 errormsg)));
+
+		errcallback.callback = rm_redo_error_callback;
+		errcallback.arg = (void *) reader;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		oldcontext = MemoryContextSwitchTo(redo_context);
+		RmgrTable[record->xl_rmid].rm_redo(reader);
+		MemoryContextSwitchTo(oldcontext);
+		MemoryContextReset(redo_context);
+
+		error_context_stack = errcallback.previous;
+
+		/* Tell the startup process, if it's waiting for us */
+		pg_atomic_write_u64(&shared->applied[worker], ++applied);
+		pg_memory_barrier();
+		if (pg_atomic_read_u32(&shared->waiting) != 0)
+			SetLatch(shared->startup_latch);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	proc_exit(0);
+}
@@ -22,9 +22,11 @@
 #include "access/timeline.h"
 #include "access/xlog.h"
 #include "access/xlog_internal.h"
+#include "access/xlogredoworker.h"
 #include "access/xlogutils.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "storage/lock.h"
 #include "storage/smgr.h"
 #include "utils/guc.h"
 #include "utils/hsearch.h"
@@ -440,6 +442,8 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 	BlockNumber lastblock;
 	Buffer		buffer;
 	SMgrRelation smgr;
+	LOCKTAG		tag;
+	bool		extension_locked = false;
 
 	Assert(blkno != P_NEW);
 
@@ -458,6 +462,20 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 
 	lastblock = smgrnblocks(smgr, forknum);
 
+	/*
+	 * Redo workers replay records concurrently, so they must not extend the
+	 * same relation at the same time.  Recheck the size once we hold the
+	 * lock; another worker might have extended it already.
+	 */
+	if (blkno >= lastblock && am_redo_worker &&
+		mode != RBM_NORMAL && mode != RBM_NORMAL_NO_LOG)
+	{
+		SET_LOCKTAG_RELATION_EXTEND(tag, rnode.dbNode, rnode.relNode);
+		(void) LockAcquire(&tag, ExclusiveLock, false, false);
+		extension_locked = true;
+		lastblock = smgrnblocks(smgr, forknum);
+	}
+
 	if (blkno < lastblock)
 	{
 		/* page exists in file */
@@ -476,6 +494,7 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 			return InvalidBuffer;
 		/* OK to extend the file */
 		/* we do this in recovery only - no rel-extension lock needed */
+		/* (except among redo workers, see above) */
 		Assert(InRecovery);
 		buffer = InvalidBuffer;
 		do
@@ -501,6 +520,9 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 		}
 	}
 
+	if (extension_locked)
+		LockRelease(&tag, ExclusiveLock, false);
+
 	if (mode == RBM_NORMAL)
 	{
 		/* check that page has been initialized */
@@ -80,6 +80,8 @@ static void show_upper_qual(List *qual, const char *qlabel,
 							ExplainState *es);
 static void show_sort_keys(SortState *sortstate, List *ancestors,
 						   ExplainState *es);
+static void show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+									   List *ancestors, ExplainState *es);
 static void show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 								   ExplainState *es);
 static void show_agg_keys(AggState *astate, List *ancestors,
@@ -101,7 +103,14 @@ static void show_sortorder_options(StringInfo buf, Node *sortexpr,
 static void show_tablesample(TableSampleClause *tsc, PlanState *planstate,
 							 List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
+static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
+									   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_bloom_filter(SeqScanState *sstate, List *ancestors,
+							  ExplainState *es);
+static void show_resultcache_info(ResultCacheState *rcstate, List *ancestors,
+								  ExplainState *es);
+static void show_hashagg_info(AggState *aggstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 								ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
@@ -826,6 +835,12 @@ ExplainPrintJIT(ExplainState *es, int jit_flags,
 		es->indent += 1;
 
 		ExplainPropertyInteger("Functions", NULL, ji->created_functions, es);
+		if (ji->cached_functions > 0)
+			ExplainPropertyInteger("Cached Functions", NULL,
+								   ji->cached_functions, es);
+		if (ji->evicted_functions > 0)
+			ExplainPropertyInteger("Evicted Functions", NULL,
+								   ji->evicted_functions, es);
 
 		appendStringInfoSpaces(es->str, es->indent * 2);
 		appendStringInfo(es->str, "Options: %s %s, %s %s, %s %s, %s %s\n",
@@ -852,6 +867,10 @@ ExplainPrintJIT(ExplainState *es, int jit_flags,
 	{
 		ExplainPropertyInteger("Worker Number", NULL, worker_num, es);
 		ExplainPropertyInteger("Functions", NULL, ji->created_functions, es);
+		ExplainPropertyInteger("Cached Functions", NULL,
+							   ji->cached_functions, es);
+		ExplainPropertyInteger("Evicted Functions", NULL,
+							   ji->evicted_functions, es);
 
 		ExplainOpenGroup("Options", "Options", true, es);
 		ExplainPropertyBool("Inlining", jit_flags & PGJIT_INLINE, es);
@@ -1212,9 +1231,15 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Material:
 			pname = sname = "Materialize";
 			break;
+		case T_ResultCache:
+			pname = sname = "Result Cache";
+			break;
 		case T_Sort:
 			pname = sname = "Sort";
 			break;
+		case T_IncrementalSort:
+			pname = sname = "Incremental Sort";
+			break;
 		case T_Group:
 			pname = sname = "Group";
 			break;
@@ -1642,6 +1667,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (IsA(plan, SeqScan))
+				show_bloom_filter((SeqScanState *) planstate, ancestors, es);
 			break;
 		case T_Gather:
 			{
@@ -1829,6 +1856,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			show_hashagg_info((AggState *) planstate, es);
 			break;
 		case T_Group:
 			show_group_keys(castNode(GroupState, planstate), ancestors, es);
@@ -1841,10 +1869,20 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_sort_keys(castNode(SortState, planstate), ancestors, es);
 			show_sort_info(castNode(SortState, planstate), es);
 			break;
+		case T_IncrementalSort:
+			show_incremental_sort_keys(castNode(IncrementalSortState, planstate),
+									   ancestors, es);
+			show_incremental_sort_info(castNode(IncrementalSortState, planstate),
+									   es);
+			break;
 		case T_MergeAppend:
 			show_merge_append_keys(castNode(MergeAppendState, planstate),
 								   ancestors, es);
 			break;
+		case T_ResultCache:
+			show_resultcache_info(castNode(ResultCacheState, planstate),
+								  ancestors, es);
+			break;
 		case T_Result:
 			show_upper_qual((List *) ((Result *) plan)->resconstantqual,
 							"One-Time Filter", planstate, ancestors, es);
@@ -2181,6 +2219,28 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 						 ancestors, es);
 }
 
+/*
+ * Show the sort keys for an IncrementalSort node, and which of them are
+ * presorted.
+ */
+static void
+show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+						   List *ancestors, ExplainState *es)
+{
+	IncrementalSort *plan = (IncrementalSort *) incrsortstate->ss.ps.plan;
+
+	show_sort_group_keys((PlanState *) incrsortstate, "Sort Key",
+						 plan->sort.numCols, plan->sort.sortColIdx,
+						 plan->sort.sortOperators, plan->sort.collations,
+						 plan->sort.nullsFirst,
+						 ancestors, es);
+	show_sort_group_keys((PlanState *) incrsortstate, "Presorted Key",
+						 plan->nPresortedCols, plan->sort.sortColIdx,
+						 plan->sort.sortOperators, plan->sort.collations,
+						 plan->sort.nullsFirst,
+						 ancestors, es);
+}
+
 /*
  * Likewise, for a MergeAppend node.
  */
@@ -2612,6 +2672,229 @@ show_sort_info(SortState *sortstate, ExplainState *es)
 	}
 }
 
+/*
+ * Print the statistics of one IncrementalSortInfo; worker is -1 for the
+ * leader's own statistics.
+ */
+static void
+show_incremental_sort_group_info(IncrementalSortInfo *info, int worker,
+								 ExplainState *es)
+{
+	List	   *methodNames = NIL;
+	TuplesortMethod m;
+
+	for (m = SORT_TYPE_TOP_N_HEAPSORT; m <= SORT_TYPE_EXTERNAL_MERGE; m++)
+	{
+		if (info->sortMethods & (1 << m))
+			methodNames = lappend(methodNames,
+								  (char *) tuplesort_method_name(m));
+	}
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		ListCell   *lc;
+		bool		first = true;
+
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		if (worker >= 0)
+			appendStringInfo(es->str, "Worker %d:  ", worker);
+		appendStringInfo(es->str, "Sort Groups: " INT64_FORMAT "  Sort Method",
+						 info->groupCount);
+		if (list_length(methodNames) > 1)
+			appendStringInfoChar(es->str, 's');
+		appendStringInfoString(es->str, ": ");
+		foreach(lc, methodNames)
+		{
+			if (!first)
+				appendStringInfoString(es->str, ", ");
+			appendStringInfoString(es->str, (const char *) lfirst(lc));
+			first = false;
+		}
+		if (info->maxMemorySpaceUsed > 0)
+			appendStringInfo(es->str,
+							 "  Average Memory: %ldkB  Peak Memory: %ldkB",
+							 info->totalMemorySpaceUsed / info->groupCount,
+							 info->maxMemorySpaceUsed);
+		if (info->maxDiskSpaceUsed > 0)
+			appendStringInfo(es->str,
+							 "  Average Disk: %ldkB  Peak Disk: %ldkB",
+							 info->totalDiskSpaceUsed / info->groupCount,
+							 info->maxDiskSpaceUsed);
+		appendStringInfoChar(es->str, '\n');
+	}
+	else
+	{
+		if (worker >= 0)
+			ExplainPropertyInteger("Worker Number", NULL, worker, es);
+		ExplainPropertyInteger("Sort Groups", NULL, info->groupCount, es);
+		ExplainPropertyList("Sort Methods Used", methodNames, es);
+		ExplainPropertyInteger("Average Sort Space Used (Memory)", "kB",
+							   info->totalMemorySpaceUsed / info->groupCount,
+							   es);
+		ExplainPropertyInteger("Peak Sort Space Used (Memory)", "kB",
+							   info->maxMemorySpaceUsed, es);
+		ExplainPropertyInteger("Average Sort Space Used (Disk)", "kB",
+							   info->totalDiskSpaceUsed / info->groupCount,
+							   es);
+		ExplainPropertyInteger("Peak Sort Space Used (Disk)", "kB",
+							   info->maxDiskSpaceUsed, es);
+	}
+}
+
+/*
+ * If it's EXPLAIN ANALYZE, show tuplesort stats for an incremental sort node
+ */
+static void
+show_incremental_sort_info(IncrementalSortState *incrsortstate,
+						   ExplainState *es)
+{
+	if (!es->analyze)
+		return;
+
+	if (incrsortstate->incsort_info.groupCount > 0)
+		show_incremental_sort_group_info(&incrsortstate->incsort_info, -1, es);
+
+	if (incrsortstate->shared_info != NULL)
+	{
+		int			n;
+		bool		opened_group = false;
+
+		for (n = 0; n < incrsortstate->shared_info->num_workers; n++)
+		{
+			IncrementalSortInfo *info = &incrsortstate->shared_info->sinfo[n];
+
+			if (info->groupCount == 0)
+				continue;		/* ignore any unfilled slots */
+
+			if (es->format != EXPLAIN_FORMAT_TEXT)
+			{
+				if (!opened_group)
+				{
+					ExplainOpenGroup("Workers", "Workers", false, es);
+					opened_group = true;
+				}
+				ExplainOpenGroup("Worker", NULL, true, es);
+			}
+			show_incremental_sort_group_info(info, n, es);
+			if (es->format != EXPLAIN_FORMAT_TEXT)
+				ExplainCloseGroup("Worker", NULL, true, es);
+		}
+		if (opened_group)
+			ExplainCloseGroup("Workers", "Workers", false, es);
+	}
+}
+
+/*
+ * Show the join keys a sequential scan probes a hash join's Bloom filter
+ * with, and how many rows the filter removed.
+ */
+static void
+show_bloom_filter(SeqScanState *sstate, List *ancestors, ExplainState *es)
+{
+	SeqScan    *plan = (SeqScan *) sstate->ss.ps.plan;
+	ListCell   *lc;
+	List	   *context;
+	StringInfoData keystr;
+	char	   *separator = "";
+
+	if (plan->bloomkeys == NIL)
+		return;
+
+	initStringInfo(&keystr);
+
+	/* Set up deparsing context */
+	context = set_deparse_context_planstate(es->deparse_cxt,
+											(Node *) sstate,
+											ancestors);
+
+	foreach(lc, plan->bloomkeys)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		appendStringInfoString(&keystr, separator);
+		appendStringInfoString(&keystr, deparse_expression(expr, context,
+														   es->verbose, false));
+		separator = ", ";
+	}
+
+	ExplainPropertyText("Bloom Filter", keystr.data, es);
+
+	pfree(keystr.data);
+
+	show_instrumentation_count("Rows Removed by Bloom Filter", 2,
+							   (PlanState *) sstate, es);
+}
+
+/*
+ * Show the cache key of a ResultCache node, and with ANALYZE, how well the
+ * cache worked out.
+ */
+static void
+show_resultcache_info(ResultCacheState *rcstate, List *ancestors,
+					  ExplainState *es)
+{
+	Plan	   *plan = ((PlanState *) rcstate)->plan;
+	ListCell   *lc;
+	List	   *context;
+	StringInfoData keystr;
+	char	   *separator = "";
+	bool		useprefix;
+	int64		memPeakKb;
+
+	initStringInfo(&keystr);
+
+	/* Set up deparsing context */
+	context = set_deparse_context_planstate(es->deparse_cxt,
+											(Node *) rcstate,
+											ancestors);
+	useprefix = list_length(es->rtable) > 1 || es->verbose;
+
+	foreach(lc, ((ResultCache *) plan)->param_exprs)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		appendStringInfoString(&keystr, separator);
+		appendStringInfoString(&keystr, deparse_expression(expr, context,
+														   useprefix, false));
+		separator = ", ";
+	}
+
+	ExplainPropertyText("Cache Key", keystr.data, es);
+
+	pfree(keystr.data);
+
+	if (!es->analyze || rcstate->stats.cache_misses == 0)
+		return;
+
+	memPeakKb = (rcstate->stats.mem_peak + 1023) / 1024;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT
+						 "  Evictions: " UINT64_FORMAT "  Overflows: "
+						 UINT64_FORMAT "  Memory Usage: " INT64_FORMAT "kB\n",
+						 rcstate->stats.cache_hits,
+						 rcstate->stats.cache_misses,
+						 rcstate->stats.cache_evictions,
+						 rcstate->stats.cache_overflows,
+						 memPeakKb);
+	}
+	else
+	{
+		ExplainPropertyInteger("Cache Hits", NULL,
+							   rcstate->stats.cache_hits, es);
+		ExplainPropertyInteger("Cache Misses", NULL,
+							   rcstate->stats.cache_misses, es);
+		ExplainPropertyInteger("Cache Evictions", NULL,
+							   rcstate->stats.cache_evictions, es);
+		ExplainPropertyInteger("Cache Overflows", NULL,
+							   rcstate->stats.cache_overflows, es);
+		ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
+	}
+}
+
 /*
  * Show information on hash buckets/batches.
  */
@@ -2715,6 +2998,41 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * Show information on hash aggregate memory usage and batches.
+ */
+static void
+show_hashagg_info(AggState *aggstate, ExplainState *es)
+{
+	Agg		   *agg = (Agg *) aggstate->ss.ps.plan;
+	long		memPeakKb = (aggstate->hash_mem_peak + 1023) / 1024;
+
+	if (!es->analyze)
+		return;
+
+	if (agg->aggstrategy != AGG_HASHED &&
+		agg->aggstrategy != AGG_MIXED)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
+		ExplainPropertyInteger("Disk Usage", "kB",
+							   aggstate->hash_disk_used, es);
+		ExplainPropertyInteger("HashAgg Batches", NULL,
+							   aggstate->hash_batches_used, es);
+	}
+	else if (aggstate->hash_batches_used > 0)
+	{
+		/* only mention spilling in text format if it actually happened */
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Batches: %d  Memory Usage: %ldkB  Disk Usage: " UINT64_FORMAT "kB\n",
+						 aggstate->hash_batches_used, memPeakKb,
+						 aggstate->hash_disk_used);
+	}
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show exact/lossy pages for a BitmapHeapScan node
  */
@@ -79,7 +79,8 @@ static void ExecInitCoerceToDomain(ExprEvalStep *scratch, CoerceToDomain *ctest,
 static void ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 								  ExprEvalStep *scratch,
 								  FunctionCallInfo fcinfo, AggStatePerTrans pertrans,
-								  int transno, int setno, int setoff, bool ishash);
+								  int transno, int setno, int setoff, bool ishash,
+								  bool nullcheck);
 
 
 /*
@@ -2924,10 +2925,16 @@ ExecInitCoerceToDomain(ExprEvalStep *scratch, CoerceToDomain *ctest,
  * check for filters, evaluate aggregate input, check that that input is not
  * NULL for a strict transition function, and then finally invoke the
  * transition for each of the concurrently computed grouping sets.
+ *
+ * If nullcheck is true, the generated code will check for a NULL pointer to
+ * the array of AggStatePerGroup structs for each hashed grouping set, and
+ * skip evaluation of that set's transitions if it is NULL.  Hash aggregation
+ * relies on that once it has run out of memory and starts spilling input
+ * tuples to disk.
  */
 ExprState *
 ExecBuildAggTrans(AggState *aggstate, AggStatePerPhase phase,
-				  bool doSort, bool doHash)
+				  bool doSort, bool doHash, bool nullcheck)
 {
 	ExprState  *state = makeNode(ExprState);
 	PlanState  *parent = &aggstate->ss.ps;
@@ -3160,7 +3167,8 @@ ExecBuildAggTrans(AggState *aggstate, AggStatePerPhase phase,
 			for (setno = 0; setno < processGroupingSets; setno++)
 			{
 				ExecBuildAggTransCall(state, aggstate, &scratch, trans_fcinfo,
-									  pertrans, transno, setno, setoff, false);
+									  pertrans, transno, setno, setoff, false,
+									  false);
 				setoff++;
 			}
 		}
@@ -3178,7 +3186,8 @@ ExecBuildAggTrans(AggState *aggstate, AggStatePerPhase phase,
 			for (setno = 0; setno < numHashes; setno++)
 			{
 				ExecBuildAggTransCall(state, aggstate, &scratch, trans_fcinfo,
-									  pertrans, transno, setno, setoff, true);
+									  pertrans, transno, setno, setoff, true,
+									  nullcheck);
 				setoff++;
 			}
 		}
@@ -3226,8 +3235,10 @@ static void
 ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 					  ExprEvalStep *scratch,
 					  FunctionCallInfo fcinfo, AggStatePerTrans pertrans,
-					  int transno, int setno, int setoff, bool ishash)
+					  int transno, int setno, int setoff, bool ishash,
+					  bool nullcheck)
 {
+	int			adjust_nullcheck_jumpnull = -1;
 	int			adjust_init_jumpnull = -1;
 	int			adjust_strict_jumpnull = -1;
 	ExprContext *aggcontext;
@@ -3237,6 +3248,21 @@ ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 	else
 		aggcontext = aggstate->aggcontexts[setno];
 
+	/*
+	 * If the per-group states of this grouping set might not exist (because
+	 * the current input tuple is being spilled rather than aggregated), skip
+	 * the whole transition for it.
+	 */
+	if (nullcheck)
+	{
+		scratch->opcode = EEOP_AGG_PLAIN_PERGROUP_NULLCHECK;
+		scratch->d.agg_plain_pergroup_nullcheck.setoff = setoff;
+		/* adjust later */
+		scratch->d.agg_plain_pergroup_nullcheck.jumpnull = -1;
+		ExprEvalPushStep(state, scratch);
+		adjust_nullcheck_jumpnull = state->steps_len - 1;
+	}
+
 	/*
 	 * If the initial value for the transition state doesn't exist in the
 	 * pg_aggregate table then we will let the first non-NULL value returned
@@ -3300,6 +3326,13 @@ ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 	ExprEvalPushStep(state, scratch);
 
 	/* adjust jumps so they jump till after transition invocation */
+	if (adjust_nullcheck_jumpnull != -1)
+	{
+		ExprEvalStep *as = &state->steps[adjust_nullcheck_jumpnull];
+
+		Assert(as->d.agg_plain_pergroup_nullcheck.jumpnull == -1);
+		as->d.agg_plain_pergroup_nullcheck.jumpnull = state->steps_len;
+	}
 	if (adjust_init_jumpnull != -1)
 	{
 		ExprEvalStep *as = &state->steps[adjust_init_jumpnull];
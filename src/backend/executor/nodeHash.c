@@ -34,6 +34,7 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "lib/bloomfilter.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/atomics.h"
@@ -155,6 +156,22 @@ MultiExecPrivateHash(HashState *node)
 	hashkeys = node->hashkeys;
 	econtext = node->ps.ps_ExprContext;
 
+	/*
+	 * If a scan on the outer side of the join wants a Bloom filter, start a
+	 * fresh one, as a rescan may have changed the set of inner tuples.
+	 */
+	if (node->build_bloom)
+	{
+		MemoryContext oldcontext;
+
+		if (node->bloom)
+			bloom_free(node->bloom);
+		oldcontext = MemoryContextSwitchTo(node->ps.state->es_query_cxt);
+		node->bloom = bloom_create(Max((int64) node->ps.plan->plan_rows, 1),
+								   work_mem, 0);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
 	/*
 	 * Get all tuples from the node below the Hash node and insert into the
 	 * hash table (or temp files).
@@ -172,6 +189,10 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (node->bloom)
+				bloom_add_element(node->bloom, (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -255,6 +255,15 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					 */
 					node->hj_FirstOuterTupleSlot = NULL;
 				}
+				else if (hashNode->build_bloom)
+				{
+					/*
+					 * The outer scan filters its tuples with a Bloom filter
+					 * built along with the hash table, so it must not be
+					 * started before the hash table is complete.
+					 */
+					node->hj_FirstOuterTupleSlot = NULL;
+				}
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
 						  !node->hj_OuterNotEmpty))
@@ -703,6 +712,28 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 		hjstate->hj_HashTupleSlot = slot;
 	}
 
+	/*
+	 * If the planner asked our outer scan to skip tuples that can't have a
+	 * join partner, have the Hash node build a Bloom filter for it.  The
+	 * scan is either our outer plan or the outer plan of a Gather; in the
+	 * latter case the workers get a copy of the filter through the parallel
+	 * query's DSM, see nodeSeqscan.c.
+	 */
+	{
+		PlanState  *scanstate = outerPlanState(hjstate);
+
+		if (IsA(scanstate, GatherState))
+			scanstate = outerPlanState(scanstate);
+		if (IsA(scanstate, SeqScanState) &&
+			((SeqScan *) scanstate->plan)->bloomkeys != NIL)
+		{
+			HashState  *hashstate = (HashState *) innerPlanState(hjstate);
+
+			hashstate->build_bloom = true;
+			((SeqScanState *) scanstate)->bloom_source = hashstate;
+		}
+	}
+
 	/*
 	 * initialize child expressions
 	 */
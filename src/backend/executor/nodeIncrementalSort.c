@@ -0,0 +1,550 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeIncrementalSort.c
+ *
+ * DESCRIPTION
+ *
+ *	Incremental sort is an optimized variant of a regular sort, used when
+ *	the input is already sorted by a prefix of the requested sort keys.
+ *	For example, when a sort by (key1, key2 ... keyN) is requested and the
+ *	input is known to be sorted by (key1, key2 ... keyM), M < N, the input
+ *	can be split into groups of tuples with equal values of the first M
+ *	keys, and only those groups need to be sorted by the remaining keys.
+ *
+ *	Consider the following example.  We have input tuples consisting of two
+ *	integers (X, Y) already presorted by X, while it's required to sort
+ *	them by both X and Y.  Let the input tuples be:
+ *
+ *	(1, 5)
+ *	(1, 2)
+ *	(2, 9)
+ *	(2, 1)
+ *	(2, 5)
+ *	(3, 3)
+ *	(3, 7)
+ *
+ *	An incremental sort algorithm would split the input into the following
+ *	groups, which have equal X, and then sort them by Y individually:
+ *
+ *		(1, 5) (1, 2)
+ *		(2, 9) (2, 1) (2, 5)
+ *		(3, 3) (3, 7)
+ *
+ *	After sorting these groups and putting them altogether, we would get
+ *	the following result which is sorted by X and Y, as requested:
+ *
+ *	(1, 2)
+ *	(1, 5)
+ *	(2, 1)
+ *	(2, 5)
+ *	(2, 9)
+ *	(3, 3)
+ *	(3, 7)
+ *
+ *	Starting a tuplesort for every group would be very expensive when the
+ *	groups are small, so we instead collect at least INCSORT_MIN_BATCH_SIZE
+ *	tuples per sort, and then keep reading until the presorted keys change.
+ *	Each batch therefore consists of whole groups and is sorted on the full
+ *	set of sort keys.  Memory use is bounded by the size of a batch rather
+ *	than the whole input, and the first tuples can be returned as soon as
+ *	the first batch has been sorted, which is what makes this node useful
+ *	underneath a LIMIT.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "executor/execdebug.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/tuplesort.h"
+
+/*
+ * Minimum number of tuples to accumulate before checking for the end of a
+ * presorted group.  This amortizes the cost of setting up a tuplesort over
+ * several small groups.
+ */
+#define INCSORT_MIN_BATCH_SIZE 32
+
+
+/*
+ * Prepare an expression that checks whether two tuples have equal values
+ * in all presorted columns.
+ */
+static ExprState *
+preparePresortedEqual(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	int			nPresortedCols = plannode->nPresortedCols;
+	Oid		   *eqOperators;
+	int			i;
+
+	eqOperators = (Oid *) palloc(nPresortedCols * sizeof(Oid));
+
+	for (i = 0; i < nPresortedCols; i++)
+	{
+		Oid			sortop = plannode->sort.sortOperators[i];
+
+		eqOperators[i] = get_equality_op_for_ordering_op(sortop, NULL);
+		if (!OidIsValid(eqOperators[i]))
+			elog(ERROR, "missing equality operator for ordering operator %u",
+				 sortop);
+	}
+
+	return execTuplesMatchPrepare(ExecGetResultType(outerPlanState(node)),
+								  nPresortedCols,
+								  plannode->sort.sortColIdx,
+								  eqOperators,
+								  plannode->sort.collations,
+								  &node->ss.ps);
+}
+
+/*
+ * Check whether a fetched tuple belongs to the same presorted group as the
+ * pivot tuple.
+ */
+static bool
+isCurrentGroup(IncrementalSortState *node, TupleTableSlot *pivot,
+			   TupleTableSlot *tuple)
+{
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+
+	econtext->ecxt_innertuple = pivot;
+	econtext->ecxt_outertuple = tuple;
+
+	return ExecQualAndReset(node->presorted_eq, econtext);
+}
+
+/*
+ * Accumulate sort statistics for the batch that was just sorted.
+ */
+static void
+instrumentSortedBatch(IncrementalSortState *node)
+{
+	IncrementalSortInfo *info = &node->incsort_info;
+	TuplesortInstrumentation sort_instr;
+
+	tuplesort_get_stats((Tuplesortstate *) node->tuplesortstate, &sort_instr);
+
+	info->groupCount++;
+	info->sortMethods |= (1 << sort_instr.sortMethod);
+
+	if (sort_instr.spaceType == SORT_SPACE_TYPE_DISK)
+	{
+		info->totalDiskSpaceUsed += sort_instr.spaceUsed;
+		if (sort_instr.spaceUsed > info->maxDiskSpaceUsed)
+			info->maxDiskSpaceUsed = sort_instr.spaceUsed;
+	}
+	else
+	{
+		info->totalMemorySpaceUsed += sort_instr.spaceUsed;
+		if (sort_instr.spaceUsed > info->maxMemorySpaceUsed)
+			info->maxMemorySpaceUsed = sort_instr.spaceUsed;
+	}
+
+	if (node->shared_info && node->am_worker)
+	{
+		Assert(IsParallelWorker());
+		Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
+		memcpy(&node->shared_info->sinfo[ParallelWorkerNumber], info,
+			   sizeof(IncrementalSortInfo));
+	}
+}
+
+/*
+ * Read the next batch of tuples from the outer plan and sort it.
+ *
+ * A batch starts with the tuple read ahead at the end of the previous batch
+ * (if any), contains at least INCSORT_MIN_BATCH_SIZE tuples unless the input
+ * runs out, and then extends to the end of the presorted group that the
+ * last of those tuples belongs to.  The first tuple of the following group
+ * is stashed in transfer_tuple for the next call.
+ */
+static void
+loadSortBatch(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	Tuplesortstate *tuplesortstate;
+	int64		nTuples = 0;
+
+	SO1_printf("ExecIncrementalSort: %s\n",
+			   "loading next batch");
+
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->sort.numCols,
+										  plannode->sort.sortColIdx,
+										  plannode->sort.sortOperators,
+										  plannode->sort.collations,
+										  plannode->sort.nullsFirst,
+										  work_mem,
+										  NULL, false);
+	node->tuplesortstate = (void *) tuplesortstate;
+
+	/*
+	 * Only the tuples not yet returned are of interest, so the bound for
+	 * this batch is whatever remains of the overall bound.
+	 */
+	if (node->bounded)
+	{
+		Assert(node->bound > node->bound_Done);
+		tuplesort_set_bound(tuplesortstate, node->bound - node->bound_Done);
+	}
+
+	ExecClearTuple(node->group_pivot);
+
+	if (!TupIsNull(node->transfer_tuple))
+	{
+		tuplesort_puttupleslot(tuplesortstate, node->transfer_tuple);
+		ExecClearTuple(node->transfer_tuple);
+		nTuples++;
+	}
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+		{
+			node->outerNodeDone = true;
+			break;
+		}
+
+		if (nTuples < INCSORT_MIN_BATCH_SIZE)
+		{
+			tuplesort_puttupleslot(tuplesortstate, slot);
+			nTuples++;
+
+			/* remember the tuple that decides where this batch ends */
+			if (nTuples == INCSORT_MIN_BATCH_SIZE)
+				ExecCopySlot(node->group_pivot, slot);
+			continue;
+		}
+
+		if (!isCurrentGroup(node, node->group_pivot, slot))
+		{
+			/* first tuple of the next batch; keep it for later */
+			ExecCopySlot(node->transfer_tuple, slot);
+			break;
+		}
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+		nTuples++;
+	}
+
+	tuplesort_performsort(tuplesortstate);
+
+	if (node->ss.ps.instrument != NULL)
+		instrumentSortedBatch(node);
+
+	SO1_printf("ExecIncrementalSort: batch of " INT64_FORMAT " tuples sorted\n",
+			   nTuples);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Assuming that the outer subtree returns tuples presorted by some
+ *		prefix of the target sort columns, performs an incremental sort.
+ *		Tuples are read in batches that consist of whole presorted groups,
+ *		each batch is sorted using tuplesort, and the sorted tuples are
+ *		returned before the next batch is read.
+ *
+ *		Conditions:
+ *		  -- none.
+ *
+ *		Initial States:
+ *		  -- the outer child is prepared to return the first tuple.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecIncrementalSort(PlanState *pstate)
+{
+	IncrementalSortState *node = castNode(IncrementalSortState, pstate);
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* Incremental sort doesn't support backward scans */
+	Assert(ScanDirectionIsForward(node->ss.ps.state->es_direction));
+
+	for (;;)
+	{
+		if (node->execution_status == INCSORT_READTUPLES)
+		{
+			/*
+			 * Return the next tuple from the current batch.  We only rely on
+			 * the slot's tuple remaining valid until the next fetch from the
+			 * tuplesort.
+			 */
+			if (tuplesort_gettupleslot((Tuplesortstate *) node->tuplesortstate,
+									   true, false, slot, NULL))
+			{
+				node->bound_Done++;
+				return slot;
+			}
+
+			/* Batch exhausted; stop if there's nothing more to read */
+			if (node->outerNodeDone)
+				return ExecClearTuple(slot);
+
+			node->execution_status = INCSORT_LOADTUPLES;
+		}
+
+		loadSortBatch(node);
+		node->execution_status = INCSORT_READTUPLES;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental sort
+ *		node produced by the planner and initializes its outer subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *incrsortstate;
+	TupleDesc	outerDesc;
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "initializing sort node");
+
+	/*
+	 * Incremental sort can't be used with EXEC_FLAG_BACKWARD or
+	 * EXEC_FLAG_MARK, because the current sort state only contains one
+	 * batch of the input.
+	 */
+	Assert((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0);
+
+	/*
+	 * create state structure
+	 */
+	incrsortstate = makeNode(IncrementalSortState);
+	incrsortstate->ss.ps.plan = (Plan *) node;
+	incrsortstate->ss.ps.state = estate;
+	incrsortstate->ss.ps.ExecProcNode = ExecIncrementalSort;
+
+	incrsortstate->bounded = false;
+	incrsortstate->bound_Done = 0;
+	incrsortstate->outerNodeDone = false;
+	incrsortstate->execution_status = INCSORT_LOADTUPLES;
+	incrsortstate->tuplesortstate = NULL;
+	memset(&incrsortstate->incsort_info, 0, sizeof(IncrementalSortInfo));
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * We need an ExprContext to evaluate the presorted key comparisons.
+	 */
+	ExecAssignExprContext(estate, &incrsortstate->ss.ps);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * We shield the child node from the need to support REWIND, BACKWARD, or
+	 * MARK/RESTORE.
+	 */
+	eflags &= ~(EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK);
+
+	outerPlanState(incrsortstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * Initialize scan slot and type.
+	 */
+	ExecCreateScanSlotFromOuterPlan(estate, &incrsortstate->ss, &TTSOpsVirtual);
+
+	/*
+	 * Initialize return slot and type. No need to initialize projection info
+	 * because this node doesn't do projections.
+	 */
+	ExecInitResultTupleSlotTL(&incrsortstate->ss.ps, &TTSOpsMinimalTuple);
+	incrsortstate->ss.ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Initialize the slots used to detect group boundaries, and the
+	 * comparison of presorted columns.
+	 */
+	outerDesc = ExecGetResultType(outerPlanState(incrsortstate));
+	incrsortstate->group_pivot =
+		MakeSingleTupleTableSlot(outerDesc, &TTSOpsMinimalTuple);
+	incrsortstate->transfer_tuple =
+		MakeSingleTupleTableSlot(outerDesc, &TTSOpsMinimalTuple);
+	incrsortstate->presorted_eq = preparePresortedEqual(incrsortstate);
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "sort node initialized");
+
+	return incrsortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "shutting down sort node");
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	/* must drop standalone tuple slots from outer node */
+	ExecDropSingleTupleTableSlot(node->group_pivot);
+	ExecDropSingleTupleTableSlot(node->transfer_tuple);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "sort node shutdown");
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/*
+	 * We only ever hold one batch of the input, so there's nothing we could
+	 * replay; forget everything and re-read the subplan.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+	ExecClearTuple(node->transfer_tuple);
+
+	if (node->tuplesortstate != NULL)
+	{
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		node->tuplesortstate = NULL;
+	}
+
+	node->outerNodeDone = false;
+	node->execution_status = INCSORT_LOADTUPLES;
+	node->bound_Done = 0;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Query Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSortEstimate
+ *
+ *		Estimate space required to propagate sort statistics.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIncrementalSortEstimate(IncrementalSortState *node, ParallelContext *pcxt)
+{
+	Size		size;
+
+	/* don't need this if not instrumenting or no workers */
+	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+		return;
+
+	size = mul_size(pcxt->nworkers, sizeof(IncrementalSortInfo));
+	size = add_size(size, offsetof(SharedIncrementalSortInfo, sinfo));
+	shm_toc_estimate_chunk(&pcxt->estimator, size);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSortInitializeDSM
+ *
+ *		Initialize DSM space for sort statistics.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIncrementalSortInitializeDSM(IncrementalSortState *node, ParallelContext *pcxt)
+{
+	Size		size;
+
+	/* don't need this if not instrumenting or no workers */
+	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+		return;
+
+	size = offsetof(SharedIncrementalSortInfo, sinfo)
+		+ pcxt->nworkers * sizeof(IncrementalSortInfo);
+	node->shared_info = shm_toc_allocate(pcxt->toc, size);
+	/* ensure any unfilled slots will contain zeroes */
+	memset(node->shared_info, 0, size);
+	node->shared_info->num_workers = pcxt->nworkers;
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
+				   node->shared_info);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSortInitializeWorker
+ *
+ *		Attach worker to DSM space for sort statistics.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIncrementalSortInitializeWorker(IncrementalSortState *node,
+									ParallelWorkerContext *pwcxt)
+{
+	node->shared_info =
+		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+	node->am_worker = true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSortRetrieveInstrumentation
+ *
+ *		Transfer sort statistics from DSM to private memory.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIncrementalSortRetrieveInstrumentation(IncrementalSortState *node)
+{
+	Size		size;
+	SharedIncrementalSortInfo *si;
+
+	if (node->shared_info == NULL)
+		return;
+
+	size = offsetof(SharedIncrementalSortInfo, sinfo)
+		+ node->shared_info->num_workers * sizeof(IncrementalSortInfo);
+	si = palloc(size);
+	memcpy(si, node->shared_info, size);
+	node->shared_info = si;
+}
@@ -31,9 +31,37 @@
 #include "access/tableam.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "lib/bloomfilter.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
 #include "utils/rel.h"
 
+/*
+ * Bloom filter shared with parallel workers.
+ *
+ * If the scan's plan has bloomkeys, its chunk of the parallel query's DSM
+ * starts with this header.  It is followed by space for a copy of the filter
+ * built by the leader's Hash node, and then by the parallel scan descriptor.
+ * The filter is copied in whenever the DSM is (re)initialized, which the
+ * Gather node above us only does once the leader has built its hash table.
+ */
+typedef struct ParallelSeqScanBloom
+{
+	bool		valid;			/* does the space hold a copy of the filter? */
+	Size		size;			/* size of the space for the filter */
+} ParallelSeqScanBloom;
+
+#define ParallelSeqScanBloomFilter(shared) \
+	((bloom_filter *) ((char *) (shared) + MAXALIGN(sizeof(ParallelSeqScanBloom))))
+#define ParallelSeqScanBloomScanOffset(size) \
+	BUFFERALIGN(MAXALIGN(sizeof(ParallelSeqScanBloom)) + (size))
+
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static bloom_filter *SeqScanGetBloomFilter(SeqScanState *node);
+static bool SeqScanBloomLacks(SeqScanState *node, bloom_filter *filter,
+							  TupleTableSlot *slot);
+static Size SeqScanBloomSpace(SeqScanState *node);
+static void SeqScanShareBloom(SeqScanState *node);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -53,6 +81,7 @@ SeqNext(SeqScanState *node)
 	EState	   *estate;
 	ScanDirection direction;
 	TupleTableSlot *slot;
+	bloom_filter *filter;
 
 	/*
 	 * get information from the estate and scan state
@@ -75,13 +104,102 @@ SeqNext(SeqScanState *node)
 	}
 
 	/*
-	 * get the next tuple from the table
+	 * get the next tuple from the table, skipping those that the Bloom
+	 * filter, if any, shows to have no join partner
 	 */
-	if (table_scan_getnextslot(scandesc, direction, slot))
-		return slot;
+	filter = SeqScanGetBloomFilter(node);
+	while (table_scan_getnextslot(scandesc, direction, slot))
+	{
+		if (filter == NULL || !SeqScanBloomLacks(node, filter, slot))
+			return slot;
+
+		InstrCountFiltered2(node, 1);
+		CHECK_FOR_INTERRUPTS();
+	}
 	return NULL;
 }
 
+/*
+ * SeqScanGetBloomFilter -- get the Bloom filter to skip tuples with
+ *
+ * Returns NULL if the scan has none, or if it hasn't been built yet.  The
+ * filter of a Hash node in this process is used directly; parallel workers
+ * use the leader's copy in the DSM.
+ */
+static bloom_filter *
+SeqScanGetBloomFilter(SeqScanState *node)
+{
+	if (node->bloom_source != NULL)
+		return node->bloom_source->bloom;
+	if (node->bloom_shared != NULL && node->bloom_shared->valid)
+		return ParallelSeqScanBloomFilter(node->bloom_shared);
+	return NULL;
+}
+
+/*
+ * SeqScanBloomLacks -- can the tuple in slot be skipped?
+ *
+ * The hash value of the tuple's join keys is computed the same way as
+ * ExecHashGetHashValue computes it for the join's outer tuples, so that it
+ * can be looked up among the values the Hash node added to the filter.
+ * Returns true if the filter shows that no inner tuple has that value, or if
+ * a key is NULL and its operator strict, as the join would then discard the
+ * tuple itself.
+ */
+static bool
+SeqScanBloomLacks(SeqScanState *node, bloom_filter *filter,
+				  TupleTableSlot *slot)
+{
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	MemoryContext oldContext;
+	uint32		hashkey = 0;
+	ListCell   *lc;
+	int			i = 0;
+
+	ResetExprContext(econtext);
+	econtext->ecxt_scantuple = slot;
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	foreach(lc, node->bloom_keys)
+	{
+		ExprState  *keyexpr = (ExprState *) lfirst(lc);
+		Datum		keyval;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		keyval = ExecEvalExpr(keyexpr, econtext, &isNull);
+
+		if (isNull)
+		{
+			if (node->bloom_strict[i])
+			{
+				MemoryContextSwitchTo(oldContext);
+				return true;	/* cannot match */
+			}
+			/* else, leave hashkey unmodified, equivalent to hashcode 0 */
+		}
+		else
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1Coll(&node->bloom_hashfunctions[i],
+													node->bloom_collations[i],
+													keyval));
+			hashkey ^= hkey;
+		}
+
+		i++;
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return bloom_lacks_element(filter, (unsigned char *) &hashkey,
+							   sizeof(hashkey));
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -151,7 +269,7 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 */
 	scanstate->ss.ss_currentRelation =
 		ExecOpenScanRelation(estate,
-							 node->scanrelid,
+							 node->scan.scanrelid,
 							 eflags);
 
 	/* and create slot with the appropriate rowtype */
@@ -169,7 +287,40 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 * initialize child expressions
 	 */
 	scanstate->ss.ps.qual =
-		ExecInitQual(node->plan.qual, (PlanState *) scanstate);
+		ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
+
+	/*
+	 * If we are to skip tuples with the help of a hash join's Bloom filter,
+	 * prepare to compute the join's outer hash values for our tuples.  The
+	 * join tells us about its Hash node itself, see ExecInitHashJoin.
+	 */
+	if (node->bloomkeys != NIL)
+	{
+		int			nkeys = list_length(node->bloomkeys);
+		ListCell   *lo;
+		ListCell   *lc;
+		int			i = 0;
+
+		scanstate->bloom_keys = ExecInitExprList(node->bloomkeys,
+												 (PlanState *) scanstate);
+		scanstate->bloom_hashfunctions = palloc(nkeys * sizeof(FmgrInfo));
+		scanstate->bloom_collations = palloc(nkeys * sizeof(Oid));
+		scanstate->bloom_strict = palloc(nkeys * sizeof(bool));
+		forboth(lo, node->bloomoperators, lc, node->bloomcollations)
+		{
+			Oid			hashop = lfirst_oid(lo);
+			Oid			left_hashfn;
+			Oid			right_hashfn;
+
+			if (!get_op_hash_functions(hashop, &left_hashfn, &right_hashfn))
+				elog(ERROR, "could not find hash function for hash operator %u",
+					 hashop);
+			fmgr_info(left_hashfn, &scanstate->bloom_hashfunctions[i]);
+			scanstate->bloom_collations[i] = lfirst_oid(lc);
+			scanstate->bloom_strict[i] = op_strict(hashop);
+			i++;
+		}
+	}
 
 	return scanstate;
 }
@@ -251,10 +402,14 @@ ExecSeqScanEstimate(SeqScanState *node,
 					ParallelContext *pcxt)
 {
 	EState	   *estate = node->ss.ps.state;
+	Size		len;
 
 	node->pscan_len = table_parallelscan_estimate(node->ss.ss_currentRelation,
 												  estate->es_snapshot);
-	shm_toc_estimate_chunk(&pcxt->estimator, node->pscan_len);
+	len = node->pscan_len;
+	if (((SeqScan *) node->ss.ps.plan)->bloomkeys != NIL)
+		len += ParallelSeqScanBloomScanOffset(SeqScanBloomSpace(node));
+	shm_toc_estimate_chunk(&pcxt->estimator, len);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 }
 
@@ -271,11 +426,29 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 	EState	   *estate = node->ss.ps.state;
 	ParallelTableScanDesc pscan;
 
-	pscan = shm_toc_allocate(pcxt->toc, node->pscan_len);
+	if (((SeqScan *) node->ss.ps.plan)->bloomkeys != NIL)
+	{
+		Size		size = SeqScanBloomSpace(node);
+		char	   *chunk;
+
+		chunk = shm_toc_allocate(pcxt->toc,
+								 ParallelSeqScanBloomScanOffset(size) +
+								 node->pscan_len);
+		node->bloom_shared = (ParallelSeqScanBloom *) chunk;
+		node->bloom_shared->size = size;
+		SeqScanShareBloom(node);
+		pscan = (ParallelTableScanDesc)
+			(chunk + ParallelSeqScanBloomScanOffset(size));
+		shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, chunk);
+	}
+	else
+	{
+		pscan = shm_toc_allocate(pcxt->toc, node->pscan_len);
+		shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
+	}
 	table_parallelscan_initialize(node->ss.ss_currentRelation,
 								  pscan,
 								  estate->es_snapshot);
-	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
 }
@@ -294,6 +467,10 @@ ExecSeqScanReInitializeDSM(SeqScanState *node,
 
 	pscan = node->ss.ss_currentScanDesc->rs_parallel;
 	table_parallelscan_reinitialize(node->ss.ss_currentRelation, pscan);
+
+	/* the hash table may have been rebuilt, so share the new filter */
+	if (node->bloom_shared != NULL)
+		SeqScanShareBloom(node);
 }
 
 /* ----------------------------------------------------------------
@@ -309,6 +486,51 @@ ExecSeqScanInitializeWorker(SeqScanState *node,
 	ParallelTableScanDesc pscan;
 
 	pscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
+	if (((SeqScan *) node->ss.ps.plan)->bloomkeys != NIL)
+	{
+		char	   *chunk = (char *) pscan;
+
+		node->bloom_shared = (ParallelSeqScanBloom *) chunk;
+		pscan = (ParallelTableScanDesc)
+			(chunk + ParallelSeqScanBloomScanOffset(node->bloom_shared->size));
+	}
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
 }
+
+/*
+ * SeqScanBloomSpace -- space needed to share the Bloom filter with workers
+ *
+ * This is zero if the filter hasn't been built yet.  That happens when the
+ * hash join is itself run by the workers, each of which builds a filter of
+ * its own.
+ */
+static Size
+SeqScanBloomSpace(SeqScanState *node)
+{
+	if (node->bloom_source == NULL || node->bloom_source->bloom == NULL)
+		return 0;
+	return bloom_total_size(node->bloom_source->bloom);
+}
+
+/*
+ * SeqScanShareBloom -- copy the current Bloom filter into the DSM
+ *
+ * A filter is always created with the same size, but if it doesn't fit
+ * anyway, the workers just do without.
+ */
+static void
+SeqScanShareBloom(SeqScanState *node)
+{
+	ParallelSeqScanBloom *shared = node->bloom_shared;
+	Size		size = SeqScanBloomSpace(node);
+
+	if (size > 0 && size == shared->size)
+	{
+		memcpy(ParallelSeqScanBloomFilter(shared), node->bloom_source->bloom,
+			   size);
+		shared->valid = true;
+	}
+	else
+		shared->valid = false;
+}
@@ -39,6 +39,8 @@ bool		jit_tuple_deforming = true;
 double		jit_above_cost = 100000;
 double		jit_inline_above_cost = 500000;
 double		jit_optimize_above_cost = 500000;
+int			jit_cache_size = 0;
+int			jit_warmup_evaluations = 0;
 
 static JitProviderCallbacks provider;
 static bool provider_successfully_loaded = false;
@@ -46,6 +48,9 @@ static bool provider_failed_loading = false;
 
 
 static bool provider_init(void);
+static Datum jit_eval_warmup(ExprState *state, ExprContext *econtext,
+							 bool *isNull);
+static void jit_compile_warmup_exprs(PlanState *parent);
 static bool file_exists(const char *name);
 
 
@@ -147,7 +152,14 @@ jit_release_context(JitContext *context)
 /*
  * Ask provider to JIT compile an expression.
  *
- * Returns true if successful, false if not.
+ * If jit_warmup_evaluations is set, the expression is instead prepared to be
+ * interpreted, and only compiled once it, or another expression of the same
+ * plan node, has been evaluated that many times. That way queries whose cost
+ * has been overestimated, or that are ended early, don't pay for compiling
+ * expressions that are hardly evaluated.
+ *
+ * Returns true if successful, i.e. if the expression is ready to be
+ * evaluated, false if not.
  */
 bool
 jit_compile_expr(struct ExprState *state)
@@ -173,10 +185,95 @@ jit_compile_expr(struct ExprState *state)
 		return false;
 
 	/* this also takes !jit_enabled into account */
-	if (provider_init())
-		return provider.compile_expr(state);
+	if (!provider_init())
+		return false;
 
-	return false;
+	if (jit_warmup_evaluations > 0)
+	{
+		PlanState  *parent = state->parent;
+		MemoryContext oldcontext;
+
+		ExecReadyInterpretedExpr(state);
+
+		state->warmup_evals_left = jit_warmup_evaluations;
+		state->interp_evalfunc = state->evalfunc;
+		state->evalfunc = jit_eval_warmup;
+
+		oldcontext = MemoryContextSwitchTo(parent->state->es_query_cxt);
+		parent->jit_warmup_exprs = lappend(parent->jit_warmup_exprs, state);
+		MemoryContextSwitchTo(oldcontext);
+
+		return true;
+	}
+
+	return provider.compile_expr(state);
+}
+
+/*
+ * Evaluate an expression that is interpreted until it has been evaluated
+ * jit_warmup_evaluations times, and compile it when that's reached.
+ */
+static Datum
+jit_eval_warmup(ExprState *state, ExprContext *econtext, bool *isNull)
+{
+	Datum		result;
+
+	if (--state->warmup_evals_left <= 0)
+	{
+		jit_compile_warmup_exprs(state->parent);
+
+		return state->evalfunc(state, econtext, isNull);
+	}
+
+	result = state->interp_evalfunc(state, econtext, isNull);
+
+	/*
+	 * The interpreter replaces the evalfunc after the first evaluation, to
+	 * skip checks in later ones. Use the replacement, but keep counting,
+	 * unless the expression has been compiled in the meantime.
+	 */
+	if (state->evalfunc != jit_eval_warmup && state->warmup_evals_left > 0)
+	{
+		state->interp_evalfunc = state->evalfunc;
+		state->evalfunc = jit_eval_warmup;
+	}
+
+	return result;
+}
+
+/*
+ * Compile all expressions of a plan node that are still interpreted. Doing
+ * so at once, rather than whenever each of them reaches the threshold, lets
+ * the provider emit their code together, and avoids compiling expressions
+ * that are evaluated less often on their own later.
+ */
+static void
+jit_compile_warmup_exprs(PlanState *parent)
+{
+	List	   *exprs = parent->jit_warmup_exprs;
+	MemoryContext oldcontext;
+	ListCell   *lc;
+
+	parent->jit_warmup_exprs = NIL;
+
+	/* the compiled expressions have to live as long as the query */
+	oldcontext = MemoryContextSwitchTo(parent->state->es_query_cxt);
+
+	foreach(lc, exprs)
+	{
+		ExprState  *state = (ExprState *) lfirst(lc);
+		ExprStateEvalFunc interp_evalfunc = state->interp_evalfunc;
+
+		state->warmup_evals_left = 0;
+
+		/* if compilation failed, just keep interpreting */
+		if (!provider.compile_expr(state))
+			state->evalfunc = interp_evalfunc;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	list_free(exprs);
 }
 
 /* Aggregate JIT instrumentation information */
@@ -184,6 +281,8 @@ void
 InstrJitAgg(JitInstrumentation *dst, JitInstrumentation *add)
 {
 	dst->created_functions += add->created_functions;
+	dst->cached_functions += add->cached_functions;
+	dst->evicted_functions += add->evicted_functions;
 	INSTR_TIME_ADD(dst->generation_counter, add->generation_counter);
 	INSTR_TIME_ADD(dst->inlining_counter, add->inlining_counter);
 	INSTR_TIME_ADD(dst->optimization_counter, add->optimization_counter);
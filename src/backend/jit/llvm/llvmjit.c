@@ -30,9 +30,12 @@
 
 #include "jit/llvmjit.h"
 #include "jit/llvmjit_emit.h"
+#include "lib/ilist.h"
 #include "miscadmin.h"
 #include "portability/instr_time.h"
 #include "storage/ipc.h"
+#include "utils/hashutils.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
 
@@ -43,6 +46,39 @@ typedef struct LLVMJitHandle
 	LLVMOrcModuleHandle orc_handle;
 } LLVMJitHandle;
 
+/*
+ * Key of the backend-local cache of emitted code: a binary description of
+ * everything the code of a module depends on, see llvm_cache_module().
+ */
+typedef struct LLVMJitCacheKey
+{
+	const char *data;
+	Size		len;
+} LLVMJitCacheKey;
+
+/*
+ * Entry in the backend-local cache of emitted code.
+ *
+ * Each entry contains the code of one module. The module is only emitted the
+ * first time its code is needed. Entries used by a live context are pinned,
+ * and only unpinned entries are evicted, in LRU order.
+ */
+struct LLVMJitCacheEntry
+{
+	LLVMJitCacheKey key;		/* hash key, must be first */
+	char	   *funcname;		/* name of the function to look up */
+	int			flags;			/* PGJIT_* flags to emit the code with */
+	size_t		module_generation;	/* generation of the module */
+	LLVMModuleRef module;		/* module, until emitted */
+	LLVMJitHandle *handle;		/* handle of the emitted module */
+	void	   *addr;			/* address of emitted function, or NULL */
+	int			refcount;		/* number of contexts pinning the entry */
+	dlist_node	lru_node;		/* position in llvm_cache_lru */
+#ifdef USE_ASSERT_CHECKING
+	char	   *ir;				/* IR of the module, to cross-check keys */
+#endif
+};
+
 
 /* types & functions commonly needed for JITing */
 LLVMTypeRef TypeSizeT;
@@ -100,12 +136,21 @@ static LLVMTargetRef llvm_targetref;
 static LLVMOrcJITStackRef llvm_opt0_orc;
 static LLVMOrcJITStackRef llvm_opt3_orc;
 
+/* code cache, see llvm_cache_module() */
+static MemoryContext llvm_cache_context = NULL;
+static HTAB *llvm_cache = NULL;
+static dlist_head llvm_cache_lru = DLIST_STATIC_INIT(llvm_cache_lru);
+
 
 static void llvm_release_context(JitContext *context);
 static void llvm_session_initialize(void);
 static void llvm_shutdown(int code, Datum arg);
 static void llvm_compile_module(LLVMJitContext *context);
+static LLVMJitHandle *llvm_emit_module(LLVMJitContext *context,
+									   LLVMModuleRef module,
+									   size_t module_generation);
 static void llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef module);
+static void llvm_cache_evict(LLVMJitContext *context);
 
 static void llvm_create_types(void);
 static uint64_t llvm_resolve_symbol(const char *name, void *ctx);
@@ -187,6 +232,20 @@ llvm_release_context(JitContext *context)
 			LLVMOrcRemoveModule(jit_handle->stack, jit_handle->orc_handle);
 			pfree(jit_handle);
 		}
+
+		/* unpin cached code, and evict what's not needed anymore */
+		while (llvm_context->cache_entries != NIL)
+		{
+			LLVMJitCacheEntry *entry;
+
+			entry = (LLVMJitCacheEntry *) linitial(llvm_context->cache_entries);
+			llvm_context->cache_entries =
+				list_delete_first(llvm_context->cache_entries);
+
+			Assert(entry->refcount > 0);
+			entry->refcount--;
+		}
+		llvm_cache_evict(NULL);
 	}
 }
 
@@ -453,7 +512,7 @@ llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef module)
 	 * functions are emitted, to reduce memory usage a bit.
 	 */
 	LLVMInitializeFunctionPassManager(llvm_fpm);
-	for (func = LLVMGetFirstFunction(context->module);
+	for (func = LLVMGetFirstFunction(module);
 		 func != NULL;
 		 func = LLVMGetNextFunction(func))
 		LLVMRunFunctionPassManager(llvm_fpm, func);
@@ -474,7 +533,7 @@ llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef module)
 	if (context->base.flags & PGJIT_INLINE
 		&& !(context->base.flags & PGJIT_OPT3))
 		LLVMAddFunctionInliningPass(llvm_mpm);
-	LLVMRunPassManager(llvm_mpm, context->module);
+	LLVMRunPassManager(llvm_mpm, module);
 	LLVMDisposePassManager(llvm_mpm);
 
 	LLVMPassManagerBuilderDispose(llvm_pmb);
@@ -486,8 +545,33 @@ llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef module)
 static void
 llvm_compile_module(LLVMJitContext *context)
 {
-	LLVMOrcModuleHandle orc_handle;
+	LLVMJitHandle *handle;
 	MemoryContext oldcontext;
+
+	handle = llvm_emit_module(context, context->module,
+							  context->module_generation);
+
+	context->module = NULL;
+	context->compiled = true;
+
+	/* remember emitted code for cleanup and lookups */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	context->handles = lappend(context->handles, handle);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Inline, optimize and emit module according to the flags set in context,
+ * taking ownership of the module.
+ *
+ * Returns the handle of the emitted code, allocated in TopMemoryContext.
+ */
+static LLVMJitHandle *
+llvm_emit_module(LLVMJitContext *context, LLVMModuleRef module,
+				 size_t module_generation)
+{
+	LLVMJitHandle *handle;
+	LLVMOrcModuleHandle orc_handle;
 	static LLVMOrcJITStackRef compile_orc;
 	instr_time	starttime;
 	instr_time	endtime;
@@ -501,7 +585,7 @@ llvm_compile_module(LLVMJitContext *context)
 	if (context->base.flags & PGJIT_INLINE)
 	{
 		INSTR_TIME_SET_CURRENT(starttime);
-		llvm_inline(context->module);
+		llvm_inline(module);
 		INSTR_TIME_SET_CURRENT(endtime);
 		INSTR_TIME_ACCUM_DIFF(context->base.instr.inlining_counter,
 							  endtime, starttime);
@@ -513,15 +597,15 @@ llvm_compile_module(LLVMJitContext *context)
 
 		filename = psprintf("%u.%zu.bc",
 							MyProcPid,
-							context->module_generation);
-		LLVMWriteBitcodeToFile(context->module, filename);
+							module_generation);
+		LLVMWriteBitcodeToFile(module, filename);
 		pfree(filename);
 	}
 
 
 	/* optimize according to the chosen optimization settings */
 	INSTR_TIME_SET_CURRENT(starttime);
-	llvm_optimize_module(context, context->module);
+	llvm_optimize_module(context, module);
 	INSTR_TIME_SET_CURRENT(endtime);
 	INSTR_TIME_ACCUM_DIFF(context->base.instr.optimization_counter,
 						  endtime, starttime);
@@ -532,8 +616,8 @@ llvm_compile_module(LLVMJitContext *context)
 
 		filename = psprintf("%u.%zu.optimized.bc",
 							MyProcPid,
-							context->module_generation);
-		LLVMWriteBitcodeToFile(context->module, filename);
+							module_generation);
+		LLVMWriteBitcodeToFile(module, filename);
 		pfree(filename);
 	}
 
@@ -546,7 +630,7 @@ llvm_compile_module(LLVMJitContext *context)
 	INSTR_TIME_SET_CURRENT(starttime);
 #if LLVM_VERSION_MAJOR > 6
 	{
-		if (LLVMOrcAddEagerlyCompiledIR(compile_orc, &orc_handle, context->module,
+		if (LLVMOrcAddEagerlyCompiledIR(compile_orc, &orc_handle, module,
 										llvm_resolve_symbol, NULL))
 		{
 			elog(ERROR, "failed to JIT module");
@@ -558,7 +642,7 @@ llvm_compile_module(LLVMJitContext *context)
 	{
 		LLVMSharedModuleRef smod;
 
-		smod = LLVMOrcMakeSharedModule(context->module);
+		smod = LLVMOrcMakeSharedModule(module);
 		if (LLVMOrcAddEagerlyCompiledIR(compile_orc, &orc_handle, smod,
 										llvm_resolve_symbol, NULL))
 		{
@@ -568,30 +652,19 @@ llvm_compile_module(LLVMJitContext *context)
 	}
 #else							/* LLVM 4.0 and 3.9 */
 	{
-		orc_handle = LLVMOrcAddEagerlyCompiledIR(compile_orc, context->module,
+		orc_handle = LLVMOrcAddEagerlyCompiledIR(compile_orc, module,
 												 llvm_resolve_symbol, NULL);
-		LLVMDisposeModule(context->module);
+		LLVMDisposeModule(module);
 	}
 #endif
 	INSTR_TIME_SET_CURRENT(endtime);
 	INSTR_TIME_ACCUM_DIFF(context->base.instr.emission_counter,
 						  endtime, starttime);
 
-	context->module = NULL;
-	context->compiled = true;
-
-	/* remember emitted code for cleanup and lookups */
-	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
-	{
-		LLVMJitHandle *handle;
-
-		handle = (LLVMJitHandle *) palloc(sizeof(LLVMJitHandle));
-		handle->stack = compile_orc;
-		handle->orc_handle = orc_handle;
-
-		context->handles = lappend(context->handles, handle);
-	}
-	MemoryContextSwitchTo(oldcontext);
+	handle = (LLVMJitHandle *) MemoryContextAlloc(TopMemoryContext,
+												  sizeof(LLVMJitHandle));
+	handle->stack = compile_orc;
+	handle->orc_handle = orc_handle;
 
 	ereport(DEBUG1,
 			(errmsg("time to inline: %.3fs, opt: %.3fs, emit: %.3fs",
@@ -600,6 +673,281 @@ llvm_compile_module(LLVMJitContext *context)
 					INSTR_TIME_GET_DOUBLE(context->base.instr.emission_counter)),
 			 errhidestmt(true),
 			 errhidecontext(true)));
+
+	return handle;
+}
+
+/*
+ * Hash and comparison functions for llvm_cache, whose keys are binary
+ * strings.
+ */
+static uint32
+llvm_cache_hash(const void *key, Size keysize)
+{
+	const LLVMJitCacheKey *k = (const LLVMJitCacheKey *) key;
+
+	return DatumGetUInt32(hash_any((const unsigned char *) k->data, k->len));
+}
+
+static int
+llvm_cache_match(const void *key1, const void *key2, Size keysize)
+{
+	const LLVMJitCacheKey *k1 = (const LLVMJitCacheKey *) key1;
+	const LLVMJitCacheKey *k2 = (const LLVMJitCacheKey *) key2;
+
+	if (k1->len != k2->len)
+		return 1;
+	return memcmp(k1->data, k2->data, k1->len);
+}
+
+#ifdef USE_ASSERT_CHECKING
+/*
+ * Return the textual IR of a module, with the functions defined in it named
+ * by their position. Modules whose code is interchangeable have the same IR.
+ */
+static char *
+llvm_cache_module_ir(LLVMModuleRef mod)
+{
+	LLVMValueRef func;
+	List	   *names = NIL;
+	ListCell   *lc;
+	char	   *llvm_ir;
+	char	   *ir;
+	int			nfuncs = 0;
+
+	for (func = LLVMGetFirstFunction(mod);
+		 func != NULL;
+		 func = LLVMGetNextFunction(func))
+	{
+		char		name[NAMEDATALEN];
+
+		if (LLVMIsDeclaration(func))
+			continue;
+
+		names = lappend(names, pstrdup(LLVMGetValueName(func)));
+		snprintf(name, sizeof(name), "cached_%d", nfuncs++);
+		LLVMSetValueName(func, name);
+	}
+
+	llvm_ir = LLVMPrintModuleToString(mod);
+	ir = MemoryContextStrdup(llvm_cache_context, llvm_ir);
+	LLVMDisposeMessage(llvm_ir);
+
+	lc = list_head(names);
+	for (func = LLVMGetFirstFunction(mod);
+		 func != NULL;
+		 func = LLVMGetNextFunction(func))
+	{
+		if (LLVMIsDeclaration(func))
+			continue;
+
+		LLVMSetValueName(func, (const char *) lfirst(lc));
+		lc = lnext(names, lc);
+	}
+	list_free_deep(names);
+
+	return ir;
+}
+#endif
+
+/*
+ * Look up the code of a freshly generated module in the backend-local code
+ * cache, add it if it's not there yet, and pin the entry until context is
+ * released.
+ *
+ * The caller describes everything the module's code depends on in key, see
+ * llvm_expr_cache_key() in llvmjit_expr.c, and has to make sure that the
+ * module does not contain anything else specific to the state it has been
+ * generated for (see l_reloc_datum()). The optimization flags of the context
+ * are added to the key here. In assert-enabled builds, the module's IR is
+ * compared to that of the cached module, to catch incomplete keys.
+ *
+ * Takes ownership of the module. funcname is the name of the function that
+ * llvm_cache_get_function() returns for the entry.
+ */
+LLVMJitCacheEntry *
+llvm_cache_module(LLVMJitContext *context, StringInfo key,
+				  LLVMModuleRef mod, const char *funcname)
+{
+	LLVMJitCacheEntry *entry;
+	LLVMJitCacheKey cachekey;
+	int			flags;
+	MemoryContext oldcontext;
+
+	llvm_assert_in_fatal_section();
+
+	if (llvm_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		llvm_cache_context = AllocSetContextCreate(TopMemoryContext,
+												   "LLVM JIT code cache",
+												   ALLOCSET_DEFAULT_SIZES);
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(LLVMJitCacheKey);
+		ctl.entrysize = sizeof(LLVMJitCacheEntry);
+		ctl.hash = llvm_cache_hash;
+		ctl.match = llvm_cache_match;
+		ctl.hcxt = llvm_cache_context;
+		llvm_cache = hash_create("LLVM JIT code cache", 256, &ctl,
+								 HASH_ELEM | HASH_FUNCTION | HASH_COMPARE |
+								 HASH_CONTEXT);
+	}
+
+	flags = context->base.flags & (PGJIT_OPT3 | PGJIT_INLINE | PGJIT_DEFORM);
+	appendBinaryStringInfo(key, (char *) &flags, sizeof(flags));
+
+	cachekey.data = key->data;
+	cachekey.len = key->len;
+	entry = (LLVMJitCacheEntry *) hash_search(llvm_cache, &cachekey,
+											  HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		/* reuse the cached code, no need to emit the module */
+#ifdef USE_ASSERT_CHECKING
+		{
+			char	   *ir = llvm_cache_module_ir(mod);
+
+			Assert(strcmp(ir, entry->ir) == 0);
+			pfree(ir);
+		}
+#endif
+		LLVMDisposeModule(mod);
+		dlist_move_head(&llvm_cache_lru, &entry->lru_node);
+		context->base.instr.cached_functions++;
+	}
+	else
+	{
+		char	   *data = MemoryContextAlloc(llvm_cache_context, key->len);
+
+		memcpy(data, key->data, key->len);
+		cachekey.data = data;
+
+		entry = (LLVMJitCacheEntry *) hash_search(llvm_cache, &cachekey,
+												  HASH_ENTER, NULL);
+		entry->funcname = MemoryContextStrdup(llvm_cache_context, funcname);
+		entry->module_generation = context->module_generation;
+		entry->module = mod;
+		entry->handle = NULL;
+		entry->addr = NULL;
+		entry->refcount = 0;
+		dlist_push_head(&llvm_cache_lru, &entry->lru_node);
+#ifdef USE_ASSERT_CHECKING
+		entry->ir = llvm_cache_module_ir(mod);
+#endif
+	}
+
+	entry->refcount++;
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	context->cache_entries = lappend(context->cache_entries, entry);
+	MemoryContextSwitchTo(oldcontext);
+
+	/* the cache might have grown beyond its limit */
+	llvm_cache_evict(context);
+
+	return entry;
+}
+
+/*
+ * Return pointer to the function of a code cache entry. If the entry's
+ * module has not been emitted yet, do so first.
+ */
+void *
+llvm_cache_get_function(LLVMJitContext *context, LLVMJitCacheEntry *entry)
+{
+	LLVMOrcTargetAddress addr = 0;
+
+	llvm_assert_in_fatal_section();
+
+	if (entry->addr != NULL)
+		return entry->addr;
+
+	if (entry->handle == NULL)
+	{
+		LLVMModuleRef module = entry->module;
+
+		/* emission failed before */
+		if (module == NULL)
+			elog(ERROR, "failed to JIT module");
+
+		/* ownership passes to LLVM, even if emission fails */
+		entry->module = NULL;
+		entry->handle = llvm_emit_module(context, module,
+										 entry->module_generation);
+	}
+
+#if defined(HAVE_DECL_LLVMORCGETSYMBOLADDRESSIN) && HAVE_DECL_LLVMORCGETSYMBOLADDRESSIN
+	if (LLVMOrcGetSymbolAddressIn(entry->handle->stack, &addr,
+								  entry->handle->orc_handle, entry->funcname))
+		elog(ERROR, "failed to look up symbol \"%s\"", entry->funcname);
+#elif LLVM_VERSION_MAJOR < 5
+	addr = LLVMOrcGetSymbolAddress(entry->handle->stack, entry->funcname);
+#else
+	if (LLVMOrcGetSymbolAddress(entry->handle->stack, &addr, entry->funcname))
+		elog(ERROR, "failed to look up symbol \"%s\"", entry->funcname);
+#endif
+
+	if (!addr)
+		elog(ERROR, "failed to JIT: %s", entry->funcname);
+
+	entry->addr = (void *) (uintptr_t) addr;
+
+	return entry->addr;
+}
+
+/*
+ * Evict unpinned entries from the code cache, least recently used first,
+ * until it holds no more than jit_cache_size entries. If context is given,
+ * the evictions are counted in its instrumentation.
+ */
+static void
+llvm_cache_evict(LLVMJitContext *context)
+{
+	dlist_node *node;
+
+	if (llvm_cache == NULL || dlist_is_empty(&llvm_cache_lru))
+		return;
+
+	node = dlist_tail_node(&llvm_cache_lru);
+	while (hash_get_num_entries(llvm_cache) > jit_cache_size)
+	{
+		LLVMJitCacheEntry *entry;
+		dlist_node *prev = NULL;
+		LLVMJitCacheKey key;
+
+		entry = dlist_container(LLVMJitCacheEntry, lru_node, node);
+		if (dlist_has_prev(&llvm_cache_lru, node))
+			prev = dlist_prev_node(&llvm_cache_lru, node);
+
+		if (entry->refcount == 0)
+		{
+			if (entry->handle)
+			{
+				LLVMOrcRemoveModule(entry->handle->stack,
+									entry->handle->orc_handle);
+				pfree(entry->handle);
+			}
+			if (entry->module)
+				LLVMDisposeModule(entry->module);
+			pfree(entry->funcname);
+#ifdef USE_ASSERT_CHECKING
+			pfree(entry->ir);
+#endif
+			dlist_delete(&entry->lru_node);
+
+			key = entry->key;
+			hash_search(llvm_cache, &key, HASH_REMOVE, NULL);
+			pfree((char *) key.data);
+
+			if (context)
+				context->base.instr.evicted_functions++;
+		}
+
+		if (prev == NULL)
+			break;
+		node = prev;
+	}
 }
 
 /*
@@ -48,21 +48,51 @@
 
 typedef struct CompiledExprState
 {
+	/* relocation array, see ExprRelocs; must be first, as the code loads it */
+	Datum	   *relocs;
 	LLVMJitContext *context;
 	const char *funcname;
+	/* code cache entry containing the function, if any */
+	LLVMJitCacheEntry *entry;
 } CompiledExprState;
 
+/*
+ * Values referenced by the generated code of an expression that may be
+ * cached.
+ *
+ * Generated code usually embeds the addresses of the data it operates on,
+ * e.g. of an expression step's result, as constants. Such code cannot be
+ * reused for any other ExprState. Code that may be cached instead loads these
+ * addresses from an array of values at runtime, so that the code only
+ * depends on the structure of the expression.
+ */
+typedef struct ExprRelocs
+{
+	/* array of values loaded at runtime, NULL if values are embedded */
+	LLVMValueRef v_relocs;
+	Datum	   *values;
+	int			nvalues;
+	int			maxvalues;
+} ExprRelocs;
+
 
 static Datum ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *isNull);
 
-static LLVMValueRef BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
-								LLVMModuleRef mod, FunctionCallInfo fcinfo,
+static LLVMValueRef l_reloc_datum(ExprRelocs *relocs, LLVMBuilderRef b,
+								  Datum value);
+static LLVMValueRef l_reloc_ptr(ExprRelocs *relocs, LLVMBuilderRef b,
+								void *ptr, LLVMTypeRef type);
+static LLVMValueRef BuildV1Call(LLVMJitContext *context, ExprRelocs *relocs,
+								LLVMBuilderRef b, LLVMModuleRef mod,
+								FunctionCallInfo fcinfo,
 								LLVMValueRef *v_fcinfo_isnull);
 static void build_EvalXFunc(LLVMBuilderRef b, LLVMModuleRef mod,
-							const char *funcname,
+							ExprRelocs *relocs, const char *funcname,
 							LLVMValueRef v_state, LLVMValueRef v_econtext,
 							ExprEvalStep *op);
 static LLVMValueRef create_LifetimeEnd(LLVMModuleRef mod);
+static void llvm_expr_cache_key(ExprState *state, StringInfo key);
+static void llvm_fcinfo_cache_key(FunctionCallInfo fcinfo, StringInfo key);
 
 
 /*
@@ -76,6 +106,12 @@ llvm_compile_expr(ExprState *state)
 	char	   *funcname;
 
 	LLVMJitContext *context = NULL;
+	ExprRelocs	relocs = {0};
+
+	/* pending module of the context, while generating a cacheable module */
+	LLVMModuleRef pending_module = NULL;
+	size_t		pending_generation = 0;
+	bool		pending_compiled = false;
 
 	LLVMBuilderRef b;
 	LLVMModuleRef mod;
@@ -138,6 +174,19 @@ llvm_compile_expr(ExprState *state)
 
 	INSTR_TIME_SET_CURRENT(starttime);
 
+	/*
+	 * If the code may be cached, generate it into a module of its own, which
+	 * is looked up in the cache, and emitted, independently of the context's
+	 * other code.
+	 */
+	if (jit_cache_size > 0)
+	{
+		pending_module = context->module;
+		pending_generation = context->module_generation;
+		pending_compiled = context->compiled;
+		context->module = NULL;
+	}
+
 	mod = llvm_mutable_module(context);
 
 	b = LLVMCreateBuilder();
@@ -225,6 +274,21 @@ llvm_compile_expr(ExprState *state)
 								   FIELDNO_EXPRCONTEXT_AGGNULLS,
 								   "v.econtext.aggnulls");
 
+	/* relocation array, stored at the start of CompiledExprState */
+	if (jit_cache_size > 0)
+	{
+		LLVMValueRef v_private;
+
+		v_private = l_load_struct_gep(b, v_state,
+									  FIELDNO_EXPRSTATE_EVALFUNC_PRIVATE,
+									  "v.state.evalfunc_private");
+		relocs.v_relocs =
+			LLVMBuildLoad(b,
+						  LLVMBuildBitCast(b, v_private,
+										   l_ptr(l_ptr(TypeSizeT)), ""),
+						  "v_relocs");
+	}
+
 	/* allocate blocks for each op upfront, so we can do jumps easily */
 	opblocks = palloc(sizeof(LLVMBasicBlockRef) * state->steps_len);
 	for (i = 0; i < state->steps_len; i++)
@@ -245,8 +309,9 @@ llvm_compile_expr(ExprState *state)
 		op = &state->steps[i];
 		opcode = ExecEvalStepOp(state, op);
 
-		v_resvaluep = l_ptr_const(op->resvalue, l_ptr(TypeSizeT));
-		v_resnullp = l_ptr_const(op->resnull, l_ptr(TypeStorageBool));
+		v_resvaluep = l_reloc_ptr(&relocs, b, op->resvalue, l_ptr(TypeSizeT));
+		v_resnullp = l_reloc_ptr(&relocs, b, op->resnull,
+								 l_ptr(TypeStorageBool));
 
 		switch (opcode)
 		{
@@ -402,7 +467,8 @@ llvm_compile_expr(ExprState *state)
 						v_slot = v_scanslot;
 
 					v_params[0] = v_state;
-					v_params[1] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+					v_params[1] = l_reloc_ptr(&relocs, b, op,
+											  l_ptr(StructExprEvalStep));
 					v_params[2] = v_econtext;
 					v_params[3] = v_slot;
 
@@ -415,7 +481,7 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_WHOLEROW:
-				build_EvalXFunc(b, mod, "ExecEvalWholeRowVar",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalWholeRowVar",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -552,7 +618,8 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_constvalue,
 								v_constnull;
 
-					v_constvalue = l_sizet_const(op->d.constval.value);
+					v_constvalue = l_reloc_datum(&relocs, b,
+												 op->d.constval.value);
 					v_constnull = l_sbool_const(op->d.constval.isnull);
 
 					LLVMBuildStore(b, v_constvalue, v_resvaluep);
@@ -582,7 +649,8 @@ llvm_compile_expr(ExprState *state)
 						elog(ERROR, "argumentless strict functions are pointless");
 
 					v_fcinfo =
-						l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+						l_reloc_ptr(&relocs, b, fcinfo,
+									l_ptr(StructFunctionCallInfoData));
 
 					/*
 					 * set resnull to true, if the function is actually
@@ -635,7 +703,7 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_fcinfo_isnull;
 					LLVMValueRef v_retval;
 
-					v_retval = BuildV1Call(context, b, mod, fcinfo,
+					v_retval = BuildV1Call(context, &relocs, b, mod, fcinfo,
 										   &v_fcinfo_isnull);
 					LLVMBuildStore(b, v_retval, v_resvaluep);
 					LLVMBuildStore(b, v_fcinfo_isnull, v_resnullp);
@@ -645,14 +713,14 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_FUNCEXPR_FUSAGE:
-				build_EvalXFunc(b, mod, "ExecEvalFuncExprFusage",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalFuncExprFusage",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 
 			case EEOP_FUNCEXPR_STRICT_FUSAGE:
-				build_EvalXFunc(b, mod, "ExecEvalFuncExprStrictFusage",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalFuncExprStrictFusage",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -661,7 +729,8 @@ llvm_compile_expr(ExprState *state)
 				{
 					LLVMValueRef v_boolanynullp;
 
-					v_boolanynullp = l_ptr_const(op->d.boolexpr.anynull,
+					v_boolanynullp = l_reloc_ptr(&relocs, b,
+												 op->d.boolexpr.anynull,
 												 l_ptr(TypeStorageBool));
 					LLVMBuildStore(b, l_sbool_const(0), v_boolanynullp);
 
@@ -697,7 +766,8 @@ llvm_compile_expr(ExprState *state)
 					b_boolcont = l_bb_before_v(opblocks[i + 1],
 											   "b.%d.boolcont", i);
 
-					v_boolanynullp = l_ptr_const(op->d.boolexpr.anynull,
+					v_boolanynullp = l_reloc_ptr(&relocs, b,
+												 op->d.boolexpr.anynull,
 												 l_ptr(TypeStorageBool));
 
 					v_boolnull = LLVMBuildLoad(b, v_resnullp, "");
@@ -763,7 +833,8 @@ llvm_compile_expr(ExprState *state)
 				{
 					LLVMValueRef v_boolanynullp;
 
-					v_boolanynullp = l_ptr_const(op->d.boolexpr.anynull,
+					v_boolanynullp = l_reloc_ptr(&relocs, b,
+												 op->d.boolexpr.anynull,
 												 l_ptr(TypeStorageBool));
 					LLVMBuildStore(b, l_sbool_const(0), v_boolanynullp);
 				}
@@ -799,7 +870,8 @@ llvm_compile_expr(ExprState *state)
 					b_boolcont = l_bb_before_v(opblocks[i + 1],
 											   "b.%d.boolcont", i);
 
-					v_boolanynullp = l_ptr_const(op->d.boolexpr.anynull,
+					v_boolanynullp = l_reloc_ptr(&relocs, b,
+												 op->d.boolexpr.anynull,
 												 l_ptr(TypeStorageBool));
 
 					v_boolnull = LLVMBuildLoad(b, v_resnullp, "");
@@ -1026,13 +1098,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_NULLTEST_ROWISNULL:
-				build_EvalXFunc(b, mod, "ExecEvalRowNull",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalRowNull",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_NULLTEST_ROWISNOTNULL:
-				build_EvalXFunc(b, mod, "ExecEvalRowNotNull",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalRowNotNull",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -1103,13 +1175,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_PARAM_EXEC:
-				build_EvalXFunc(b, mod, "ExecEvalParamExec",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalParamExec",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_PARAM_EXTERN:
-				build_EvalXFunc(b, mod, "ExecEvalParamExtern",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalParamExtern",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -1133,7 +1205,8 @@ llvm_compile_expr(ExprState *state)
 										 l_ptr(v_functype));
 
 					v_params[0] = v_state;
-					v_params[1] = l_ptr_const(op, l_ptr(TypeSizeT));
+					v_params[1] = l_reloc_ptr(&relocs, b, op,
+											  l_ptr(TypeSizeT));
 					v_params[2] = v_econtext;
 					LLVMBuildCall(b,
 								  v_func,
@@ -1144,19 +1217,19 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_SBSREF_OLD:
-				build_EvalXFunc(b, mod, "ExecEvalSubscriptingRefOld",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalSubscriptingRefOld",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_SBSREF_ASSIGN:
-				build_EvalXFunc(b, mod, "ExecEvalSubscriptingRefAssign",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalSubscriptingRefAssign",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_SBSREF_FETCH:
-				build_EvalXFunc(b, mod, "ExecEvalSubscriptingRefFetch",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalSubscriptingRefFetch",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -1176,9 +1249,11 @@ llvm_compile_expr(ExprState *state)
 					b_notavail = l_bb_before_v(opblocks[i + 1],
 											   "op.%d.notavail", i);
 
-					v_casevaluep = l_ptr_const(op->d.casetest.value,
+					v_casevaluep = l_reloc_ptr(&relocs, b,
+											   op->d.casetest.value,
 											   l_ptr(TypeSizeT));
-					v_casenullp = l_ptr_const(op->d.casetest.isnull,
+					v_casenullp = l_reloc_ptr(&relocs, b,
+											  op->d.casetest.isnull,
 											  l_ptr(TypeStorageBool));
 
 					v_casevaluenull =
@@ -1224,7 +1299,8 @@ llvm_compile_expr(ExprState *state)
 					b_notnull = l_bb_before_v(opblocks[i + 1],
 											  "op.%d.readonly.notnull", i);
 
-					v_nullp = l_ptr_const(op->d.make_readonly.isnull,
+					v_nullp = l_reloc_ptr(&relocs, b,
+										  op->d.make_readonly.isnull,
 										  l_ptr(TypeStorageBool));
 
 					v_null = LLVMBuildLoad(b, v_nullp, "");
@@ -1241,7 +1317,8 @@ llvm_compile_expr(ExprState *state)
 					/* if value is not null, convert to RO datum */
 					LLVMPositionBuilderAtEnd(b, b_notnull);
 
-					v_valuep = l_ptr_const(op->d.make_readonly.value,
+					v_valuep = l_reloc_ptr(&relocs, b,
+										   op->d.make_readonly.value,
 										   l_ptr(TypeSizeT));
 
 					v_value = LLVMBuildLoad(b, v_valuep, "");
@@ -1290,8 +1367,10 @@ llvm_compile_expr(ExprState *state)
 					b_inputcall = l_bb_before_v(opblocks[i + 1],
 												"op.%d.inputcall", i);
 
-					v_fcinfo_out = l_ptr_const(fcinfo_out, l_ptr(StructFunctionCallInfoData));
-					v_fcinfo_in = l_ptr_const(fcinfo_in, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo_out = l_reloc_ptr(&relocs, b, fcinfo_out,
+											   l_ptr(StructFunctionCallInfoData));
+					v_fcinfo_in = l_reloc_ptr(&relocs, b, fcinfo_in,
+											  l_ptr(StructFunctionCallInfoData));
 					v_fn_addr_out = l_ptr_const(fcinfo_out->flinfo->fn_addr, TypePGFunction);
 					v_fn_addr_in = l_ptr_const(fcinfo_in->flinfo->fn_addr, TypePGFunction);
 
@@ -1415,7 +1494,8 @@ llvm_compile_expr(ExprState *state)
 					b_bothargnull = l_bb_before_v(opblocks[i + 1], "op.%d.bothargnull", i);
 					b_anyargnull = l_bb_before_v(opblocks[i + 1], "op.%d.anyargnull", i);
 
-					v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo = l_reloc_ptr(&relocs, b, fcinfo,
+										   l_ptr(StructFunctionCallInfoData));
 
 					/* load args[0|1].isnull for both arguments */
 					v_argnull0 = l_funcnull(b, v_fcinfo, 0);
@@ -1466,7 +1546,7 @@ llvm_compile_expr(ExprState *state)
 					/* neither argument is null: compare */
 					LLVMPositionBuilderAtEnd(b, b_noargnull);
 
-					v_result = BuildV1Call(context, b, mod, fcinfo,
+					v_result = BuildV1Call(context, &relocs, b, mod, fcinfo,
 										   &v_fcinfo_isnull);
 
 					if (opcode == EEOP_DISTINCT)
@@ -1510,7 +1590,8 @@ llvm_compile_expr(ExprState *state)
 					b_argsequal = l_bb_before_v(opblocks[i + 1],
 												"b.%d.argsequal", i);
 
-					v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo = l_reloc_ptr(&relocs, b, fcinfo,
+										   l_ptr(StructFunctionCallInfoData));
 
 					/* if either argument is NULL they can't be equal */
 					v_argnull0 = l_funcnull(b, v_fcinfo, 0);
@@ -1536,7 +1617,8 @@ llvm_compile_expr(ExprState *state)
 					/* build block to invoke function and check result */
 					LLVMPositionBuilderAtEnd(b, b_nonull);
 
-					v_retval = BuildV1Call(context, b, mod, fcinfo, &v_fcinfo_isnull);
+					v_retval = BuildV1Call(context, &relocs, b, mod, fcinfo,
+										   &v_fcinfo_isnull);
 
 					/*
 					 * If result not null, and arguments are equal return null
@@ -1566,37 +1648,37 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_SQLVALUEFUNCTION:
-				build_EvalXFunc(b, mod, "ExecEvalSQLValueFunction",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalSQLValueFunction",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_CURRENTOFEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalCurrentOfExpr",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalCurrentOfExpr",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_NEXTVALUEEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalNextValueExpr",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalNextValueExpr",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_ARRAYEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalArrayExpr",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalArrayExpr",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_ARRAYCOERCE:
-				build_EvalXFunc(b, mod, "ExecEvalArrayCoerce",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalArrayCoerce",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_ROW:
-				build_EvalXFunc(b, mod, "ExecEvalRow",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalRow",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -1631,7 +1713,7 @@ llvm_compile_expr(ExprState *state)
 						LLVMValueRef v_argnull1;
 						LLVMValueRef v_anyargisnull;
 
-						v_fcinfo = l_ptr_const(fcinfo,
+						v_fcinfo = l_reloc_ptr(&relocs, b, fcinfo,
 											   l_ptr(StructFunctionCallInfoData));
 
 						v_argnull0 = l_funcnull(b, v_fcinfo, 0);
@@ -1660,7 +1742,7 @@ llvm_compile_expr(ExprState *state)
 					LLVMPositionBuilderAtEnd(b, b_compare);
 
 					/* call function */
-					v_retval = BuildV1Call(context, b, mod, fcinfo,
+					v_retval = BuildV1Call(context, &relocs, b, mod, fcinfo,
 										   &v_fcinfo_isnull);
 					LLVMBuildStore(b, v_retval, v_resvaluep);
 
@@ -1751,25 +1833,25 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_MINMAX:
-				build_EvalXFunc(b, mod, "ExecEvalMinMax",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalMinMax",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_FIELDSELECT:
-				build_EvalXFunc(b, mod, "ExecEvalFieldSelect",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalFieldSelect",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_FIELDSTORE_DEFORM:
-				build_EvalXFunc(b, mod, "ExecEvalFieldStoreDeForm",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalFieldStoreDeForm",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_FIELDSTORE_FORM:
-				build_EvalXFunc(b, mod, "ExecEvalFieldStoreForm",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalFieldStoreForm",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -1784,7 +1866,8 @@ llvm_compile_expr(ExprState *state)
 					v_fn = llvm_get_decl(mod, FuncExecEvalSubscriptingRef);
 
 					v_params[0] = v_state;
-					v_params[1] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+					v_params[1] = l_reloc_ptr(&relocs, b, op,
+											  l_ptr(StructExprEvalStep));
 					v_ret = LLVMBuildCall(b, v_fn,
 										  v_params, lengthof(v_params), "");
 					v_ret = LLVMBuildZExt(b, v_ret, TypeStorageBool, "");
@@ -1812,9 +1895,11 @@ llvm_compile_expr(ExprState *state)
 					b_notavail = l_bb_before_v(opblocks[i + 1],
 											   "op.%d.notavail", i);
 
-					v_casevaluep = l_ptr_const(op->d.casetest.value,
+					v_casevaluep = l_reloc_ptr(&relocs, b,
+											   op->d.casetest.value,
 											   l_ptr(TypeSizeT));
-					v_casenullp = l_ptr_const(op->d.casetest.isnull,
+					v_casenullp = l_reloc_ptr(&relocs, b,
+											  op->d.casetest.isnull,
 											  l_ptr(TypeStorageBool));
 
 					v_casevaluenull =
@@ -1852,31 +1937,31 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_DOMAIN_NOTNULL:
-				build_EvalXFunc(b, mod, "ExecEvalConstraintNotNull",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalConstraintNotNull",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_DOMAIN_CHECK:
-				build_EvalXFunc(b, mod, "ExecEvalConstraintCheck",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalConstraintCheck",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_CONVERT_ROWTYPE:
-				build_EvalXFunc(b, mod, "ExecEvalConvertRowtype",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalConvertRowtype",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_SCALARARRAYOP:
-				build_EvalXFunc(b, mod, "ExecEvalScalarArrayOp",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalScalarArrayOp",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_XMLEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalXmlExpr",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalXmlExpr",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -1894,7 +1979,7 @@ llvm_compile_expr(ExprState *state)
 					 * in ExecInitAgg() after initializing the expression). So
 					 * load it from memory each time round.
 					 */
-					v_aggnop = l_ptr_const(&aggref->aggno,
+					v_aggnop = l_reloc_ptr(&relocs, b, &aggref->aggno,
 										   l_ptr(LLVMInt32Type()));
 					v_aggno = LLVMBuildLoad(b, v_aggnop, "v_aggno");
 
@@ -1911,7 +1996,7 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_GROUPING_FUNC:
-				build_EvalXFunc(b, mod, "ExecEvalGroupingFunc",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalGroupingFunc",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -1929,7 +2014,7 @@ llvm_compile_expr(ExprState *state)
 					 * up in ExecInitWindowAgg() after initializing the
 					 * expression). So load it from memory each time round.
 					 */
-					v_wfuncnop = l_ptr_const(&wfunc->wfuncno,
+					v_wfuncnop = l_reloc_ptr(&relocs, b, &wfunc->wfuncno,
 											 l_ptr(LLVMInt32Type()));
 					v_wfuncno = LLVMBuildLoad(b, v_wfuncnop, "v_wfuncno");
 
@@ -1947,13 +2032,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_SUBPLAN:
-				build_EvalXFunc(b, mod, "ExecEvalSubPlan",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalSubPlan",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_ALTERNATIVE_SUBPLAN:
-				build_EvalXFunc(b, mod, "ExecEvalAlternativeSubPlan",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalAlternativeSubPlan",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -1968,7 +2053,7 @@ llvm_compile_expr(ExprState *state)
 					b_deserialize = l_bb_before_v(opblocks[i + 1],
 												  "op.%d.deserialize", i);
 
-					v_fcinfo = l_ptr_const(fcinfo,
+					v_fcinfo = l_reloc_ptr(&relocs, b, fcinfo,
 										   l_ptr(StructFunctionCallInfoData));
 					v_argnull0 = l_funcnull(b, v_fcinfo, 0);
 
@@ -1998,10 +2083,11 @@ llvm_compile_expr(ExprState *state)
 					fcinfo = op->d.agg_deserialize.fcinfo_data;
 
 					v_tmpcontext =
-						l_ptr_const(aggstate->tmpcontext->ecxt_per_tuple_memory,
+						l_reloc_ptr(&relocs, b,
+									aggstate->tmpcontext->ecxt_per_tuple_memory,
 									l_ptr(StructMemoryContextData));
 					v_oldcontext = l_mcxt_switch(mod, b, v_tmpcontext);
-					v_retval = BuildV1Call(context, b, mod, fcinfo,
+					v_retval = BuildV1Call(context, &relocs, b, mod, fcinfo,
 										   &v_fcinfo_isnull);
 					l_mcxt_switch(mod, b, v_oldcontext);
 
@@ -2028,8 +2114,10 @@ llvm_compile_expr(ExprState *state)
 					Assert(nargs > 0);
 
 					jumpnull = op->d.agg_strict_input_check.jumpnull;
-					v_argsp = l_ptr_const(args, l_ptr(StructNullableDatum));
-					v_nullsp = l_ptr_const(nulls, l_ptr(TypeStorageBool));
+					v_argsp = l_reloc_ptr(&relocs, b, args,
+										  l_ptr(StructNullableDatum));
+					v_nullsp = l_reloc_ptr(&relocs, b, nulls,
+										   l_ptr(TypeStorageBool));
 
 					/* create blocks for checking args */
 					b_checknulls = palloc(sizeof(LLVMBasicBlockRef *) * nargs);
@@ -2082,6 +2170,45 @@ llvm_compile_expr(ExprState *state)
 					break;
 				}
 
+			case EEOP_AGG_PLAIN_PERGROUP_NULLCHECK:
+				{
+					int			jumpnull;
+					LLVMValueRef v_aggstatep;
+					LLVMValueRef v_allpergroupsp;
+					LLVMValueRef v_pergroup_allaggs;
+					LLVMValueRef v_setoff;
+
+					jumpnull = op->d.agg_plain_pergroup_nullcheck.jumpnull;
+
+					/*
+					 * pergroup_allaggs = aggstate->all_pergroups
+					 * [op->d.agg_plain_pergroup_nullcheck.setoff];
+					 */
+					v_aggstatep = l_reloc_ptr(&relocs, b,
+											  castNode(AggState, state->parent),
+											  l_ptr(StructAggState));
+
+					v_allpergroupsp =
+						l_load_struct_gep(b, v_aggstatep,
+										  FIELDNO_AGGSTATE_ALL_PERGROUPS,
+										  "aggstate.all_pergroups");
+
+					v_setoff =
+						l_int32_const(op->d.agg_plain_pergroup_nullcheck.setoff);
+
+					v_pergroup_allaggs = l_load_gep1(b, v_allpergroupsp,
+													 v_setoff, "");
+
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntEQ,
+												  LLVMBuildPtrToInt(b, v_pergroup_allaggs,
+																	TypeSizeT, ""),
+												  l_sizet_const(0), ""),
+									opblocks[jumpnull],
+									opblocks[i + 1]);
+					break;
+				}
+
 			case EEOP_AGG_INIT_TRANS:
 				{
 					AggState   *aggstate;
@@ -2104,9 +2231,9 @@ llvm_compile_expr(ExprState *state)
 					aggstate = op->d.agg_init_trans.aggstate;
 					pertrans = op->d.agg_init_trans.pertrans;
 
-					v_aggstatep = l_ptr_const(aggstate,
+					v_aggstatep = l_reloc_ptr(&relocs, b, aggstate,
 											  l_ptr(StructAggState));
-					v_pertransp = l_ptr_const(pertrans,
+					v_pertransp = l_reloc_ptr(&relocs, b, pertrans,
 											  l_ptr(StructAggStatePerTransData));
 
 					/*
@@ -2147,7 +2274,8 @@ llvm_compile_expr(ExprState *state)
 						LLVMValueRef v_current_set;
 						LLVMValueRef v_aggcontext;
 
-						v_aggcontext = l_ptr_const(op->d.agg_init_trans.aggcontext,
+						v_aggcontext = l_reloc_ptr(&relocs, b,
+												   op->d.agg_init_trans.aggcontext,
 												   l_ptr(StructExprContext));
 
 						v_current_set =
@@ -2195,7 +2323,8 @@ llvm_compile_expr(ExprState *state)
 					int			jumpnull = op->d.agg_strict_trans_check.jumpnull;
 
 					aggstate = op->d.agg_strict_trans_check.aggstate;
-					v_aggstatep = l_ptr_const(aggstate, l_ptr(StructAggState));
+					v_aggstatep = l_reloc_ptr(&relocs, b, aggstate,
+											  l_ptr(StructAggState));
 
 					/*
 					 * pergroup = &aggstate->all_pergroups
@@ -2267,9 +2396,9 @@ llvm_compile_expr(ExprState *state)
 
 					fcinfo = pertrans->transfn_fcinfo;
 
-					v_aggstatep = l_ptr_const(aggstate,
+					v_aggstatep = l_reloc_ptr(&relocs, b, aggstate,
 											  l_ptr(StructAggState));
-					v_pertransp = l_ptr_const(pertrans,
+					v_pertransp = l_reloc_ptr(&relocs, b, pertrans,
 											  l_ptr(StructAggStatePerTransData));
 
 					/*
@@ -2288,9 +2417,10 @@ llvm_compile_expr(ExprState *state)
 									 l_load_gep1(b, v_allpergroupsp, v_setoff, ""),
 									 &v_transno, 1, "");
 
-					v_fcinfo = l_ptr_const(fcinfo,
+					v_fcinfo = l_reloc_ptr(&relocs, b, fcinfo,
 										   l_ptr(StructFunctionCallInfoData));
-					v_aggcontext = l_ptr_const(op->d.agg_trans.aggcontext,
+					v_aggcontext = l_reloc_ptr(&relocs, b,
+											   op->d.agg_trans.aggcontext,
 											   l_ptr(StructExprContext));
 
 					v_current_setp =
@@ -2317,7 +2447,8 @@ llvm_compile_expr(ExprState *state)
 
 					/* invoke transition function in per-tuple context */
 					v_tmpcontext =
-						l_ptr_const(aggstate->tmpcontext->ecxt_per_tuple_memory,
+						l_reloc_ptr(&relocs, b,
+									aggstate->tmpcontext->ecxt_per_tuple_memory,
 									l_ptr(StructMemoryContextData));
 					v_oldcontext = l_mcxt_switch(mod, b, v_tmpcontext);
 
@@ -2339,7 +2470,7 @@ llvm_compile_expr(ExprState *state)
 								   l_funcnullp(b, v_fcinfo, 0));
 
 					/* and invoke transition function */
-					v_retval = BuildV1Call(context, b, mod, fcinfo,
+					v_retval = BuildV1Call(context, &relocs, b, mod, fcinfo,
 										   &v_fcinfo_isnull);
 
 					/*
@@ -2419,13 +2550,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_AGG_ORDERED_TRANS_DATUM:
-				build_EvalXFunc(b, mod, "ExecEvalAggOrderedTransDatum",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalAggOrderedTransDatum",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
 
 			case EEOP_AGG_ORDERED_TRANS_TUPLE:
-				build_EvalXFunc(b, mod, "ExecEvalAggOrderedTransTuple",
+				build_EvalXFunc(b, mod, &relocs, "ExecEvalAggOrderedTransTuple",
 								v_state, v_econtext, op);
 				LLVMBuildBr(b, opblocks[i + 1]);
 				break;
@@ -2448,9 +2579,25 @@ llvm_compile_expr(ExprState *state)
 
 		CompiledExprState *cstate = palloc0(sizeof(CompiledExprState));
 
+		cstate->relocs = relocs.values;
 		cstate->context = context;
 		cstate->funcname = funcname;
 
+		/* look up the code in the cache, and give the module back */
+		if (relocs.v_relocs != NULL)
+		{
+			StringInfoData key;
+
+			initStringInfo(&key);
+			llvm_expr_cache_key(state, &key);
+			cstate->entry = llvm_cache_module(context, &key, mod, funcname);
+			pfree(key.data);
+
+			context->module = pending_module;
+			context->module_generation = pending_generation;
+			context->compiled = pending_compiled;
+		}
+
 		state->evalfunc = ExecRunCompiledExpr;
 		state->evalfunc_private = cstate;
 	}
@@ -2481,8 +2628,12 @@ ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *isNull)
 	CheckExprStillValid(state, econtext);
 
 	llvm_enter_fatal_on_oom();
-	func = (ExprStateEvalFunc) llvm_get_function(cstate->context,
-												 cstate->funcname);
+	if (cstate->entry)
+		func = (ExprStateEvalFunc) llvm_cache_get_function(cstate->context,
+														   cstate->entry);
+	else
+		func = (ExprStateEvalFunc) llvm_get_function(cstate->context,
+													 cstate->funcname);
 	llvm_leave_fatal_on_oom();
 	Assert(func);
 
@@ -2492,8 +2643,255 @@ ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *isNull)
 	return func(state, econtext, isNull);
 }
 
+/*
+ * Emit a value referenced by the generated code, either as a constant or,
+ * if the code may be cached, as a load from the relocation array.
+ */
+static LLVMValueRef
+l_reloc_datum(ExprRelocs *relocs, LLVMBuilderRef b, Datum value)
+{
+	LLVMValueRef v_idx;
+
+	if (relocs->v_relocs == NULL)
+		return l_sizet_const(value);
+
+	if (relocs->values == NULL)
+	{
+		relocs->maxvalues = 16;
+		relocs->values = palloc(sizeof(Datum) * relocs->maxvalues);
+	}
+	else if (relocs->nvalues >= relocs->maxvalues)
+	{
+		relocs->maxvalues *= 2;
+		relocs->values = repalloc(relocs->values,
+								  sizeof(Datum) * relocs->maxvalues);
+	}
+
+	v_idx = l_int32_const(relocs->nvalues);
+	relocs->values[relocs->nvalues++] = value;
+
+	return l_load_gep1(b, relocs->v_relocs, v_idx, "");
+}
+
+/*
+ * Emit a pointer to data referenced by the generated code.
+ */
+static LLVMValueRef
+l_reloc_ptr(ExprRelocs *relocs, LLVMBuilderRef b, void *ptr, LLVMTypeRef type)
+{
+	if (relocs->v_relocs == NULL)
+		return l_ptr_const(ptr, type);
+
+	return LLVMBuildIntToPtr(b, l_reloc_datum(relocs, b, PointerGetDatum(ptr)),
+							 type, "");
+}
+
+/*
+ * Describe everything the code generated for an expression that may be
+ * cached depends on, for use as key of the code cache: the expression's
+ * steps, with the fields that are embedded in the code or determine its
+ * shape. Values loaded from the relocation array don't need to be included.
+ *
+ * This has to be kept in sync with llvm_compile_expr(), otherwise the code
+ * of different expressions can be mixed up. Assert-enabled builds check
+ * that the IR of modules with the same key is identical.
+ */
+static void
+llvm_expr_cache_key(ExprState *state, StringInfo key)
+{
+	int			i;
+
+#define APPEND_KEY(field) \
+	appendBinaryStringInfo(key, (const char *) &(field), sizeof(field))
+
+	APPEND_KEY(state->steps_len);
+
+	for (i = 0; i < state->steps_len; i++)
+	{
+		ExprEvalStep *op = &state->steps[i];
+		ExprEvalOp	opcode = ExecEvalStepOp(state, op);
+
+		APPEND_KEY(opcode);
+
+		switch (opcode)
+		{
+			case EEOP_INNER_FETCHSOME:
+			case EEOP_OUTER_FETCHSOME:
+			case EEOP_SCAN_FETCHSOME:
+				{
+					TupleDesc	desc = op->d.fetch.known_desc;
+					int			natts = -1;
+					int			attnum;
+
+					APPEND_KEY(op->d.fetch.last_var);
+					APPEND_KEY(op->d.fetch.fixed);
+					if (!op->d.fetch.fixed)
+						break;
+
+					/* the deform function depends on slot type and desc */
+					APPEND_KEY(op->d.fetch.kind);
+					if (desc)
+						natts = desc->natts;
+					APPEND_KEY(natts);
+					for (attnum = 0; attnum < natts; attnum++)
+					{
+						Form_pg_attribute att = TupleDescAttr(desc, attnum);
+
+						APPEND_KEY(att->attlen);
+						APPEND_KEY(att->attbyval);
+						APPEND_KEY(att->attalign);
+						APPEND_KEY(att->attnotnull);
+						APPEND_KEY(att->atthasmissing);
+						APPEND_KEY(att->attisdropped);
+					}
+					break;
+				}
+
+			case EEOP_INNER_VAR:
+			case EEOP_OUTER_VAR:
+			case EEOP_SCAN_VAR:
+				APPEND_KEY(op->d.var.attnum);
+				break;
+
+			case EEOP_ASSIGN_INNER_VAR:
+			case EEOP_ASSIGN_OUTER_VAR:
+			case EEOP_ASSIGN_SCAN_VAR:
+				APPEND_KEY(op->d.assign_var.attnum);
+				APPEND_KEY(op->d.assign_var.resultnum);
+				break;
+
+			case EEOP_ASSIGN_TMP:
+			case EEOP_ASSIGN_TMP_MAKE_RO:
+				APPEND_KEY(op->d.assign_tmp.resultnum);
+				break;
+
+			case EEOP_CONST:
+				APPEND_KEY(op->d.constval.isnull);
+				break;
+
+			case EEOP_FUNCEXPR:
+			case EEOP_FUNCEXPR_STRICT:
+				APPEND_KEY(op->d.func.nargs);
+				llvm_fcinfo_cache_key(op->d.func.fcinfo_data, key);
+				break;
+
+			case EEOP_BOOL_AND_STEP_FIRST:
+			case EEOP_BOOL_AND_STEP:
+			case EEOP_BOOL_AND_STEP_LAST:
+			case EEOP_BOOL_OR_STEP_FIRST:
+			case EEOP_BOOL_OR_STEP:
+			case EEOP_BOOL_OR_STEP_LAST:
+				APPEND_KEY(op->d.boolexpr.jumpdone);
+				break;
+
+			case EEOP_QUAL:
+				APPEND_KEY(op->d.qualexpr.jumpdone);
+				break;
+
+			case EEOP_JUMP:
+			case EEOP_JUMP_IF_NULL:
+			case EEOP_JUMP_IF_NOT_NULL:
+			case EEOP_JUMP_IF_NOT_TRUE:
+				APPEND_KEY(op->d.jump.jumpdone);
+				break;
+
+			case EEOP_PARAM_CALLBACK:
+				APPEND_KEY(op->d.cparam.paramfunc);
+				break;
+
+			case EEOP_IOCOERCE:
+				APPEND_KEY(op->d.iocoerce.fcinfo_data_out->flinfo->fn_addr);
+				APPEND_KEY(op->d.iocoerce.fcinfo_data_in->flinfo->fn_addr);
+				APPEND_KEY(op->d.iocoerce.finfo_in->fn_strict);
+				break;
+
+			case EEOP_DISTINCT:
+			case EEOP_NOT_DISTINCT:
+			case EEOP_NULLIF:
+				llvm_fcinfo_cache_key(op->d.func.fcinfo_data, key);
+				break;
+
+			case EEOP_ROWCOMPARE_STEP:
+				APPEND_KEY(op->d.rowcompare_step.finfo->fn_strict);
+				APPEND_KEY(op->d.rowcompare_step.jumpnull);
+				APPEND_KEY(op->d.rowcompare_step.jumpdone);
+				llvm_fcinfo_cache_key(op->d.rowcompare_step.fcinfo_data, key);
+				break;
+
+			case EEOP_ROWCOMPARE_FINAL:
+				APPEND_KEY(op->d.rowcompare_final.rctype);
+				break;
+
+			case EEOP_SBSREF_SUBSCRIPT:
+				APPEND_KEY(op->d.sbsref_subscript.jumpdone);
+				break;
+
+			case EEOP_AGG_STRICT_DESERIALIZE:
+			case EEOP_AGG_DESERIALIZE:
+				APPEND_KEY(op->d.agg_deserialize.jumpnull);
+				llvm_fcinfo_cache_key(op->d.agg_deserialize.fcinfo_data, key);
+				break;
+
+			case EEOP_AGG_STRICT_INPUT_CHECK_ARGS:
+			case EEOP_AGG_STRICT_INPUT_CHECK_NULLS:
+				APPEND_KEY(op->d.agg_strict_input_check.nargs);
+				APPEND_KEY(op->d.agg_strict_input_check.jumpnull);
+				break;
+
+			case EEOP_AGG_PLAIN_PERGROUP_NULLCHECK:
+				APPEND_KEY(op->d.agg_plain_pergroup_nullcheck.setoff);
+				APPEND_KEY(op->d.agg_plain_pergroup_nullcheck.jumpnull);
+				break;
+
+			case EEOP_AGG_INIT_TRANS:
+				APPEND_KEY(op->d.agg_init_trans.setno);
+				APPEND_KEY(op->d.agg_init_trans.setoff);
+				APPEND_KEY(op->d.agg_init_trans.transno);
+				APPEND_KEY(op->d.agg_init_trans.jumpnull);
+				break;
+
+			case EEOP_AGG_STRICT_TRANS_CHECK:
+				APPEND_KEY(op->d.agg_strict_trans_check.setoff);
+				APPEND_KEY(op->d.agg_strict_trans_check.transno);
+				APPEND_KEY(op->d.agg_strict_trans_check.jumpnull);
+				break;
+
+			case EEOP_AGG_PLAIN_TRANS_BYVAL:
+			case EEOP_AGG_PLAIN_TRANS:
+				APPEND_KEY(op->d.agg_trans.setno);
+				APPEND_KEY(op->d.agg_trans.setoff);
+				APPEND_KEY(op->d.agg_trans.transno);
+				llvm_fcinfo_cache_key(op->d.agg_trans.pertrans->transfn_fcinfo,
+									  key);
+				break;
+
+			default:
+				/* only the opcode matters */
+				break;
+		}
+	}
+
+#undef APPEND_KEY
+}
+
+/*
+ * Describe a function called by generated code, see llvm_expr_cache_key().
+ * The function is referenced by its OID or address, see
+ * llvm_function_reference().
+ */
+static void
+llvm_fcinfo_cache_key(FunctionCallInfo fcinfo, StringInfo key)
+{
+	appendBinaryStringInfo(key, (const char *) &fcinfo->flinfo->fn_oid,
+						   sizeof(fcinfo->flinfo->fn_oid));
+	appendBinaryStringInfo(key, (const char *) &fcinfo->flinfo->fn_addr,
+						   sizeof(fcinfo->flinfo->fn_addr));
+	appendBinaryStringInfo(key, (const char *) &fcinfo->nargs,
+						   sizeof(fcinfo->nargs));
+}
+
 static LLVMValueRef
-BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
+BuildV1Call(LLVMJitContext *context, ExprRelocs *relocs, LLVMBuilderRef b,
 			LLVMModuleRef mod, FunctionCallInfo fcinfo,
 			LLVMValueRef *v_fcinfo_isnull)
 {
@@ -2504,7 +2902,8 @@ BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
 
 	v_fn = llvm_function_reference(context, b, mod, fcinfo);
 
-	v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+	v_fcinfo = l_reloc_ptr(relocs, b, fcinfo,
+						   l_ptr(StructFunctionCallInfoData));
 	v_fcinfo_isnullp = LLVMBuildStructGEP(b, v_fcinfo,
 										  FIELDNO_FUNCTIONCALLINFODATA_ISNULL,
 										  "v_fcinfo_isnull");
@@ -2524,11 +2923,13 @@ BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
 		LLVMValueRef params[2];
 
 		params[0] = l_int64_const(sizeof(NullableDatum) * fcinfo->nargs);
-		params[1] = l_ptr_const(fcinfo->args, l_ptr(LLVMInt8Type()));
+		params[1] = l_reloc_ptr(relocs, b, fcinfo->args,
+								l_ptr(LLVMInt8Type()));
 		LLVMBuildCall(b, v_lifetime, params, lengthof(params), "");
 
 		params[0] = l_int64_const(sizeof(fcinfo->isnull));
-		params[1] = l_ptr_const(&fcinfo->isnull, l_ptr(LLVMInt8Type()));
+		params[1] = l_reloc_ptr(relocs, b, &fcinfo->isnull,
+								l_ptr(LLVMInt8Type()));
 		LLVMBuildCall(b, v_lifetime, params, lengthof(params), "");
 	}
 
@@ -2539,7 +2940,8 @@ BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
  * Implement an expression step by calling the function funcname.
  */
 static void
-build_EvalXFunc(LLVMBuilderRef b, LLVMModuleRef mod, const char *funcname,
+build_EvalXFunc(LLVMBuilderRef b, LLVMModuleRef mod, ExprRelocs *relocs,
+				const char *funcname,
 				LLVMValueRef v_state, LLVMValueRef v_econtext,
 				ExprEvalStep *op)
 {
@@ -2562,7 +2964,7 @@ build_EvalXFunc(LLVMBuilderRef b, LLVMModuleRef mod, const char *funcname,
 	}
 
 	params[0] = v_state;
-	params[1] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+	params[1] = l_reloc_ptr(relocs, b, op, l_ptr(StructExprEvalStep));
 	params[2] = v_econtext;
 
 	LLVMBuildCall(b,
@@ -129,6 +129,20 @@ bloom_free(bloom_filter *filter)
 	pfree(filter);
 }
 
+/*
+ * Total size of Bloom filter, in bytes
+ *
+ * A filter is a single allocation that contains no pointers, so a copy of
+ * this many bytes (for example, in shared memory) can be used in place of the
+ * original.
+ */
+Size
+bloom_total_size(bloom_filter *filter)
+{
+	return offsetof(bloom_filter, bitset) +
+		sizeof(unsigned char) * filter->m / BITS_PER_BYTE;
+}
+
 /*
  * Add element to Bloom filter
  */
@@ -17,8 +17,11 @@
  * is only expected to happen a small number of times until a stable size is
  * found, since growth is geometric.
  *
- * Future versions may support iterators and incremental resizing; for now
- * the implementation is minimalist.
+ * Sequential scans visit the partitions in order, holding one partition lock
+ * at a time; resizing is blocked for the duration of the scan.
+ *
+ * Future versions may support incremental resizing; for now the
+ * implementation is minimalist.
  *
  * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -153,6 +156,10 @@ struct dshash_table
 #define BUCKET_INDEX_FOR_PARTITION(partition, size_log2)	\
 	((partition) << NUM_SPLITS(size_log2))
 
+/* The partition that a given bucket index belongs to. */
+#define PARTITION_FOR_BUCKET_INDEX(bucket_idx, size_log2)	\
+	((bucket_idx) >> NUM_SPLITS(size_log2))
+
 /* The head of the active bucket for a given hash value (lvalue). */
 #define BUCKET_FOR_HASH(hash_table, hash)								\
 	(hash_table->buckets[												\
@@ -592,6 +599,131 @@ dshash_memhash(const void *v, size_t size, void *arg)
 	return tag_hash(v, size);
 }
 
+/*
+ * Initialize a sequential scan over the hash table.  No locks are taken until
+ * the first call to dshash_seq_next.  If 'exclusive' is true, partitions are
+ * locked exclusively and the caller may delete the current entry with
+ * dshash_delete_current.
+ *
+ * The caller must not hold any partition locks, and must not call other
+ * dshash functions on the same table until the scan is finished with
+ * dshash_seq_term.
+ */
+void
+dshash_seq_init(dshash_seq_status *status, dshash_table *hash_table,
+				bool exclusive)
+{
+	status->hash_table = hash_table;
+	status->curbucket = 0;
+	status->nbuckets = 0;
+	status->curitem = NULL;
+	status->pnextitem = InvalidDsaPointer;
+	status->curpartition = -1;
+	status->exclusive = exclusive;
+}
+
+/*
+ * Return the next entry of a sequential scan, or NULL when the scan is
+ * complete.  The returned entry remains locked until the next call.
+ */
+void *
+dshash_seq_next(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	LWLockMode	lockmode = status->exclusive ? LW_EXCLUSIVE : LW_SHARED;
+	dsa_pointer next_item_pointer;
+
+	if (status->curpartition == -1)
+	{
+		/*
+		 * First call.  Lock partition 0; once any partition lock is held the
+		 * table cannot be resized, so the bucket array stays valid for the
+		 * rest of the scan.
+		 */
+		Assert(status->curbucket == 0);
+		Assert(!hash_table->find_locked);
+
+		status->curpartition = 0;
+		LWLockAcquire(PARTITION_LOCK(hash_table, 0), lockmode);
+
+		ensure_valid_bucket_pointers(hash_table);
+
+		status->nbuckets = ((size_t) 1) << hash_table->size_log2;
+		next_item_pointer = hash_table->buckets[status->curbucket];
+	}
+	else
+		next_item_pointer = status->pnextitem;
+
+	Assert(LWLockHeldByMeInMode(PARTITION_LOCK(hash_table,
+											   status->curpartition),
+								lockmode));
+
+	/* Advance to the next non-empty bucket if this one is exhausted. */
+	while (!DsaPointerIsValid(next_item_pointer))
+	{
+		int			next_partition;
+
+		if (++status->curbucket >= status->nbuckets)
+			return NULL;
+
+		next_partition = PARTITION_FOR_BUCKET_INDEX(status->curbucket,
+													hash_table->size_log2);
+
+		if (status->curpartition != next_partition)
+		{
+			/*
+			 * Lock the next partition before releasing the current one, so
+			 * that a concurrent resize can't sneak in between.  This is the
+			 * same order resize() acquires them in, so it can't deadlock.
+			 */
+			LWLockAcquire(PARTITION_LOCK(hash_table, next_partition),
+						  lockmode);
+			LWLockRelease(PARTITION_LOCK(hash_table, status->curpartition));
+			status->curpartition = next_partition;
+		}
+
+		next_item_pointer = hash_table->buckets[status->curbucket];
+	}
+
+	status->curitem = dsa_get_address(hash_table->area, next_item_pointer);
+
+	/* Remember the successor, in case the caller deletes this item. */
+	status->pnextitem = status->curitem->next;
+
+	return ENTRY_FROM_ITEM(status->curitem);
+}
+
+/*
+ * Finish a sequential scan, releasing any lock still held.
+ */
+void
+dshash_seq_term(dshash_seq_status *status)
+{
+	if (status->curpartition >= 0)
+		LWLockRelease(PARTITION_LOCK(status->hash_table,
+									 status->curpartition));
+	status->curpartition = -1;
+}
+
+/*
+ * Remove the entry most recently returned by dshash_seq_next.  The scan must
+ * have been started in exclusive mode.
+ */
+void
+dshash_delete_current(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	dshash_table_item *item = status->curitem;
+
+	Assert(status->exclusive);
+	Assert(hash_table->control->magic == DSHASH_MAGIC);
+	Assert(LWLockHeldByMeInMode(PARTITION_LOCK(hash_table,
+											   PARTITION_FOR_HASH(item->hash)),
+								LW_EXCLUSIVE));
+
+	delete_item(hash_table, item);
+}
+
 /*
  * Print debugging information about the internal state of the hash table to
  * stderr.  The caller must hold no partition locks.
@@ -18,10 +18,14 @@
 
 #include "executor/executor.h"
 #include "foreign/fdwapi.h"
+#include "nodes/nodeFuncs.h"
 #include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/planmain.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
 
 /* Hook for plugins to get control in add_paths_to_joinrel() */
 set_join_pathlist_hook_type set_join_pathlist_hook = NULL;
@@ -866,6 +870,237 @@ clause_sides_match_join(RestrictInfo *rinfo, RelOptInfo *outerrel,
 	return false;				/* no good for these input relations */
 }
 
+/*
+ * paraminfo_get_equal_hashops
+ *		Determine if param_info and innerrel's lateral_vars can be hashed.
+ *		Returns true if hashing is possible, otherwise returns false.
+ *
+ * Additionally we also collect the outer exprs and the hash operators and
+ * collations to compare them with for each parameter to innerrel.  These are
+ * set in 'param_exprs', 'operators' and 'collations' when we return true.
+ *
+ * Two parameter values that the hash operator finds equal, such as numeric
+ * 1.0 and 1.00, aren't necessarily interchangeable.  That's fine for the
+ * outer side of a hash joinable clause, as the clause can't tell them apart
+ * either, but other uses of a parameter may.  If there are any such uses,
+ * 'binary_mode' is set to true, meaning that the parameters must be compared
+ * bitwise rather than with the hash operators.
+ */
+static bool
+paraminfo_get_equal_hashops(ParamPathInfo *param_info,
+							RelOptInfo *outerrel, RelOptInfo *innerrel,
+							List **param_exprs, List **operators,
+							List **collations, bool *binary_mode)
+{
+	ListCell   *lc;
+
+	*param_exprs = NIL;
+	*operators = NIL;
+	*collations = NIL;
+	*binary_mode = false;
+
+	if (param_info != NULL)
+	{
+		foreach(lc, param_info->ppi_clauses)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+			OpExpr	   *opexpr = (OpExpr *) rinfo->clause;
+			Node	   *expr;
+			Oid			hasheqop;
+
+			if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2 ||
+				!clause_sides_match_join(rinfo, outerrel, innerrel))
+				return false;
+
+			if (rinfo->outer_is_left)
+				expr = (Node *) linitial(opexpr->args);
+			else
+				expr = (Node *) lsecond(opexpr->args);
+
+			/* Reject if there are any volatile functions */
+			if (contain_volatile_functions(expr))
+				return false;
+
+			/*
+			 * The clause can only be evaluated the same way for outer values
+			 * that its own hash operator, on the outer side's type, finds
+			 * equal under the clause's collation.  Other clauses must compare
+			 * the values bitwise.
+			 */
+			if (OidIsValid(rinfo->hashjoinoperator))
+			{
+				Oid			lhs_opno;
+				Oid			rhs_opno;
+
+				if (!get_compatible_hash_operators(rinfo->hashjoinoperator,
+												   &lhs_opno, &rhs_opno))
+					return false;
+
+				hasheqop = rinfo->outer_is_left ? lhs_opno : rhs_opno;
+				*collations = lappend_oid(*collations, opexpr->inputcollid);
+			}
+			else
+			{
+				TypeCacheEntry *typentry;
+
+				typentry = lookup_type_cache(exprType(expr),
+											 TYPECACHE_HASH_PROC | TYPECACHE_EQ_OPR);
+				if (!OidIsValid(typentry->hash_proc) ||
+					!OidIsValid(typentry->eq_opr) ||
+					!op_hashjoinable(typentry->eq_opr, exprType(expr)))
+					return false;
+
+				hasheqop = typentry->eq_opr;
+				*collations = lappend_oid(*collations, exprCollation(expr));
+				*binary_mode = true;
+			}
+
+			*param_exprs = lappend(*param_exprs, expr);
+			*operators = lappend_oid(*operators, hasheqop);
+		}
+	}
+
+	/*
+	 * Now add any lateral vars to the cache key too.  These may be used
+	 * anywhere in innerrel, including its target list, so they must be
+	 * compared bitwise.
+	 */
+	foreach(lc, innerrel->lateral_vars)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+		Oid			exprtype = exprType(expr);
+		TypeCacheEntry *typentry;
+
+		/* Reject if there are any volatile functions */
+		if (contain_volatile_functions(expr))
+			return false;
+
+		typentry = lookup_type_cache(exprtype,
+									 TYPECACHE_HASH_PROC | TYPECACHE_EQ_OPR);
+
+		/* can't use result cache without a valid hash equals operator */
+		if (!OidIsValid(typentry->hash_proc) ||
+			!OidIsValid(typentry->eq_opr) ||
+			!op_hashjoinable(typentry->eq_opr, exprtype))
+			return false;
+
+		*param_exprs = lappend(*param_exprs, expr);
+		*operators = lappend_oid(*operators, typentry->eq_opr);
+		*collations = lappend_oid(*collations, exprCollation(expr));
+		*binary_mode = true;
+	}
+
+	/* We're okay to use result cache */
+	return true;
+}
+
+/*
+ * get_resultcache_path
+ *		If possible, make and return a Result Cache path atop of 'inner_path'.
+ *		Otherwise return NULL.
+ */
+static Path *
+get_resultcache_path(PlannerInfo *root, RelOptInfo *innerrel,
+					 RelOptInfo *outerrel, Path *inner_path,
+					 Path *outer_path, JoinType jointype,
+					 JoinPathExtraData *extra)
+{
+	List	   *param_exprs;
+	List	   *hash_operators;
+	List	   *collations;
+	bool		binary_mode;
+	ListCell   *lc;
+
+	/* Obviously not if it's disabled */
+	if (!enable_resultcache)
+		return NULL;
+
+	/*
+	 * We can safely not bother with all this unless we expect to perform more
+	 * than one inner scan.  The first scan is always going to be a cache
+	 * miss.  This would likely fail later anyway based on costs, so this is
+	 * really just to save some wasted effort.
+	 */
+	if (outer_path->parent->rows < 2)
+		return NULL;
+
+	/*
+	 * We can only have a result cache when there's some kind of cache key,
+	 * either parameterized path clauses or lateral Vars.  No cache key sounds
+	 * more like something a Materialize node might be more useful for.
+	 */
+	if ((inner_path->param_info == NULL ||
+		 inner_path->param_info->ppi_clauses == NIL) &&
+		innerrel->lateral_vars == NIL)
+		return NULL;
+
+	/*
+	 * Nested loop SEMI and ANTI joins don't scan the inner side to
+	 * completion, so the cache entry would never be marked as complete
+	 * unless the join is also unique, which we don't prove for these join
+	 * types.
+	 */
+	if (jointype == JOIN_SEMI || jointype == JOIN_ANTI)
+		return NULL;
+
+	/*
+	 * With a unique join, Nested Loop skips to the next outer tuple after
+	 * the first inner tuple that passes the join quals, so we mark cache
+	 * entries complete after caching their first tuple.  That is only
+	 * correct when the first tuple is also the match, that is when every
+	 * join clause is enforced by the inner path itself.  Otherwise there is
+	 * no way to know the entry is complete, so don't bother.
+	 */
+	if (extra->inner_unique)
+	{
+		if (inner_path->param_info == NULL)
+			return NULL;
+
+		foreach(lc, extra->restrictlist)
+		{
+			if (!list_member_ptr(inner_path->param_info->ppi_clauses,
+								 lfirst(lc)))
+				return NULL;
+		}
+	}
+
+	/*
+	 * We can't use a result cache if there are volatile functions in the
+	 * inner rel's target list or restrict list.  A cache hit could reduce the
+	 * number of calls to these functions.
+	 */
+	if (contain_volatile_functions((Node *) innerrel->reltarget->exprs))
+		return NULL;
+
+	foreach(lc, innerrel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (contain_volatile_functions((Node *) rinfo->clause))
+			return NULL;
+	}
+
+	/* Check if we have hash ops for each parameter to the path */
+	if (!paraminfo_get_equal_hashops(inner_path->param_info,
+									 outerrel,
+									 innerrel,
+									 &param_exprs,
+									 &hash_operators,
+									 &collations,
+									 &binary_mode))
+		return NULL;
+
+	return (Path *) create_resultcache_path(root,
+											innerrel,
+											inner_path,
+											param_exprs,
+											hash_operators,
+											collations,
+											binary_mode,
+											extra->inner_unique,
+											outer_path->parent->rows);
+}
+
 /*
  * sort_inner_and_outer
  *	  Create mergejoin join paths by explicitly sorting both the outer and
@@ -1471,6 +1706,7 @@ match_unsorted_outer(PlannerInfo *root,
 			foreach(lc2, innerrel->cheapest_parameterized_paths)
 			{
 				Path	   *innerpath = (Path *) lfirst(lc2);
+				Path	   *rcpath;
 
 				try_nestloop_path(root,
 								  joinrel,
@@ -1479,6 +1715,22 @@ match_unsorted_outer(PlannerInfo *root,
 								  merge_pathkeys,
 								  jointype,
 								  extra);
+
+				/*
+				 * Try generating a result cache path and see if that makes
+				 * the nested loop any cheaper.
+				 */
+				rcpath = get_resultcache_path(root, innerrel, outerrel,
+											  innerpath, outerpath, jointype,
+											  extra);
+				if (rcpath != NULL)
+					try_nestloop_path(root,
+									  joinrel,
+									  outerpath,
+									  rcpath,
+									  merge_pathkeys,
+									  jointype,
+									  extra);
 			}
 
 			/* Also consider materialized form of the cheapest inner path */
@@ -1658,6 +1910,23 @@ consider_parallel_nestloop(PlannerInfo *root,
 
 			try_partial_nestloop_path(root, joinrel, outerpath, innerpath,
 									  pathkeys, jointype, extra);
+
+			/*
+			 * Try generating a result cache path and see if that makes the
+			 * nested loop any cheaper.
+			 */
+			if (save_jointype != JOIN_UNIQUE_INNER)
+			{
+				Path	   *rcpath;
+
+				rcpath = get_resultcache_path(root, innerrel, outerrel,
+											  innerpath, outerpath, jointype,
+											  extra);
+				if (rcpath != NULL)
+					try_partial_nestloop_path(root, joinrel, outerpath,
+											  rcpath, pathkeys, jointype,
+											  extra);
+			}
 		}
 	}
 }
@@ -4850,7 +4850,7 @@ create_distinct_paths(PlannerInfo *root,
 	 * should prevent selection of hashing: if the query uses DISTINCT ON
 	 * (because it won't really have the expected behavior if we hash), or if
 	 * enable_hashagg is off, or if it looks like the hashtable will exceed
-	 * work_mem.
+	 * work_mem and enable_hashagg_disk is off.
 	 *
 	 * Note: grouping_is_hashable() is much more expensive to check than the
 	 * other gating conditions, so we want to do it last.
@@ -4859,6 +4859,8 @@ create_distinct_paths(PlannerInfo *root,
 		allow_hash = true;		/* we have no alternatives */
 	else if (parse->hasDistinctOn || !enable_hashagg)
 		allow_hash = false;		/* policy-based decision not to hash */
+	else if (enable_hashagg_disk)
+		allow_hash = true;		/* hashagg can spill if it must */
 	else
 	{
 		Size		hashentrysize;
@@ -4963,19 +4965,22 @@ create_ordered_paths(PlannerInfo *root,
 
 	foreach(lc, input_rel->pathlist)
 	{
-		Path	   *path = (Path *) lfirst(lc);
+		Path	   *input_path = (Path *) lfirst(lc);
+		Path	   *path = input_path;
 		bool		is_sorted;
+		int			presorted_keys;
 
-		is_sorted = pathkeys_contained_in(root->sort_pathkeys,
-										  path->pathkeys);
-		if (path == cheapest_input_path || is_sorted)
+		is_sorted = pathkeys_count_contained_in(root->sort_pathkeys,
+												input_path->pathkeys,
+												&presorted_keys);
+		if (input_path == cheapest_input_path || is_sorted)
 		{
 			if (!is_sorted)
 			{
 				/* An explicit sort here can take advantage of LIMIT */
 				path = (Path *) create_sort_path(root,
 												 ordered_rel,
-												 path,
+												 input_path,
 												 root->sort_pathkeys,
 												 limit_tuples);
 			}
@@ -4987,6 +4992,30 @@ create_ordered_paths(PlannerInfo *root,
 
 			add_path(ordered_rel, path);
 		}
+
+		/*
+		 * If the path is sorted by a prefix of the required pathkeys, an
+		 * incremental sort only needs to sort the groups sharing that prefix.
+		 * This is worth trying for any such path, not just the cheapest one,
+		 * since with a LIMIT it may be able to return the first rows much
+		 * sooner than a full sort.
+		 */
+		if (enable_incrementalsort && !is_sorted && presorted_keys > 0)
+		{
+			path = (Path *) create_incremental_sort_path(root,
+														 ordered_rel,
+														 input_path,
+														 root->sort_pathkeys,
+														 presorted_keys,
+														 limit_tuples);
+
+			/* Add projection step if needed */
+			if (path->pathtarget != target)
+				path = apply_projection_to_path(root, ordered_rel,
+												path, target);
+
+			add_path(ordered_rel, path);
+		}
 	}
 
 	/*
@@ -5038,6 +5067,52 @@ create_ordered_paths(PlannerInfo *root,
 
 			add_path(ordered_rel, path);
 		}
+
+		/*
+		 * Consider incremental sort on any partial path that is sorted by a
+		 * prefix of the required pathkeys, feeding a Gather Merge.
+		 */
+		if (enable_incrementalsort)
+		{
+			foreach(lc, input_rel->partial_pathlist)
+			{
+				Path	   *input_path = (Path *) lfirst(lc);
+				Path	   *path;
+				bool		is_sorted;
+				int			presorted_keys;
+				double		total_groups;
+
+				is_sorted = pathkeys_count_contained_in(root->sort_pathkeys,
+														input_path->pathkeys,
+														&presorted_keys);
+
+				/* Already-sorted and unsorted paths were handled above */
+				if (is_sorted || presorted_keys == 0)
+					continue;
+
+				path = (Path *) create_incremental_sort_path(root,
+															 ordered_rel,
+															 input_path,
+															 root->sort_pathkeys,
+															 presorted_keys,
+															 limit_tuples);
+				total_groups = input_path->rows *
+					input_path->parallel_workers;
+				path = (Path *)
+					create_gather_merge_path(root, ordered_rel,
+											 path,
+											 path->pathtarget,
+											 root->sort_pathkeys, NULL,
+											 &total_groups);
+
+				/* Add projection step if needed */
+				if (path->pathtarget != target)
+					path = apply_projection_to_path(root, ordered_rel,
+													path, target);
+
+				add_path(ordered_rel, path);
+			}
+		}
 	}
 
 	/*
@@ -6453,6 +6528,54 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 			}
 		}
 
+		/*
+		 * Consider incremental sort on input paths that are sorted by a
+		 * prefix of the grouping keys.  Grouping sets are left to the full
+		 * sort above, since each rollup may need a different order.
+		 */
+		if (enable_incrementalsort && !parse->groupingSets)
+		{
+			foreach(lc, input_rel->pathlist)
+			{
+				Path	   *path = (Path *) lfirst(lc);
+				int			presorted_keys;
+
+				if (pathkeys_count_contained_in(root->group_pathkeys,
+												path->pathkeys,
+												&presorted_keys) ||
+					presorted_keys == 0)
+					continue;
+
+				path = (Path *) create_incremental_sort_path(root,
+															 grouped_rel,
+															 path,
+															 root->group_pathkeys,
+															 presorted_keys,
+															 -1.0);
+
+				if (parse->hasAggs)
+					add_path(grouped_rel, (Path *)
+							 create_agg_path(root,
+											 grouped_rel,
+											 path,
+											 grouped_rel->reltarget,
+											 parse->groupClause ? AGG_SORTED : AGG_PLAIN,
+											 AGGSPLIT_SIMPLE,
+											 parse->groupClause,
+											 havingQual,
+											 agg_costs,
+											 dNumGroups));
+				else
+					add_path(grouped_rel, (Path *)
+							 create_group_path(root,
+											   grouped_rel,
+											   path,
+											   parse->groupClause,
+											   havingQual,
+											   dNumGroups));
+			}
+		}
+
 		/*
 		 * Instead of operating directly on the input relation, we can
 		 * consider finalizing a partially aggregated path.
@@ -6523,11 +6646,13 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 
 			/*
 			 * Provided that the estimated size of the hashtable does not
-			 * exceed work_mem, we'll generate a HashAgg Path, although if we
-			 * were unable to sort above, then we'd better generate a Path, so
-			 * that we at least have one.
+			 * exceed work_mem, or that hashagg is allowed to spill to disk,
+			 * we'll generate a HashAgg Path.  If we were unable to sort
+			 * above, then we'd better generate a Path anyway, so that we at
+			 * least have one.
 			 */
-			if (hashaggtablesize < work_mem * 1024L ||
+			if (enable_hashagg_disk ||
+				hashaggtablesize < work_mem * 1024L ||
 				grouped_rel->pathlist == NIL)
 			{
 				/*
@@ -6549,8 +6674,9 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 
 		/*
 		 * Generate a Finalize HashAgg Path atop of the cheapest partially
-		 * grouped path, assuming there is one. Once again, we'll only do this
-		 * if it looks as though the hash table won't exceed work_mem.
+		 * grouped path, assuming there is one. Once again, unless hashagg
+		 * may spill to disk, we'll only do this if it looks as though the
+		 * hash table won't exceed work_mem.
 		 */
 		if (partially_grouped_rel && partially_grouped_rel->pathlist)
 		{
@@ -6560,7 +6686,8 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 														  agg_final_costs,
 														  dNumGroups);
 
-			if (hashaggtablesize < work_mem * 1024L)
+			if (enable_hashagg_disk ||
+				hashaggtablesize < work_mem * 1024L)
 				add_path(grouped_rel, (Path *)
 						 create_agg_path(root,
 										 grouped_rel,
@@ -6827,9 +6954,10 @@ create_partial_grouping_paths(PlannerInfo *root,
 
 		/*
 		 * Tentatively produce a partial HashAgg Path, depending on if it
-		 * looks as if the hash table will fit in work_mem.
+		 * looks as if the hash table will fit in work_mem (or if hashagg is
+		 * allowed to spill to disk).
 		 */
-		if (hashaggtablesize < work_mem * 1024L &&
+		if ((enable_hashagg_disk || hashaggtablesize < work_mem * 1024L) &&
 			cheapest_total_path != NULL)
 		{
 			add_path(partially_grouped_rel, (Path *)
@@ -6856,7 +6984,7 @@ create_partial_grouping_paths(PlannerInfo *root,
 									   dNumPartialPartialGroups);
 
 		/* Do the same for partial paths. */
-		if (hashaggtablesize < work_mem * 1024L &&
+		if ((enable_hashagg_disk || hashaggtablesize < work_mem * 1024L) &&
 			cheapest_partial_path != NULL)
 		{
 			add_partial_path(partially_grouped_rel, (Path *)
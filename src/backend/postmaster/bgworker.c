@@ -15,6 +15,7 @@
 #include <unistd.h>
 
 #include "access/parallel.h"
+#include "access/xlogredoworker.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -129,6 +130,12 @@ static const struct
 	},
 	{
 		"ApplyWorkerMain", ApplyWorkerMain
+	},
+	{
+		"ParallelApplyWorkerMain", ParallelApplyWorkerMain
+	},
+	{
+		"RedoWorkerMain", RedoWorkerMain
 	}
 };
 
@@ -378,6 +378,8 @@ CheckpointerMain(void)
 			ExitOnAnyError = true;
 			/* Close down the database */
 			ShutdownXLOG(0, 0);
+			/* Save the shared table and function statistics */
+			pgstat_write_shared_stats();
 			/* Normal exit from the checkpointer is here */
 			proc_exit(0);		/* done */
 		}
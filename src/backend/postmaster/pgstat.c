@@ -38,9 +38,12 @@
 #include "access/transam.h"
 #include "access/twophase_rmgr.h"
 #include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlogprefetch.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_proc.h"
 #include "common/ip.h"
+#include "lib/dshash.h"
 #include "libpq/libpq.h"
 #include "libpq/pqsignal.h"
 #include "mb/pg_wchar.h"
@@ -103,6 +106,14 @@
 #define PGSTAT_TAB_HASH_SIZE	512
 #define PGSTAT_FUNCTION_HASH_SIZE	512
 
+/* ----------
+ * Size of the part of the shared-memory statistics area that's carved out of
+ * the main shared memory segment.  The area grows into DSM segments beyond
+ * that, as needed.
+ * ----------
+ */
+#define PGSTAT_SHMEM_DSA_INIT_SIZE	(256 * 1024)
+
 
 /* ----------
  * Total number of backends including auxiliary
@@ -154,7 +165,7 @@ static bool pgStatRunningInCollector = false;
 
 /*
  * Structures in which backends store per-table info that's waiting to be
- * sent to the collector.
+ * flushed to shared memory.
  *
  * NOTE: once allocated, TabStatusArray structures are never moved or deleted
  * for the life of the backend.  Also, we zero out the t_id fields of the
@@ -189,14 +200,14 @@ typedef struct TabStatHashEntry
 static HTAB *pgStatTabHash = NULL;
 
 /*
- * Backends store per-function info that's waiting to be sent to the collector
- * in this hash table (indexed by function OID).
+ * Backends store per-function info that's waiting to be flushed to shared
+ * memory in this hash table (indexed by function OID).
  */
 static HTAB *pgStatFunctions = NULL;
 
 /*
  * Indicates if backend has some function stats that it hasn't yet
- * sent to the collector.
+ * flushed to shared memory.
  */
 static bool have_function_stats = false;
 
@@ -236,10 +247,82 @@ typedef struct TwoPhasePgStatRecord
 } TwoPhasePgStatRecord;
 
 /*
- * Info about current "snapshot" of stats file
+ * Table and function statistics are kept in shared memory, in two dshash
+ * tables living in a DSA area that is created in place in the main shared
+ * memory segment.  Entries are keyed by database and object OID; objects of
+ * shared catalogs use InvalidOid as the database.
+ */
+typedef struct PgStat_SharedKey
+{
+	Oid			databaseid;
+	Oid			objectid;
+} PgStat_SharedKey;
+
+typedef struct PgStat_SharedTabEntry
+{
+	PgStat_SharedKey key;		/* hash key (must be first) */
+	PgStat_StatTabEntry stats;
+} PgStat_SharedTabEntry;
+
+typedef struct PgStat_SharedFuncEntry
+{
+	PgStat_SharedKey key;		/* hash key (must be first) */
+	PgStat_StatFuncEntry stats;
+} PgStat_SharedFuncEntry;
+
+typedef struct PgStat_ShmemControl
+{
+	dshash_table_handle tables_handle;
+	dshash_table_handle functions_handle;
+	/* the in-place DSA area follows, at PgStatShmemDSAPlace() */
+} PgStat_ShmemControl;
+
+#define PgStatShmemDSAPlace(ctl) \
+	((void *) ((char *) (ctl) + MAXALIGN(sizeof(PgStat_ShmemControl))))
+
+static const dshash_parameters tables_hash_params = {
+	sizeof(PgStat_SharedKey),
+	sizeof(PgStat_SharedTabEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static const dshash_parameters functions_hash_params = {
+	sizeof(PgStat_SharedKey),
+	sizeof(PgStat_SharedFuncEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static PgStat_ShmemControl *PgStatShmem = NULL;
+
+/* This backend's attachment to the shared statistics, if any */
+static dsa_area *pgStatDSA = NULL;
+static dshash_table *pgStatSharedTables = NULL;
+static dshash_table *pgStatSharedFunctions = NULL;
+
+/*
+ * Info about current "snapshot" of stats file, and of the shared-memory
+ * entries fetched so far in this transaction.  Entries that didn't exist are
+ * remembered too, so that repeated lookups give consistent answers.
  */
+typedef struct PgStat_LocalEntry
+{
+	PgStat_SharedKey key;		/* hash key (must be first) */
+	bool		found;
+	union
+	{
+		PgStat_StatTabEntry tab;
+		PgStat_StatFuncEntry func;
+	}			stats;
+} PgStat_LocalEntry;
+
 static MemoryContext pgStatLocalContext = NULL;
 static HTAB *pgStatDBHash = NULL;
+static HTAB *pgStatLocalTables = NULL;
+static HTAB *pgStatLocalFunctions = NULL;
 
 /* Status for backends including auxiliary */
 static LocalPgBackendStatus *localBackendStatusTable = NULL;
@@ -285,25 +368,34 @@ static pid_t pgstat_forkexec(void);
 NON_EXEC_STATIC void PgstatCollectorMain(int argc, char *argv[]) pg_attribute_noreturn();
 static void pgstat_exit(SIGNAL_ARGS);
 static void pgstat_beshutdown_hook(int code, Datum arg);
+static void pgstat_shutdown_hook(int code, Datum arg);
 static void pgstat_sighup_handler(SIGNAL_ARGS);
 
 static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
-												 Oid tableoid, bool create);
 static void pgstat_write_statsfiles(bool permanent, bool allDbs);
-static void pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent);
-static HTAB *pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep);
-static void pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash, bool permanent);
+static HTAB *pgstat_read_statsfiles(bool permanent);
 static void backend_read_statsfile(void);
 static void pgstat_read_current_status(void);
 
 static bool pgstat_write_statsfile_needed(void);
 static bool pgstat_db_requested(Oid databaseid);
 
-static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg);
-static void pgstat_send_funcstats(void);
+static void pgstat_flush_tabstat(PgStat_TableStatus *entry,
+								 PgStat_MsgDbstat *dbmsg);
+static void pgstat_send_dbstat(PgStat_MsgDbstat *dbmsg);
+static void pgstat_flush_funcstats(void);
 static HTAB *pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid);
 
+static bool pgstat_attach_shmem(void);
+static void pgstat_detach_shmem(void);
+static PgStat_SharedTabEntry *pgstat_get_shared_tabentry(Oid databaseid,
+													   Oid tableoid);
+static void pgstat_purge_shared_entries(dshash_table *hash, Oid databaseid,
+										HTAB *keep_oids);
+static void *pgstat_fetch_shared_entry(dshash_table *hash, HTAB **localhash,
+									   Oid databaseid, Oid objectid,
+									   size_t statsize);
+
 static PgStat_TableStatus *get_tabstat_entry(Oid rel_id, bool isshared);
 
 static void pgstat_setup_memcxt(void);
@@ -318,19 +410,14 @@ static void pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype);
 static void pgstat_send(void *msg, int len);
 
 static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
-static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
-static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
+static void pgstat_recv_dbstat(PgStat_MsgDbstat *msg, int len);
 static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
 static void pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len);
 static void pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len);
 static void pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len);
 static void pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len);
-static void pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len);
-static void pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len);
 static void pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len);
 static void pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len);
-static void pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len);
-static void pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len);
 static void pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len);
 static void pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len);
 static void pgstat_recv_checksum_failure(PgStat_MsgChecksumFailure *msg, int len);
@@ -647,10 +734,13 @@ pgstat_reset_remove_files(const char *directory)
 
 		/*
 		 * Skip directory entries that don't match the file names we write.
-		 * See get_dbstat_filename for the database-specific pattern.
+		 * Per-database files aren't written anymore, but remove any left
+		 * behind by older versions too.
 		 */
 		if (strncmp(entry->d_name, "global.", 7) == 0)
 			nchars = 7;
+		else if (strncmp(entry->d_name, "shared.", 7) == 0)
+			nchars = 7;
 		else
 		{
 			nchars = 0;
@@ -801,10 +891,11 @@ allow_immediate_pgstat_restart(void)
  * pgstat_report_stat() -
  *
  *	Must be called by processes that performs DML: tcop/postgres.c, logical
- *	receiver processes, SPI worker, etc. to send the so far collected
- *	per-table and function usage statistics to the collector.  Note that this
- *	is called only when not within a transaction, so it is fair to use
- *	transaction stop time as an approximation of current time.
+ *	receiver processes, SPI worker, etc. to flush the so far collected
+ *	per-table and function usage statistics to shared memory, and the
+ *	database-wide totals to the collector.  Note that this is called only
+ *	when not within a transaction, so it is fair to use transaction stop time
+ *	as an approximation of current time.
  * ----------
  */
 void
@@ -815,8 +906,8 @@ pgstat_report_stat(bool force)
 	static TimestampTz last_report = 0;
 
 	TimestampTz now;
-	PgStat_MsgTabstat regular_msg;
-	PgStat_MsgTabstat shared_msg;
+	PgStat_MsgDbstat regular_msg;
+	PgStat_MsgDbstat shared_msg;
 	TabStatusArray *tsa;
 	int			i;
 
@@ -827,8 +918,9 @@ pgstat_report_stat(bool force)
 		return;
 
 	/*
-	 * Don't send a message unless it's been at least PGSTAT_STAT_INTERVAL
-	 * msec since we last sent one, or the caller wants to force stats out.
+	 * Don't flush unless it's been at least PGSTAT_STAT_INTERVAL msec since
+	 * we last did, or the caller wants to force stats out.  Batching the
+	 * updates this way keeps the traffic on the shared hash tables low.
 	 */
 	now = GetCurrentTransactionStopTimestamp();
 	if (!force &&
@@ -836,6 +928,9 @@ pgstat_report_stat(bool force)
 		return;
 	last_report = now;
 
+	if (!pgstat_attach_shmem())
+		return;
+
 	/*
 	 * Destroy pgStatTabHash before we start invalidating PgStat_TableEntry
 	 * entries it points to.  (Should we fail partway through the loop below,
@@ -849,22 +944,20 @@ pgstat_report_stat(bool force)
 
 	/*
 	 * Scan through the TabStatusArray struct(s) to find tables that actually
-	 * have counts, and build messages to send.  We have to separate shared
-	 * relations from regular ones because the databaseid field in the message
-	 * header has to depend on that.
+	 * have counts, and add them to their shared entries.  The database-wide
+	 * sums are accumulated separately for shared relations and regular ones,
+	 * because they're charged to different databases.
 	 */
+	memset(&regular_msg, 0, sizeof(regular_msg));
+	memset(&shared_msg, 0, sizeof(shared_msg));
 	regular_msg.m_databaseid = MyDatabaseId;
 	shared_msg.m_databaseid = InvalidOid;
-	regular_msg.m_nentries = 0;
-	shared_msg.m_nentries = 0;
 
 	for (tsa = pgStatTabList; tsa != NULL; tsa = tsa->tsa_next)
 	{
 		for (i = 0; i < tsa->tsa_used; i++)
 		{
 			PgStat_TableStatus *entry = &tsa->tsa_entries[i];
-			PgStat_MsgTabstat *this_msg;
-			PgStat_TableEntry *this_ent;
 
 			/* Shouldn't have any pending transaction-dependent counts */
 			Assert(entry->trans == NULL);
@@ -877,19 +970,8 @@ pgstat_report_stat(bool force)
 					   sizeof(PgStat_TableCounts)) == 0)
 				continue;
 
-			/*
-			 * OK, insert data into the appropriate message, and send if full.
-			 */
-			this_msg = entry->t_shared ? &shared_msg : &regular_msg;
-			this_ent = &this_msg->m_entry[this_msg->m_nentries];
-			this_ent->t_id = entry->t_id;
-			memcpy(&this_ent->t_counts, &entry->t_counts,
-				   sizeof(PgStat_TableCounts));
-			if (++this_msg->m_nentries >= PGSTAT_NUM_TABENTRIES)
-			{
-				pgstat_send_tabstat(this_msg);
-				this_msg->m_nentries = 0;
-			}
+			pgstat_flush_tabstat(entry,
+								 entry->t_shared ? &shared_msg : &regular_msg);
 		}
 		/* zero out PgStat_TableStatus structs after use */
 		MemSet(tsa->tsa_entries, 0,
@@ -898,115 +980,156 @@ pgstat_report_stat(bool force)
 	}
 
 	/*
-	 * Send partial messages.  Make sure that any pending xact commit/abort
-	 * gets counted, even if there are no table stats to send.
+	 * Send the database-wide totals.  Make sure that any pending xact
+	 * commit/abort gets counted, even if there are no table stats.
 	 */
-	if (regular_msg.m_nentries > 0 ||
-		pgStatXactCommit > 0 || pgStatXactRollback > 0)
-		pgstat_send_tabstat(&regular_msg);
-	if (shared_msg.m_nentries > 0)
-		pgstat_send_tabstat(&shared_msg);
-
-	/* Now, send function statistics */
-	pgstat_send_funcstats();
+	pgstat_send_dbstat(&regular_msg);
+	pgstat_send_dbstat(&shared_msg);
+
+	/* Now, flush function statistics */
+	pgstat_flush_funcstats();
 }
 
 /*
- * Subroutine for pgstat_report_stat: finish and send a tabstat message
+ * Subroutine for pgstat_report_stat: add one table's pending counts to its
+ * shared entry, and to the database-wide totals in *dbmsg
  */
 static void
-pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
+pgstat_flush_tabstat(PgStat_TableStatus *entry, PgStat_MsgDbstat *dbmsg)
 {
-	int			n;
-	int			len;
+	PgStat_TableCounts *counts = &entry->t_counts;
+	PgStat_SharedTabEntry *shentry;
+	PgStat_StatTabEntry *tabentry;
 
-	/* It's unlikely we'd get here with no socket, but maybe not impossible */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
+	shentry = pgstat_get_shared_tabentry(dbmsg->m_databaseid, entry->t_id);
+	tabentry = &shentry->stats;
+
+	tabentry->numscans += counts->t_numscans;
+	tabentry->tuples_returned += counts->t_tuples_returned;
+	tabentry->tuples_fetched += counts->t_tuples_fetched;
+	tabentry->tuples_inserted += counts->t_tuples_inserted;
+	tabentry->tuples_updated += counts->t_tuples_updated;
+	tabentry->tuples_deleted += counts->t_tuples_deleted;
+	tabentry->tuples_hot_updated += counts->t_tuples_hot_updated;
+	/* If table was truncated, first reset the live/dead counters */
+	if (counts->t_truncated)
+	{
+		tabentry->n_live_tuples = 0;
+		tabentry->n_dead_tuples = 0;
+	}
+	tabentry->n_live_tuples += counts->t_delta_live_tuples;
+	tabentry->n_dead_tuples += counts->t_delta_dead_tuples;
+	tabentry->changes_since_analyze += counts->t_changed_tuples;
+	tabentry->blocks_fetched += counts->t_blocks_fetched;
+	tabentry->blocks_hit += counts->t_blocks_hit;
+
+	/* Clamp n_live_tuples in case of negative delta_live_tuples */
+	tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
+	/* Likewise for n_dead_tuples */
+	tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+
+	dshash_release_lock(pgStatSharedTables, shentry);
+
+	/*
+	 * Add per-table stats to the per-database totals, too.
+	 */
+	dbmsg->m_tuples_returned += counts->t_tuples_returned;
+	dbmsg->m_tuples_fetched += counts->t_tuples_fetched;
+	dbmsg->m_tuples_inserted += counts->t_tuples_inserted;
+	dbmsg->m_tuples_updated += counts->t_tuples_updated;
+	dbmsg->m_tuples_deleted += counts->t_tuples_deleted;
+	dbmsg->m_blocks_fetched += counts->t_blocks_fetched;
+	dbmsg->m_blocks_hit += counts->t_blocks_hit;
+}
+
+/*
+ * Subroutine for pgstat_report_stat: finish and send a dbstat message
+ */
+static void
+pgstat_send_dbstat(PgStat_MsgDbstat *dbmsg)
+{
+	/* we assume this inits to all zeroes: */
+	static const PgStat_MsgDbstat all_zeroes;
 
 	/*
 	 * Report and reset accumulated xact commit/rollback and I/O timings
-	 * whenever we send a normal tabstat message
+	 * whenever we send a message for our own database
 	 */
-	if (OidIsValid(tsmsg->m_databaseid))
+	if (OidIsValid(dbmsg->m_databaseid))
 	{
-		tsmsg->m_xact_commit = pgStatXactCommit;
-		tsmsg->m_xact_rollback = pgStatXactRollback;
-		tsmsg->m_block_read_time = pgStatBlockReadTime;
-		tsmsg->m_block_write_time = pgStatBlockWriteTime;
+		dbmsg->m_xact_commit = pgStatXactCommit;
+		dbmsg->m_xact_rollback = pgStatXactRollback;
+		dbmsg->m_block_read_time = pgStatBlockReadTime;
+		dbmsg->m_block_write_time = pgStatBlockWriteTime;
 		pgStatXactCommit = 0;
 		pgStatXactRollback = 0;
 		pgStatBlockReadTime = 0;
 		pgStatBlockWriteTime = 0;
 	}
-	else
-	{
-		tsmsg->m_xact_commit = 0;
-		tsmsg->m_xact_rollback = 0;
-		tsmsg->m_block_read_time = 0;
-		tsmsg->m_block_write_time = 0;
-	}
 
-	n = tsmsg->m_nentries;
-	len = offsetof(PgStat_MsgTabstat, m_entry[0]) +
-		n * sizeof(PgStat_TableEntry);
+	/* Don't bother the collector if there's nothing to report */
+	if (memcmp(&dbmsg->m_xact_commit, &all_zeroes.m_xact_commit,
+			   sizeof(PgStat_MsgDbstat) -
+			   offsetof(PgStat_MsgDbstat, m_xact_commit)) == 0)
+		return;
+
+	/* It's unlikely we'd get here with no socket, but maybe not impossible */
+	if (pgStatSock == PGINVALID_SOCKET)
+		return;
 
-	pgstat_setheader(&tsmsg->m_hdr, PGSTAT_MTYPE_TABSTAT);
-	pgstat_send(tsmsg, len);
+	pgstat_setheader(&dbmsg->m_hdr, PGSTAT_MTYPE_DBSTAT);
+	pgstat_send(dbmsg, sizeof(PgStat_MsgDbstat));
 }
 
 /*
- * Subroutine for pgstat_report_stat: populate and send a function stat message
+ * Subroutine for pgstat_report_stat: flush function stats to shared memory
  */
 static void
-pgstat_send_funcstats(void)
+pgstat_flush_funcstats(void)
 {
 	/* we assume this inits to all zeroes: */
 	static const PgStat_FunctionCounts all_zeroes;
 
-	PgStat_MsgFuncstat msg;
 	PgStat_BackendFunctionEntry *entry;
 	HASH_SEQ_STATUS fstat;
 
 	if (pgStatFunctions == NULL)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_FUNCSTAT);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_nentries = 0;
-
 	hash_seq_init(&fstat, pgStatFunctions);
 	while ((entry = (PgStat_BackendFunctionEntry *) hash_seq_search(&fstat)) != NULL)
 	{
-		PgStat_FunctionEntry *m_ent;
+		PgStat_SharedKey key;
+		PgStat_SharedFuncEntry *shentry;
+		bool		found;
 
 		/* Skip it if no counts accumulated since last time */
 		if (memcmp(&entry->f_counts, &all_zeroes,
 				   sizeof(PgStat_FunctionCounts)) == 0)
 			continue;
 
-		/* need to convert format of time accumulators */
-		m_ent = &msg.m_entry[msg.m_nentries];
-		m_ent->f_id = entry->f_id;
-		m_ent->f_numcalls = entry->f_counts.f_numcalls;
-		m_ent->f_total_time = INSTR_TIME_GET_MICROSEC(entry->f_counts.f_total_time);
-		m_ent->f_self_time = INSTR_TIME_GET_MICROSEC(entry->f_counts.f_self_time);
-
-		if (++msg.m_nentries >= PGSTAT_NUM_FUNCENTRIES)
+		key.databaseid = MyDatabaseId;
+		key.objectid = entry->f_id;
+		shentry = dshash_find_or_insert(pgStatSharedFunctions, &key, &found);
+		if (!found)
 		{
-			pgstat_send(&msg, offsetof(PgStat_MsgFuncstat, m_entry[0]) +
-						msg.m_nentries * sizeof(PgStat_FunctionEntry));
-			msg.m_nentries = 0;
+			memset(&shentry->stats, 0, sizeof(PgStat_StatFuncEntry));
+			shentry->stats.functionid = entry->f_id;
 		}
 
+		/* need to convert format of time accumulators */
+		shentry->stats.f_numcalls += entry->f_counts.f_numcalls;
+		shentry->stats.f_total_time +=
+			INSTR_TIME_GET_MICROSEC(entry->f_counts.f_total_time);
+		shentry->stats.f_self_time +=
+			INSTR_TIME_GET_MICROSEC(entry->f_counts.f_self_time);
+
+		dshash_release_lock(pgStatSharedFunctions, shentry);
+
 		/* reset the entry's counts */
 		MemSet(&entry->f_counts, 0, sizeof(PgStat_FunctionCounts));
 	}
 
-	if (msg.m_nentries > 0)
-		pgstat_send(&msg, offsetof(PgStat_MsgFuncstat, m_entry[0]) +
-					msg.m_nentries * sizeof(PgStat_FunctionEntry));
-
 	have_function_stats = false;
 }
 
@@ -1014,20 +1137,20 @@ pgstat_send_funcstats(void)
 /* ----------
  * pgstat_vacuum_stat() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Get rid of statistics entries for objects that no longer exist: tell the
+ *	collector about dropped databases, and remove our database's dead tables
+ *	and functions from shared memory.
  * ----------
  */
 void
 pgstat_vacuum_stat(void)
 {
 	HTAB	   *htab;
-	PgStat_MsgTabpurge msg;
-	PgStat_MsgFuncpurge f_msg;
 	HASH_SEQ_STATUS hstat;
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	int			len;
+	dshash_seq_status dstat;
+	PgStat_SharedFuncEntry *funcentry;
+	bool		have_functions;
 
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
@@ -1044,8 +1167,7 @@ pgstat_vacuum_stat(void)
 	htab = pgstat_collect_oids(DatabaseRelationId, Anum_pg_database_oid);
 
 	/*
-	 * Search the database hash table for dead databases and tell the
-	 * collector to drop them.
+	 * Search the database hash table for dead databases and drop them.
 	 */
 	hash_seq_init(&hstat, pgStatDBHash);
 	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
@@ -1063,128 +1185,38 @@ pgstat_vacuum_stat(void)
 	/* Clean up */
 	hash_destroy(htab);
 
-	/*
-	 * Lookup our own database entry; if not found, nothing more to do.
-	 */
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &MyDatabaseId,
-												 HASH_FIND, NULL);
-	if (dbentry == NULL || dbentry->tables == NULL)
+	if (!pgstat_attach_shmem())
 		return;
 
 	/*
-	 * Similarly to above, make a list of all known relations in this DB.
+	 * Similarly to above, make a list of all known relations in this DB, and
+	 * remove the shared entries of all other relations of this DB.
 	 */
 	htab = pgstat_collect_oids(RelationRelationId, Anum_pg_class_oid);
+	pgstat_purge_shared_entries(pgStatSharedTables, MyDatabaseId, htab);
+	hash_destroy(htab);
 
 	/*
-	 * Initialize our messages table counter to zero
-	 */
-	msg.m_nentries = 0;
-
-	/*
-	 * Check for all tables listed in stats hashtable if they still exist.
+	 * Now repeat the above steps for functions.  However, we needn't bother
+	 * scanning pg_proc in the common case where no function stats are being
+	 * collected.
 	 */
-	hash_seq_init(&hstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&hstat)) != NULL)
+	have_functions = false;
+	dshash_seq_init(&dstat, pgStatSharedFunctions, false);
+	while ((funcentry = dshash_seq_next(&dstat)) != NULL)
 	{
-		Oid			tabid = tabentry->tableid;
-
-		CHECK_FOR_INTERRUPTS();
-
-		if (hash_search(htab, (void *) &tabid, HASH_FIND, NULL) != NULL)
-			continue;
-
-		/*
-		 * Not there, so add this table's Oid to the message
-		 */
-		msg.m_tableid[msg.m_nentries++] = tabid;
-
-		/*
-		 * If the message is full, send it out and reinitialize to empty
-		 */
-		if (msg.m_nentries >= PGSTAT_NUM_TABPURGE)
+		if (funcentry->key.databaseid == MyDatabaseId)
 		{
-			len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-				+ msg.m_nentries * sizeof(Oid);
-
-			pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-			msg.m_databaseid = MyDatabaseId;
-			pgstat_send(&msg, len);
-
-			msg.m_nentries = 0;
+			have_functions = true;
+			break;
 		}
 	}
+	dshash_seq_term(&dstat);
 
-	/*
-	 * Send the rest
-	 */
-	if (msg.m_nentries > 0)
-	{
-		len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-			+ msg.m_nentries * sizeof(Oid);
-
-		pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-		msg.m_databaseid = MyDatabaseId;
-		pgstat_send(&msg, len);
-	}
-
-	/* Clean up */
-	hash_destroy(htab);
-
-	/*
-	 * Now repeat the above steps for functions.  However, we needn't bother
-	 * in the common case where no function stats are being collected.
-	 */
-	if (dbentry->functions != NULL &&
-		hash_get_num_entries(dbentry->functions) > 0)
+	if (have_functions)
 	{
 		htab = pgstat_collect_oids(ProcedureRelationId, Anum_pg_proc_oid);
-
-		pgstat_setheader(&f_msg.m_hdr, PGSTAT_MTYPE_FUNCPURGE);
-		f_msg.m_databaseid = MyDatabaseId;
-		f_msg.m_nentries = 0;
-
-		hash_seq_init(&hstat, dbentry->functions);
-		while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&hstat)) != NULL)
-		{
-			Oid			funcid = funcentry->functionid;
-
-			CHECK_FOR_INTERRUPTS();
-
-			if (hash_search(htab, (void *) &funcid, HASH_FIND, NULL) != NULL)
-				continue;
-
-			/*
-			 * Not there, so add this function's Oid to the message
-			 */
-			f_msg.m_functionid[f_msg.m_nentries++] = funcid;
-
-			/*
-			 * If the message is full, send it out and reinitialize to empty
-			 */
-			if (f_msg.m_nentries >= PGSTAT_NUM_FUNCPURGE)
-			{
-				len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-					+ f_msg.m_nentries * sizeof(Oid);
-
-				pgstat_send(&f_msg, len);
-
-				f_msg.m_nentries = 0;
-			}
-		}
-
-		/*
-		 * Send the rest
-		 */
-		if (f_msg.m_nentries > 0)
-		{
-			len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-				+ f_msg.m_nentries * sizeof(Oid);
-
-			pgstat_send(&f_msg, len);
-		}
-
+		pgstat_purge_shared_entries(pgStatSharedFunctions, MyDatabaseId, htab);
 		hash_destroy(htab);
 	}
 }
@@ -1244,7 +1276,8 @@ pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
+ *	Remove the shared table and function entries of a database we just
+ *	dropped, and tell the collector about it.
  *	(If the message gets lost, we will still clean the dead DB eventually
  *	via future invocations of pgstat_vacuum_stat().)
  * ----------
@@ -1254,6 +1287,12 @@ pgstat_drop_database(Oid databaseid)
 {
 	PgStat_MsgDropdb msg;
 
+	if (pgstat_attach_shmem())
+	{
+		pgstat_purge_shared_entries(pgStatSharedTables, databaseid, NULL);
+		pgstat_purge_shared_entries(pgStatSharedFunctions, databaseid, NULL);
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1266,9 +1305,7 @@ pgstat_drop_database(Oid databaseid)
 /* ----------
  * pgstat_drop_relation() -
  *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Remove the shared entry of a relation we just dropped.
  *
  *	Currently not used for lack of any good place to call it; we rely
  *	entirely on pgstat_vacuum_stat() to clean out stats for dead rels.
@@ -1278,20 +1315,14 @@ pgstat_drop_database(Oid databaseid)
 void
 pgstat_drop_relation(Oid relid)
 {
-	PgStat_MsgTabpurge msg;
-	int			len;
+	PgStat_SharedKey key;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (!pgstat_attach_shmem())
 		return;
 
-	msg.m_tableid[0] = relid;
-	msg.m_nentries = 1;
-
-	len = offsetof(PgStat_MsgTabpurge, m_tableid[0]) + sizeof(Oid);
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, len);
+	key.databaseid = MyDatabaseId;
+	key.objectid = relid;
+	(void) dshash_delete_key(pgStatSharedTables, &key);
 }
 #endif							/* NOT_USED */
 
@@ -1299,7 +1330,8 @@ pgstat_drop_relation(Oid relid)
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Reset the table and function counters for our database, and tell the
+ *	statistics collector to reset the database-wide ones.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1310,6 +1342,12 @@ pgstat_reset_counters(void)
 {
 	PgStat_MsgResetcounter msg;
 
+	if (pgstat_attach_shmem())
+	{
+		pgstat_purge_shared_entries(pgStatSharedTables, MyDatabaseId, NULL);
+		pgstat_purge_shared_entries(pgStatSharedFunctions, MyDatabaseId, NULL);
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1332,6 +1370,20 @@ pgstat_reset_shared_counters(const char *target)
 {
 	PgStat_MsgResetsharedcounter msg;
 
+	/* Recovery prefetch statistics are kept in shared memory */
+	if (strcmp(target, "recovery_prefetch") == 0)
+	{
+		XLogPrefetchRequestReset();
+		return;
+	}
+
+	/* So are the group commit histograms */
+	if (strcmp(target, "wal_flush") == 0)
+	{
+		ResetXLogFlushHistogram();
+		return;
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1343,7 +1395,7 @@ pgstat_reset_shared_counters(const char *target)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"archiver\" or \"bgwriter\".")));
+				 errhint("Target must be \"archiver\", \"bgwriter\", \"recovery_prefetch\" or \"wal_flush\".")));
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
 	pgstat_send(&msg, sizeof(msg));
@@ -1352,7 +1404,8 @@ pgstat_reset_shared_counters(const char *target)
 /* ----------
  * pgstat_reset_single_counter() -
  *
- *	Tell the statistics collector to reset a single counter.
+ *	Reset a single table's or function's counters, and tell the statistics
+ *	collector to update the database's reset timestamp.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1362,14 +1415,24 @@ void
 pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
 	PgStat_MsgResetsinglecounter msg;
+	PgStat_SharedKey key;
+
+	if (pgstat_attach_shmem())
+	{
+		/* Remove object if it exists, ignore it if not */
+		key.databaseid = MyDatabaseId;
+		key.objectid = objoid;
+		if (type == RESET_TABLE)
+			(void) dshash_delete_key(pgStatSharedTables, &key);
+		else if (type == RESET_FUNCTION)
+			(void) dshash_delete_key(pgStatSharedFunctions, &key);
+	}
 
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSINGLECOUNTER);
 	msg.m_databaseid = MyDatabaseId;
-	msg.m_resettype = type;
-	msg.m_objectid = objoid;
 
 	pgstat_send(&msg, sizeof(msg));
 }
@@ -1401,32 +1464,47 @@ pgstat_report_autovac(Oid dboid)
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Store the results of the VACUUM we just did in the table's entry.
  * ---------
  */
 void
 pgstat_report_vacuum(Oid tableoid, bool shared,
 					 PgStat_Counter livetuples, PgStat_Counter deadtuples)
 {
-	PgStat_MsgVacuum msg;
+	PgStat_SharedTabEntry *shentry;
+	PgStat_StatTabEntry *tabentry;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts || !pgstat_attach_shmem())
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
-	msg.m_databaseid = shared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = tableoid;
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_vacuumtime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	ts = GetCurrentTimestamp();
+
+	shentry = pgstat_get_shared_tabentry(shared ? InvalidOid : MyDatabaseId,
+										 tableoid);
+	tabentry = &shentry->stats;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_vacuum_timestamp = ts;
+		tabentry->autovac_vacuum_count++;
+	}
+	else
+	{
+		tabentry->vacuum_timestamp = ts;
+		tabentry->vacuum_count++;
+	}
+
+	dshash_release_lock(pgStatSharedTables, shentry);
 }
 
 /* --------
  * pgstat_report_analyze() -
  *
- *	Tell the collector about the table we just analyzed.
+ *	Store the results of the ANALYZE we just did in the table's entry.
  *
  * Caller must provide new live- and dead-tuples estimates, as well as a
  * flag indicating whether to reset the changes_since_analyze counter.
@@ -1437,9 +1515,11 @@ pgstat_report_analyze(Relation rel,
 					  PgStat_Counter livetuples, PgStat_Counter deadtuples,
 					  bool resetcounter)
 {
-	PgStat_MsgAnalyze msg;
+	PgStat_SharedTabEntry *shentry;
+	PgStat_StatTabEntry *tabentry;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts || !pgstat_attach_shmem())
 		return;
 
 	/*
@@ -1447,10 +1527,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
-	 * be double-counted after commit.  (This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
-	 * committing.)
+	 * off these counts from what we store now, else they'll be double-counted
+	 * after commit.  (This approach also ensures that the shared entry ends
+	 * up with the right numbers if we abort instead of committing.)
 	 */
 	if (rel->pgstat_info != NULL)
 	{
@@ -1468,15 +1547,36 @@ pgstat_report_analyze(Relation rel,
 		deadtuples = Max(deadtuples, 0);
 	}
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_ANALYZE);
-	msg.m_databaseid = rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = RelationGetRelid(rel);
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_resetcounter = resetcounter;
-	msg.m_analyzetime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	ts = GetCurrentTimestamp();
+
+	shentry = pgstat_get_shared_tabentry(rel->rd_rel->relisshared ?
+										 InvalidOid : MyDatabaseId,
+										 RelationGetRelid(rel));
+	tabentry = &shentry->stats;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * If commanded, reset changes_since_analyze to zero.  This forgets any
+	 * changes that were committed while the ANALYZE was in progress, but we
+	 * have no good way to estimate how many of those there were.
+	 */
+	if (resetcounter)
+		tabentry->changes_since_analyze = 0;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_analyze_timestamp = ts;
+		tabentry->autovac_analyze_count++;
+	}
+	else
+	{
+		tabentry->analyze_timestamp = ts;
+		tabentry->analyze_count++;
+	}
+
+	dshash_release_lock(pgStatSharedTables, shentry);
 }
 
 /* --------
@@ -2449,56 +2549,41 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one table or NULL. NULL doesn't mean
- *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the table doesn't exist, it is just not yet known to the
+ *	statistics system, so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatTabEntry *
 pgstat_fetch_stat_tabentry(Oid relid)
 {
-	Oid			dbid;
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
 
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
+	/* Look in our database first; if not found, maybe it's a shared table */
+	tabentry = pgstat_fetch_stat_tabentry_extended(false, relid);
+	if (tabentry == NULL)
+		tabentry = pgstat_fetch_stat_tabentry_extended(true, relid);
 
-	/*
-	 * Lookup our database, then look in its table hash table.
-	 */
-	dbid = MyDatabaseId;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
-	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
-	}
+	return tabentry;
+}
 
-	/*
-	 * If we didn't find it, maybe it's a shared table.
-	 */
-	dbid = InvalidOid;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
-	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
-	}
 
-	return NULL;
+/* ----------
+ * pgstat_fetch_stat_tabentry_extended() -
+ *
+ *	As above, but only look in either our own database or the shared
+ *	catalogs, as the caller says.
+ * ----------
+ */
+PgStat_StatTabEntry *
+pgstat_fetch_stat_tabentry_extended(bool shared, Oid relid)
+{
+	if (!pgstat_attach_shmem())
+		return NULL;
+
+	return (PgStat_StatTabEntry *)
+		pgstat_fetch_shared_entry(pgStatSharedTables, &pgStatLocalTables,
+								  shared ? InvalidOid : MyDatabaseId, relid,
+								  sizeof(PgStat_StatTabEntry));
 }
 
 
@@ -2512,22 +2597,13 @@ pgstat_fetch_stat_tabentry(Oid relid)
 PgStat_StatFuncEntry *
 pgstat_fetch_stat_funcentry(Oid func_id)
 {
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatFuncEntry *funcentry = NULL;
-
-	/* load the stats file if needed */
-	backend_read_statsfile();
-
-	/* Lookup our database, then find the requested function.  */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-	if (dbentry != NULL && dbentry->functions != NULL)
-	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-														 (void *) &func_id,
-														 HASH_FIND, NULL);
-	}
+	if (!pgstat_attach_shmem())
+		return NULL;
 
-	return funcentry;
+	return (PgStat_StatFuncEntry *)
+		pgstat_fetch_shared_entry(pgStatSharedFunctions, &pgStatLocalFunctions,
+								  MyDatabaseId, func_id,
+								  sizeof(PgStat_StatFuncEntry));
 }
 
 
@@ -2798,30 +2874,440 @@ CreateSharedBackendStatus(void)
 }
 
 
-/* ----------
- * pgstat_initialize() -
- *
- *	Initialize pgstats state, and set up our on-proc-exit hook.
- *	Called from InitPostgres and AuxiliaryProcessMain. For auxiliary process,
- *	MyBackendId is invalid. Otherwise, MyBackendId must be set,
- *	but we must not have started any transaction yet (since the
- *	exit hook must run after the last transaction exit).
- *	NOTE: MyDatabaseId isn't set yet; so the shutdown hook has to be careful.
- * ----------
+/* ------------------------------------------------------------
+ * Functions for management of the shared-memory table and function stats
+ * ------------------------------------------------------------
+ */
+
+/*
+ * Report shared-memory space needed by PgStatShmemInit.  The DSA area is
+ * created in place, so its initial segment is part of the main shared memory
+ * segment; it grows into DSM segments if that's not enough.
+ */
+Size
+PgStatShmemSize(void)
+{
+	return add_size(MAXALIGN(sizeof(PgStat_ShmemControl)),
+					PGSTAT_SHMEM_DSA_INIT_SIZE);
+}
+
+/*
+ * Initialize the shared-memory statistics area and its hash tables
  */
 void
-pgstat_initialize(void)
+PgStatShmemInit(void)
 {
-	/* Initialize MyBEEntry */
-	if (MyBackendId != InvalidBackendId)
+	bool		found;
+
+	PgStatShmem = (PgStat_ShmemControl *)
+		ShmemInitStruct("Shared Memory Stats", PgStatShmemSize(), &found);
+
+	if (!IsUnderPostmaster)
 	{
-		Assert(MyBackendId >= 1 && MyBackendId <= MaxBackends);
-		MyBEEntry = &BackendStatusArray[MyBackendId - 1];
+		dsa_area   *area;
+		dshash_table *tables;
+		dshash_table *functions;
+
+		Assert(!found);
+
+		area = dsa_create_in_place(PgStatShmemDSAPlace(PgStatShmem),
+								   PGSTAT_SHMEM_DSA_INIT_SIZE,
+								   LWTRANCHE_PGSTATS_DSA, NULL);
+		dsa_pin(area);
+
+		/*
+		 * The postmaster must not create DSM segments, so make sure the hash
+		 * tables are created within the in-place part of the area.  Backends
+		 * lift the limit when they attach.
+		 */
+		dsa_set_size_limit(area, PGSTAT_SHMEM_DSA_INIT_SIZE);
+
+		tables = dshash_create(area, &tables_hash_params, NULL);
+		functions = dshash_create(area, &functions_hash_params, NULL);
+		PgStatShmem->tables_handle = dshash_get_hash_table_handle(tables);
+		PgStatShmem->functions_handle = dshash_get_hash_table_handle(functions);
+
+		dsa_set_size_limit(area, -1);
+
+		dshash_detach(tables);
+		dshash_detach(functions);
+		dsa_detach(area);
 	}
 	else
-	{
-		/* Must be an auxiliary process */
-		Assert(MyAuxProcType != NotAnAuxProcess);
+		Assert(found);
+}
+
+/*
+ * Attach to the shared statistics, if not already done.
+ *
+ * Returns false if the shared memory area hasn't been set up in this process.
+ */
+static bool
+pgstat_attach_shmem(void)
+{
+	MemoryContext oldcontext;
+
+	if (pgStatDSA != NULL)
+		return true;
+
+	if (PgStatShmem == NULL)
+		return false;
+
+	/* The attachment must survive until process exit */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	pgStatDSA = dsa_attach_in_place(PgStatShmemDSAPlace(PgStatShmem), NULL);
+	dsa_pin_mapping(pgStatDSA);
+
+	pgStatSharedTables = dshash_attach(pgStatDSA, &tables_hash_params,
+									   PgStatShmem->tables_handle, NULL);
+	pgStatSharedFunctions = dshash_attach(pgStatDSA, &functions_hash_params,
+										  PgStatShmem->functions_handle, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return true;
+}
+
+/*
+ * Detach from the shared statistics, if attached
+ */
+static void
+pgstat_detach_shmem(void)
+{
+	if (pgStatDSA == NULL)
+		return;
+
+	dshash_detach(pgStatSharedTables);
+	dshash_detach(pgStatSharedFunctions);
+	dsa_detach(pgStatDSA);
+
+	pgStatSharedTables = NULL;
+	pgStatSharedFunctions = NULL;
+	pgStatDSA = NULL;
+}
+
+/*
+ * Find or create the shared entry of a table.  The entry is returned with
+ * its partition lock held exclusively; the caller must release it by
+ * passing the returned pointer (not that of its stats) to
+ * dshash_release_lock(pgStatSharedTables, ...).
+ */
+static PgStat_SharedTabEntry *
+pgstat_get_shared_tabentry(Oid databaseid, Oid tableoid)
+{
+	PgStat_SharedTabEntry *entry;
+	PgStat_SharedKey key;
+	bool		found;
+
+	Assert(pgStatSharedTables != NULL);
+
+	key.databaseid = databaseid;
+	key.objectid = tableoid;
+	entry = (PgStat_SharedTabEntry *)
+		dshash_find_or_insert(pgStatSharedTables, &key, &found);
+
+	if (!found)
+	{
+		memset(&entry->stats, 0, sizeof(PgStat_StatTabEntry));
+		entry->stats.tableid = tableoid;
+	}
+
+	return entry;
+}
+
+/*
+ * Remove the shared entries of a database.  If keep_oids is not NULL, it's a
+ * hash table of object OIDs whose entries are to be kept.
+ */
+static void
+pgstat_purge_shared_entries(dshash_table *hash, Oid databaseid,
+							HTAB *keep_oids)
+{
+	dshash_seq_status status;
+	PgStat_SharedKey *key;
+
+	dshash_seq_init(&status, hash, true);
+	while ((key = (PgStat_SharedKey *) dshash_seq_next(&status)) != NULL)
+	{
+		if (key->databaseid != databaseid)
+			continue;
+
+		if (keep_oids != NULL &&
+			hash_search(keep_oids, (void *) &key->objectid,
+						HASH_FIND, NULL) != NULL)
+			continue;
+
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
+
+/*
+ * Fetch a copy of a shared entry into the backend-local snapshot.
+ *
+ * Once an object has been looked up, the same answer is returned until the
+ * snapshot is discarded by pgstat_clear_snapshot(), so that the caller sees
+ * stable values within a transaction.  Returns NULL if there's no entry.
+ */
+static void *
+pgstat_fetch_shared_entry(dshash_table *hash, HTAB **localhash,
+						  Oid databaseid, Oid objectid, size_t statsize)
+{
+	PgStat_LocalEntry *localent;
+	PgStat_SharedKey key;
+	bool		found;
+
+	Assert(statsize <= sizeof(localent->stats));
+
+	if (*localhash == NULL)
+	{
+		HASHCTL		ctl;
+
+		pgstat_setup_memcxt();
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(PgStat_SharedKey);
+		ctl.entrysize = sizeof(PgStat_LocalEntry);
+		ctl.hcxt = pgStatLocalContext;
+		*localhash = hash_create("Statistics snapshot entries",
+								 PGSTAT_TAB_HASH_SIZE,
+								 &ctl,
+								 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	key.databaseid = databaseid;
+	key.objectid = objectid;
+	localent = (PgStat_LocalEntry *) hash_search(*localhash, (void *) &key,
+												 HASH_ENTER, &found);
+
+	if (!found)
+	{
+		char	   *sharedent;
+
+		sharedent = (char *) dshash_find(hash, &key, false);
+		if (sharedent != NULL)
+		{
+			/* the stats are at the same offset in both shared entry types */
+			StaticAssertStmt(offsetof(PgStat_SharedTabEntry, stats) ==
+							 offsetof(PgStat_SharedFuncEntry, stats),
+							 "shared stats entry layouts differ");
+			memcpy(&localent->stats,
+				   sharedent + offsetof(PgStat_SharedTabEntry, stats),
+				   statsize);
+			dshash_release_lock(hash, sharedent);
+			localent->found = true;
+		}
+		else
+			localent->found = false;
+	}
+
+	return localent->found ? (void *) &localent->stats : NULL;
+}
+
+/* ----------
+ * pgstat_write_shared_stats() -
+ *
+ *	Save the shared table and function statistics to the permanent stats
+ *	file, so that they survive a clean shutdown.  This is done by the
+ *	checkpointer after the shutdown checkpoint, or by a standalone backend
+ *	at exit.  The file is read back by pgstat_restore_shared_stats().
+ * ----------
+ */
+void
+pgstat_write_shared_stats(void)
+{
+	dshash_seq_status status;
+	PgStat_SharedTabEntry *tabentry;
+	PgStat_SharedFuncEntry *funcentry;
+	FILE	   *fpout;
+	int32		format_id;
+	const char *tmpfile = PGSTAT_STAT_SHARED_TMPFILE;
+	const char *statfile = PGSTAT_STAT_SHARED_FILENAME;
+	int			rc;
+
+	if (!pgstat_attach_shmem())
+		return;
+
+	elog(DEBUG2, "writing stats file \"%s\"", statfile);
+
+	fpout = AllocateFile(tmpfile, PG_BINARY_W);
+	if (fpout == NULL)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not open temporary statistics file \"%s\": %m",
+						tmpfile)));
+		return;
+	}
+
+	format_id = PGSTAT_FILE_FORMAT_ID;
+	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	dshash_seq_init(&status, pgStatSharedTables, false);
+	while ((tabentry = dshash_seq_next(&status)) != NULL)
+	{
+		fputc('T', fpout);
+		rc = fwrite(tabentry, sizeof(PgStat_SharedTabEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+	dshash_seq_term(&status);
+
+	dshash_seq_init(&status, pgStatSharedFunctions, false);
+	while ((funcentry = dshash_seq_next(&status)) != NULL)
+	{
+		fputc('F', fpout);
+		rc = fwrite(funcentry, sizeof(PgStat_SharedFuncEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+	dshash_seq_term(&status);
+
+	fputc('E', fpout);
+
+	if (ferror(fpout))
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not write temporary statistics file \"%s\": %m",
+						tmpfile)));
+		FreeFile(fpout);
+		unlink(tmpfile);
+	}
+	else if (FreeFile(fpout) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not close temporary statistics file \"%s\": %m",
+						tmpfile)));
+		unlink(tmpfile);
+	}
+	else if (rename(tmpfile, statfile) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not rename temporary statistics file \"%s\" to \"%s\": %m",
+						tmpfile, statfile)));
+		unlink(tmpfile);
+	}
+}
+
+/* ----------
+ * pgstat_restore_shared_stats() -
+ *
+ *	Load the table and function statistics saved at the last clean shutdown
+ *	into shared memory.  Called by the startup process when no recovery is
+ *	needed.  The file is removed afterwards, so that stale values can't be
+ *	loaded again after a crash.
+ * ----------
+ */
+void
+pgstat_restore_shared_stats(void)
+{
+	FILE	   *fpin;
+	int32		format_id;
+	PgStat_SharedTabEntry tabbuf;
+	PgStat_SharedFuncEntry funcbuf;
+	void	   *entry;
+	bool		found;
+	const char *statfile = PGSTAT_STAT_SHARED_FILENAME;
+
+	if (!pgstat_attach_shmem())
+		return;
+
+	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
+	{
+		if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not open statistics file \"%s\": %m",
+							statfile)));
+		return;
+	}
+
+	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
+		format_id != PGSTAT_FILE_FORMAT_ID)
+	{
+		ereport(LOG,
+				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		goto done;
+	}
+
+	for (;;)
+	{
+		switch (fgetc(fpin))
+		{
+			case 'T':
+				if (fread(&tabbuf, 1, sizeof(tabbuf), fpin) != sizeof(tabbuf))
+				{
+					ereport(LOG,
+							(errmsg("corrupted statistics file \"%s\"",
+									statfile)));
+					goto done;
+				}
+				entry = dshash_find_or_insert(pgStatSharedTables,
+											  &tabbuf.key, &found);
+				memcpy(entry, &tabbuf, sizeof(tabbuf));
+				dshash_release_lock(pgStatSharedTables, entry);
+				break;
+
+			case 'F':
+				if (fread(&funcbuf, 1, sizeof(funcbuf), fpin) != sizeof(funcbuf))
+				{
+					ereport(LOG,
+							(errmsg("corrupted statistics file \"%s\"",
+									statfile)));
+					goto done;
+				}
+				entry = dshash_find_or_insert(pgStatSharedFunctions,
+											  &funcbuf.key, &found);
+				memcpy(entry, &funcbuf, sizeof(funcbuf));
+				dshash_release_lock(pgStatSharedFunctions, entry);
+				break;
+
+			case 'E':
+				goto done;
+
+			default:
+				ereport(LOG,
+						(errmsg("corrupted statistics file \"%s\"",
+								statfile)));
+				goto done;
+		}
+	}
+
+done:
+	FreeFile(fpin);
+
+	elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
+	unlink(statfile);
+}
+
+
+/* ----------
+ * pgstat_initialize() -
+ *
+ *	Initialize pgstats state, and set up our on-proc-exit hook.
+ *	Called from InitPostgres and AuxiliaryProcessMain. For auxiliary process,
+ *	MyBackendId is invalid. Otherwise, MyBackendId must be set,
+ *	but we must not have started any transaction yet (since the
+ *	exit hook must run after the last transaction exit).
+ *	NOTE: MyDatabaseId isn't set yet; so the shutdown hook has to be careful.
+ * ----------
+ */
+void
+pgstat_initialize(void)
+{
+	/* Initialize MyBEEntry */
+	if (MyBackendId != InvalidBackendId)
+	{
+		Assert(MyBackendId >= 1 && MyBackendId <= MaxBackends);
+		MyBEEntry = &BackendStatusArray[MyBackendId - 1];
+	}
+	else
+	{
+		/* Must be an auxiliary process */
+		Assert(MyAuxProcType != NotAnAuxProcess);
 
 		/*
 		 * Assign the MyBEEntry for an auxiliary process.  Since it doesn't
@@ -2834,8 +3320,9 @@ pgstat_initialize(void)
 		MyBEEntry = &BackendStatusArray[MaxBackends + MyAuxProcType];
 	}
 
-	/* Set up a process-exit hook to clean up */
+	/* Set up process-exit hooks to clean up */
 	on_shmem_exit(pgstat_beshutdown_hook, 0);
+	before_shmem_exit(pgstat_shutdown_hook, 0);
 }
 
 /* ----------
@@ -3071,26 +3558,13 @@ pgstat_bestart(void)
 /*
  * Shut down a single backend's statistics reporting at process exit.
  *
- * Flush any remaining statistics counts out to the collector.
- * Without this, operations triggered during backend exit (such as
- * temp table deletions) won't be counted.
- *
- * Lastly, clear out our entry in the PgBackendStatus array.
+ * Clear out our entry in the PgBackendStatus array.
  */
 static void
 pgstat_beshutdown_hook(int code, Datum arg)
 {
 	volatile PgBackendStatus *beentry = MyBEEntry;
 
-	/*
-	 * If we got as far as discovering our own database ID, we can report what
-	 * we did to the collector.  Otherwise, we'd be sending an invalid
-	 * database ID, so forget it.  (This means that accesses to pg_database
-	 * during failed backend starts might never get counted.)
-	 */
-	if (OidIsValid(MyDatabaseId))
-		pgstat_report_stat(true);
-
 	/*
 	 * Clear my status entry, following the protocol of bumping st_changecount
 	 * before and after.  We use a volatile pointer here to ensure the
@@ -3103,20 +3577,52 @@ pgstat_beshutdown_hook(int code, Datum arg)
 	PGSTAT_END_WRITE_ACTIVITY(beentry);
 }
 
-
-/* ----------
- * pgstat_report_activity() -
- *
- *	Called from tcop/postgres.c to report what the backend is actually doing
- *	(but note cmd_str can be NULL for certain cases).
+/*
+ * Flush any remaining statistics counts at process exit, and detach from the
+ * shared statistics.  Without this, operations triggered during backend exit
+ * (such as temp table deletions) won't be counted.
  *
- * All updates of the status entry follow the protocol of bumping
- * st_changecount before and after.  We use a volatile pointer here to
- * ensure the compiler doesn't try to get cute.
- * ----------
+ * This must run before dynamic shared memory segments are detached, hence
+ * it's a before_shmem_exit callback.  pgstat_initialize registers it before
+ * the callbacks that abort the last transaction and drop temp tables, so it
+ * runs after them.
  */
-void
-pgstat_report_activity(BackendState state, const char *cmd_str)
+static void
+pgstat_shutdown_hook(int code, Datum arg)
+{
+	/*
+	 * If we got as far as discovering our own database ID, we can report what
+	 * we did.  Otherwise, we'd be charging an invalid database ID, so forget
+	 * it.  (This means that accesses to pg_database during failed backend
+	 * starts might never get counted.)
+	 */
+	if (OidIsValid(MyDatabaseId))
+		pgstat_report_stat(true);
+
+	/*
+	 * A standalone backend is the only process that ever ran, so it must
+	 * save the statistics itself; see pgstat_write_shared_stats.
+	 */
+	if (!IsUnderPostmaster)
+		pgstat_write_shared_stats();
+
+	pgstat_detach_shmem();
+}
+
+
+/* ----------
+ * pgstat_report_activity() -
+ *
+ *	Called from tcop/postgres.c to report what the backend is actually doing
+ *	(but note cmd_str can be NULL for certain cases).
+ *
+ * All updates of the status entry follow the protocol of bumping
+ * st_changecount before and after.  We use a volatile pointer here to
+ * ensure the compiler doesn't try to get cute.
+ * ----------
+ */
+void
+pgstat_report_activity(BackendState state, const char *cmd_str)
 {
 	volatile PgBackendStatus *beentry = MyBEEntry;
 	TimestampTz start_timestamp;
@@ -3808,6 +4314,12 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_HASH_GROW_BUCKETS_REINSERTING:
 			event_name = "Hash/GrowBuckets/Reinserting";
 			break;
+		case WAIT_EVENT_LOGICAL_PARALLEL_APPLY_COMMIT:
+			event_name = "LogicalParallelApplyCommit";
+			break;
+		case WAIT_EVENT_LOGICAL_PARALLEL_APPLY_WORKER:
+			event_name = "LogicalParallelApplyWorker";
+			break;
 		case WAIT_EVENT_LOGICAL_SYNC_DATA:
 			event_name = "LogicalSyncData";
 			break;
@@ -3841,6 +4353,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_PROMOTE:
 			event_name = "Promote";
 			break;
+		case WAIT_EVENT_REDO_WORKER_BARRIER:
+			event_name = "RedoWorkerBarrier";
+			break;
 		case WAIT_EVENT_REPLICATION_ORIGIN_DROP:
 			event_name = "ReplicationOriginDrop";
 			break;
@@ -3853,6 +4368,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_SYNC_REP:
 			event_name = "SyncRep";
 			break;
+		case WAIT_EVENT_WAL_FLUSH_GROUP:
+			event_name = "WALFlushGroup";
+			break;
 			/* no default case, so that compiler will warn */
 	}
 
@@ -4455,7 +4973,7 @@ PgstatCollectorMain(int argc, char *argv[])
 	 * Read in existing stats files or initialize the stats to zero.
 	 */
 	pgStatRunningInCollector = true;
-	pgStatDBHash = pgstat_read_statsfiles(InvalidOid, true, true);
+	pgStatDBHash = pgstat_read_statsfiles(true);
 
 	/*
 	 * Loop to process messages until we get SIGQUIT or detect ungraceful
@@ -4556,12 +5074,8 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_inquiry(&msg.msg_inquiry, len);
 					break;
 
-				case PGSTAT_MTYPE_TABSTAT:
-					pgstat_recv_tabstat(&msg.msg_tabstat, len);
-					break;
-
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge(&msg.msg_tabpurge, len);
+				case PGSTAT_MTYPE_DBSTAT:
+					pgstat_recv_dbstat(&msg.msg_dbstat, len);
 					break;
 
 				case PGSTAT_MTYPE_DROPDB:
@@ -4588,14 +5102,6 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_autovac(&msg.msg_autovacuum_start, len);
 					break;
 
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum(&msg.msg_vacuum, len);
-					break;
-
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze(&msg.msg_analyze, len);
-					break;
-
 				case PGSTAT_MTYPE_ARCHIVER:
 					pgstat_recv_archiver(&msg.msg_archiver, len);
 					break;
@@ -4604,14 +5110,6 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_bgwriter(&msg.msg_bgwriter, len);
 					break;
 
-				case PGSTAT_MTYPE_FUNCSTAT:
-					pgstat_recv_funcstat(&msg.msg_funcstat, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCPURGE:
-					pgstat_recv_funcpurge(&msg.msg_funcpurge, len);
-					break;
-
 				case PGSTAT_MTYPE_RECOVERYCONFLICT:
 					pgstat_recv_recoveryconflict(
 												 &msg.msg_recoveryconflict,
@@ -4705,14 +5203,10 @@ pgstat_sighup_handler(SIGNAL_ARGS)
 
 /*
  * Subroutine to clear stats in a database entry
- *
- * Tables and functions hashes are initialized to empty.
  */
 static void
 reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 {
-	HASHCTL		hash_ctl;
-
 	dbentry->n_xact_commit = 0;
 	dbentry->n_xact_rollback = 0;
 	dbentry->n_blocks_fetched = 0;
@@ -4738,21 +5232,6 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
 	dbentry->stats_timestamp = 0;
-
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_BLOBS);
-
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-	dbentry->functions = hash_create("Per-database function",
-									 PGSTAT_FUNCTION_HASH_SIZE,
-									 &hash_ctl,
-									 HASH_ELEM | HASH_BLOBS);
 }
 
 /*
@@ -4775,61 +5254,9 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 	if (!create && !found)
 		return NULL;
 
-	/*
-	 * If not found, initialize the new one.  This creates empty hash tables
-	 * for tables and functions, too.
-	 */
-	if (!found)
-		reset_dbentry_counters(result);
-
-	return result;
-}
-
-
-/*
- * Lookup the hash table entry for the specified table. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
- */
-static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
-{
-	PgStat_StatTabEntry *result;
-	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
-
-	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
-
-	if (!create && !found)
-		return NULL;
-
 	/* If not found, initialize the new one. */
 	if (!found)
-	{
-		result->numscans = 0;
-		result->tuples_returned = 0;
-		result->tuples_fetched = 0;
-		result->tuples_inserted = 0;
-		result->tuples_updated = 0;
-		result->tuples_deleted = 0;
-		result->tuples_hot_updated = 0;
-		result->n_live_tuples = 0;
-		result->n_dead_tuples = 0;
-		result->changes_since_analyze = 0;
-		result->blocks_fetched = 0;
-		result->blocks_hit = 0;
-		result->vacuum_timestamp = 0;
-		result->vacuum_count = 0;
-		result->autovac_vacuum_timestamp = 0;
-		result->autovac_vacuum_count = 0;
-		result->analyze_timestamp = 0;
-		result->analyze_count = 0;
-		result->autovac_analyze_timestamp = 0;
-		result->autovac_analyze_count = 0;
-	}
+		reset_dbentry_counters(result);
 
 	return result;
 }
@@ -4837,7 +5264,7 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
 
 /* ----------
  * pgstat_write_statsfiles() -
- *		Write the global statistics file, as well as requested DB files.
+ *		Write the global statistics file.
  *
  *	'permanent' specifies writing to the permanent files not temporary ones.
  *	When true (happens only when the collector is shutting down), also remove
@@ -4845,8 +5272,8 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
  *	can't read old data before the new collector is ready.
  *
  *	When 'allDbs' is false, only the requested databases (listed in
- *	pending_write_requests) will be written; otherwise, all databases
- *	will be written.
+ *	pending_write_requests) are marked as freshly written; otherwise, all
+ *	databases are.
  * ----------
  */
 static void
@@ -4905,24 +5332,15 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	hash_seq_init(&hstat, pgStatDBHash);
 	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
 	{
-		/*
-		 * Write out the table and function stats for this DB into the
-		 * appropriate per-DB stat file, if required.
-		 */
+		/* Make DB's timestamp consistent with the global stats, if asked */
 		if (allDbs || pgstat_db_requested(dbentry->databaseid))
-		{
-			/* Make DB's timestamp consistent with the global stats */
 			dbentry->stats_timestamp = globalStats.stats_timestamp;
 
-			pgstat_write_db_statsfile(dbentry, permanent);
-		}
-
 		/*
-		 * Write out the DB entry. We don't write the tables or functions
-		 * pointers, since they're of no use to any other process.
+		 * Write out the DB entry.
 		 */
 		fputc('D', fpout);
-		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
+		rc = fwrite(dbentry, sizeof(PgStat_StatDBEntry), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
 
@@ -4970,161 +5388,20 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	pending_write_requests = NIL;
 }
 
-/*
- * return the filename for a DB stat file; filename is the output buffer,
- * of length len.
- */
-static void
-get_dbstat_filename(bool permanent, bool tempname, Oid databaseid,
-					char *filename, int len)
-{
-	int			printed;
-
-	/* NB -- pgstat_reset_remove_files knows about the pattern this uses */
-	printed = snprintf(filename, len, "%s/db_%u.%s",
-					   permanent ? PGSTAT_STAT_PERMANENT_DIRECTORY :
-					   pgstat_stat_directory,
-					   databaseid,
-					   tempname ? "tmp" : "stat");
-	if (printed >= len)
-		elog(ERROR, "overlength pgstat path");
-}
-
-/* ----------
- * pgstat_write_db_statsfile() -
- *		Write the stat file for a single database.
- *
- *	If writing to the permanent file (happens when the collector is
- *	shutting down only), remove the temporary file so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
- * ----------
- */
-static void
-pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
-{
-	HASH_SEQ_STATUS tstat;
-	HASH_SEQ_STATUS fstat;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpout;
-	int32		format_id;
-	Oid			dbid = dbentry->databaseid;
-	int			rc;
-	char		tmpfile[MAXPGPATH];
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, true, dbid, tmpfile, MAXPGPATH);
-	get_dbstat_filename(permanent, false, dbid, statfile, MAXPGPATH);
-
-	elog(DEBUG2, "writing stats file \"%s\"", statfile);
-
-	/*
-	 * Open the statistics temp file to write out the current values.
-	 */
-	fpout = AllocateFile(tmpfile, PG_BINARY_W);
-	if (fpout == NULL)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not open temporary statistics file \"%s\": %m",
-						tmpfile)));
-		return;
-	}
-
-	/*
-	 * Write the file header --- currently just a format ID.
-	 */
-	format_id = PGSTAT_FILE_FORMAT_ID;
-	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Walk through the database's access stats per table.
-	 */
-	hash_seq_init(&tstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
-	{
-		fputc('T', fpout);
-		rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
-
-	/*
-	 * Walk through the database's function stats table.
-	 */
-	hash_seq_init(&fstat, dbentry->functions);
-	while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&fstat)) != NULL)
-	{
-		fputc('F', fpout);
-		rc = fwrite(funcentry, sizeof(PgStat_StatFuncEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
-
-	/*
-	 * No more output to be done. Close the temp file and replace the old
-	 * pgstat.stat with it.  The ferror() check replaces testing for error
-	 * after each individual fputc or fwrite above.
-	 */
-	fputc('E', fpout);
-
-	if (ferror(fpout))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write temporary statistics file \"%s\": %m",
-						tmpfile)));
-		FreeFile(fpout);
-		unlink(tmpfile);
-	}
-	else if (FreeFile(fpout) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not close temporary statistics file \"%s\": %m",
-						tmpfile)));
-		unlink(tmpfile);
-	}
-	else if (rename(tmpfile, statfile) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not rename temporary statistics file \"%s\" to \"%s\": %m",
-						tmpfile, statfile)));
-		unlink(tmpfile);
-	}
-
-	if (permanent)
-	{
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing temporary stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-}
-
 /* ----------
  * pgstat_read_statsfiles() -
  *
- *	Reads in some existing statistics collector files and returns the
- *	databases hash table that is the top level of the data.
- *
- *	If 'onlydb' is not InvalidOid, it means we only want data for that DB
- *	plus the shared catalogs ("DB 0").  We'll still populate the DB hash
- *	table for all databases, but we don't bother even creating table/function
- *	hash tables for other databases.
+ *	Reads in the existing statistics collector file and returns the
+ *	databases hash table.
  *
  *	'permanent' specifies reading from the permanent files not temporary ones.
  *	When true (happens only when the collector is starting up), remove the
  *	files after reading; the in-memory status is now authoritative, and the
  *	files would be out of date in case somebody else reads them.
- *
- *	If a 'deep' read is requested, table/function stats are read, otherwise
- *	the table/function hash tables remain empty.
  * ----------
  */
 static HTAB *
-pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
+pgstat_read_statsfiles(bool permanent)
 {
 	PgStat_StatDBEntry *dbentry;
 	PgStat_StatDBEntry dbbuf;
@@ -5159,216 +5436,10 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 
 	/*
 	 * Set the current timestamp (will be kept only in case we can't load an
-	 * existing statsfile).
-	 */
-	globalStats.stat_reset_timestamp = GetCurrentTimestamp();
-	archiverStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
-	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return dbhash;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		goto done;
-	}
-
-	/*
-	 * Read global stats struct
-	 */
-	if (fread(&globalStats, 1, sizeof(globalStats), fpin) != sizeof(globalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&globalStats, 0, sizeof(globalStats));
-		goto done;
-	}
-
-	/*
-	 * In the collector, disregard the timestamp we read from the permanent
-	 * stats file; we should be willing to write a temp stats file immediately
-	 * upon the first request from any backend.  This only matters if the old
-	 * file's timestamp is less than PGSTAT_STAT_INTERVAL ago, but that's not
-	 * an unusual scenario.
-	 */
-	if (pgStatRunningInCollector)
-		globalStats.stats_timestamp = 0;
-
-	/*
-	 * Read archiver stats struct
-	 */
-	if (fread(&archiverStats, 1, sizeof(archiverStats), fpin) != sizeof(archiverStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		memset(&archiverStats, 0, sizeof(archiverStats));
-		goto done;
-	}
-
-	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'D'	A PgStat_StatDBEntry struct describing a database
-				 * follows.
-				 */
-			case 'D':
-				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Add to the DB hash
-				 */
-				dbentry = (PgStat_StatDBEntry *) hash_search(dbhash,
-															 (void *) &dbbuf.databaseid,
-															 HASH_ENTER,
-															 &found);
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
-				dbentry->tables = NULL;
-				dbentry->functions = NULL;
-
-				/*
-				 * In the collector, disregard the timestamp we read from the
-				 * permanent stats file; we should be willing to write a temp
-				 * stats file immediately upon the first request from any
-				 * backend.
-				 */
-				if (pgStatRunningInCollector)
-					dbentry->stats_timestamp = 0;
-
-				/*
-				 * Don't create tables/functions hashtables for uninteresting
-				 * databases.
-				 */
-				if (onlydb != InvalidOid)
-				{
-					if (dbbuf.databaseid != onlydb &&
-						dbbuf.databaseid != InvalidOid)
-						break;
-				}
-
-				memset(&hash_ctl, 0, sizeof(hash_ctl));
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-											  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->functions = hash_create("Per-database function",
-												 PGSTAT_FUNCTION_HASH_SIZE,
-												 &hash_ctl,
-												 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				/*
-				 * If requested, read the data from the database-specific
-				 * file.  Otherwise we just leave the hashtables empty.
-				 */
-				if (deep)
-					pgstat_read_db_statsfile(dbentry->databaseid,
-											 dbentry->tables,
-											 dbentry->functions,
-											 permanent);
-
-				break;
-
-			case 'E':
-				goto done;
-
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
-
-done:
-	FreeFile(fpin);
-
-	/* If requested to read the permanent file, also get rid of it. */
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-
-	return dbhash;
-}
-
-
-/* ----------
- * pgstat_read_db_statsfile() -
- *
- *	Reads in the existing statistics collector file for the given database,
- *	filling the passed-in tables and functions hash tables.
- *
- *	As in pgstat_read_statsfiles, if the permanent file is requested, it is
- *	removed after reading.
- *
- *	Note: this code has the ability to skip storing per-table or per-function
- *	data, if NULL is passed for the corresponding hashtable.  That's not used
- *	at the moment though.
- * ----------
- */
-static void
-pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
-						 bool permanent)
-{
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
-	PgStat_StatFuncEntry funcbuf;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, false, databaseid, statfile, MAXPGPATH);
+	 * existing statsfile).
+	 */
+	globalStats.stat_reset_timestamp = GetCurrentTimestamp();
+	archiverStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
 
 	/*
 	 * Try to open the stats file. If it doesn't exist, the backends simply
@@ -5386,7 +5457,7 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 					(errcode_for_file_access(),
 					 errmsg("could not open statistics file \"%s\": %m",
 							statfile)));
-		return;
+		return dbhash;
 	}
 
 	/*
@@ -5400,6 +5471,38 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 		goto done;
 	}
 
+	/*
+	 * Read global stats struct
+	 */
+	if (fread(&globalStats, 1, sizeof(globalStats), fpin) != sizeof(globalStats))
+	{
+		ereport(pgStatRunningInCollector ? LOG : WARNING,
+				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		memset(&globalStats, 0, sizeof(globalStats));
+		goto done;
+	}
+
+	/*
+	 * In the collector, disregard the timestamp we read from the permanent
+	 * stats file; we should be willing to write a temp stats file immediately
+	 * upon the first request from any backend.  This only matters if the old
+	 * file's timestamp is less than PGSTAT_STAT_INTERVAL ago, but that's not
+	 * an unusual scenario.
+	 */
+	if (pgStatRunningInCollector)
+		globalStats.stats_timestamp = 0;
+
+	/*
+	 * Read archiver stats struct
+	 */
+	if (fread(&archiverStats, 1, sizeof(archiverStats), fpin) != sizeof(archiverStats))
+	{
+		ereport(pgStatRunningInCollector ? LOG : WARNING,
+				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		memset(&archiverStats, 0, sizeof(archiverStats));
+		goto done;
+	}
+
 	/*
 	 * We found an existing collector stats file. Read it and put all the
 	 * hashtable entries into place.
@@ -5409,11 +5512,12 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 		switch (fgetc(fpin))
 		{
 				/*
-				 * 'T'	A PgStat_StatTabEntry follows.
+				 * 'D'	A PgStat_StatDBEntry struct describing a database
+				 * follows.
 				 */
-			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
+			case 'D':
+				if (fread(&dbbuf, 1, sizeof(PgStat_StatDBEntry),
+						  fpin) != sizeof(PgStat_StatDBEntry))
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
 							(errmsg("corrupted statistics file \"%s\"",
@@ -5422,15 +5526,12 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 				}
 
 				/*
-				 * Skip if table data not wanted.
+				 * Add to the DB hash
 				 */
-				if (tabhash == NULL)
-					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-															   (void *) &tabbuf.tableid,
-															   HASH_ENTER, &found);
-
+				dbentry = (PgStat_StatDBEntry *) hash_search(dbhash,
+															 (void *) &dbbuf.databaseid,
+															 HASH_ENTER,
+															 &found);
 				if (found)
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
@@ -5439,46 +5540,18 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 					goto done;
 				}
 
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
-				break;
-
-				/*
-				 * 'F'	A PgStat_StatFuncEntry follows.
-				 */
-			case 'F':
-				if (fread(&funcbuf, 1, sizeof(PgStat_StatFuncEntry),
-						  fpin) != sizeof(PgStat_StatFuncEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
+				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
 
 				/*
-				 * Skip if function data not wanted.
+				 * In the collector, disregard the timestamp we read from the
+				 * permanent stats file; we should be willing to write a temp
+				 * stats file immediately upon the first request from any
+				 * backend.
 				 */
-				if (funchash == NULL)
-					break;
-
-				funcentry = (PgStat_StatFuncEntry *) hash_search(funchash,
-																 (void *) &funcbuf.functionid,
-																 HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(funcentry, &funcbuf, sizeof(funcbuf));
+				if (pgStatRunningInCollector)
+					dbentry->stats_timestamp = 0;
 				break;
 
-				/*
-				 * 'E'	The EOF marker of a complete stats file.
-				 */
 			case 'E':
 				goto done;
 
@@ -5493,13 +5566,17 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 done:
 	FreeFile(fpin);
 
+	/* If requested to read the permanent file, also get rid of it. */
 	if (permanent)
 	{
 		elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
 		unlink(statfile);
 	}
+
+	return dbhash;
 }
 
+
 /* ----------
  * pgstat_read_db_statsfile_timestamp() -
  *
@@ -5594,8 +5671,8 @@ pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
 				 * follows.
 				 */
 			case 'D':
-				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
+				if (fread(&dbentry, 1, sizeof(PgStat_StatDBEntry),
+						  fpin) != sizeof(PgStat_StatDBEntry))
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
 							(errmsg("corrupted statistics file \"%s\"",
@@ -5752,15 +5829,7 @@ backend_read_statsfile(void)
 				(errmsg("using stale statistics instead of current ones "
 						"because stats collector is not responding")));
 
-	/*
-	 * Autovacuum launcher wants stats about all databases, but a shallow read
-	 * is sufficient.  Regular backends want a deep read for just the tables
-	 * they can see (MyDatabaseId + shared catalogs).
-	 */
-	if (IsAutoVacuumLauncherProcess())
-		pgStatDBHash = pgstat_read_statsfiles(InvalidOid, false, false);
-	else
-		pgStatDBHash = pgstat_read_statsfiles(MyDatabaseId, false, true);
+	pgStatDBHash = pgstat_read_statsfiles(false);
 }
 
 
@@ -5800,6 +5869,8 @@ pgstat_clear_snapshot(void)
 	/* Reset variables */
 	pgStatLocalContext = NULL;
 	pgStatDBHash = NULL;
+	pgStatLocalTables = NULL;
+	pgStatLocalFunctions = NULL;
 	localBackendStatusTable = NULL;
 	localNumBackends = 0;
 }
@@ -5899,142 +5970,31 @@ pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
 
 
 /* ----------
- * pgstat_recv_tabstat() -
+ * pgstat_recv_dbstat() -
  *
- *	Count what the backend has done.
+ *	Count what the backend has done at the database level.  Per-table
+ *	counts have already been flushed to shared memory by the sender.
  * ----------
  */
 static void
-pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
+pgstat_recv_dbstat(PgStat_MsgDbstat *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	int			i;
-	bool		found;
 
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
 
-	/*
-	 * Update database-wide stats.
-	 */
 	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
 	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
 	dbentry->n_block_read_time += msg->m_block_read_time;
 	dbentry->n_block_write_time += msg->m_block_write_time;
 
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
-
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new table entry, initialize counters to the values we
-			 * just got.
-			 */
-			tabentry->numscans = tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned = tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched = tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated = tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted = tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated = tabmsg->t_counts.t_tuples_hot_updated;
-			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
-			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
-
-			tabentry->vacuum_timestamp = 0;
-			tabentry->vacuum_count = 0;
-			tabentry->autovac_vacuum_timestamp = 0;
-			tabentry->autovac_vacuum_count = 0;
-			tabentry->analyze_timestamp = 0;
-			tabentry->analyze_count = 0;
-			tabentry->autovac_analyze_timestamp = 0;
-			tabentry->autovac_analyze_count = 0;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			tabentry->numscans += tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned += tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated += tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated += tabmsg->t_counts.t_tuples_hot_updated;
-			/* If table was truncated, first reset the live/dead counters */
-			if (tabmsg->t_counts.t_truncated)
-			{
-				tabentry->n_live_tuples = 0;
-				tabentry->n_dead_tuples = 0;
-			}
-			tabentry->n_live_tuples += tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples += tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
-			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
-		}
-
-		/* Clamp n_live_tuples in case of negative delta_live_tuples */
-		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
-		/* Likewise for n_dead_tuples */
-		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
-
-		/*
-		 * Add per-table stats to the per-database entry, too.
-		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
-	}
-}
-
-
-/* ----------
- * pgstat_recv_tabpurge() -
- *
- *	Arrange for dead table removal.
- * ----------
- */
-static void
-pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->tables)
-		return;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
-	}
+	dbentry->n_tuples_returned += msg->m_tuples_returned;
+	dbentry->n_tuples_fetched += msg->m_tuples_fetched;
+	dbentry->n_tuples_inserted += msg->m_tuples_inserted;
+	dbentry->n_tuples_updated += msg->m_tuples_updated;
+	dbentry->n_tuples_deleted += msg->m_tuples_deleted;
+	dbentry->n_blocks_fetched += msg->m_blocks_fetched;
+	dbentry->n_blocks_hit += msg->m_blocks_hit;
 }
 
 
@@ -6056,22 +6016,11 @@ pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 	dbentry = pgstat_get_db_entry(dbid, false);
 
 	/*
-	 * If found, remove it (along with the db statfile).
+	 * If found, remove it.  The database's table and function entries in
+	 * shared memory have already been removed by the sender.
 	 */
 	if (dbentry)
 	{
-		char		statfile[MAXPGPATH];
-
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing stats file \"%s\"", statfile);
-		unlink(statfile);
-
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
-		if (dbentry->functions != NULL)
-			hash_destroy(dbentry->functions);
-
 		if (hash_search(pgStatDBHash,
 						(void *) &dbid,
 						HASH_REMOVE, NULL) == NULL)
@@ -6101,20 +6050,8 @@ pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 		return;
 
 	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
-	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
-	if (dbentry->functions != NULL)
-		hash_destroy(dbentry->functions);
-
-	dbentry->tables = NULL;
-	dbentry->functions = NULL;
-
-	/*
-	 * Reset database-level stats, too.  This creates empty hash tables for
-	 * tables and functions.
+	 * Reset database-level stats.  The sender has already thrown away the
+	 * database's table and function entries in shared memory.
 	 */
 	reset_dbentry_counters(dbentry);
 }
@@ -6163,16 +6100,11 @@ pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
 	if (!dbentry)
 		return;
 
-	/* Set the reset timestamp for the whole database */
+	/*
+	 * Set the reset timestamp for the whole database.  The object itself has
+	 * already been removed from shared memory by the sender.
+	 */
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
-
-	/* Remove object if it exists, ignore it if not */
-	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
-	else if (msg->m_resettype == RESET_FUNCTION)
-		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
 }
 
 /* ----------
@@ -6194,83 +6126,6 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 	dbentry->last_autovac_time = msg->m_start_time;
 }
 
-/* ----------
- * pgstat_recv_vacuum() -
- *
- *	Process a VACUUM message.
- * ----------
- */
-static void
-pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->autovac_vacuum_count++;
-	}
-	else
-	{
-		tabentry->vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->vacuum_count++;
-	}
-}
-
-/* ----------
- * pgstat_recv_analyze() -
- *
- *	Process an ANALYZE message.
- * ----------
- */
-static void
-pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	/*
-	 * If commanded, reset changes_since_analyze to zero.  This forgets any
-	 * changes that were committed while the ANALYZE was in progress, but we
-	 * have no good way to estimate how many of those there were.
-	 */
-	if (msg->m_resetcounter)
-		tabentry->changes_since_analyze = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
-		tabentry->autovac_analyze_count++;
-	}
-	else
-	{
-		tabentry->analyze_timestamp = msg->m_analyzetime;
-		tabentry->analyze_count++;
-	}
-}
-
-
 /* ----------
  * pgstat_recv_archiver() -
  *
@@ -6409,86 +6264,6 @@ pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
 	dbentry->n_temp_files += 1;
 }
 
-/* ----------
- * pgstat_recv_funcstat() -
- *
- *	Count what the backend has done.
- * ----------
- */
-static void
-pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
-{
-	PgStat_FunctionEntry *funcmsg = &(msg->m_entry[0]);
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatFuncEntry *funcentry;
-	int			i;
-	bool		found;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	/*
-	 * Process all function entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++, funcmsg++)
-	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-														 (void *) &(funcmsg->f_id),
-														 HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new function entry, initialize counters to the values
-			 * we just got.
-			 */
-			funcentry->f_numcalls = funcmsg->f_numcalls;
-			funcentry->f_total_time = funcmsg->f_total_time;
-			funcentry->f_self_time = funcmsg->f_self_time;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			funcentry->f_numcalls += funcmsg->f_numcalls;
-			funcentry->f_total_time += funcmsg->f_total_time;
-			funcentry->f_self_time += funcmsg->f_self_time;
-		}
-	}
-}
-
-/* ----------
- * pgstat_recv_funcpurge() -
- *
- *	Arrange for dead function removal.
- * ----------
- */
-static void
-pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->functions)
-		return;
-
-	/*
-	 * Process all function entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->functions,
-						   (void *) &(msg->m_functionid[i]),
-						   HASH_REMOVE, NULL);
-	}
-}
-
 /* ----------
  * pgstat_write_statsfile_needed() -
  *
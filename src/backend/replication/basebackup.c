@@ -15,8 +15,18 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <time.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/xlog_internal.h"	/* for pg_start/stop_backup */
+#include "catalog/pg_tablespace_d.h"
 #include "catalog/pg_type.h"
 #include "common/file_perm.h"
 #include "lib/stringinfo.h"
@@ -29,6 +39,7 @@
 #include "port.h"
 #include "postmaster/syslogger.h"
 #include "replication/basebackup.h"
+#include "replication/basebackup_incremental.h"
 #include "replication/walsender.h"
 #include "replication/walsender_private.h"
 #include "storage/bufpage.h"
@@ -38,10 +49,23 @@
 #include "storage/ipc.h"
 #include "storage/reinit.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/pg_lsn.h"
 #include "utils/ps_status.h"
 #include "utils/relcache.h"
 #include "utils/timestamp.h"
 
+/*
+ * Methods for compressing the tar streams on the server side.
+ */
+typedef enum
+{
+	BACKUP_COMPRESSION_NONE,
+	BACKUP_COMPRESSION_GZIP,
+	BACKUP_COMPRESSION_LZ4,
+	BACKUP_COMPRESSION_ZSTD
+} BackupCompressionMethod;
+
 typedef struct
 {
 	const char *label;
@@ -51,6 +75,12 @@ typedef struct
 	bool		includewal;
 	uint32		maxrate;
 	bool		sendtblspcmapfile;
+	BackupCompressionMethod compression;
+	int			compression_level;
+	bool		parallel;
+	Oid			tablespace;
+	XLogRecPtr	startpoint;
+	XLogRecPtr	incremental_lsn;
 } basebackup_options;
 
 
@@ -58,6 +88,12 @@ static int64 sendDir(const char *path, int basepathlen, bool sizeonly,
 					 List *tablespaces, bool sendtblspclinks);
 static bool sendFile(const char *readfilename, const char *tarfilename,
 					 struct stat *statbuf, bool missing_ok, Oid dboid);
+static bool sendIncrementalFile(const char *readfilename,
+								const char *tarfilename, struct stat *statbuf,
+								Bitmapset *blocks);
+static bool get_relation_segment(const char *path, const char *filename,
+								 bool isDbDir, RelFileNode *rnode,
+								 ForkNumber *forknum, BlockNumber *segno);
 static void sendFileWithContent(const char *filename, const char *content);
 static int64 _tarWriteHeader(const char *filename, const char *linktarget,
 							 struct stat *statbuf, bool sizeonly);
@@ -67,10 +103,16 @@ static void send_int8_string(StringInfoData *buf, int64 intval);
 static void SendBackupHeader(List *tablespaces);
 static void base_backup_cleanup(int code, Datum arg);
 static void perform_base_backup(basebackup_options *opt);
+static void perform_tablespace_backup(basebackup_options *opt);
 static void parse_basebackup_options(List *options, basebackup_options *opt);
 static void SendXlogRecPtrResult(XLogRecPtr ptr, TimeLineID tli);
 static int	compareWalFileNames(const ListCell *a, const ListCell *b);
+static void setup_throttle(uint32 maxrate);
 static void throttle(size_t increment);
+static void begin_archive(void);
+static void send_archive_data(const char *data, size_t len);
+static void end_archive(void);
+static void send_compressed_data(const char *data, size_t len);
 static bool is_checksummed_file(const char *fullpath, const char *filename);
 
 /* Was the backup currently in-progress initiated in recovery mode? */
@@ -79,6 +121,13 @@ static bool backup_started_in_recovery = false;
 /* Relative path of temporary statistics directory */
 static char *statrelpath = NULL;
 
+/*
+ * Modified blocks to send in an incremental backup, or NULL if sending a
+ * full backup, and the OID of the tablespace currently being sent.
+ */
+static IncrementalBackupInfo *incremental_info = NULL;
+static Oid	current_tablespace = InvalidOid;
+
 /*
  * Size of each block sent into the tar stream for larger files.
  */
@@ -119,6 +168,34 @@ static XLogRecPtr startptr;
 /* Total number of checksum failures during base backup. */
 static long long int total_checksum_failures;
 
+/*
+ * Backup label of a parallel base backup that is still in progress in this
+ * session, waiting for STOP_BACKUP.  Allocated in TopMemoryContext.
+ */
+static char *parallel_backup_label = NULL;
+
+/*
+ * Server-side compression of the tar streams.  Each tar stream sent in a
+ * CopyOutResponse is compressed as a single, self-contained gzip member,
+ * LZ4 frame or zstd frame, so the client can write it out verbatim.  The
+ * compression contexts are created on first use and reset between streams.
+ */
+static BackupCompressionMethod compression = BACKUP_COMPRESSION_NONE;
+static int	compression_level = 0;
+static char *compress_buf = NULL;
+static size_t compress_buf_size = 0;
+
+#ifdef HAVE_LIBZ
+static z_stream *gzip_stream = NULL;
+#endif
+#ifdef USE_LZ4
+static LZ4F_cctx *lz4_cctx = NULL;
+static LZ4F_preferences_t lz4_prefs;
+#endif
+#ifdef USE_ZSTD
+static ZSTD_CCtx *zstd_cctx = NULL;
+#endif
+
 /* Do not verify checksums. */
 static bool noverify_checksums = false;
 
@@ -240,6 +317,7 @@ perform_base_backup(basebackup_options *opt)
 	XLogRecPtr	endptr;
 	TimeLineID	endtli;
 	StringInfo	labelfile;
+	StringInfo	sent_labelfile;
 	StringInfo	tblspc_map_file = NULL;
 	int			datadirpathlen;
 	List	   *tablespaces = NIL;
@@ -252,6 +330,7 @@ perform_base_backup(basebackup_options *opt)
 	tblspc_map_file = makeStringInfo();
 
 	total_checksum_failures = 0;
+	incremental_info = NULL;
 
 	startptr = do_pg_start_backup(opt->label, opt->fastcheckpoint, &starttli,
 								  labelfile, &tablespaces,
@@ -272,6 +351,25 @@ perform_base_backup(basebackup_options *opt)
 
 		SendXlogRecPtrResult(startptr, starttli);
 
+		/*
+		 * For an incremental backup, find out which blocks were modified
+		 * since the reference backup started, and mark the backup_label we
+		 * send so that it can't be used without combining it first.  The
+		 * label used to stop the backup is left alone.
+		 */
+		if (!XLogRecPtrIsInvalid(opt->incremental_lsn))
+		{
+			incremental_info = BuildIncrementalBackupInfo(opt->incremental_lsn,
+														  startptr);
+			sent_labelfile = makeStringInfo();
+			appendStringInfo(sent_labelfile, "%s%s%X/%X\n",
+							 labelfile->data, INCREMENTAL_LABEL_LINE,
+							 (uint32) (opt->incremental_lsn >> 32),
+							 (uint32) opt->incremental_lsn);
+		}
+		else
+			sent_labelfile = labelfile;
+
 		/*
 		 * Calculate the relative path of temporary statistics directory in
 		 * order to skip the files which are located in that directory later.
@@ -293,47 +391,31 @@ perform_base_backup(basebackup_options *opt)
 		SendBackupHeader(tablespaces);
 
 		/* Setup and activate network throttling, if client requested it */
-		if (opt->maxrate > 0)
-		{
-			throttling_sample =
-				(int64) opt->maxrate * (int64) 1024 / THROTTLING_FREQUENCY;
-
-			/*
-			 * The minimum amount of time for throttling_sample bytes to be
-			 * transferred.
-			 */
-			elapsed_min_unit = USECS_PER_SEC / THROTTLING_FREQUENCY;
-
-			/* Enable throttling. */
-			throttling_counter = 0;
-
-			/* The 'real data' starts now (header was ignored). */
-			throttled_last = GetCurrentTimestamp();
-		}
-		else
-		{
-			/* Disable throttling. */
-			throttling_counter = -1;
-		}
+		setup_throttle(opt->maxrate);
 
 		/* Send off our tablespaces one by one */
 		foreach(lc, tablespaces)
 		{
 			tablespaceinfo *ti = (tablespaceinfo *) lfirst(lc);
-			StringInfoData buf;
 
-			/* Send CopyOutResponse message */
-			pq_beginmessage(&buf, 'H');
-			pq_sendbyte(&buf, 0);	/* overall format */
-			pq_sendint16(&buf, 0);	/* natts */
-			pq_endmessage(&buf);
+			/*
+			 * In a parallel backup, only the main data directory is sent
+			 * over this connection.  The client fetches the other
+			 * tablespaces over separate connections, using the TABLESPACE
+			 * option, while this backup is still in progress.
+			 */
+			if (opt->parallel && ti->path != NULL)
+				continue;
+
+			begin_archive();
+			current_tablespace = ti->path ? atooid(ti->oid) : InvalidOid;
 
 			if (ti->path == NULL)
 			{
 				struct stat statbuf;
 
 				/* In the main tar, include the backup_label first... */
-				sendFileWithContent(BACKUP_LABEL_FILE, labelfile->data);
+				sendFileWithContent(BACKUP_LABEL_FILE, sent_labelfile->data);
 
 				/*
 				 * Send tablespace_map file if required and then the bulk of
@@ -369,13 +451,29 @@ perform_base_backup(basebackup_options *opt)
 				Assert(lnext(tablespaces, lc) == NULL);
 			}
 			else
-				pq_putemptymessage('c');	/* CopyDone */
+				end_archive();
 		}
 
-		endptr = do_pg_stop_backup(labelfile->data, !opt->nowait, &endtli);
+		/*
+		 * A parallel backup is left running until the client issues
+		 * STOP_BACKUP, once all the tablespaces have been received.
+		 */
+		if (opt->parallel)
+			parallel_backup_label = MemoryContextStrdup(TopMemoryContext,
+														labelfile->data);
+		else
+			endptr = do_pg_stop_backup(labelfile->data, !opt->nowait, &endtli);
+
+		incremental_info = NULL;
 	}
 	PG_END_ENSURE_ERROR_CLEANUP(base_backup_cleanup, (Datum) 0);
 
+	/*
+	 * A parallel backup now outlives this command, so make sure it's aborted
+	 * if the session exits before STOP_BACKUP.
+	 */
+	if (opt->parallel)
+		before_shmem_exit(base_backup_cleanup, (Datum) 0);
 
 	if (opt->includewal)
 	{
@@ -543,9 +641,7 @@ perform_base_backup(basebackup_options *opt)
 			{
 				CheckXLogRemoved(segno, tli);
 				/* Send the chunk as a CopyData message */
-				if (pq_putmessage('d', buf, cnt))
-					ereport(ERROR,
-							(errmsg("base backup could not send data, aborting backup")));
+				send_archive_data(buf, cnt);
 
 				len += cnt;
 				throttle(cnt);
@@ -606,9 +702,12 @@ perform_base_backup(basebackup_options *opt)
 		}
 
 		/* Send CopyDone message for the last tar file */
-		pq_putemptymessage('c');
+		end_archive();
 	}
-	SendXlogRecPtrResult(endptr, endtli);
+
+	/* In a parallel backup, the end position is returned by STOP_BACKUP */
+	if (!opt->parallel)
+		SendXlogRecPtrResult(endptr, endtli);
 
 	if (total_checksum_failures)
 	{
@@ -623,6 +722,81 @@ perform_base_backup(basebackup_options *opt)
 
 }
 
+/*
+ * Send a single tablespace, on behalf of a parallel base backup.
+ *
+ * A backup started with the PARALLEL option only sends the main data
+ * directory over the leading connection.  The client fetches the other
+ * tablespaces over separate connections with this, before finishing the
+ * backup with STOP_BACKUP on the leading connection.  The files are copied
+ * safely as long as the server stays in backup mode while we send them, which
+ * we check before and after doing so; it's up to the client not to stop the
+ * backup before all the tablespaces have been received.
+ */
+static void
+perform_tablespace_backup(basebackup_options *opt)
+{
+	char		path[MAXPGPATH];
+	struct stat statbuf;
+
+	if (!BackupModeActive())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("a base backup must be in progress to send a tablespace"),
+				 errhint("Start the backup with BASE_BACKUP PARALLEL on another connection.")));
+
+	/*
+	 * Use an absolute path, like the tablespace list built by
+	 * do_pg_start_backup() does, so that is_checksummed_file() recognizes
+	 * the files in it.
+	 */
+	snprintf(path, sizeof(path), "%s/pg_tblspc/%u", DataDir, opt->tablespace);
+	if (lstat(path, &statbuf) != 0)
+	{
+		if (errno == ENOENT)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_OBJECT),
+					 errmsg("tablespace with OID %u does not exist",
+							opt->tablespace)));
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+	}
+
+	/*
+	 * Checksums of pages modified after the start of the backup can't be
+	 * verified reliably, so use the start position of the leading connection.
+	 */
+	backup_started_in_recovery = RecoveryInProgress();
+	startptr = opt->startpoint;
+	total_checksum_failures = 0;
+	incremental_info = NULL;
+	current_tablespace = opt->tablespace;
+
+	setup_throttle(opt->maxrate);
+
+	begin_archive();
+	sendTablespace(path, false);
+	end_archive();
+
+	if (!BackupModeActive())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("base backup ended while tablespace %u was being sent",
+						opt->tablespace)));
+
+	if (total_checksum_failures)
+	{
+		if (total_checksum_failures > 1)
+			ereport(WARNING,
+					(errmsg("%lld total checksum verification failures", total_checksum_failures)));
+
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("checksum verification failure during base backup")));
+	}
+}
+
 /*
  * list_sort comparison function, to compare log/seg portion of WAL segment
  * filenames, ignoring the timeline portion.
@@ -651,6 +825,12 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_maxrate = false;
 	bool		o_tablespace_map = false;
 	bool		o_noverify_checksums = false;
+	bool		o_compression = false;
+	bool		o_compression_level = false;
+	bool		o_parallel = false;
+	bool		o_tablespace = false;
+	bool		o_start_lsn = false;
+	bool		o_incremental = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	foreach(lopt, options)
@@ -739,12 +919,174 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 			noverify_checksums = true;
 			o_noverify_checksums = true;
 		}
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *method = strVal(defel->arg);
+
+			if (o_compression)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+
+			if (pg_strcasecmp(method, "none") == 0)
+				opt->compression = BACKUP_COMPRESSION_NONE;
+			else if (pg_strcasecmp(method, "gzip") == 0)
+				opt->compression = BACKUP_COMPRESSION_GZIP;
+			else if (pg_strcasecmp(method, "lz4") == 0)
+				opt->compression = BACKUP_COMPRESSION_LZ4;
+			else if (pg_strcasecmp(method, "zstd") == 0)
+				opt->compression = BACKUP_COMPRESSION_ZSTD;
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("unrecognized compression method \"%s\"",
+								method)));
+
+#ifndef HAVE_LIBZ
+			if (opt->compression == BACKUP_COMPRESSION_GZIP)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("compression method \"%s\" is not supported by this build",
+								method)));
+#endif
+#ifndef USE_LZ4
+			if (opt->compression == BACKUP_COMPRESSION_LZ4)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("compression method \"%s\" is not supported by this build",
+								method)));
+#endif
+#ifndef USE_ZSTD
+			if (opt->compression == BACKUP_COMPRESSION_ZSTD)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("compression method \"%s\" is not supported by this build",
+								method)));
+#endif
+			o_compression = true;
+		}
+		else if (strcmp(defel->defname, "compression_level") == 0)
+		{
+			if (o_compression_level)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->compression_level = intVal(defel->arg);
+			o_compression_level = true;
+		}
+		else if (strcmp(defel->defname, "parallel") == 0)
+		{
+			if (o_parallel)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->parallel = true;
+			o_parallel = true;
+		}
+		else if (strcmp(defel->defname, "tablespace") == 0)
+		{
+			if (o_tablespace)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->tablespace = (Oid) intVal(defel->arg);
+			if (!OidIsValid(opt->tablespace))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid tablespace OID %u", opt->tablespace)));
+			o_tablespace = true;
+		}
+		else if (strcmp(defel->defname, "start_lsn") == 0)
+		{
+			if (o_start_lsn)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->startpoint =
+				DatumGetLSN(DirectFunctionCall1(pg_lsn_in,
+												CStringGetDatum(strVal(defel->arg))));
+			o_start_lsn = true;
+		}
+		else if (strcmp(defel->defname, "incremental") == 0)
+		{
+			if (o_incremental)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->incremental_lsn =
+				DatumGetLSN(DirectFunctionCall1(pg_lsn_in,
+												CStringGetDatum(strVal(defel->arg))));
+			if (XLogRecPtrIsInvalid(opt->incremental_lsn))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid incremental backup reference location \"%s\"",
+								strVal(defel->arg))));
+			o_incremental = true;
+		}
 		else
 			elog(ERROR, "option \"%s\" not recognized",
 				 defel->defname);
 	}
 	if (opt->label == NULL)
 		opt->label = "base backup";
+
+	if (o_compression_level)
+	{
+		int			max_level;
+
+		switch (opt->compression)
+		{
+			case BACKUP_COMPRESSION_GZIP:
+				max_level = 9;
+				break;
+			case BACKUP_COMPRESSION_LZ4:
+				max_level = 12;
+				break;
+			case BACKUP_COMPRESSION_ZSTD:
+				max_level = 22;
+				break;
+			default:
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("COMPRESSION_LEVEL requires a compression method")));
+				max_level = 0;	/* keep compiler quiet */
+				break;
+		}
+		if (opt->compression_level < 1 || opt->compression_level > max_level)
+			ereport(ERROR,
+					(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+					 errmsg("%d is outside the valid range for parameter \"%s\" (%d .. %d)",
+							opt->compression_level, "COMPRESSION_LEVEL",
+							1, max_level)));
+	}
+
+	if (opt->parallel && opt->includewal)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("options \"%s\" and \"%s\" cannot be used together",
+						"PARALLEL", "WAL")));
+
+	if (o_incremental && (o_parallel || o_tablespace))
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("INCREMENTAL cannot be combined with PARALLEL or TABLESPACE")));
+
+	if (o_tablespace != o_start_lsn)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("options \"%s\" and \"%s\" must be used together",
+						"TABLESPACE", "START_LSN")));
+
+	/*
+	 * Sending a single tablespace doesn't start or stop the backup, nor does
+	 * it send any of the main data directory.
+	 */
+	if (o_tablespace &&
+		(o_label || o_progress || o_fast || o_nowait || o_wal ||
+		 o_tablespace_map || o_parallel))
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("TABLESPACE can only be combined with START_LSN, MAX_RATE, NOVERIFY_CHECKSUMS, COMPRESSION and COMPRESSION_LEVEL")));
 }
 
 
@@ -762,18 +1104,63 @@ SendBaseBackup(BaseBackupCmd *cmd)
 
 	parse_basebackup_options(cmd->options, &opt);
 
+	if (parallel_backup_label != NULL && !OidIsValid(opt.tablespace))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("a parallel base backup is already in progress in this session"),
+				 errhint("Run STOP_BACKUP to finish it.")));
+
+	compression = opt.compression;
+	compression_level = opt.compression_level;
+
 	WalSndSetState(WALSNDSTATE_BACKUP);
 
 	if (update_process_title)
 	{
 		char		activitymsg[50];
 
-		snprintf(activitymsg, sizeof(activitymsg), "sending backup \"%s\"",
-				 opt.label);
+		if (OidIsValid(opt.tablespace))
+			snprintf(activitymsg, sizeof(activitymsg),
+					 "sending backup of tablespace %u", opt.tablespace);
+		else
+			snprintf(activitymsg, sizeof(activitymsg), "sending backup \"%s\"",
+					 opt.label);
 		set_ps_display(activitymsg, false);
 	}
 
-	perform_base_backup(&opt);
+	if (OidIsValid(opt.tablespace))
+		perform_tablespace_backup(&opt);
+	else
+		perform_base_backup(&opt);
+}
+
+/*
+ * SendStopBackup() - finish a parallel base backup.
+ *
+ * Takes the system out of backup mode after a BASE_BACKUP PARALLEL command,
+ * once the client has received all the tablespaces, and sends the end
+ * position of the backup.
+ */
+void
+SendStopBackup(StopBackupCmd *cmd)
+{
+	XLogRecPtr	endptr;
+	TimeLineID	endtli;
+
+	if (parallel_backup_label == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("no parallel base backup is in progress in this session")));
+
+	WalSndSetState(WALSNDSTATE_BACKUP);
+
+	endptr = do_pg_stop_backup(parallel_backup_label, !cmd->nowait, &endtli);
+	cancel_before_shmem_exit(base_backup_cleanup, (Datum) 0);
+
+	pfree(parallel_backup_label);
+	parallel_backup_label = NULL;
+
+	SendXlogRecPtrResult(endptr, endtli);
 }
 
 static void
@@ -946,7 +1333,7 @@ sendFileWithContent(const char *filename, const char *content)
 
 	_tarWriteHeader(filename, NULL, &statbuf, false);
 	/* Send the contents as a CopyData message */
-	pq_putmessage('d', content, len);
+	send_archive_data(content, len);
 
 	/* Pad to 512 byte boundary, per tar format requirements */
 	pad = ((len + 511) & ~511) - len;
@@ -955,7 +1342,7 @@ sendFileWithContent(const char *filename, const char *content)
 		char		buf[512];
 
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		send_archive_data(buf, pad);
 	}
 }
 
@@ -1300,10 +1687,30 @@ sendDir(const char *path, int basepathlen, bool sizeonly, List *tablespaces,
 		else if (S_ISREG(statbuf.st_mode))
 		{
 			bool		sent = false;
+			RelFileNode rnode;
+			ForkNumber	forknum;
+			BlockNumber segno;
+			Bitmapset  *blocks;
 
 			if (!sizeonly)
-				sent = sendFile(pathbuf, pathbuf + basepathlen + 1, &statbuf,
-								true, isDbDir ? pg_atoi(lastDir + 1, sizeof(Oid), 0) : InvalidOid);
+			{
+				/*
+				 * In an incremental backup, send only the modified blocks of
+				 * relation segments, unless the whole segment is needed.
+				 */
+				if (incremental_info != NULL &&
+					get_relation_segment(path, de->d_name, isDbDir,
+										 &rnode, &forknum, &segno) &&
+					GetModifiedBlocks(incremental_info, &rnode, forknum,
+									  segno, &blocks))
+					sent = sendIncrementalFile(pathbuf,
+											   pathbuf + basepathlen + 1,
+											   &statbuf, blocks);
+				else
+					sent = sendFile(pathbuf, pathbuf + basepathlen + 1,
+									&statbuf, true,
+									isDbDir ? pg_atoi(lastDir + 1, sizeof(Oid), 0) : InvalidOid);
+			}
 
 			if (sent || sizeonly)
 			{
@@ -1347,6 +1754,44 @@ is_checksummed_file(const char *fullpath, const char *filename)
 		return false;
 }
 
+/*
+ * Check whether 'filename' in directory 'path' is a segment of a permanent
+ * relation, and if so, identify it.  'isDbDir' tells whether 'path' is a
+ * database directory, as determined by sendDir().
+ */
+static bool
+get_relation_segment(const char *path, const char *filename, bool isDbDir,
+					 RelFileNode *rnode, ForkNumber *forknum,
+					 BlockNumber *segno)
+{
+	int			oidchars;
+	const char *segpath;
+
+	if (isDbDir)
+	{
+		rnode->spcNode = strncmp(path, "./base/", 7) == 0 ?
+			DEFAULTTABLESPACE_OID : current_tablespace;
+		rnode->dbNode = atooid(last_dir_separator(path) + 1);
+	}
+	else if (strcmp(path, "./global") == 0)
+	{
+		rnode->spcNode = GLOBALTABLESPACE_OID;
+		rnode->dbNode = InvalidOid;
+	}
+	else
+		return false;
+
+	if (!OidIsValid(rnode->spcNode) ||
+		!parse_filename_for_nontemp_relation(filename, &oidchars, forknum))
+		return false;
+
+	rnode->relNode = atooid(filename);
+	segpath = strchr(filename, '.');
+	*segno = segpath ? atoi(segpath + 1) : 0;
+
+	return true;
+}
+
 /*****
  * Functions for handling tar file format
  *
@@ -1549,9 +1994,7 @@ sendFile(const char *readfilename, const char *tarfilename, struct stat *statbuf
 		}
 
 		/* Send the chunk as a CopyData message */
-		if (pq_putmessage('d', buf, cnt))
-			ereport(ERROR,
-					(errmsg("base backup could not send data, aborting backup")));
+		send_archive_data(buf, cnt);
 
 		len += cnt;
 		throttle(cnt);
@@ -1576,7 +2019,7 @@ sendFile(const char *readfilename, const char *tarfilename, struct stat *statbuf
 		while (len < statbuf->st_size)
 		{
 			cnt = Min(sizeof(buf), statbuf->st_size - len);
-			pq_putmessage('d', buf, cnt);
+			send_archive_data(buf, cnt);
 			len += cnt;
 			throttle(cnt);
 		}
@@ -1590,7 +2033,7 @@ sendFile(const char *readfilename, const char *tarfilename, struct stat *statbuf
 	if (pad > 0)
 	{
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		send_archive_data(buf, pad);
 	}
 
 	FreeFile(fp);
@@ -1611,6 +2054,134 @@ sendFile(const char *readfilename, const char *tarfilename, struct stat *statbuf
 	return true;
 }
 
+/*
+ * Send a relation segment in an incremental backup, including only the
+ * blocks in 'blocks'.  The file is sent under its name prefixed with
+ * INCREMENTAL_PREFIX, in the format described in basebackup_incremental.h.
+ *
+ * Checksums are not verified on the blocks sent this way.
+ *
+ * Returns true if the file was successfully sent, false if the file did not
+ * exist.
+ */
+static bool
+sendIncrementalFile(const char *readfilename, const char *tarfilename,
+					struct stat *statbuf, Bitmapset *blocks)
+{
+	FILE	   *fp;
+	char		buf[TAR_SEND_SIZE];
+	char		incrfilename[MAXPGPATH];
+	const char *filename;
+	IncrementalFileHeader hdr;
+	BlockNumber *blocknums;
+	struct stat incrstatbuf;
+	pgoff_t		len;
+	size_t		pad;
+	size_t		buflen = 0;
+	BlockNumber nextblkno = InvalidBlockNumber;
+	int			blkno;
+	uint32		i;
+
+	fp = AllocateFile(readfilename, "rb");
+	if (fp == NULL)
+	{
+		if (errno == ENOENT)
+			return false;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", readfilename)));
+	}
+
+	/*
+	 * Blocks beyond the length of the segment must have been truncated away
+	 * after the WAL we scanned, and any partial block at the end was being
+	 * added concurrently; either way, replaying WAL takes care of them.
+	 */
+	hdr.magic = INCREMENTAL_MAGIC;
+	hdr.truncation_block_length = statbuf->st_size / BLCKSZ;
+	hdr.nblocks = 0;
+	blocknums = palloc(sizeof(BlockNumber) * Max(bms_num_members(blocks), 1));
+	blkno = -1;
+	while ((blkno = bms_next_member(blocks, blkno)) >= 0 &&
+		   (BlockNumber) blkno < hdr.truncation_block_length)
+		blocknums[hdr.nblocks++] = blkno;
+
+	filename = last_dir_separator(tarfilename);
+	if (filename == NULL)
+		snprintf(incrfilename, sizeof(incrfilename), "%s%s",
+				 INCREMENTAL_PREFIX, tarfilename);
+	else
+		snprintf(incrfilename, sizeof(incrfilename), "%.*s%s%s",
+				 (int) (filename + 1 - tarfilename), tarfilename,
+				 INCREMENTAL_PREFIX, filename + 1);
+
+	incrstatbuf = *statbuf;
+	incrstatbuf.st_size = sizeof(IncrementalFileHeader) +
+		sizeof(BlockNumber) * hdr.nblocks + (pgoff_t) BLCKSZ * hdr.nblocks;
+	_tarWriteHeader(incrfilename, NULL, &incrstatbuf, false);
+
+	send_archive_data((char *) &hdr, sizeof(IncrementalFileHeader));
+	send_archive_data((char *) blocknums, sizeof(BlockNumber) * hdr.nblocks);
+	len = sizeof(IncrementalFileHeader) + sizeof(BlockNumber) * hdr.nblocks;
+	throttle(len);
+
+	/* Send the blocks, reading consecutive ones in one go where possible */
+	Assert(TAR_SEND_SIZE % BLCKSZ == 0);
+	for (i = 0; i < hdr.nblocks; i++)
+	{
+		size_t		cnt;
+
+		if (blocknums[i] != nextblkno || buflen == sizeof(buf))
+		{
+			if (buflen > 0)
+			{
+				send_archive_data(buf, buflen);
+				throttle(buflen);
+				len += buflen;
+				buflen = 0;
+			}
+			if (fseek(fp, (long) blocknums[i] * BLCKSZ, SEEK_SET) != 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not fseek in file \"%s\": %m",
+								readfilename)));
+		}
+
+		/*
+		 * If the file was truncated concurrently, send zeros instead; WAL
+		 * replay will truncate it again.
+		 */
+		cnt = fread(buf + buflen, 1, BLCKSZ, fp);
+		CHECK_FREAD_ERROR(fp, readfilename);
+		if (cnt < BLCKSZ)
+			MemSet(buf + buflen + cnt, 0, BLCKSZ - cnt);
+
+		buflen += BLCKSZ;
+		nextblkno = blocknums[i] + 1;
+	}
+	if (buflen > 0)
+	{
+		send_archive_data(buf, buflen);
+		throttle(buflen);
+		len += buflen;
+	}
+
+	Assert(len == incrstatbuf.st_size);
+
+	/* Pad to 512 byte boundary, per tar format requirements */
+	pad = ((len + 511) & ~511) - len;
+	if (pad > 0)
+	{
+		MemSet(buf, 0, pad);
+		send_archive_data(buf, pad);
+	}
+
+	FreeFile(fp);
+	pfree(blocknums);
+
+	return true;
+}
+
 
 static int64
 _tarWriteHeader(const char *filename, const char *linktarget,
@@ -1644,7 +2215,7 @@ _tarWriteHeader(const char *filename, const char *linktarget,
 				elog(ERROR, "unrecognized tar error: %d", rc);
 		}
 
-		pq_putmessage('d', h, sizeof(h));
+		send_archive_data(h, sizeof(h));
 	}
 
 	return sizeof(h);
@@ -1669,6 +2240,349 @@ _tarWriteDir(const char *pathbuf, int basepathlen, struct stat *statbuf,
 	return _tarWriteHeader(pathbuf + basepathlen + 1, NULL, statbuf, sizeonly);
 }
 
+/*
+ * Start a tar stream: send a CopyOutResponse message, and begin a new
+ * compressed stream if server-side compression was requested.
+ */
+static void
+begin_archive(void)
+{
+	StringInfoData buf;
+	size_t		bufsize = 0;
+
+	/* Send CopyOutResponse message */
+	pq_beginmessage(&buf, 'H');
+	pq_sendbyte(&buf, 0);		/* overall format */
+	pq_sendint16(&buf, 0);		/* natts */
+	pq_endmessage(&buf);
+
+	if (compression == BACKUP_COMPRESSION_NONE)
+		return;
+
+	/* Make sure the output buffer is big enough for the chosen method */
+	switch (compression)
+	{
+#ifdef HAVE_LIBZ
+		case BACKUP_COMPRESSION_GZIP:
+			bufsize = TAR_SEND_SIZE;
+			break;
+#endif
+#ifdef USE_LZ4
+		case BACKUP_COMPRESSION_LZ4:
+			memset(&lz4_prefs, 0, sizeof(lz4_prefs));
+			lz4_prefs.compressionLevel = compression_level;
+			bufsize = LZ4F_compressBound(TAR_SEND_SIZE, &lz4_prefs);
+			break;
+#endif
+#ifdef USE_ZSTD
+		case BACKUP_COMPRESSION_ZSTD:
+			bufsize = ZSTD_CStreamOutSize();
+			break;
+#endif
+		default:
+			elog(ERROR, "unrecognized compression method: %d", compression);
+	}
+	if (compress_buf_size < bufsize)
+	{
+		if (compress_buf)
+			pfree(compress_buf);
+		compress_buf = MemoryContextAlloc(TopMemoryContext, bufsize);
+		compress_buf_size = bufsize;
+	}
+
+	switch (compression)
+	{
+#ifdef HAVE_LIBZ
+		case BACKUP_COMPRESSION_GZIP:
+			{
+				/*
+				 * Start from a fresh stream every time, as the previous one
+				 * may have been abandoned halfway through by an error.
+				 */
+				if (gzip_stream == NULL)
+					gzip_stream = MemoryContextAlloc(TopMemoryContext,
+													 sizeof(z_stream));
+				else
+					deflateEnd(gzip_stream);
+				memset(gzip_stream, 0, sizeof(z_stream));
+
+				/* 15 + 16 asks for a gzip header and trailer */
+				if (deflateInit2(gzip_stream,
+								 compression_level ? compression_level : Z_DEFAULT_COMPRESSION,
+								 Z_DEFLATED, 15 + 16, 8,
+								 Z_DEFAULT_STRATEGY) != Z_OK)
+					ereport(ERROR,
+							(errcode(ERRCODE_OUT_OF_MEMORY),
+							 errmsg("could not initialize compression library: %s",
+									gzip_stream->msg ? gzip_stream->msg : "unknown error")));
+				break;
+			}
+#endif
+#ifdef USE_LZ4
+		case BACKUP_COMPRESSION_LZ4:
+			{
+				size_t		len;
+
+				if (lz4_cctx == NULL)
+				{
+					LZ4F_errorCode_t err;
+
+					err = LZ4F_createCompressionContext(&lz4_cctx, LZ4F_VERSION);
+					if (LZ4F_isError(err))
+						ereport(ERROR,
+								(errcode(ERRCODE_OUT_OF_MEMORY),
+								 errmsg("could not create LZ4 compression context: %s",
+										LZ4F_getErrorName(err))));
+				}
+
+				len = LZ4F_compressBegin(lz4_cctx, compress_buf,
+										 compress_buf_size, &lz4_prefs);
+				if (LZ4F_isError(len))
+					ereport(ERROR,
+							(errmsg("could not compress data: %s",
+									LZ4F_getErrorName(len))));
+				send_compressed_data(compress_buf, len);
+				break;
+			}
+#endif
+#ifdef USE_ZSTD
+		case BACKUP_COMPRESSION_ZSTD:
+			{
+				size_t		ret;
+
+				if (zstd_cctx == NULL)
+				{
+					zstd_cctx = ZSTD_createCCtx();
+					if (zstd_cctx == NULL)
+						ereport(ERROR,
+								(errcode(ERRCODE_OUT_OF_MEMORY),
+								 errmsg("could not create zstd compression context")));
+				}
+
+				ZSTD_CCtx_reset(zstd_cctx, ZSTD_reset_session_only);
+				ret = ZSTD_CCtx_setParameter(zstd_cctx, ZSTD_c_compressionLevel,
+											 compression_level ? compression_level : ZSTD_CLEVEL_DEFAULT);
+				if (ZSTD_isError(ret))
+					ereport(ERROR,
+							(errmsg("could not set zstd compression level %d: %s",
+									compression_level, ZSTD_getErrorName(ret))));
+				break;
+			}
+#endif
+		default:
+			elog(ERROR, "unrecognized compression method: %d", compression);
+	}
+}
+
+/*
+ * Add data to the current tar stream, compressing it if requested.
+ */
+static void
+send_archive_data(const char *data, size_t len)
+{
+	switch (compression)
+	{
+		case BACKUP_COMPRESSION_NONE:
+			/* Send the chunk as a CopyData message */
+			if (pq_putmessage('d', data, len))
+				ereport(ERROR,
+						(errmsg("base backup could not send data, aborting backup")));
+			break;
+#ifdef HAVE_LIBZ
+		case BACKUP_COMPRESSION_GZIP:
+			gzip_stream->next_in = (Bytef *) data;
+			gzip_stream->avail_in = len;
+			while (gzip_stream->avail_in > 0)
+			{
+				gzip_stream->next_out = (Bytef *) compress_buf;
+				gzip_stream->avail_out = compress_buf_size;
+				if (deflate(gzip_stream, Z_NO_FLUSH) == Z_STREAM_ERROR)
+					ereport(ERROR,
+							(errmsg("could not compress data: %s",
+									gzip_stream->msg ? gzip_stream->msg : "unknown error")));
+				send_compressed_data(compress_buf,
+									 compress_buf_size - gzip_stream->avail_out);
+			}
+			break;
+#endif
+#ifdef USE_LZ4
+		case BACKUP_COMPRESSION_LZ4:
+			/* The output buffer is only large enough for TAR_SEND_SIZE */
+			while (len > 0)
+			{
+				size_t		chunk = Min(len, TAR_SEND_SIZE);
+				size_t		clen;
+
+				clen = LZ4F_compressUpdate(lz4_cctx, compress_buf,
+										   compress_buf_size, data, chunk,
+										   NULL);
+				if (LZ4F_isError(clen))
+					ereport(ERROR,
+							(errmsg("could not compress data: %s",
+									LZ4F_getErrorName(clen))));
+				send_compressed_data(compress_buf, clen);
+				data += chunk;
+				len -= chunk;
+			}
+			break;
+#endif
+#ifdef USE_ZSTD
+		case BACKUP_COMPRESSION_ZSTD:
+			{
+				ZSTD_inBuffer in = {data, len, 0};
+
+				while (in.pos < in.size)
+				{
+					ZSTD_outBuffer out = {compress_buf, compress_buf_size, 0};
+					size_t		ret;
+
+					ret = ZSTD_compressStream2(zstd_cctx, &out, &in,
+											   ZSTD_e_continue);
+					if (ZSTD_isError(ret))
+						ereport(ERROR,
+								(errmsg("could not compress data: %s",
+										ZSTD_getErrorName(ret))));
+					send_compressed_data(compress_buf, out.pos);
+				}
+				break;
+			}
+#endif
+		default:
+			elog(ERROR, "unrecognized compression method: %d", compression);
+	}
+}
+
+/*
+ * Finish the current tar stream, and send a CopyDone message.
+ *
+ * Uncompressed streams are left without the end-of-archive marker, which the
+ * client appends after any files of its own.  That's not possible once the
+ * stream is compressed, so in that case the marker is added here.
+ */
+static void
+end_archive(void)
+{
+	if (compression != BACKUP_COMPRESSION_NONE)
+	{
+		char		zerobuf[1024];
+
+		/* 2 * 512 bytes empty data at end of file */
+		MemSet(zerobuf, 0, sizeof(zerobuf));
+		send_archive_data(zerobuf, sizeof(zerobuf));
+	}
+
+	switch (compression)
+	{
+		case BACKUP_COMPRESSION_NONE:
+			break;
+#ifdef HAVE_LIBZ
+		case BACKUP_COMPRESSION_GZIP:
+			{
+				int			rc;
+
+				gzip_stream->avail_in = 0;
+				do
+				{
+					gzip_stream->next_out = (Bytef *) compress_buf;
+					gzip_stream->avail_out = compress_buf_size;
+					rc = deflate(gzip_stream, Z_FINISH);
+					if (rc == Z_STREAM_ERROR)
+						ereport(ERROR,
+								(errmsg("could not compress data: %s",
+										gzip_stream->msg ? gzip_stream->msg : "unknown error")));
+					send_compressed_data(compress_buf,
+										 compress_buf_size - gzip_stream->avail_out);
+				} while (rc != Z_STREAM_END);
+				break;
+			}
+#endif
+#ifdef USE_LZ4
+		case BACKUP_COMPRESSION_LZ4:
+			{
+				size_t		clen;
+
+				clen = LZ4F_compressEnd(lz4_cctx, compress_buf,
+										compress_buf_size, NULL);
+				if (LZ4F_isError(clen))
+					ereport(ERROR,
+							(errmsg("could not compress data: %s",
+									LZ4F_getErrorName(clen))));
+				send_compressed_data(compress_buf, clen);
+				break;
+			}
+#endif
+#ifdef USE_ZSTD
+		case BACKUP_COMPRESSION_ZSTD:
+			{
+				ZSTD_inBuffer in = {NULL, 0, 0};
+				size_t		remaining;
+
+				do
+				{
+					ZSTD_outBuffer out = {compress_buf, compress_buf_size, 0};
+
+					remaining = ZSTD_compressStream2(zstd_cctx, &out, &in,
+													 ZSTD_e_end);
+					if (ZSTD_isError(remaining))
+						ereport(ERROR,
+								(errmsg("could not compress data: %s",
+										ZSTD_getErrorName(remaining))));
+					send_compressed_data(compress_buf, out.pos);
+				} while (remaining != 0);
+				break;
+			}
+#endif
+		default:
+			elog(ERROR, "unrecognized compression method: %d", compression);
+	}
+
+	pq_putemptymessage('c');	/* CopyDone */
+}
+
+/*
+ * Send a piece of compressed data as a CopyData message.
+ */
+static void
+send_compressed_data(const char *data, size_t len)
+{
+	if (len == 0)
+		return;
+
+	if (pq_putmessage('d', data, len))
+		ereport(ERROR,
+				(errmsg("base backup could not send data, aborting backup")));
+}
+
+/*
+ * Setup and activate network throttling, if the client requested it.
+ */
+static void
+setup_throttle(uint32 maxrate)
+{
+	if (maxrate > 0)
+	{
+		throttling_sample =
+			(int64) maxrate * (int64) 1024 / THROTTLING_FREQUENCY;
+
+		/*
+		 * The minimum amount of time for throttling_sample bytes to be
+		 * transferred.
+		 */
+		elapsed_min_unit = USECS_PER_SEC / THROTTLING_FREQUENCY;
+
+		/* Enable throttling. */
+		throttling_counter = 0;
+
+		/* The 'real data' starts now (header was ignored). */
+		throttled_last = GetCurrentTimestamp();
+	}
+	else
+	{
+		/* Disable throttling. */
+		throttling_counter = -1;
+	}
+}
+
 /*
  * Increment the network transfer counter by the given number of bytes,
  * and sleep if necessary to comply with the requested network transfer
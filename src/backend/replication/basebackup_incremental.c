@@ -0,0 +1,302 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_incremental.c
+ *	  code for determining which blocks to include in an incremental
+ *	  base backup
+ *
+ * Every change to a relation block is WAL-logged with a reference to the
+ * block, so the blocks modified since an earlier backup started can be
+ * found by reading the WAL between that backup's start location and ours.
+ * We collect them in a hash table keyed by relation segment, holding the
+ * set of modified block offsets within each segment.
+ *
+ * Some changes can't be tracked that way.  A relation that was created or
+ * truncated in the meantime, or that belongs to a database created in the
+ * meantime, is sent in full.  So are all forks other than the main fork,
+ * since the free space map is not WAL-logged and visibility map bits are
+ * cleared without registering the map page.
+ *
+ * Portions Copyright (c) 2010-2019, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/basebackup_incremental.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogreader.h"
+#include "access/xlogutils.h"
+#include "catalog/storage_xlog.h"
+#include "commands/dbcommands_xlog.h"
+#include "miscadmin.h"
+#include "replication/basebackup_incremental.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+/* Hash table key identifying a relation segment */
+typedef struct ModifiedSegmentKey
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber segno;
+} ModifiedSegmentKey;
+
+typedef struct ModifiedSegmentEntry
+{
+	ModifiedSegmentKey key;		/* hash key; must be first */
+	Bitmapset  *blocks;			/* modified blocks, relative to segment */
+} ModifiedSegmentEntry;
+
+/*
+ * Relations to send in full are tracked by RelFileNode.  An entry with
+ * relNode == InvalidOid covers a whole database directory.
+ */
+typedef struct FullRelationEntry
+{
+	RelFileNode rnode;			/* hash key; must be first */
+} FullRelationEntry;
+
+struct IncrementalBackupInfo
+{
+	MemoryContext mcxt;
+	HTAB	   *segments;
+	HTAB	   *fullrels;
+};
+
+static void mark_block_modified(IncrementalBackupInfo *ib,
+								const RelFileNode *rnode, ForkNumber forknum,
+								BlockNumber blkno);
+static void mark_relation_full(IncrementalBackupInfo *ib, Oid spcNode,
+							   Oid dbNode, Oid relNode);
+static void process_record(IncrementalBackupInfo *ib, XLogReaderState *record);
+
+/*
+ * Scan the WAL between 'prior_lsn', the start location of the backup the
+ * new one is based on, and 'start_lsn', the start location of the new
+ * backup, and build the map of modified blocks from it.
+ */
+IncrementalBackupInfo *
+BuildIncrementalBackupInfo(XLogRecPtr prior_lsn, XLogRecPtr start_lsn)
+{
+	IncrementalBackupInfo *ib;
+	XLogReaderState *xlogreader;
+	XLogRecPtr	recptr;
+	XLogSegNo	prior_segno;
+	HASHCTL		ctl;
+	MemoryContext oldcontext;
+
+	if (prior_lsn > start_lsn)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("incremental backup reference location %X/%X is ahead of the backup start location %X/%X",
+						(uint32) (prior_lsn >> 32), (uint32) prior_lsn,
+						(uint32) (start_lsn >> 32), (uint32) start_lsn)));
+
+	/*
+	 * Fail early with a useful message if the WAL we need is gone.  It could
+	 * still be removed by a checkpoint while we're reading it, in which case
+	 * we fail when we get there.
+	 */
+	XLByteToSeg(prior_lsn, prior_segno, wal_segment_size);
+	if (prior_segno <= XLogGetLastRemovedSegno())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("WAL required for an incremental backup from %X/%X has already been removed",
+						(uint32) (prior_lsn >> 32), (uint32) prior_lsn),
+				 errhint("Take a full backup instead.")));
+
+	ib = palloc(sizeof(IncrementalBackupInfo));
+	ib->mcxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "incremental backup",
+									 ALLOCSET_DEFAULT_SIZES);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(ModifiedSegmentKey);
+	ctl.entrysize = sizeof(ModifiedSegmentEntry);
+	ctl.hcxt = ib->mcxt;
+	ib->segments = hash_create("incremental backup modified segments", 1024,
+							   &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(RelFileNode);
+	ctl.entrysize = sizeof(FullRelationEntry);
+	ctl.hcxt = ib->mcxt;
+	ib->fullrels = hash_create("incremental backup full relations", 64,
+							   &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	if (prior_lsn == start_lsn)
+		return ib;
+
+	xlogreader = XLogReaderAllocate(wal_segment_size, NULL,
+									&read_local_xlog_page, NULL);
+	if (!xlogreader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	oldcontext = MemoryContextSwitchTo(ib->mcxt);
+
+	/*
+	 * The start location of a backup is the redo pointer of a checkpoint, so
+	 * there's a record starting right there.
+	 */
+	recptr = prior_lsn;
+	for (;;)
+	{
+		XLogRecord *record;
+		char	   *errormsg;
+
+		CHECK_FOR_INTERRUPTS();
+
+		record = XLogReadRecord(xlogreader, recptr, &errormsg);
+		if (record == NULL)
+		{
+			if (errormsg)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read WAL record at %X/%X: %s",
+								(uint32) (xlogreader->EndRecPtr >> 32),
+								(uint32) xlogreader->EndRecPtr,
+								errormsg)));
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read WAL record at %X/%X",
+							(uint32) (xlogreader->EndRecPtr >> 32),
+							(uint32) xlogreader->EndRecPtr)));
+		}
+		recptr = InvalidXLogRecPtr;
+
+		if (xlogreader->ReadRecPtr >= start_lsn)
+			break;
+
+		process_record(ib, xlogreader);
+
+		if (xlogreader->EndRecPtr >= start_lsn)
+			break;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	XLogReaderFree(xlogreader);
+
+	elog(DEBUG1, "incremental backup: %ld modified relation segments, %ld relations sent in full",
+		 hash_get_num_entries(ib->segments),
+		 hash_get_num_entries(ib->fullrels));
+
+	return ib;
+}
+
+/*
+ * Determine which blocks of the given relation segment need to be sent.
+ *
+ * Returns false if the whole segment must be sent.  Otherwise returns true,
+ * and sets *blocks to the set of modified block offsets within the segment,
+ * which is NULL if none were modified.
+ */
+bool
+GetModifiedBlocks(IncrementalBackupInfo *ib, const RelFileNode *rnode,
+				  ForkNumber forknum, BlockNumber segno, Bitmapset **blocks)
+{
+	ModifiedSegmentKey key;
+	ModifiedSegmentEntry *entry;
+	RelFileNode dbnode;
+
+	if (forknum != MAIN_FORKNUM)
+		return false;
+
+	if (hash_search(ib->fullrels, rnode, HASH_FIND, NULL) != NULL)
+		return false;
+
+	dbnode = *rnode;
+	dbnode.relNode = InvalidOid;
+	if (hash_search(ib->fullrels, &dbnode, HASH_FIND, NULL) != NULL)
+		return false;
+
+	key.rnode = *rnode;
+	key.forknum = forknum;
+	key.segno = segno;
+	entry = hash_search(ib->segments, &key, HASH_FIND, NULL);
+
+	*blocks = entry ? entry->blocks : NULL;
+	return true;
+}
+
+static void
+mark_block_modified(IncrementalBackupInfo *ib, const RelFileNode *rnode,
+					ForkNumber forknum, BlockNumber blkno)
+{
+	ModifiedSegmentKey key;
+	ModifiedSegmentEntry *entry;
+	bool		found;
+
+	/* Only the main fork is ever sent incrementally */
+	if (forknum != MAIN_FORKNUM)
+		return;
+
+	key.rnode = *rnode;
+	key.forknum = forknum;
+	key.segno = blkno / RELSEG_SIZE;
+	entry = hash_search(ib->segments, &key, HASH_ENTER, &found);
+	if (!found)
+		entry->blocks = NULL;
+	entry->blocks = bms_add_member(entry->blocks, blkno % RELSEG_SIZE);
+}
+
+static void
+mark_relation_full(IncrementalBackupInfo *ib, Oid spcNode, Oid dbNode,
+				   Oid relNode)
+{
+	RelFileNode rnode;
+
+	rnode.spcNode = spcNode;
+	rnode.dbNode = dbNode;
+	rnode.relNode = relNode;
+	(void) hash_search(ib->fullrels, &rnode, HASH_ENTER, NULL);
+}
+
+static void
+process_record(IncrementalBackupInfo *ib, XLogReaderState *record)
+{
+	uint8		rmid = XLogRecGetRmid(record);
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	int			block_id;
+
+	for (block_id = 0; block_id <= record->max_block_id; block_id++)
+	{
+		RelFileNode rnode;
+		ForkNumber	forknum;
+		BlockNumber blkno;
+
+		if (!XLogRecGetBlockTag(record, block_id, &rnode, &forknum, &blkno))
+			continue;
+		mark_block_modified(ib, &rnode, forknum, blkno);
+	}
+
+	if (rmid == RM_SMGR_ID)
+	{
+		if (info == XLOG_SMGR_CREATE)
+		{
+			xl_smgr_create *xlrec = (xl_smgr_create *) XLogRecGetData(record);
+
+			mark_relation_full(ib, xlrec->rnode.spcNode, xlrec->rnode.dbNode,
+							   xlrec->rnode.relNode);
+		}
+		else if (info == XLOG_SMGR_TRUNCATE)
+		{
+			xl_smgr_truncate *xlrec = (xl_smgr_truncate *) XLogRecGetData(record);
+
+			mark_relation_full(ib, xlrec->rnode.spcNode, xlrec->rnode.dbNode,
+							   xlrec->rnode.relNode);
+		}
+	}
+	else if (rmid == RM_DBASE_ID && info == XLOG_DBASE_CREATE)
+	{
+		xl_dbase_create_rec *xlrec = (xl_dbase_create_rec *) XLogRecGetData(record);
+
+		mark_relation_full(ib, xlrec->tablespace_id, xlrec->db_id, InvalidOid);
+	}
+}
@@ -422,6 +422,12 @@ libpqrcv_startstreaming(WalReceiverConn *conn,
 		PQfreemem(pubnames_literal);
 		pfree(pubnames_str);
 
+		if (options->proto.logical.binary)
+			appendStringInfoString(&cmd, ", binary 'true'");
+
+		if (options->proto.logical.streaming)
+			appendStringInfoString(&cmd, ", streaming 'on'");
+
 		appendStringInfoChar(&cmd, ')');
 	}
 	else
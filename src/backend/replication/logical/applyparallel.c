@@ -0,0 +1,1013 @@
+/*-------------------------------------------------------------------------
+ * applyparallel.c
+ *	   Parallel apply of logical replication transactions.
+ *
+ * Copyright (c) 2016-2019, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/logical/applyparallel.c
+ *
+ * NOTES
+ *	  The apply worker of a subscription can hand transactions it receives
+ *	  off to a pool of parallel apply workers, rather than applying them
+ *	  itself, so that transactions that don't touch the same rows are
+ *	  applied concurrently.  The apply worker acts as the leader: it
+ *	  forwards each protocol message of a transaction to the worker chosen
+ *	  at its BEGIN, through a shared memory queue, while keeping track of
+ *	  the replica identity key values of the rows each transaction changes.
+ *	  When a change touches a row that an earlier transaction still being
+ *	  applied has changed too, the leader waits for that transaction to
+ *	  commit before passing the change on.
+ *
+ *	  Transactions are numbered in the order they are received, and each
+ *	  worker waits until the transactions numbered before its own have
+ *	  committed before committing, so they commit in the same order as on
+ *	  the publisher, and the replication origin advances monotonically.
+ *	  The workers share the origin of the leader.  The leader reports a
+ *	  transaction as flushed to the publisher only once all transactions
+ *	  before it have been reported committed too.
+ *
+ *	  Changes whose conflicts can't be detected by their key -- TRUNCATE, and
+ *	  changes to relations that have other unique constraints, triggers, or
+ *	  keys that can't be compared reliably in text form (see
+ *	  logicalrep_rel_parallel_keys) -- make their transaction exclusive: it
+ *	  waits for all transactions before it to commit, and the next
+ *	  transaction isn't started before it has committed.  Transactions are
+ *	  applied by the leader itself while any table of the subscription is
+ *	  still being synchronized, and streamed transactions are always applied
+ *	  by the leader, after all transactions before them.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "libpq/pqformat.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "replication/logicallauncher.h"
+#include "replication/logicalproto.h"
+#include "replication/logicalrelation.h"
+#include "replication/logicalworker.h"
+#include "replication/origin.h"
+#include "replication/worker_internal.h"
+#include "storage/condition_variable.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/hashutils.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+
+#define PARALLEL_APPLY_MAGIC		0x50415057
+#define PARALLEL_APPLY_KEY_SHARED	1
+#define PARALLEL_APPLY_KEY_QUEUES	2
+
+/* Size of each worker's queue of protocol messages */
+#define PARALLEL_APPLY_QUEUE_SIZE	(256 * 1024)
+
+/* Forget keys of committed transactions once there are this many */
+#define PARALLEL_APPLY_MAX_KEYS		65536
+
+/* GUCs */
+int			max_parallel_apply_workers_per_subscription = 0;
+
+typedef enum ParallelApplyState
+{
+	PARALLEL_APPLY_IDLE,		/* waiting for a transaction */
+	PARALLEL_APPLY_BUSY,		/* applying a transaction */
+	PARALLEL_APPLY_DONE			/* committed it, not yet reaped by leader */
+} ParallelApplyState;
+
+typedef struct ParallelApplySlot
+{
+	ParallelApplyState state;
+	uint64		seq;			/* number of the transaction being applied */
+	XLogRecPtr	remote_end;		/* its end on the publisher */
+	XLogRecPtr	local_end;		/* its local commit, if any */
+} ParallelApplySlot;
+
+/*
+ * State shared between the leader and its parallel apply workers.  The
+ * slots and last_committed are protected by the mutex.
+ */
+typedef struct ParallelApplyShared
+{
+	slock_t		mutex;
+
+	Oid			dbid;
+	Oid			userid;
+	Oid			subid;
+	pid_t		leader_pid;
+	Latch	   *leader_latch;
+
+	/* Number of the last transaction committed by a worker */
+	uint64		last_committed;
+	ConditionVariable commit_cv;
+
+	int			nworkers;
+	ParallelApplySlot slots[FLEXIBLE_ARRAY_MEMBER];
+} ParallelApplyShared;
+
+/*
+ * Row changed by a transaction handed out, identified by a hash of its key.
+ * Distinct rows may share an entry, which only costs some parallelism.
+ */
+typedef struct ParallelApplyKey
+{
+	LogicalRepRelId relid;
+	uint32		hash;
+} ParallelApplyKey;
+
+typedef struct ParallelApplyKeyEntry
+{
+	ParallelApplyKey key;		/* hash key; must be first */
+	uint64		seq;			/* last transaction that changed the row */
+} ParallelApplyKeyEntry;
+
+/*
+ * RELATION and TYPE messages are applied by all workers, and remembered so
+ * that they can be sent to workers started later.
+ */
+typedef struct ParallelApplySchemaKey
+{
+	char		action;
+	uint32		id;
+} ParallelApplySchemaKey;
+
+typedef struct ParallelApplySchemaEntry
+{
+	ParallelApplySchemaKey key; /* hash key; must be first */
+	char	   *data;
+	int			len;
+} ParallelApplySchemaEntry;
+
+/* Leader state */
+static int	pa_requested = 0;
+static dsm_segment *pa_seg = NULL;
+static ParallelApplyShared *pa_shared = NULL;
+static BackgroundWorkerHandle **pa_handles = NULL;
+static shm_mq_handle **pa_queues = NULL;
+static HTAB *pa_keys = NULL;
+static HTAB *pa_schema = NULL;
+static bool pa_exit_registered = false;
+
+/* Worker the transaction being received is forwarded to, or -1 */
+static int	pa_current = -1;
+
+/*
+ * Transactions are numbered from 1.  All transactions up to pa_reaped have
+ * been committed and recorded for flush tracking; pa_exclusive is the last
+ * transaction that had to be applied alone.
+ */
+static uint64 pa_last_seq = 0;
+static uint64 pa_reaped = 0;
+static uint64 pa_exclusive = 0;
+
+/* Worker state */
+static ParallelApplyShared *MyParallelApplyShared = NULL;
+static ParallelApplySlot *MyParallelApplySlot = NULL;
+
+static volatile sig_atomic_t got_SIGHUP = false;
+
+static void pa_start(void);
+static void pa_shutdown(void);
+static void pa_on_exit(int code, Datum arg);
+static void pa_send(int worker, const char *data, Size len);
+static void pa_wait_for(uint64 seq);
+static bool pa_begin(StringInfo s);
+static void pa_make_exclusive(void);
+static void pa_track_change(char action, StringInfo s);
+static bool pa_track_key(LogicalRepRelId relid, Bitmapset *keys,
+						 LogicalRepTupleData *tup);
+static void pa_remember_schema(char action, StringInfo s);
+
+/*
+ * Launch the workers and set up their queues.  If none can be started, we
+ * carry on applying transactions ourselves.
+ */
+static void
+pa_start(void)
+{
+	int			maxworkers = max_parallel_apply_workers_per_subscription;
+	shm_toc_estimator e;
+	Size		segsize;
+	Size		sharedsize;
+	shm_toc    *toc;
+	char	   *queues;
+	BackgroundWorker worker;
+	MemoryContext oldctx;
+	int			nworkers;
+	int			i;
+
+	sharedsize = add_size(offsetof(ParallelApplyShared, slots),
+						  mul_size(maxworkers, sizeof(ParallelApplySlot)));
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sharedsize);
+	shm_toc_estimate_chunk(&e, mul_size(maxworkers,
+										PARALLEL_APPLY_QUEUE_SIZE));
+	shm_toc_estimate_keys(&e, 2);
+	segsize = shm_toc_estimate(&e);
+
+	pa_seg = dsm_create(segsize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (pa_seg == NULL)
+	{
+		ereport(LOG,
+				(errmsg("could not create shared memory segment for logical replication parallel apply workers")));
+		return;
+	}
+	dsm_pin_mapping(pa_seg);
+	toc = shm_toc_create(PARALLEL_APPLY_MAGIC, dsm_segment_address(pa_seg),
+						 segsize);
+
+	pa_shared = shm_toc_allocate(toc, sharedsize);
+	SpinLockInit(&pa_shared->mutex);
+	pa_shared->dbid = MyLogicalRepWorker->dbid;
+	pa_shared->userid = MyLogicalRepWorker->userid;
+	pa_shared->subid = MyLogicalRepWorker->subid;
+	pa_shared->leader_pid = MyProcPid;
+	pa_shared->leader_latch = MyLatch;
+	pa_shared->last_committed = pa_last_seq;
+	ConditionVariableInit(&pa_shared->commit_cv);
+	pa_shared->nworkers = 0;
+	for (i = 0; i < maxworkers; i++)
+	{
+		pa_shared->slots[i].state = PARALLEL_APPLY_IDLE;
+		pa_shared->slots[i].seq = 0;
+	}
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_SHARED, pa_shared);
+
+	queues = shm_toc_allocate(toc, mul_size(maxworkers,
+											PARALLEL_APPLY_QUEUE_SIZE));
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_QUEUES, queues);
+
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	pa_handles = palloc0(sizeof(BackgroundWorkerHandle *) * maxworkers);
+	pa_queues = palloc0(sizeof(shm_mq_handle *) * maxworkers);
+	MemoryContextSwitchTo(oldctx);
+
+	if (!pa_exit_registered)
+	{
+		before_shmem_exit(pa_on_exit, (Datum) 0);
+		pa_exit_registered = true;
+	}
+
+	memset(&worker, 0, sizeof(worker));
+	snprintf(worker.bgw_type, BGW_MAXLEN,
+			 "logical replication parallel apply worker");
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+		BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	sprintf(worker.bgw_library_name, "postgres");
+	sprintf(worker.bgw_function_name, "ParallelApplyWorkerMain");
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(pa_seg));
+	worker.bgw_notify_pid = MyProcPid;
+
+	/*
+	 * Workers are numbered consecutively from zero, so if we run out of
+	 * background worker slots, we just use fewer.
+	 */
+	for (nworkers = 0; nworkers < maxworkers; nworkers++)
+	{
+		shm_mq	   *mq;
+		pid_t		pid;
+
+		mq = shm_mq_create(queues + nworkers * PARALLEL_APPLY_QUEUE_SIZE,
+						   PARALLEL_APPLY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+
+		snprintf(worker.bgw_name, BGW_MAXLEN,
+				 "logical replication parallel apply worker %d for subscription %u",
+				 nworkers, MyLogicalRepWorker->subid);
+		memcpy(worker.bgw_extra, &nworkers, sizeof(int));
+		if (!RegisterDynamicBackgroundWorker(&worker, &pa_handles[nworkers]))
+			break;
+		if (WaitForBackgroundWorkerStartup(pa_handles[nworkers],
+										   &pid) != BGWH_STARTED)
+		{
+			pfree(pa_handles[nworkers]);
+			pa_handles[nworkers] = NULL;
+			break;
+		}
+		oldctx = MemoryContextSwitchTo(ApplyContext);
+		pa_queues[nworkers] = shm_mq_attach(mq, pa_seg,
+											pa_handles[nworkers]);
+		MemoryContextSwitchTo(oldctx);
+	}
+
+	if (nworkers < maxworkers)
+		ereport(LOG,
+				(errmsg("started %d of %d logical replication parallel apply workers for subscription \"%s\"",
+						nworkers, maxworkers, MySubscription->name),
+				 errhint("You might need to increase max_worker_processes.")));
+
+	pa_shared->nworkers = nworkers;
+	if (nworkers == 0)
+	{
+		pa_shutdown();
+		return;
+	}
+
+	/* Tell the new workers about the relations and types we know */
+	if (pa_schema != NULL)
+	{
+		HASH_SEQ_STATUS status;
+		ParallelApplySchemaEntry *entry;
+
+		hash_seq_init(&status, pa_schema);
+		while ((entry = hash_seq_search(&status)) != NULL)
+		{
+			for (i = 0; i < nworkers; i++)
+				pa_send(i, entry->data, entry->len);
+		}
+	}
+
+	if (pa_keys == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(ParallelApplyKey);
+		ctl.entrysize = sizeof(ParallelApplyKeyEntry);
+		ctl.hcxt = ApplyContext;
+		pa_keys = hash_create("logical replication parallel apply keys",
+							  1024, &ctl,
+							  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+}
+
+/*
+ * Wait for all transactions handed out to be committed, then stop the
+ * workers.
+ */
+static void
+pa_shutdown(void)
+{
+	int			i;
+
+	if (pa_seg == NULL)
+		return;
+
+	pa_wait_for(pa_last_seq);
+
+	/* Workers exit when they see that we've detached from their queues */
+	for (i = 0; i < pa_shared->nworkers; i++)
+		shm_mq_detach(pa_queues[i]);
+	for (i = 0; i < pa_shared->nworkers; i++)
+	{
+		WaitForBackgroundWorkerShutdown(pa_handles[i]);
+		pfree(pa_handles[i]);
+	}
+
+	dsm_detach(pa_seg);
+	pa_seg = NULL;
+	pa_shared = NULL;
+	pfree(pa_handles);
+	pfree(pa_queues);
+	pa_handles = NULL;
+	pa_queues = NULL;
+
+	if (pa_keys != NULL)
+	{
+		hash_destroy(pa_keys);
+		pa_keys = NULL;
+	}
+}
+
+/*
+ * Stop the workers if we exit, whether or not they're done: transactions
+ * they have not committed yet will be received again when we restart.
+ */
+static void
+pa_on_exit(int code, Datum arg)
+{
+	int			i;
+
+	if (pa_seg == NULL)
+		return;
+
+	for (i = 0; i < pa_shared->nworkers; i++)
+		TerminateBackgroundWorker(pa_handles[i]);
+}
+
+/*
+ * Send a protocol message to a worker.
+ */
+static void
+pa_send(int worker, const char *data, Size len)
+{
+	shm_mq_result res;
+
+	res = shm_mq_send(pa_queues[worker], len, data, false);
+	if (res != SHM_MQ_SUCCESS)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("logical replication parallel apply worker %d exited unexpectedly",
+						worker)));
+}
+
+/*
+ * Collect the transactions the workers have committed, in order, and record
+ * them for flush tracking.  Also check that none of the workers has died,
+ * which means that it failed to apply a transaction.
+ */
+void
+parallel_apply_reap(void)
+{
+	bool		found;
+	int			i;
+
+	if (pa_seg == NULL)
+		return;
+
+	do
+	{
+		found = false;
+		for (i = 0; i < pa_shared->nworkers; i++)
+		{
+			ParallelApplySlot *slot = &pa_shared->slots[i];
+			XLogRecPtr	remote_end;
+			XLogRecPtr	local_end;
+
+			SpinLockAcquire(&pa_shared->mutex);
+			if (slot->state != PARALLEL_APPLY_DONE ||
+				slot->seq != pa_reaped + 1)
+			{
+				SpinLockRelease(&pa_shared->mutex);
+				continue;
+			}
+			remote_end = slot->remote_end;
+			local_end = slot->local_end;
+			slot->state = PARALLEL_APPLY_IDLE;
+			SpinLockRelease(&pa_shared->mutex);
+
+			/* Empty transactions don't need to be flushed */
+			if (!XLogRecPtrIsInvalid(local_end))
+				store_flush_position(remote_end, local_end);
+
+			pa_reaped++;
+			found = true;
+		}
+	} while (found);
+
+	for (i = 0; i < pa_shared->nworkers; i++)
+	{
+		pid_t		pid;
+
+		if (GetBackgroundWorkerPid(pa_handles[i], &pid) != BGWH_STARTED)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("logical replication parallel apply worker %d exited unexpectedly",
+							i)));
+	}
+}
+
+/*
+ * Are any transactions handed out to workers not yet reaped?
+ */
+bool
+parallel_apply_in_progress(void)
+{
+	return pa_reaped < pa_last_seq;
+}
+
+/*
+ * Wait until the given transaction, and all before it, have been committed
+ * by the workers.
+ */
+static void
+pa_wait_for(uint64 seq)
+{
+	for (;;)
+	{
+		parallel_apply_reap();
+		if (pa_reaped >= seq)
+			break;
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+						 WAIT_EVENT_LOGICAL_PARALLEL_APPLY_WORKER);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Hand the transaction starting with the given BEGIN message to a worker,
+ * if possible.
+ *
+ * Returns true if it was handed out.  Otherwise, waits for all transactions
+ * handed out before to be committed and returns false; the caller must then
+ * apply the transaction itself.
+ */
+static bool
+pa_begin(StringInfo s)
+{
+	int			worker = -1;
+	int			i;
+
+	/* Start or stop workers if the setting has changed */
+	if (max_parallel_apply_workers_per_subscription != pa_requested)
+	{
+		pa_shutdown();
+		pa_requested = max_parallel_apply_workers_per_subscription;
+		if (pa_requested > 0)
+			pa_start();
+	}
+
+	if (pa_seg == NULL)
+		return false;
+
+	/*
+	 * Changes to tables being synchronized must be applied in step with the
+	 * synchronization workers, so leave that to the leader.
+	 */
+	AcceptInvalidationMessages();
+	if (!AllTablesyncsReady())
+	{
+		pa_wait_for(pa_last_seq);
+		return false;
+	}
+
+	/* Don't start anything while an exclusive transaction is running */
+	if (pa_exclusive > pa_reaped)
+		pa_wait_for(pa_exclusive);
+
+	parallel_apply_reap();
+
+	/* Forget rows changed by transactions already committed */
+	if (hash_get_num_entries(pa_keys) > PARALLEL_APPLY_MAX_KEYS)
+	{
+		HASH_SEQ_STATUS status;
+		ParallelApplyKeyEntry *entry;
+
+		hash_seq_init(&status, pa_keys);
+		while ((entry = hash_seq_search(&status)) != NULL)
+		{
+			if (entry->seq <= pa_reaped)
+				(void) hash_search(pa_keys, &entry->key, HASH_REMOVE, NULL);
+		}
+	}
+
+	/* Find an idle worker, waiting for the oldest transaction if need be */
+	for (;;)
+	{
+		for (i = 0; i < pa_shared->nworkers; i++)
+		{
+			bool		idle;
+
+			SpinLockAcquire(&pa_shared->mutex);
+			idle = pa_shared->slots[i].state == PARALLEL_APPLY_IDLE;
+			SpinLockRelease(&pa_shared->mutex);
+
+			if (idle)
+			{
+				worker = i;
+				break;
+			}
+		}
+		if (worker >= 0)
+			break;
+
+		pa_wait_for(pa_reaped + 1);
+	}
+
+	SpinLockAcquire(&pa_shared->mutex);
+	pa_shared->slots[worker].state = PARALLEL_APPLY_BUSY;
+	pa_shared->slots[worker].seq = ++pa_last_seq;
+	pa_shared->slots[worker].remote_end = InvalidXLogRecPtr;
+	pa_shared->slots[worker].local_end = InvalidXLogRecPtr;
+	SpinLockRelease(&pa_shared->mutex);
+
+	pa_current = worker;
+	pa_send(worker, &s->data[s->cursor], s->len - s->cursor);
+
+	return true;
+}
+
+/*
+ * Make the transaction being handed out wait for all transactions before
+ * it, and the transactions after it wait for it.
+ */
+static void
+pa_make_exclusive(void)
+{
+	if (pa_exclusive == pa_last_seq)
+		return;
+
+	pa_wait_for(pa_last_seq - 1);
+	pa_exclusive = pa_last_seq;
+}
+
+/*
+ * Note that the transaction being handed out changes the row with the given
+ * key, waiting for the last transaction that changed it to commit first.
+ *
+ * Returns false if the key can't be compared, because it's stored
+ * out-of-line and was not sent.
+ */
+static bool
+pa_track_key(LogicalRepRelId relid, Bitmapset *keys,
+			 LogicalRepTupleData *tup)
+{
+	ParallelApplyKey key;
+	ParallelApplyKeyEntry *entry;
+	bool		found;
+	int			i;
+
+	memset(&key, 0, sizeof(key));
+	key.relid = relid;
+	key.hash = hash_uint32(relid);
+
+	i = -1;
+	while ((i = bms_next_member(keys, i)) >= 0)
+	{
+		uint32		hash = 0;
+
+		if (!tup->changed[i])
+			return false;
+		if (tup->values[i] != NULL)
+			hash = DatumGetUInt32(hash_any((unsigned char *) tup->values[i],
+										   tup->binlen[i] >= 0 ?
+										   tup->binlen[i] :
+										   strlen(tup->values[i])));
+		key.hash = hash_combine(key.hash, hash);
+	}
+
+	entry = hash_search(pa_keys, &key, HASH_ENTER, &found);
+	if (found && entry->seq > pa_reaped && entry->seq != pa_last_seq)
+		pa_wait_for(entry->seq);
+	entry->seq = pa_last_seq;
+
+	return true;
+}
+
+/*
+ * Track the rows changed by an INSERT, UPDATE or DELETE message of the
+ * transaction being handed out.
+ */
+static void
+pa_track_change(char action, StringInfo s)
+{
+	StringInfoData msg;
+	LogicalRepRelId relid;
+	LogicalRepTupleData *oldtup;
+	LogicalRepTupleData *newtup;
+	bool		has_oldtuple = false;
+	Bitmapset  *keys;
+	bool		ok = true;
+
+	if (pa_exclusive == pa_last_seq)
+		return;
+
+	/* Parse a copy, leaving the original to be sent */
+	msg = *s;
+	msg.cursor++;
+
+	oldtup = palloc(sizeof(LogicalRepTupleData));
+	newtup = palloc(sizeof(LogicalRepTupleData));
+
+	switch (action)
+	{
+		case 'I':
+			relid = logicalrep_read_insert(&msg, newtup);
+			break;
+		case 'U':
+			relid = logicalrep_read_update(&msg, &has_oldtuple, oldtup,
+										   newtup);
+			break;
+		case 'D':
+			relid = logicalrep_read_delete(&msg, oldtup);
+			has_oldtuple = true;
+			break;
+		default:
+			elog(ERROR, "unexpected action \"%c\"", action);
+			relid = InvalidOid; /* keep compiler quiet */
+	}
+
+	keys = logicalrep_rel_parallel_keys(relid);
+	if (keys == NULL)
+		ok = false;
+	if (ok && has_oldtuple)
+		ok = pa_track_key(relid, keys, oldtup);
+	if (ok && action != 'D')
+		ok = pa_track_key(relid, keys, newtup);
+
+	if (!ok)
+		pa_make_exclusive();
+
+	pfree(oldtup);
+	pfree(newtup);
+}
+
+/*
+ * Remember a RELATION or TYPE message, to send it to workers started later.
+ */
+static void
+pa_remember_schema(char action, StringInfo s)
+{
+	ParallelApplySchemaKey key;
+	ParallelApplySchemaEntry *entry;
+	StringInfoData msg;
+	bool		found;
+
+	if (pa_schema == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(ParallelApplySchemaKey);
+		ctl.entrysize = sizeof(ParallelApplySchemaEntry);
+		ctl.hcxt = ApplyContext;
+		pa_schema = hash_create("logical replication parallel apply schema",
+								128, &ctl,
+								HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	/* Both carry the remote OID right after the message type */
+	msg = *s;
+	msg.cursor++;
+	memset(&key, 0, sizeof(key));
+	key.action = action;
+	key.id = pq_getmsgint(&msg, 4);
+
+	entry = hash_search(pa_schema, &key, HASH_ENTER, &found);
+	if (found)
+		pfree(entry->data);
+	entry->len = s->len - s->cursor;
+	entry->data = MemoryContextAlloc(ApplyContext, entry->len);
+	memcpy(entry->data, &s->data[s->cursor], entry->len);
+}
+
+/*
+ * Hand a protocol message off to a parallel apply worker, if possible.
+ *
+ * Returns true if a worker will apply it.  Otherwise the caller must apply
+ * it itself, after all transactions handed out before it, which we've
+ * waited for if necessary.
+ */
+bool
+parallel_apply_dispatch(StringInfo s)
+{
+	char		action;
+	int			i;
+
+	if (am_tablesync_worker() || s->cursor >= s->len)
+		return false;
+
+	action = s->data[s->cursor];
+
+	/* Schema information is applied by us as well as by all workers */
+	if (action == 'R' || action == 'Y')
+	{
+		pa_remember_schema(action, s);
+		if (pa_seg != NULL)
+		{
+			for (i = 0; i < pa_shared->nworkers; i++)
+				pa_send(i, &s->data[s->cursor], s->len - s->cursor);
+		}
+		return false;
+	}
+
+	if (pa_current < 0)
+	{
+		if (action == 'B')
+			return pa_begin(s);
+
+		/* Streamed transactions are applied after everything before them */
+		if (action == 'c' && pa_seg != NULL)
+			pa_wait_for(pa_last_seq);
+
+		return false;
+	}
+
+	switch (action)
+	{
+		case 'I':
+		case 'U':
+		case 'D':
+			pa_track_change(action, s);
+			break;
+
+		case 'T':
+			pa_make_exclusive();
+			break;
+
+		case 'C':
+		case 'O':
+			break;
+
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("unexpected logical replication message type \"%c\" within a transaction",
+							action)));
+	}
+
+	pa_send(pa_current, &s->data[s->cursor], s->len - s->cursor);
+
+	if (action == 'C')
+		pa_current = -1;
+
+	return true;
+}
+
+/*
+ * In a parallel apply worker, wait until all transactions before ours have
+ * been committed.
+ */
+void
+parallel_apply_wait_for_turn(void)
+{
+	for (;;)
+	{
+		bool		myturn;
+
+		SpinLockAcquire(&MyParallelApplyShared->mutex);
+		myturn = (MyParallelApplyShared->last_committed + 1 ==
+				  MyParallelApplySlot->seq);
+		SpinLockRelease(&MyParallelApplyShared->mutex);
+
+		if (myturn)
+			break;
+
+		ConditionVariableSleep(&MyParallelApplyShared->commit_cv,
+							   WAIT_EVENT_LOGICAL_PARALLEL_APPLY_COMMIT);
+	}
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * In a parallel apply worker, report that our transaction has been
+ * committed, at local_end, or that there was nothing to commit.
+ */
+void
+parallel_apply_mark_done(XLogRecPtr remote_end, XLogRecPtr local_end)
+{
+	/* Empty transactions haven't waited yet */
+	parallel_apply_wait_for_turn();
+
+	SpinLockAcquire(&MyParallelApplyShared->mutex);
+	MyParallelApplySlot->remote_end = remote_end;
+	MyParallelApplySlot->local_end = local_end;
+	MyParallelApplySlot->state = PARALLEL_APPLY_DONE;
+	MyParallelApplyShared->last_committed = MyParallelApplySlot->seq;
+	SpinLockRelease(&MyParallelApplyShared->mutex);
+
+	ConditionVariableBroadcast(&MyParallelApplyShared->commit_cv);
+	SetLatch(MyParallelApplyShared->leader_latch);
+}
+
+/* SIGHUP: set flag to reload configuration at next convenient time */
+static void
+parallel_apply_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+
+	/* Waken anything waiting on the process latch */
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * Main entry point for a parallel apply worker.
+ */
+void
+ParallelApplyWorkerMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	shm_toc    *toc;
+	ParallelApplyShared *shared;
+	char	   *queues;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	MemoryContext oldctx;
+	char		originname[NAMEDATALEN];
+	RepOriginId originid;
+	int			worker;
+
+	pqsignal(SIGHUP, parallel_apply_sighup);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	memcpy(&worker, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_APPLY_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+	shared = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_SHARED, false);
+	queues = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_QUEUES, false);
+
+	mq = (shm_mq *) (queues + worker * PARALLEL_APPLY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	MyParallelApplyShared = shared;
+	MyParallelApplySlot = &shared->slots[worker];
+
+	/* We're a logical replication worker, without a launcher slot */
+	MyLogicalRepWorker = MemoryContextAllocZero(TopMemoryContext,
+												sizeof(LogicalRepWorker));
+	MyLogicalRepWorker->dbid = shared->dbid;
+	MyLogicalRepWorker->userid = shared->userid;
+	MyLogicalRepWorker->subid = shared->subid;
+	MyLogicalRepWorker->relid = InvalidOid;
+	MyLogicalRepWorker->parallel_apply = true;
+
+	/* Run as replica session replication role. */
+	SetConfigOption("session_replication_role", "replica",
+					PGC_SUSET, PGC_S_OVERRIDE);
+
+	/* Connect to our database. */
+	BackgroundWorkerInitializeConnectionByOid(MyLogicalRepWorker->dbid,
+											  MyLogicalRepWorker->userid,
+											  0);
+
+	ApplyContext = AllocSetContextCreate(TopMemoryContext,
+										 "ApplyContext",
+										 ALLOCSET_DEFAULT_SIZES);
+	ApplyMessageContext = AllocSetContextCreate(ApplyContext,
+												"ApplyMessageContext",
+												ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * Load the subscription.  The leader exits on any change to it that
+	 * matters, and we're stopped along with it, so it stays valid.
+	 */
+	StartTransactionCommand();
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	MySubscription = GetSubscription(MyLogicalRepWorker->subid, true);
+	MemoryContextSwitchTo(oldctx);
+	if (!MySubscription)
+		proc_exit(0);
+	MySubscriptionValid = true;
+
+	SetConfigOption("synchronous_commit", MySubscription->synccommit,
+					PGC_BACKEND, PGC_S_OVERRIDE);
+
+	/* Advance the replication origin of the leader */
+	snprintf(originname, sizeof(originname), "pg_%u", MySubscription->oid);
+	originid = replorigin_by_name(originname, false);
+	replorigin_session_setup(originid, shared->leader_pid);
+	replorigin_session_origin = originid;
+	CommitTransactionCommand();
+
+	ereport(DEBUG1,
+			(errmsg("logical replication parallel apply worker %d for subscription \"%s\" has started",
+					worker, MySubscription->name)));
+
+	for (;;)
+	{
+		StringInfoData s;
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		/* We're done when the leader detaches from our queue */
+		res = shm_mq_receive(mqh, &nbytes, &data, false);
+		if (res != SHM_MQ_SUCCESS)
+			break;
+
+		MemoryContextSwitchTo(ApplyMessageContext);
+
+		s.data = data;
+		s.len = nbytes;
+		s.cursor = 0;
+		s.maxlen = -1;
+
+		apply_dispatch(&s);
+
+		MemoryContextReset(ApplyMessageContext);
+	}
+
+	proc_exit(0);
+}
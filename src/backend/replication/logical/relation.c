@@ -16,10 +16,14 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/sysattr.h"
 #include "access/table.h"
+#include "access/xact.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_index.h"
 #include "catalog/pg_subscription_rel.h"
+#include "catalog/pg_type.h"
 #include "executor/executor.h"
 #include "nodes/makefuncs.h"
 #include "replication/logicalrelation.h"
@@ -142,6 +146,7 @@ logicalrep_relmap_free_entry(LogicalRepRelMapEntry *entry)
 
 	if (entry->attrmap)
 		pfree(entry->attrmap);
+	bms_free(entry->parallel_keys);
 }
 
 /*
@@ -209,6 +214,160 @@ logicalrep_rel_att_by_name(LogicalRepRelation *remoterel, const char *attname)
 	return -1;
 }
 
+/*
+ * Can the transactions modifying this relation be applied in parallel, with
+ * conflicts between them detected by comparing the values of the replica
+ * identity key columns sent by the publisher?  If so, return the set of
+ * those remote columns, allocated in LogicalRepRelMapContext; otherwise
+ * NULL.
+ *
+ * That requires that no two rows with different keys can conflict: the
+ * relation must have no unique or exclusion constraint other than its key,
+ * and no triggers, which might touch other rows.  The local key must be the
+ * same as the remote one, and since the values are compared in text form,
+ * the key columns must be of the same type locally and remotely, and of a
+ * type for which equality implies identical output.
+ */
+static Bitmapset *
+logicalrep_rel_find_parallel_keys(LogicalRepRelMapEntry *entry,
+								  Bitmapset *idkey)
+{
+	Relation	rel = entry->localrel;
+	LogicalRepRelation *remoterel = &entry->remoterel;
+	Oid			keyidxoid;
+	Relation	keyidx;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	Bitmapset  *keys = NULL;
+	MemoryContext oldctx;
+	int			i;
+
+	if (!entry->updatable || idkey == NULL ||
+		rel->rd_rel->relkind != RELKIND_RELATION ||
+		rel->trigdesc != NULL ||
+		bms_num_members(idkey) != bms_num_members(remoterel->attkeys))
+		return NULL;
+
+	keyidxoid = RelationGetReplicaIndex(rel);
+	if (!OidIsValid(keyidxoid))
+		keyidxoid = RelationGetPrimaryKeyIndex(rel);
+	if (!OidIsValid(keyidxoid))
+		return NULL;
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Oid			indexoid = lfirst_oid(lc);
+		HeapTuple	tup;
+		Form_pg_index index;
+		bool		conflicts;
+
+		if (indexoid == keyidxoid)
+			continue;
+
+		tup = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(indexoid));
+		if (!HeapTupleIsValid(tup))
+			elog(ERROR, "cache lookup failed for index %u", indexoid);
+		index = (Form_pg_index) GETSTRUCT(tup);
+		conflicts = index->indisunique || index->indisexclusion;
+		ReleaseSysCache(tup);
+
+		if (conflicts)
+		{
+			list_free(indexoidlist);
+			return NULL;
+		}
+	}
+	list_free(indexoidlist);
+
+	keyidx = index_open(keyidxoid, AccessShareLock);
+	for (i = 0; i < keyidx->rd_index->indnkeyatts; i++)
+	{
+		AttrNumber	attnum = keyidx->rd_index->indkey.values[i];
+		Form_pg_attribute attr;
+		int			remoteattnum;
+		bool		ok;
+
+		Assert(AttributeNumberIsValid(attnum));
+		attr = TupleDescAttr(RelationGetDescr(rel),
+							 AttrNumberGetAttrOffset(attnum));
+		remoteattnum = entry->attrmap[AttrNumberGetAttrOffset(attnum)];
+
+		switch (attr->atttypid)
+		{
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+			case OIDOID:
+			case UUIDOID:
+				ok = true;
+				break;
+			case TEXTOID:
+			case VARCHAROID:
+				ok = get_collation_isdeterministic(keyidx->rd_indcollation[i]);
+				break;
+			default:
+				ok = false;
+				break;
+		}
+
+		if (!ok || remoteattnum < 0 ||
+			remoterel->atttyps[remoteattnum] != attr->atttypid)
+		{
+			bms_free(keys);
+			keys = NULL;
+			break;
+		}
+
+		oldctx = MemoryContextSwitchTo(LogicalRepRelMapContext);
+		keys = bms_add_member(keys, remoteattnum);
+		MemoryContextSwitchTo(oldctx);
+	}
+	index_close(keyidx, AccessShareLock);
+
+	if (keys != NULL && !bms_equal(keys, remoterel->attkeys))
+	{
+		bms_free(keys);
+		keys = NULL;
+	}
+
+	return keys;
+}
+
+/*
+ * Get the remote key columns by which conflicts between transactions
+ * modifying the given relation can be detected, for parallel apply, or NULL
+ * if they can't be.  The local relation is looked up if necessary, which
+ * must be done outside of a transaction.
+ */
+Bitmapset *
+logicalrep_rel_parallel_keys(LogicalRepRelId remoteid)
+{
+	LogicalRepRelMapEntry *entry;
+	MemoryContext oldctx;
+
+	if (LogicalRepRelMap == NULL)
+		logicalrep_relmap_init();
+
+	entry = hash_search(LogicalRepRelMap, (void *) &remoteid,
+						HASH_FIND, NULL);
+	if (entry == NULL)
+		elog(ERROR, "no relation map entry for remote relation ID %u",
+			 remoteid);
+
+	if (!OidIsValid(entry->localreloid))
+	{
+		oldctx = CurrentMemoryContext;
+		StartTransactionCommand();
+		entry = logicalrep_rel_open(remoteid, AccessShareLock);
+		logicalrep_rel_close(entry, AccessShareLock);
+		CommitTransactionCommand();
+		MemoryContextSwitchTo(oldctx);
+	}
+
+	return entry->parallel_keys;
+}
+
 /*
  * Open the local relation associated with the remote one.
  *
@@ -348,6 +507,9 @@ logicalrep_rel_open(LogicalRepRelId remoteid, LOCKMODE lockmode)
 			}
 		}
 
+		bms_free(entry->parallel_keys);
+		entry->parallel_keys = logicalrep_rel_find_parallel_keys(entry, idkey);
+
 		entry->localreloid = relid;
 	}
 	else
@@ -36,6 +36,15 @@
  *	  contents of individual (sub-)transactions will be read from disk in
  *	  chunks.
  *
+ *	  If the output plugin supports it, large transactions can instead be
+ *	  streamed to it before they commit: the changes decoded so far are sent
+ *	  in a block delimited by stream start/stop callbacks and then discarded,
+ *	  and once the commit (or abort) is decoded, the output plugin is told to
+ *	  commit (or discard) what it has been sent.  Only transactions that do
+ *	  not modify the catalog are streamed, because their changes don't depend
+ *	  on catalog contents that could vanish due to a concurrent abort; others
+ *	  are still spilled to disk.
+ *
  *	  This module also has to deal with reassembling toast records from the
  *	  individual chunks stored in WAL. When a new (or initial) version of a
  *	  tuple is stored in WAL it will always be preceded by the toast chunks
@@ -52,7 +61,8 @@
  *	  To limit the amount of memory used by decoded changes, we track memory
  *	  used at the reorder buffer level (i.e. total amount of memory), and for
  *	  each transaction. When the total amount of used memory exceeds the
- *	  limit, the transaction consuming the most memory is then serialized to
+ *	  limit, the largest transaction that can be streamed is streamed, and if
+ *	  there's none, the transaction consuming the most memory is serialized to
  *	  disk.
  *
  *	  Only decoded changes are evicted from memory (spilled to disk), not the
@@ -97,7 +107,7 @@
 #include "replication/logical.h"
 #include "replication/reorderbuffer.h"
 #include "replication/slot.h"
-#include "replication/snapbuild.h"	/* just for SnapBuildSnapDecRefcount */
+#include "replication/snapbuild.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
 #include "storage/sinval.h"
@@ -212,6 +222,11 @@ static ReorderBufferChange *ReorderBufferIterTXNNext(ReorderBuffer *rb, ReorderB
 static void ReorderBufferIterTXNFinish(ReorderBuffer *rb,
 									   ReorderBufferIterTXNState *state);
 static void ReorderBufferExecuteInvalidations(ReorderBuffer *rb, ReorderBufferTXN *txn);
+static void ReorderBufferProcessTXN(ReorderBuffer *rb, ReorderBufferTXN *txn,
+									XLogRecPtr commit_lsn,
+									volatile Snapshot snapshot_now,
+									volatile CommandId command_id,
+									bool streaming);
 
 /*
  * ---------------------------------------
@@ -235,6 +250,17 @@ static void ReorderBufferFreeSnap(ReorderBuffer *rb, Snapshot snap);
 static Snapshot ReorderBufferCopySnap(ReorderBuffer *rb, Snapshot orig_snap,
 									  ReorderBufferTXN *txn, CommandId cid);
 
+/*
+ * ---------------------------------------
+ * Streaming support functions
+ * ---------------------------------------
+ */
+static inline bool ReorderBufferCanStream(ReorderBuffer *rb);
+static bool ReorderBufferCanStartStreaming(ReorderBuffer *rb);
+static void ReorderBufferStreamTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
+static void ReorderBufferStreamCommit(ReorderBuffer *rb, ReorderBufferTXN *txn);
+static void ReorderBufferTruncateTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
+
 /* ---------------------------------------
  * toast reassembly support
  * ---------------------------------------
@@ -619,11 +645,15 @@ ReorderBufferTXNByXid(ReorderBuffer *rb, TransactionId xid, bool create,
 }
 
 /*
- * Queue a change into a transaction so it can be replayed upon commit.
+ * Queue a change into a transaction so it can be replayed upon commit, or
+ * streamed before that.
+ *
+ * toast_insert is true for the insertion of a toast chunk, which is only
+ * complete once the main table change that it belongs to has been queued.
  */
 void
 ReorderBufferQueueChange(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn,
-						 ReorderBufferChange *change)
+						 ReorderBufferChange *change, bool toast_insert)
 {
 	ReorderBufferTXN *txn;
 
@@ -632,6 +662,19 @@ ReorderBufferQueueChange(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn,
 	change->lsn = lsn;
 	change->txn = txn;
 
+	/*
+	 * Keep track of whether the transaction ends in the middle of a toasted
+	 * tuple or a speculative insertion, since it can't be streamed then.
+	 */
+	if (toast_insert ||
+		change->action == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT)
+		txn->has_partial_change = true;
+	else if (change->action == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM ||
+			 ((change->action == REORDER_BUFFER_CHANGE_INSERT ||
+			   change->action == REORDER_BUFFER_CHANGE_UPDATE) &&
+			  change->data.tp.clear_toast_afterwards))
+		txn->has_partial_change = false;
+
 	Assert(InvalidXLogRecPtr != lsn);
 	dlist_push_tail(&txn->changes, &change->node);
 	txn->nentries++;
@@ -669,7 +712,7 @@ ReorderBufferQueueMessage(ReorderBuffer *rb, TransactionId xid,
 		change->data.msg.message = palloc(message_size);
 		memcpy(change->data.msg.message, message, message_size);
 
-		ReorderBufferQueueChange(rb, xid, lsn, change);
+		ReorderBufferQueueChange(rb, xid, lsn, change, false);
 
 		MemoryContextSwitchTo(oldcontext);
 	}
@@ -1300,6 +1343,14 @@ ReorderBufferCleanupTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		dlist_delete(&txn->base_snapshot_node);
 	}
 
+	/* and the snapshot kept from streaming, if any */
+	if (txn->snapshot_now != NULL)
+	{
+		Assert(txn->snapshot_now->copied);
+		ReorderBufferFreeSnap(rb, txn->snapshot_now);
+		txn->snapshot_now = NULL;
+	}
+
 	/*
 	 * Remove TXN from its containing list.
 	 *
@@ -1476,57 +1527,25 @@ ReorderBufferFreeSnap(ReorderBuffer *rb, Snapshot snap)
 }
 
 /*
- * Perform the replay of a transaction and its non-aborted subtransactions.
- *
- * Subtransactions previously have to be processed by
- * ReorderBufferCommitChild(), even if previously assigned to the toplevel
- * transaction with ReorderBufferAssignChild.
+ * Replay the changes of a transaction and its subtransactions, starting from
+ * the given snapshot and command id.  Helper for ReorderBufferCommit() and
+ * ReorderBufferStreamTXN().
  *
- * We currently can only decode a transaction's contents when its commit
- * record is read because that's the only place where we know about cache
- * invalidations. Thus, once a toplevel commit is read, we iterate over the top
- * and subtransactions (using a k-way merge) and replay the changes in lsn
- * order.
+ * Normally, the whole transaction is passed to the output plugin between the
+ * begin and commit callbacks, and cleaned up afterwards.  In streaming mode,
+ * the changes queued so far are passed between the stream start and stop
+ * callbacks instead, and then discarded, keeping the transaction around.
  */
-void
-ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
-					XLogRecPtr commit_lsn, XLogRecPtr end_lsn,
-					TimestampTz commit_time,
-					RepOriginId origin_id, XLogRecPtr origin_lsn)
+static void
+ReorderBufferProcessTXN(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						XLogRecPtr commit_lsn,
+						volatile Snapshot snapshot_now,
+						volatile CommandId command_id,
+						bool streaming)
 {
-	ReorderBufferTXN *txn;
-	volatile Snapshot snapshot_now;
-	volatile CommandId command_id = FirstCommandId;
 	bool		using_subtxn;
 	ReorderBufferIterTXNState *volatile iterstate = NULL;
-
-	txn = ReorderBufferTXNByXid(rb, xid, false, NULL, InvalidXLogRecPtr,
-								false);
-
-	/* unknown transaction, nothing to replay */
-	if (txn == NULL)
-		return;
-
-	txn->final_lsn = commit_lsn;
-	txn->end_lsn = end_lsn;
-	txn->commit_time = commit_time;
-	txn->origin_id = origin_id;
-	txn->origin_lsn = origin_lsn;
-
-	/*
-	 * If this transaction has no snapshot, it didn't make any changes to the
-	 * database, so there's nothing to decode.  Note that
-	 * ReorderBufferCommitChild will have transferred any snapshots from
-	 * subtransactions if there were any.
-	 */
-	if (txn->base_snapshot == NULL)
-	{
-		Assert(txn->ninvalidations == 0);
-		ReorderBufferCleanupTXN(rb, txn);
-		return;
-	}
-
-	snapshot_now = txn->base_snapshot;
+	volatile XLogRecPtr prev_lsn = InvalidXLogRecPtr;
 
 	/* build data to be able to lookup the CommandIds of catalog tuples */
 	ReorderBufferBuildTupleCidHash(rb, txn);
@@ -1556,7 +1575,8 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		else
 			StartTransactionCommand();
 
-		rb->begin(rb, txn);
+		if (!streaming)
+			rb->begin(rb, txn);
 
 		iterstate = ReorderBufferIterTXNInit(rb, txn);
 		while ((change = ReorderBufferIterTXNNext(rb, iterstate)) != NULL)
@@ -1564,6 +1584,17 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 			Relation	relation = NULL;
 			Oid			reloid;
 
+			/*
+			 * When streaming, open the block of changes with the first one,
+			 * and remember the LSN of the last one to close it with.
+			 */
+			if (streaming)
+			{
+				if (prev_lsn == InvalidXLogRecPtr)
+					rb->stream_start(rb, txn, change->lsn);
+				prev_lsn = change->lsn;
+			}
+
 			switch (change->action)
 			{
 				case REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM:
@@ -1640,7 +1671,10 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					if (!IsToastRelation(relation))
 					{
 						ReorderBufferToastReplace(rb, txn, relation, change);
-						rb->apply_change(rb, txn, relation, change);
+						if (streaming)
+							rb->stream_change(rb, txn, relation, change);
+						else
+							rb->apply_change(rb, txn, relation, change);
 
 						/*
 						 * Only clear reassembled toast chunks if we're sure
@@ -1738,7 +1772,12 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 							relations[nrelations++] = relation;
 						}
 
-						rb->apply_truncate(rb, txn, nrelations, relations, change);
+						if (streaming)
+							rb->stream_truncate(rb, txn, nrelations, relations,
+												change);
+						else
+							rb->apply_truncate(rb, txn, nrelations, relations,
+											   change);
 
 						for (i = 0; i < nrelations; i++)
 							RelationClose(relations[i]);
@@ -1747,10 +1786,16 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					}
 
 				case REORDER_BUFFER_CHANGE_MESSAGE:
-					rb->message(rb, txn, change->lsn, true,
-								change->data.msg.prefix,
-								change->data.msg.message_size,
-								change->data.msg.message);
+					if (streaming)
+						rb->stream_message(rb, txn, change->lsn, true,
+										   change->data.msg.prefix,
+										   change->data.msg.message_size,
+										   change->data.msg.message);
+					else
+						rb->message(rb, txn, change->lsn, true,
+									change->data.msg.prefix,
+									change->data.msg.message_size,
+									change->data.msg.message);
 					break;
 
 				case REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT:
@@ -1836,8 +1881,14 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		ReorderBufferIterTXNFinish(rb, iterstate);
 		iterstate = NULL;
 
-		/* call commit callback */
-		rb->commit(rb, txn, commit_lsn);
+		/* close the block of streamed changes, or call commit callback */
+		if (streaming)
+		{
+			if (prev_lsn != InvalidXLogRecPtr)
+				rb->stream_stop(rb, txn, prev_lsn);
+		}
+		else
+			rb->commit(rb, txn, commit_lsn);
 
 		/* this is just a sanity check against bad output plugin behaviour */
 		if (GetCurrentTransactionIdIfAny() != InvalidTransactionId)
@@ -1861,11 +1912,30 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		if (using_subtxn)
 			RollbackAndReleaseCurrentSubTransaction();
 
-		if (snapshot_now->copied)
-			ReorderBufferFreeSnap(rb, snapshot_now);
+		if (streaming)
+		{
+			/*
+			 * Keep the transaction, along with the snapshot and command id
+			 * to continue from in the next block, but discard the changes
+			 * we just streamed.  The snapshot has to be copied, since the
+			 * change it might come from is about to go away.
+			 */
+			if (!snapshot_now->copied)
+				snapshot_now = ReorderBufferCopySnap(rb, snapshot_now,
+													 txn, command_id);
+			txn->snapshot_now = snapshot_now;
+			txn->command_id = command_id;
 
-		/* remove potential on-disk data, and deallocate */
-		ReorderBufferCleanupTXN(rb, txn);
+			ReorderBufferTruncateTXN(rb, txn);
+		}
+		else
+		{
+			if (snapshot_now->copied)
+				ReorderBufferFreeSnap(rb, snapshot_now);
+
+			/* remove potential on-disk data, and deallocate */
+			ReorderBufferCleanupTXN(rb, txn);
+		}
 	}
 	PG_CATCH();
 	{
@@ -1898,6 +1968,67 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 	PG_END_TRY();
 }
 
+/*
+ * Perform the replay of a transaction and its non-aborted subtransactions.
+ *
+ * Subtransactions previously have to be processed by
+ * ReorderBufferCommitChild(), even if previously assigned to the toplevel
+ * transaction with ReorderBufferAssignChild.
+ *
+ * We currently can only decode a transaction's contents when its commit
+ * record is read because that's the only place where we know about cache
+ * invalidations. Thus, once a toplevel commit is read, we iterate over the top
+ * and subtransactions (using a k-way merge) and replay the changes in lsn
+ * order.
+ */
+void
+ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
+					XLogRecPtr commit_lsn, XLogRecPtr end_lsn,
+					TimestampTz commit_time,
+					RepOriginId origin_id, XLogRecPtr origin_lsn)
+{
+	ReorderBufferTXN *txn;
+
+	txn = ReorderBufferTXNByXid(rb, xid, false, NULL, InvalidXLogRecPtr,
+								false);
+
+	/* unknown transaction, nothing to replay */
+	if (txn == NULL)
+		return;
+
+	txn->final_lsn = commit_lsn;
+	txn->end_lsn = end_lsn;
+	txn->commit_time = commit_time;
+	txn->origin_id = origin_id;
+	txn->origin_lsn = origin_lsn;
+
+	/*
+	 * If parts of the transaction have been streamed already, stream the
+	 * rest of it and then commit it.
+	 */
+	if (txn->streamed)
+	{
+		ReorderBufferStreamCommit(rb, txn);
+		return;
+	}
+
+	/*
+	 * If this transaction has no snapshot, it didn't make any changes to the
+	 * database, so there's nothing to decode.  Note that
+	 * ReorderBufferCommitChild will have transferred any snapshots from
+	 * subtransactions if there were any.
+	 */
+	if (txn->base_snapshot == NULL)
+	{
+		Assert(txn->ninvalidations == 0);
+		ReorderBufferCleanupTXN(rb, txn);
+		return;
+	}
+
+	ReorderBufferProcessTXN(rb, txn, commit_lsn, txn->base_snapshot,
+							FirstCommandId, false);
+}
+
 /*
  * Abort a transaction that possibly has previous changes. Needs to be first
  * called for subtransactions and then for the toplevel xid.
@@ -1925,6 +2056,10 @@ ReorderBufferAbort(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn)
 	/* cosmetic... */
 	txn->final_lsn = lsn;
 
+	/* tell the output plugin to discard what it got streamed, if anything */
+	if (txn->streamed)
+		rb->stream_abort(rb, txn, lsn);
+
 	/* remove potential on-disk data, and deallocate */
 	ReorderBufferCleanupTXN(rb, txn);
 }
@@ -1957,22 +2092,18 @@ ReorderBufferAbortOld(ReorderBuffer *rb, TransactionId oldestRunningXid)
 		if (TransactionIdPrecedes(txn->xid, oldestRunningXid))
 		{
 			/*
-			 * We set final_lsn on a transaction when we decode its commit or
-			 * abort record, but we never see those records for crashed
-			 * transactions.  To ensure cleanup of these transactions, set
-			 * final_lsn to that of their last change; this causes
-			 * ReorderBufferRestoreCleanup to do the right thing.
+			 * We never see commit or abort records for crashed transactions,
+			 * but ReorderBufferSerializeTXN keeps final_lsn pointing at the
+			 * last change spilled to disk, so ReorderBufferRestoreCleanup
+			 * does the right thing for them.
 			 */
-			if (txn->serialized && txn->final_lsn == 0)
-			{
-				ReorderBufferChange *last =
-				dlist_tail_element(ReorderBufferChange, node, &txn->changes);
-
-				txn->final_lsn = last->lsn;
-			}
+			Assert(!txn->serialized || txn->final_lsn != InvalidXLogRecPtr);
 
 			elog(DEBUG2, "aborting old transaction %u", txn->xid);
 
+			if (txn->streamed)
+				rb->stream_abort(rb, txn, InvalidXLogRecPtr);
+
 			/* remove potential on-disk data, and deallocate this tx */
 			ReorderBufferCleanupTXN(rb, txn);
 		}
@@ -2020,6 +2151,10 @@ ReorderBufferForget(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn)
 	else
 		Assert(txn->ninvalidations == 0);
 
+	/* the output plugin may have seen some of it streamed already */
+	if (txn->streamed)
+		rb->stream_abort(rb, txn, lsn);
+
 	/* remove potential on-disk data, and deallocate */
 	ReorderBufferCleanupTXN(rb, txn);
 }
@@ -2088,7 +2223,7 @@ ReorderBufferAddSnapshot(ReorderBuffer *rb, TransactionId xid,
 	change->data.snapshot = snap;
 	change->action = REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT;
 
-	ReorderBufferQueueChange(rb, xid, lsn, change);
+	ReorderBufferQueueChange(rb, xid, lsn, change, false);
 }
 
 /*
@@ -2137,7 +2272,7 @@ ReorderBufferAddNewCommandId(ReorderBuffer *rb, TransactionId xid,
 	change->data.command_id = cid;
 	change->action = REORDER_BUFFER_CHANGE_INTERNAL_COMMAND_ID;
 
-	ReorderBufferQueueChange(rb, xid, lsn, change);
+	ReorderBufferQueueChange(rb, xid, lsn, change, false);
 }
 
 /*
@@ -2362,12 +2497,68 @@ ReorderBufferLargestTXN(ReorderBuffer *rb)
 	return largest;
 }
 
+/*
+ * Find the largest toplevel transaction that can be streamed, counting the
+ * changes of its subtransactions too.  Returns NULL if there's none.
+ *
+ * A transaction can be streamed only if it doesn't modify the catalog, as
+ * its changes are decoded using catalog contents that a concurrent abort
+ * could make disappear under us otherwise, and only if its last change is
+ * complete, i.e. not a toast chunk or a speculative insertion waiting for
+ * the rest of the change.
+ */
+static ReorderBufferTXN *
+ReorderBufferLargestStreamableTXN(ReorderBuffer *rb)
+{
+	dlist_iter	iter;
+	ReorderBufferTXN *largest = NULL;
+	Size		largest_size = 0;
+
+	dlist_foreach(iter, &rb->toplevel_by_lsn)
+	{
+		ReorderBufferTXN *txn;
+		dlist_iter	subtxn_i;
+		Size		size;
+		bool		streamable;
+
+		txn = dlist_container(ReorderBufferTXN, node, iter.cur);
+
+		if (txn->base_snapshot == NULL || txn->has_catalog_changes ||
+			txn->has_partial_change)
+			continue;
+
+		size = txn->size;
+		streamable = true;
+		dlist_foreach(subtxn_i, &txn->subtxns)
+		{
+			ReorderBufferTXN *subtxn;
+
+			subtxn = dlist_container(ReorderBufferTXN, node, subtxn_i.cur);
+			if (subtxn->has_catalog_changes || subtxn->has_partial_change)
+			{
+				streamable = false;
+				break;
+			}
+			size += subtxn->size;
+		}
+
+		if (streamable && size > largest_size)
+		{
+			largest = txn;
+			largest_size = size;
+		}
+	}
+
+	return largest;
+}
+
 /*
  * Check whether the logical_decoding_work_mem limit was reached, and if yes
- * pick the transaction to evict and spill the changes to disk.
+ * pick the transaction to evict: stream it to the output plugin if possible,
+ * or otherwise spill its changes to disk.
  *
- * XXX At this point we select just a single (largest) transaction, but
- * we might also adapt a more elaborate eviction strategy - for example
+ * XXX At this point we select just a single (largest) transaction at a time,
+ * but we might also adapt a more elaborate eviction strategy - for example
  * evicting enough transactions to free certain fraction (e.g. 50%) of
  * the memory limit.
  */
@@ -2376,36 +2567,229 @@ ReorderBufferCheckMemoryLimit(ReorderBuffer *rb)
 {
 	ReorderBufferTXN *txn;
 
-	/* bail out if we haven't exceeded the memory limit */
-	if (rb->size < logical_decoding_work_mem * 1024L)
-		return;
-
 	/*
-	 * Pick the largest transaction (or subtransaction) and evict it from
-	 * memory by serializing it to disk.
+	 * Evict transactions until we're below the memory limit.  Streaming the
+	 * largest streamable transaction doesn't necessarily get us there in one
+	 * go, as it need not be the largest transaction overall.
 	 */
-	txn = ReorderBufferLargestTXN(rb);
+	while (rb->size >= logical_decoding_work_mem * 1024L)
+	{
+		if (ReorderBufferCanStream(rb) &&
+			ReorderBufferCanStartStreaming(rb) &&
+			(txn = ReorderBufferLargestStreamableTXN(rb)) != NULL)
+		{
+			/*
+			 * Stream the transaction (and its subtransactions), which frees
+			 * their changes.
+			 */
+			ReorderBufferStreamTXN(rb, txn);
+
+			Assert(txn->size == 0);
+			Assert(txn->nentries_mem == 0);
+		}
+		else
+		{
+			/*
+			 * Pick the largest transaction (or subtransaction) and evict it
+			 * from memory by serializing it to disk.
+			 */
+			txn = ReorderBufferLargestTXN(rb);
 
-	ReorderBufferSerializeTXN(rb, txn);
+			ReorderBufferSerializeTXN(rb, txn);
+
+			/*
+			 * After eviction, the transaction should have no entries in
+			 * memory, and should use 0 bytes for changes.
+			 */
+			Assert(txn->size == 0);
+			Assert(txn->nentries_mem == 0);
+
+			/*
+			 * And furthermore, evicting the transaction should get us below
+			 * the memory limit again - it is not possible that we're still
+			 * exceeding the memory limit after evicting the transaction.
+			 *
+			 * This follows from the simple fact that the selected transaction
+			 * is at least as large as the most recent change (which caused us
+			 * to go over the memory limit). So by evicting it we're
+			 * definitely back below the memory limit.
+			 */
+			Assert(rb->size < logical_decoding_work_mem * 1024L);
+		}
+	}
+}
+
+/*
+ * Can the output plugin accept streamed transactions at all?
+ */
+static inline bool
+ReorderBufferCanStream(ReorderBuffer *rb)
+{
+	LogicalDecodingContext *ctx = rb->private_data;
+
+	return ctx->streaming && !ctx->fast_forward;
+}
+
+/*
+ * Can we stream transactions right now?  Not before the snapshot builder has
+ * reached a consistent state, nor while still skipping over records the
+ * client has confirmed already.
+ */
+static bool
+ReorderBufferCanStartStreaming(ReorderBuffer *rb)
+{
+	LogicalDecodingContext *ctx = rb->private_data;
+	SnapBuild  *builder = ctx->snapshot_builder;
+
+	if (SnapBuildCurrentState(builder) < SNAPBUILD_CONSISTENT)
+		return false;
+
+	return !SnapBuildXactNeedsSkip(builder, ctx->reader->EndRecPtr);
+}
+
+/*
+ * Does the transaction, or any of its subtransactions, have changes that
+ * haven't been streamed yet?
+ */
+static bool
+ReorderBufferTXNHasChanges(ReorderBufferTXN *txn)
+{
+	dlist_iter	iter;
+
+	if (txn->nentries > 0)
+		return true;
+
+	dlist_foreach(iter, &txn->subtxns)
+	{
+		ReorderBufferTXN *subtxn;
+
+		subtxn = dlist_container(ReorderBufferTXN, node, iter.cur);
+		if (subtxn->nentries > 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Stream the changes of a toplevel transaction queued so far, and those of
+ * its subtransactions, to the output plugin, and discard them.
+ */
+static void
+ReorderBufferStreamTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
+{
+	Snapshot	snapshot_now;
+	CommandId	command_id;
+
+	Assert(!txn->is_known_as_subxact);
+
+	/* nothing to decode without a snapshot, nor without changes */
+	if (txn->base_snapshot == NULL || !ReorderBufferTXNHasChanges(txn))
+		return;
+
+	if (!txn->streamed)
+	{
+		/* the first block starts from the base snapshot */
+		snapshot_now = txn->base_snapshot;
+		command_id = FirstCommandId;
+	}
+	else
+	{
+		/*
+		 * Continue from where the previous block ended.  Copy the snapshot
+		 * again, so that it covers subtransactions started since.
+		 */
+		Assert(txn->snapshot_now != NULL);
+
+		command_id = txn->command_id;
+		snapshot_now = ReorderBufferCopySnap(rb, txn->snapshot_now,
+											 txn, command_id);
+		ReorderBufferFreeSnap(rb, txn->snapshot_now);
+		txn->snapshot_now = NULL;
+	}
+
+	ReorderBufferProcessTXN(rb, txn, InvalidXLogRecPtr, snapshot_now,
+							command_id, true);
+}
+
+/*
+ * Stream the rest of a transaction that has been streamed in part already,
+ * once its commit has been decoded, and commit it.
+ */
+static void
+ReorderBufferStreamCommit(ReorderBuffer *rb, ReorderBufferTXN *txn)
+{
+	ReorderBufferStreamTXN(rb, txn);
+
+	rb->stream_commit(rb, txn, txn->final_lsn);
 
 	/*
-	 * After eviction, the transaction should have no entries in memory, and
-	 * should use 0 bytes for changes.
+	 * The invalidations are executed after each streamed block, but there
+	 * may have been no changes left to stream at all.
 	 */
+	if (txn->ninvalidations > 0)
+		ReorderBufferImmediateInvalidation(rb, txn->ninvalidations,
+										   txn->invalidations);
+
+	ReorderBufferCleanupTXN(rb, txn);
+}
+
+/*
+ * Discard the changes of a transaction and its subtransactions, after they
+ * have been streamed, but keep the transactions themselves.
+ */
+static void
+ReorderBufferTruncateTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
+{
+	dlist_mutable_iter iter;
+
+	dlist_foreach_modify(iter, &txn->subtxns)
+	{
+		ReorderBufferTXN *subtxn;
+
+		subtxn = dlist_container(ReorderBufferTXN, node, iter.cur);
+		Assert(subtxn->is_known_as_subxact);
+		Assert(subtxn->nsubtxns == 0);
+
+		ReorderBufferTruncateTXN(rb, subtxn);
+	}
+
+	dlist_foreach_modify(iter, &txn->changes)
+	{
+		ReorderBufferChange *change;
+
+		change = dlist_container(ReorderBufferChange, node, iter.cur);
+
+		/* Check we're not mixing changes from different transactions. */
+		Assert(change->txn == txn);
+
+		dlist_delete(&change->node);
+		ReorderBufferReturnChange(rb, change);
+	}
+
+	/* there can't be any reassembled toast chunks left over */
+	ReorderBufferToastReset(rb, txn);
+
 	Assert(txn->size == 0);
-	Assert(txn->nentries_mem == 0);
 
-	/*
-	 * And furthermore, evicting the transaction should get us below the
-	 * memory limit again - it is not possible that we're still exceeding the
-	 * memory limit after evicting the transaction.
-	 *
-	 * This follows from the simple fact that the selected transaction is at
-	 * least as large as the most recent change (which caused us to go over
-	 * the memory limit). So by evicting it we're definitely back below the
-	 * memory limit.
-	 */
-	Assert(rb->size < logical_decoding_work_mem * 1024L);
+	txn->nentries = 0;
+	txn->nentries_mem = 0;
+
+	/* remove the changes spilled to disk, they've been streamed too */
+	if (txn->serialized)
+	{
+		ReorderBufferRestoreCleanup(rb, txn);
+		txn->serialized = false;
+	}
+
+	/* the hash of catalog tuple cids is rebuilt for the next block */
+	if (txn->tuplecid_hash != NULL)
+	{
+		hash_destroy(txn->tuplecid_hash);
+		txn->tuplecid_hash = NULL;
+	}
+
+	txn->streamed = true;
 }
 
 /*
@@ -2472,6 +2856,13 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		}
 
 		ReorderBufferSerializeChange(rb, txn, fd, change);
+
+		/*
+		 * Remember the last LSN spilled, so that changes of a transaction
+		 * that's still in progress can be restored, and the files removed.
+		 */
+		txn->final_lsn = change->lsn;
+
 		dlist_delete(&change->node);
 		ReorderBufferReturnChange(rb, change);
 
@@ -104,6 +104,7 @@
 #include "utils/snapmgr.h"
 
 static bool table_states_valid = false;
+static List *table_states = NIL;
 
 StringInfo	copybuf = NULL;
 
@@ -258,6 +259,47 @@ invalidate_syncing_table_states(Datum arg, int cacheid, uint32 hashvalue)
 	table_states_valid = false;
 }
 
+/*
+ * Rebuild the list of tables that are not yet READY, if it was invalidated.
+ *
+ * Returns true if a transaction was started to do so, which the caller must
+ * commit.
+ */
+static bool
+fetch_table_states(void)
+{
+	MemoryContext oldctx;
+	List	   *rstates;
+	ListCell   *lc;
+	SubscriptionRelState *rstate;
+
+	if (table_states_valid)
+		return false;
+
+	/* Clean the old list. */
+	list_free_deep(table_states);
+	table_states = NIL;
+
+	StartTransactionCommand();
+
+	/* Fetch all non-ready tables. */
+	rstates = GetSubscriptionNotReadyRelations(MySubscription->oid);
+
+	/* Allocate the tracking info in a permanent memory context. */
+	oldctx = MemoryContextSwitchTo(CacheMemoryContext);
+	foreach(lc, rstates)
+	{
+		rstate = palloc(sizeof(SubscriptionRelState));
+		memcpy(rstate, lfirst(lc), sizeof(SubscriptionRelState));
+		table_states = lappend(table_states, rstate);
+	}
+	MemoryContextSwitchTo(oldctx);
+
+	table_states_valid = true;
+
+	return true;
+}
+
 /*
  * Handle table synchronization cooperation from the synchronization
  * worker.
@@ -324,43 +366,14 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 		Oid			relid;
 		TimestampTz last_start_time;
 	};
-	static List *table_states = NIL;
 	static HTAB *last_start_times = NULL;
 	ListCell   *lc;
-	bool		started_tx = false;
+	bool		started_tx;
 
 	Assert(!IsTransactionState());
 
 	/* We need up-to-date sync state info for subscription tables here. */
-	if (!table_states_valid)
-	{
-		MemoryContext oldctx;
-		List	   *rstates;
-		ListCell   *lc;
-		SubscriptionRelState *rstate;
-
-		/* Clean the old list. */
-		list_free_deep(table_states);
-		table_states = NIL;
-
-		StartTransactionCommand();
-		started_tx = true;
-
-		/* Fetch all non-ready tables. */
-		rstates = GetSubscriptionNotReadyRelations(MySubscription->oid);
-
-		/* Allocate the tracking info in a permanent memory context. */
-		oldctx = MemoryContextSwitchTo(CacheMemoryContext);
-		foreach(lc, rstates)
-		{
-			rstate = palloc(sizeof(SubscriptionRelState));
-			memcpy(rstate, lfirst(lc), sizeof(SubscriptionRelState));
-			table_states = lappend(table_states, rstate);
-		}
-		MemoryContextSwitchTo(oldctx);
-
-		table_states_valid = true;
-	}
+	started_tx = fetch_table_states();
 
 	/*
 	 * Prepare a hash table for tracking last start times of workers, to avoid
@@ -522,6 +535,28 @@ process_syncing_tables_for_apply(XLogRecPtr current_lsn)
 	}
 }
 
+/*
+ * Are all tables of the subscription in READY state?
+ *
+ * Called by the apply worker outside of a transaction.
+ */
+bool
+AllTablesyncsReady(void)
+{
+	bool		started_tx;
+
+	Assert(!IsTransactionState());
+
+	started_tx = fetch_table_states();
+	if (started_tx)
+	{
+		CommitTransactionCommand();
+		pgstat_report_stat(false);
+	}
+
+	return table_states == NIL;
+}
+
 /*
  * Process possible state change(s) of tables that are being synchronized.
  */
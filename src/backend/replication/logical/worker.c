@@ -58,6 +58,7 @@
 #include "replication/walreceiver.h"
 #include "replication/worker_internal.h"
 #include "rewrite/rewriteHandler.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
@@ -94,7 +95,7 @@ typedef struct SlotErrCallbackArg
 	int			remote_attnum;
 } SlotErrCallbackArg;
 
-static MemoryContext ApplyMessageContext = NULL;
+MemoryContext ApplyMessageContext = NULL;
 MemoryContext ApplyContext = NULL;
 
 WalReceiverConn *wrconn = NULL;
@@ -105,9 +106,28 @@ bool		MySubscriptionValid = false;
 bool		in_remote_transaction = false;
 static XLogRecPtr remote_final_lsn = InvalidXLogRecPtr;
 
-static void send_feedback(XLogRecPtr recvpos, bool force, bool requestReply);
+/*
+ * The changes of a transaction streamed before its commit are spooled to a
+ * temporary file, and applied once its commit arrives.  Changes of
+ * subtransactions that abort in the meantime are skipped then.
+ */
+typedef struct StreamXidEntry
+{
+	TransactionId xid;			/* toplevel transaction (hash key) */
+	BufFile    *file;			/* spooled changes */
+	TransactionId *aborted_subxids; /* subtransactions to skip */
+	int			naborted_subxids;
+	int			maxaborted_subxids;
+} StreamXidEntry;
 
-static void store_flush_position(XLogRecPtr remote_lsn);
+static MemoryContext LogicalStreamingContext = NULL;
+static HTAB *stream_xids = NULL;
+
+/* Are we inside a block of streamed changes, and of which transaction? */
+static bool in_streamed_transaction = false;
+static StreamXidEntry *stream_entry = NULL;
+
+static void send_feedback(XLogRecPtr recvpos, bool force, bool requestReply);
 
 static void maybe_reread_subscription(void);
 
@@ -296,13 +316,87 @@ slot_store_error_callback(void *arg)
 }
 
 /*
- * Store data in C string form into slot.
+ * Convert a column value received from the publisher into a Datum of the
+ * local column's type.
+ *
+ * Values in text format go through the input function of the local type.
+ * Values in binary format are received by the receive function of the local
+ * type if it is the same as the remote type.  Otherwise they are received
+ * with the remote type, which the publisher only sends in binary format if
+ * it is a built-in type, and converted to the local type through text.
+ */
+static Datum
+slot_input_value(Form_pg_attribute att, LogicalRepRelMapEntry *rel,
+				 LogicalRepTupleData *tupleData, int remoteattnum)
+{
+	char	   *value = tupleData->values[remoteattnum];
+	Oid			remotetypid = rel->remoterel.atttyps[remoteattnum];
+	Oid			typinput;
+	Oid			typioparam;
+	Oid			typreceive;
+	Oid			typoutput;
+	bool		typisvarlena;
+	StringInfoData buf;
+	Datum		result;
+
+	if (tupleData->binlen[remoteattnum] < 0)
+	{
+		getTypeInputInfo(att->atttypid, &typinput, &typioparam);
+		return OidInputFunctionCall(typinput, value, typioparam,
+									att->atttypmod);
+	}
+
+	if (!get_typisdefined(remotetypid))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("data type %u received in binary format does not exist",
+						remotetypid),
+				 errhint("Disable the binary option of the subscription.")));
+
+	/* The value is followed by a terminating zero byte, like a StringInfo */
+	buf.data = value;
+	buf.len = tupleData->binlen[remoteattnum];
+	buf.maxlen = buf.len + 1;
+	buf.cursor = 0;
+
+	if (remotetypid == att->atttypid)
+	{
+		getTypeBinaryInputInfo(att->atttypid, &typreceive, &typioparam);
+		result = OidReceiveFunctionCall(typreceive, &buf, typioparam,
+										att->atttypmod);
+	}
+	else
+	{
+		getTypeBinaryInputInfo(remotetypid, &typreceive, &typioparam);
+		result = OidReceiveFunctionCall(typreceive, &buf, typioparam, -1);
+	}
+
+	if (buf.cursor != buf.len)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("incorrect binary data format in logical replication column %d",
+						remoteattnum + 1)));
+
+	if (remotetypid != att->atttypid)
+	{
+		getTypeOutputInfo(remotetypid, &typoutput, &typisvarlena);
+		value = OidOutputFunctionCall(typoutput, result);
+		getTypeInputInfo(att->atttypid, &typinput, &typioparam);
+		result = OidInputFunctionCall(typinput, value, typioparam,
+									  att->atttypmod);
+	}
+
+	return result;
+}
+
+/*
+ * Store data received from the publisher into slot.
  * This is similar to BuildTupleFromCStrings but TupleTableSlot fits our
  * use better.
  */
 static void
-slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
-					char **values)
+slot_store_data(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
+				LogicalRepTupleData *tupleData)
 {
 	int			natts = slot->tts_tupleDescriptor->natts;
 	int			i;
@@ -327,18 +421,13 @@ slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 		int			remoteattnum = rel->attrmap[i];
 
 		if (!att->attisdropped && remoteattnum >= 0 &&
-			values[remoteattnum] != NULL)
+			tupleData->values[remoteattnum] != NULL)
 		{
-			Oid			typinput;
-			Oid			typioparam;
-
 			errarg.local_attnum = i;
 			errarg.remote_attnum = remoteattnum;
 
-			getTypeInputInfo(att->atttypid, &typinput, &typioparam);
-			slot->tts_values[i] =
-				OidInputFunctionCall(typinput, values[remoteattnum],
-									 typioparam, att->atttypmod);
+			slot->tts_values[i] = slot_input_value(att, rel, tupleData,
+												   remoteattnum);
 			slot->tts_isnull[i] = false;
 
 			errarg.local_attnum = -1;
@@ -363,20 +452,19 @@ slot_store_cstrings(TupleTableSlot *slot, LogicalRepRelMapEntry *rel,
 }
 
 /*
- * Replace selected columns with user data provided as C strings.
+ * Replace selected columns with data received from the publisher.
  * This is somewhat similar to heap_modify_tuple but also calls the type
  * input functions on the user data.
  * "slot" is filled with a copy of the tuple in "srcslot", with
- * columns selected by the "replaces" array replaced with data values
- * from "values".
+ * columns marked as changed in "tupleData" replaced with its values.
  * Caution: unreplaced pass-by-ref columns in "slot" will point into the
  * storage for "srcslot".  This is OK for current usage, but someday we may
  * need to materialize "slot" at the end to make it independent of "srcslot".
  */
 static void
-slot_modify_cstrings(TupleTableSlot *slot, TupleTableSlot *srcslot,
-					 LogicalRepRelMapEntry *rel,
-					 char **values, bool *replaces)
+slot_modify_data(TupleTableSlot *slot, TupleTableSlot *srcslot,
+				 LogicalRepRelMapEntry *rel,
+				 LogicalRepTupleData *tupleData)
 {
 	int			natts = slot->tts_tupleDescriptor->natts;
 	int			i;
@@ -413,21 +501,16 @@ slot_modify_cstrings(TupleTableSlot *slot, TupleTableSlot *srcslot,
 		if (remoteattnum < 0)
 			continue;
 
-		if (!replaces[remoteattnum])
+		if (!tupleData->changed[remoteattnum])
 			continue;
 
-		if (values[remoteattnum] != NULL)
+		if (tupleData->values[remoteattnum] != NULL)
 		{
-			Oid			typinput;
-			Oid			typioparam;
-
 			errarg.local_attnum = i;
 			errarg.remote_attnum = remoteattnum;
 
-			getTypeInputInfo(att->atttypid, &typinput, &typioparam);
-			slot->tts_values[i] =
-				OidInputFunctionCall(typinput, values[remoteattnum],
-									 typioparam, att->atttypmod);
+			slot->tts_values[i] = slot_input_value(att, rel, tupleData,
+												   remoteattnum);
 			slot->tts_isnull[i] = false;
 
 			errarg.local_attnum = -1;
@@ -465,18 +548,21 @@ apply_handle_begin(StringInfo s)
 }
 
 /*
- * Handle COMMIT message.
+ * Commit the local transaction applying a remote one, once all of its
+ * changes have been applied.
+ *
+ * A parallel apply worker commits only once the transactions handed out
+ * before its own have committed, and leaves tracking of the flush position
+ * to the leader.
  *
  * TODO, support tracking of multiple origins
  */
 static void
-apply_handle_commit(StringInfo s)
+apply_commit(LogicalRepCommitData *commit_data)
 {
-	LogicalRepCommitData commit_data;
-
-	logicalrep_read_commit(s, &commit_data);
+	XLogRecPtr	local_end = InvalidXLogRecPtr;
 
-	Assert(commit_data.commit_lsn == remote_final_lsn);
+	Assert(commit_data->commit_lsn == remote_final_lsn);
 
 	/* The synchronization worker runs in single transaction. */
 	if (IsTransactionState() && !am_tablesync_worker())
@@ -485,13 +571,18 @@ apply_handle_commit(StringInfo s)
 		 * Update origin state so we can restart streaming from correct
 		 * position in case of crash.
 		 */
-		replorigin_session_origin_lsn = commit_data.end_lsn;
-		replorigin_session_origin_timestamp = commit_data.committime;
+		replorigin_session_origin_lsn = commit_data->end_lsn;
+		replorigin_session_origin_timestamp = commit_data->committime;
+
+		if (am_parallel_apply_worker())
+			parallel_apply_wait_for_turn();
 
 		CommitTransactionCommand();
 		pgstat_report_stat(false);
 
-		store_flush_position(commit_data.end_lsn);
+		local_end = XactLastCommitEnd;
+		if (!am_parallel_apply_worker())
+			store_flush_position(commit_data->end_lsn, local_end);
 	}
 	else
 	{
@@ -502,12 +593,31 @@ apply_handle_commit(StringInfo s)
 
 	in_remote_transaction = false;
 
-	/* Process any tables that are being synchronized in parallel. */
-	process_syncing_tables(commit_data.end_lsn);
+	/*
+	 * Process any tables that are being synchronized in parallel.  That's
+	 * left to the leader if we're a parallel apply worker.
+	 */
+	if (am_parallel_apply_worker())
+		parallel_apply_mark_done(commit_data->end_lsn, local_end);
+	else
+		process_syncing_tables(commit_data->end_lsn);
 
 	pgstat_report_activity(STATE_IDLE, NULL);
 }
 
+/*
+ * Handle COMMIT message.
+ */
+static void
+apply_handle_commit(StringInfo s)
+{
+	LogicalRepCommitData commit_data;
+
+	logicalrep_read_commit(s, &commit_data);
+
+	apply_commit(&commit_data);
+}
+
 /*
  * Handle ORIGIN message.
  *
@@ -527,6 +637,287 @@ apply_handle_origin(StringInfo s)
 				 errmsg("ORIGIN message sent out of order")));
 }
 
+/*
+ * If we're inside a block of streamed changes, spool the change to the
+ * file of the transaction instead of applying it, and return true.
+ *
+ * Each change is stored as its length, followed by the xid of the
+ * (sub)transaction it belongs to, the action, and the rest of the message.
+ */
+static bool
+handle_streamed_transaction(const char action, StringInfo s)
+{
+	TransactionId xid;
+	int			len;
+
+	if (!in_streamed_transaction)
+		return false;
+
+	Assert(stream_entry != NULL);
+
+	xid = pq_getmsgint(s, 4);
+
+	len = sizeof(TransactionId) + sizeof(char) + (s->len - s->cursor);
+
+	if (BufFileWrite(stream_entry->file, &len, sizeof(len)) != sizeof(len) ||
+		BufFileWrite(stream_entry->file, &xid, sizeof(xid)) != sizeof(xid) ||
+		BufFileWrite(stream_entry->file, (void *) &action,
+					 sizeof(action)) != sizeof(action) ||
+		BufFileWrite(stream_entry->file, &s->data[s->cursor],
+					 s->len - s->cursor) != s->len - s->cursor)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to streamed transaction file: %m")));
+
+	return true;
+}
+
+/*
+ * Forget the changes spooled for a streamed transaction.
+ */
+static void
+stream_cleanup_entry(StreamXidEntry *entry)
+{
+	BufFileClose(entry->file);
+	if (entry->aborted_subxids)
+		pfree(entry->aborted_subxids);
+
+	hash_search(stream_xids, &entry->xid, HASH_REMOVE, NULL);
+}
+
+/*
+ * Handle STREAM START message.
+ */
+static void
+apply_handle_stream_start(StringInfo s)
+{
+	TransactionId xid;
+	bool		first_segment;
+	StreamXidEntry *entry;
+	MemoryContext oldctx;
+
+	if (in_streamed_transaction || in_remote_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM START message sent out of order")));
+
+	xid = logicalrep_read_stream_start(s, &first_segment);
+
+	if (!TransactionIdIsValid(xid))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid transaction ID in streamed replication transaction")));
+
+	if (stream_xids == NULL)
+	{
+		HASHCTL		ctl;
+
+		LogicalStreamingContext = AllocSetContextCreate(ApplyContext,
+														"LogicalStreamingContext",
+														ALLOCSET_DEFAULT_SIZES);
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(TransactionId);
+		ctl.entrysize = sizeof(StreamXidEntry);
+		ctl.hcxt = LogicalStreamingContext;
+		stream_xids = hash_create("logical replication streamed transactions",
+								  16, &ctl,
+								  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = hash_search(stream_xids, &xid, HASH_FIND, NULL);
+
+	if (first_segment)
+	{
+		/*
+		 * The transaction is being sent from its start, which happens again
+		 * if the connection was lost in the middle; drop what we have.
+		 */
+		if (entry)
+			stream_cleanup_entry(entry);
+
+		entry = hash_search(stream_xids, &xid, HASH_ENTER, NULL);
+
+		oldctx = MemoryContextSwitchTo(LogicalStreamingContext);
+		entry->file = BufFileCreateTemp(true);
+		entry->aborted_subxids = NULL;
+		entry->naborted_subxids = 0;
+		entry->maxaborted_subxids = 0;
+		MemoryContextSwitchTo(oldctx);
+	}
+	else if (entry == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("no data spooled for streamed transaction %u", xid)));
+
+	stream_entry = entry;
+	in_streamed_transaction = true;
+
+	pgstat_report_activity(STATE_RUNNING, NULL);
+}
+
+/*
+ * Handle STREAM STOP message.
+ */
+static void
+apply_handle_stream_stop(StringInfo s)
+{
+	if (!in_streamed_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM STOP message sent out of order")));
+
+	in_streamed_transaction = false;
+	stream_entry = NULL;
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+}
+
+/*
+ * Handle STREAM ABORT message.
+ *
+ * For the toplevel transaction, drop everything spooled for it; for a
+ * subtransaction, remember to skip its changes when applying the rest.
+ */
+static void
+apply_handle_stream_abort(StringInfo s)
+{
+	TransactionId xid;
+	TransactionId subxid;
+	StreamXidEntry *entry;
+
+	if (in_streamed_transaction || in_remote_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM ABORT message sent out of order")));
+
+	logicalrep_read_stream_abort(s, &xid, &subxid);
+
+	/* nothing to do if nothing has been spooled since we started */
+	entry = stream_xids ? hash_search(stream_xids, &xid, HASH_FIND, NULL) : NULL;
+	if (entry == NULL)
+		return;
+
+	if (xid == subxid)
+		stream_cleanup_entry(entry);
+	else
+	{
+		if (entry->naborted_subxids >= entry->maxaborted_subxids)
+		{
+			if (entry->maxaborted_subxids == 0)
+			{
+				entry->maxaborted_subxids = 16;
+				entry->aborted_subxids =
+					MemoryContextAlloc(LogicalStreamingContext,
+									   entry->maxaborted_subxids * sizeof(TransactionId));
+			}
+			else
+			{
+				entry->maxaborted_subxids *= 2;
+				entry->aborted_subxids =
+					repalloc(entry->aborted_subxids,
+							 entry->maxaborted_subxids * sizeof(TransactionId));
+			}
+		}
+		entry->aborted_subxids[entry->naborted_subxids++] = subxid;
+	}
+}
+
+/*
+ * Handle STREAM COMMIT message: apply the changes spooled for the
+ * transaction, except those of aborted subtransactions, and commit.
+ */
+static void
+apply_handle_stream_commit(StringInfo s)
+{
+	TransactionId xid;
+	LogicalRepCommitData commit_data;
+	StreamXidEntry *entry;
+	StringInfoData buf;
+	MemoryContext oldctx;
+
+	if (in_streamed_transaction || in_remote_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM COMMIT message sent out of order")));
+
+	xid = logicalrep_read_stream_commit(s, &commit_data);
+
+	entry = stream_xids ? hash_search(stream_xids, &xid, HASH_FIND, NULL) : NULL;
+	if (entry == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("no data spooled for streamed transaction %u", xid)));
+
+	remote_final_lsn = commit_data.commit_lsn;
+	in_remote_transaction = true;
+
+	pgstat_report_activity(STATE_RUNNING, NULL);
+
+	if (BufFileSeek(entry->file, 0, 0, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind streamed transaction file: %m")));
+
+	oldctx = MemoryContextSwitchTo(LogicalStreamingContext);
+	initStringInfo(&buf);
+	MemoryContextSwitchTo(oldctx);
+
+	for (;;)
+	{
+		StringInfoData msg;
+		TransactionId subxid;
+		int			len;
+		size_t		nread;
+		int			i;
+		bool		skip = false;
+
+		CHECK_FOR_INTERRUPTS();
+
+		nread = BufFileRead(entry->file, &len, sizeof(len));
+		if (nread == 0)
+			break;
+		if (nread != sizeof(len) || len <= (int) sizeof(TransactionId))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from streamed transaction file: %m")));
+
+		resetStringInfo(&buf);
+		enlargeStringInfo(&buf, len);
+		if (BufFileRead(entry->file, buf.data, len) != len)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from streamed transaction file: %m")));
+
+		memcpy(&subxid, buf.data, sizeof(TransactionId));
+		for (i = 0; i < entry->naborted_subxids; i++)
+		{
+			if (entry->aborted_subxids[i] == subxid)
+			{
+				skip = true;
+				break;
+			}
+		}
+		if (skip)
+			continue;
+
+		msg.data = buf.data + sizeof(TransactionId);
+		msg.len = len - sizeof(TransactionId);
+		msg.maxlen = -1;
+		msg.cursor = 0;
+
+		MemoryContextSwitchTo(ApplyMessageContext);
+		apply_dispatch(&msg);
+		MemoryContextReset(ApplyMessageContext);
+	}
+
+	pfree(buf.data);
+
+	apply_commit(&commit_data);
+
+	stream_cleanup_entry(entry);
+}
+
 /*
  * Handle RELATION message.
  *
@@ -590,6 +981,9 @@ apply_handle_insert(StringInfo s)
 	TupleTableSlot *remoteslot;
 	MemoryContext oldctx;
 
+	if (handle_streamed_transaction('I', s))
+		return;
+
 	ensure_transaction();
 
 	relid = logicalrep_read_insert(s, &newtup);
@@ -615,7 +1009,7 @@ apply_handle_insert(StringInfo s)
 
 	/* Process and store remote tuple in the slot */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel, newtup.values);
+	slot_store_data(remoteslot, rel, &newtup);
 	slot_fill_defaults(rel, estate, remoteslot);
 	MemoryContextSwitchTo(oldctx);
 
@@ -693,6 +1087,9 @@ apply_handle_update(StringInfo s)
 	bool		found;
 	MemoryContext oldctx;
 
+	if (handle_streamed_transaction('U', s))
+		return;
+
 	ensure_transaction();
 
 	relid = logicalrep_read_update(s, &has_oldtup, &oldtup,
@@ -725,8 +1122,8 @@ apply_handle_update(StringInfo s)
 
 	/* Build the search tuple. */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel,
-						has_oldtup ? oldtup.values : newtup.values);
+	slot_store_data(remoteslot, rel,
+					has_oldtup ? &oldtup : &newtup);
 	MemoryContextSwitchTo(oldctx);
 
 	/*
@@ -756,8 +1153,7 @@ apply_handle_update(StringInfo s)
 	{
 		/* Process and store remote tuple in the slot */
 		oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-		slot_modify_cstrings(remoteslot, localslot, rel,
-							 newtup.values, newtup.changed);
+		slot_modify_data(remoteslot, localslot, rel, &newtup);
 		MemoryContextSwitchTo(oldctx);
 
 		EvalPlanQualSetSlot(&epqstate, remoteslot);
@@ -813,6 +1209,9 @@ apply_handle_delete(StringInfo s)
 	bool		found;
 	MemoryContext oldctx;
 
+	if (handle_streamed_transaction('D', s))
+		return;
+
 	ensure_transaction();
 
 	relid = logicalrep_read_delete(s, &oldtup);
@@ -844,7 +1243,7 @@ apply_handle_delete(StringInfo s)
 
 	/* Find the tuple using the replica identity index. */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_cstrings(remoteslot, rel, oldtup.values);
+	slot_store_data(remoteslot, rel, &oldtup);
 	MemoryContextSwitchTo(oldctx);
 
 	/*
@@ -912,6 +1311,9 @@ apply_handle_truncate(StringInfo s)
 	List	   *relids_logged = NIL;
 	ListCell   *lc;
 
+	if (handle_streamed_transaction('T', s))
+		return;
+
 	ensure_transaction();
 
 	remote_relids = logicalrep_read_truncate(s, &cascade, &restart_seqs);
@@ -960,7 +1362,7 @@ apply_handle_truncate(StringInfo s)
 /*
  * Logical replication protocol message dispatcher.
  */
-static void
+void
 apply_dispatch(StringInfo s)
 {
 	char		action = pq_getmsgbyte(s);
@@ -1003,6 +1405,22 @@ apply_dispatch(StringInfo s)
 		case 'O':
 			apply_handle_origin(s);
 			break;
+			/* STREAM START */
+		case 'S':
+			apply_handle_stream_start(s);
+			break;
+			/* STREAM END */
+		case 'E':
+			apply_handle_stream_stop(s);
+			break;
+			/* STREAM ABORT */
+		case 'A':
+			apply_handle_stream_abort(s);
+			break;
+			/* STREAM COMMIT */
+		case 'c':
+			apply_handle_stream_commit(s);
+			break;
 		default:
 			ereport(ERROR,
 					(errcode(ERRCODE_PROTOCOL_VIOLATION),
@@ -1065,10 +1483,10 @@ get_flush_position(XLogRecPtr *write, XLogRecPtr *flush,
 }
 
 /*
- * Store current remote/local lsn pair in the tracking list.
+ * Store a remote/local lsn pair in the tracking list.
  */
-static void
-store_flush_position(XLogRecPtr remote_lsn)
+void
+store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn)
 {
 	FlushPosition *flushpos;
 
@@ -1077,7 +1495,7 @@ store_flush_position(XLogRecPtr remote_lsn)
 
 	/* Track commit lsn  */
 	flushpos = (FlushPosition *) palloc(sizeof(FlushPosition));
-	flushpos->local_end = XactLastCommitEnd;
+	flushpos->local_end = local_lsn;
 	flushpos->remote_end = remote_lsn;
 
 	dlist_push_tail(&lsn_mapping, &flushpos->node);
@@ -1189,7 +1607,8 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 
 						UpdateWorkerStats(last_received, send_time, false);
 
-						apply_dispatch(&s);
+						if (!parallel_apply_dispatch(&s))
+							apply_dispatch(&s);
 					}
 					else if (c == 'k')
 					{
@@ -1216,6 +1635,9 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 			}
 		}
 
+		/* Collect the transactions parallel apply workers have committed */
+		parallel_apply_reap();
+
 		/* confirm all writes so far */
 		send_feedback(last_received, false, false);
 
@@ -1362,9 +1784,10 @@ send_feedback(XLogRecPtr recvpos, bool force, bool requestReply)
 
 	/*
 	 * No outstanding transactions to flush, we can report the latest received
-	 * position. This is important for synchronous replication.
+	 * position. This is important for synchronous replication.  Transactions
+	 * still being applied by parallel apply workers are outstanding too.
 	 */
-	if (!have_pending_txes)
+	if (!have_pending_txes && !parallel_apply_in_progress())
 		flushpos = writepos = recvpos;
 
 	if (writepos < last_writepos)
@@ -1517,6 +1940,35 @@ maybe_reread_subscription(void)
 		proc_exit(0);
 	}
 
+	/*
+	 * Exit if the binary option was changed, which is also requested when
+	 * starting the replication.  The launcher will start new worker.
+	 */
+	if (newsub->binary != MySubscription->binary)
+	{
+		ereport(LOG,
+				(errmsg("logical replication apply worker for subscription \"%s\" will "
+						"restart because the binary option was changed",
+						MySubscription->name)));
+
+		proc_exit(0);
+	}
+
+	/*
+	 * Exit if streaming of in-progress transactions was switched on or off,
+	 * which is requested when starting the replication.  The launcher will
+	 * start new worker.
+	 */
+	if (newsub->stream != MySubscription->stream)
+	{
+		ereport(LOG,
+				(errmsg("logical replication apply worker for subscription \"%s\" will "
+						"restart because the streaming option was changed",
+						MySubscription->name)));
+
+		proc_exit(0);
+	}
+
 	/*
 	 * Exit if publication list was changed. The launcher will start new
 	 * worker.
@@ -1709,7 +2161,7 @@ ApplyWorkerMain(Datum main_arg)
 		originid = replorigin_by_name(originname, true);
 		if (!OidIsValid(originid))
 			originid = replorigin_create(originname);
-		replorigin_session_setup(originid);
+		replorigin_session_setup(originid, 0);
 		replorigin_session_origin = originid;
 		origin_startpos = replorigin_session_get_progress(false);
 		CommitTransactionCommand();
@@ -1740,9 +2192,25 @@ ApplyWorkerMain(Datum main_arg)
 	options.logical = true;
 	options.startpoint = origin_startpos;
 	options.slotname = myslotname;
-	options.proto.logical.proto_version = LOGICALREP_PROTO_VERSION_NUM;
 	options.proto.logical.publication_names = MySubscription->publications;
 
+	/*
+	 * Ask for in-progress transactions to be streamed if the subscription
+	 * wants that and the publisher supports it.  Table synchronization
+	 * workers apply everything in a single transaction, so they don't.
+	 */
+	options.proto.logical.streaming =
+		(MySubscription->stream && !am_tablesync_worker() &&
+		 walrcv_server_version(wrconn) >= 130000);
+
+	/* Older publishers don't know the binary option */
+	options.proto.logical.binary =
+		(MySubscription->binary &&
+		 walrcv_server_version(wrconn) >= 130000);
+
+	options.proto.logical.proto_version = options.proto.logical.streaming ?
+		LOGICALREP_PROTO_STREAM_VERSION_NUM : LOGICALREP_PROTO_VERSION_NUM;
+
 	/* Start normal logical streaming replication. */
 	walrcv_startstreaming(wrconn, &options);
 
@@ -63,6 +63,7 @@ static SQLCmd *make_sqlcmd(void);
 
 /* Keyword tokens. */
 %token K_BASE_BACKUP
+%token K_STOP_BACKUP
 %token K_IDENTIFY_SYSTEM
 %token K_SHOW
 %token K_START_REPLICATION
@@ -78,6 +79,12 @@ static SQLCmd *make_sqlcmd(void);
 %token K_WAL
 %token K_TABLESPACE_MAP
 %token K_NOVERIFY_CHECKSUMS
+%token K_COMPRESSION
+%token K_COMPRESSION_LEVEL
+%token K_PARALLEL
+%token K_TABLESPACE
+%token K_START_LSN
+%token K_INCREMENTAL
 %token K_TIMELINE
 %token K_PHYSICAL
 %token K_LOGICAL
@@ -89,7 +96,7 @@ static SQLCmd *make_sqlcmd(void);
 %token K_USE_SNAPSHOT
 
 %type <node>	command
-%type <node>	base_backup start_replication start_logical_replication
+%type <node>	base_backup stop_backup start_replication start_logical_replication
 				create_replication_slot drop_replication_slot identify_system
 				timeline_history show sql_cmd
 %type <list>	base_backup_opt_list
@@ -118,6 +125,7 @@ opt_semicolon:	';'
 command:
 			identify_system
 			| base_backup
+			| stop_backup
 			| start_replication
 			| start_logical_replication
 			| create_replication_slot
@@ -156,6 +164,8 @@ var_name:	IDENT	{ $$ = $1; }
 /*
  * BASE_BACKUP [LABEL '<label>'] [PROGRESS] [FAST] [WAL] [NOWAIT]
  * [MAX_RATE %d] [TABLESPACE_MAP] [NOVERIFY_CHECKSUMS]
+ * [COMPRESSION '<method>'] [COMPRESSION_LEVEL %d] [PARALLEL]
+ * [TABLESPACE %d START_LSN '<lsn>'] [INCREMENTAL '<lsn>']
  */
 base_backup:
 			K_BASE_BACKUP base_backup_opt_list
@@ -214,6 +224,54 @@ base_backup_opt:
 				  $$ = makeDefElem("noverify_checksums",
 								   (Node *)makeInteger(true), -1);
 				}
+			| K_COMPRESSION SCONST
+				{
+				  $$ = makeDefElem("compression",
+								   (Node *)makeString($2), -1);
+				}
+			| K_COMPRESSION_LEVEL UCONST
+				{
+				  $$ = makeDefElem("compression_level",
+								   (Node *)makeInteger($2), -1);
+				}
+			| K_PARALLEL
+				{
+				  $$ = makeDefElem("parallel",
+								   (Node *)makeInteger(true), -1);
+				}
+			| K_TABLESPACE UCONST
+				{
+				  $$ = makeDefElem("tablespace",
+								   (Node *)makeInteger($2), -1);
+				}
+			| K_START_LSN SCONST
+				{
+				  $$ = makeDefElem("start_lsn",
+								   (Node *)makeString($2), -1);
+				}
+			| K_INCREMENTAL SCONST
+				{
+				  $$ = makeDefElem("incremental",
+								   (Node *)makeString($2), -1);
+				}
+			;
+
+/*
+ * STOP_BACKUP [NOWAIT]
+ */
+stop_backup:
+			K_STOP_BACKUP
+				{
+					StopBackupCmd *cmd = makeNode(StopBackupCmd);
+					cmd->nowait = false;
+					$$ = (Node *) cmd;
+				}
+			| K_STOP_BACKUP K_NOWAIT
+				{
+					StopBackupCmd *cmd = makeNode(StopBackupCmd);
+					cmd->nowait = true;
+					$$ = (Node *) cmd;
+				}
 			;
 
 create_replication_slot:
@@ -1555,6 +1555,11 @@ exec_replication_command(const char *cmd_string)
 			SendBaseBackup((BaseBackupCmd *) cmd_node);
 			break;
 
+		case T_StopBackupCmd:
+			PreventInTransactionBlock(true, "STOP_BACKUP");
+			SendStopBackup((StopBackupCmd *) cmd_node);
+			break;
+
 		case T_CreateReplicationSlotCmd:
 			CreateReplicationSlot((CreateReplicationSlotCmd *) cmd_node);
 			break;
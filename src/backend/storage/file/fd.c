@@ -147,6 +147,9 @@ int			max_safe_fds = 32;	/* default if not changed */
 /* Whether it is safe to continue running after fsync() fails. */
 bool		data_sync_retry = false;
 
+/* Which kinds of files to open with O_DIRECT; see IO_DIRECT_* in fd.h */
+int			io_direct_flags = 0;
+
 /* Debugging.... */
 
 #ifdef FDDEBUG
@@ -1970,3 +1970,74 @@ pg_stat_get_archiver(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(HeapTupleGetDatum(
 									  heap_form_tuple(tupdesc, values, nulls)));
 }
+
+/*
+ * Returns the group commit histograms, one row per bucket.  upper_bound is
+ * the exclusive upper bound of the bucket, in microseconds for the flush and
+ * wait columns and in processes for the group size column, or NULL for the
+ * last bucket, which has none.
+ */
+Datum
+pg_stat_get_wal_flush_histogram(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_WAL_FLUSH_HISTOGRAM_COLS	5
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	uint64		flush_latency[XLOG_FLUSH_HIST_BUCKETS];
+	uint64		wait_latency[XLOG_FLUSH_HIST_BUCKETS];
+	uint64		group_size[XLOG_FLUSH_HIST_BUCKETS];
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(oldcontext);
+
+	GetXLogFlushHistogram(flush_latency, wait_latency, group_size);
+
+	for (i = 0; i < XLOG_FLUSH_HIST_BUCKETS; i++)
+	{
+		Datum		values[PG_STAT_GET_WAL_FLUSH_HISTOGRAM_COLS];
+		bool		nulls[PG_STAT_GET_WAL_FLUSH_HISTOGRAM_COLS];
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(i);
+		if (i == XLOG_FLUSH_HIST_BUCKETS - 1)
+			nulls[1] = true;
+		else
+			values[1] = Int64GetDatum(INT64CONST(1) << i);
+		values[2] = Int64GetDatum(flush_latency[i]);
+		values[3] = Int64GetDatum(wait_latency[i]);
+		values[4] = Int64GetDatum(group_size[i]);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -102,6 +102,22 @@ typedef void (*WriteDataCallback) (size_t nbytes, char *buf,
  */
 #define MINIMUM_VERSION_FOR_TEMP_SLOTS 100000
 
+/*
+ * Server-side compression and parallel backups are supported from version 13.
+ */
+#define MINIMUM_VERSION_FOR_SERVER_COMPRESSION 130000
+#define MINIMUM_VERSION_FOR_PARALLEL_BACKUP 130000
+
+/*
+ * Incremental backups are supported from version 13.
+ */
+#define MINIMUM_VERSION_FOR_INCREMENTAL_BACKUP 130000
+
+/*
+ * Exit code of a tablespace worker that received a checksum failure.
+ */
+#define TABLESPACE_WORKER_CHECKSUM_FAILURE 2
+
 /*
  * Different ways to include WAL
  */
@@ -123,6 +139,11 @@ static bool checksum_failure = false;
 static bool showprogress = false;
 static int	verbose = 0;
 static int	compresslevel = 0;
+static char *server_compression = NULL;
+static int	server_compression_level = 0;
+static char *server_compression_suffix = "";
+static int	num_jobs = 1;
+static char *incremental_lsn = NULL;
 static IncludeWal includewal = STREAM_WAL;
 static bool fastcheckpoint = false;
 static bool writerecoveryconf = false;
@@ -158,6 +179,11 @@ static int	bgpipe[2] = {-1, -1};
 static pid_t bgchild = -1;
 static bool in_log_streamer = false;
 
+/* Handles to the background processes receiving tablespaces, if any */
+static pid_t *tablespace_workers = NULL;
+static int	num_tablespace_workers = 0;
+static bool in_tablespace_worker = false;
+
 /* End position for xlog streaming, empty string if unknown yet */
 static XLogRecPtr xlogendptr;
 
@@ -181,18 +207,26 @@ static void ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum);
 static void ReceiveTarAndUnpackCopyChunk(size_t r, char *copybuf,
 										 void *callback_data);
 static void BaseBackup(void);
+#ifndef WIN32
+static void StartTablespaceWorkers(PGresult *res, const char *startpos,
+								   const char *options);
+static int	TablespaceWorkerMain(PGresult *res, int worker, int nworkers,
+								 const char *startpos, const char *options);
+static void WaitForTablespaceWorkers(void);
+#endif
 
 static bool reached_end_position(XLogRecPtr segendpos, uint32 timeline,
 								 bool segment_finished);
 
 static const char *get_tablespace_mapping(const char *dir);
 static void tablespace_list_append(const char *arg);
+static char *read_backup_start_lsn(const char *dir);
 
 
 static void
 cleanup_directories_atexit(void)
 {
-	if (success || in_log_streamer)
+	if (success || in_log_streamer || in_tablespace_worker)
 		return;
 
 	if (!noclean && !checksum_failure)
@@ -255,6 +289,21 @@ kill_bgchild_atexit(void)
 	if (bgchild > 0)
 		kill(bgchild, SIGTERM);
 }
+
+/*
+ * Likewise for the subprocesses receiving tablespaces in a parallel backup.
+ */
+static void
+kill_tablespace_workers_atexit(void)
+{
+	int			i;
+
+	for (i = 0; i < num_tablespace_workers; i++)
+	{
+		if (tablespace_workers[i] > 0)
+			kill(tablespace_workers[i], SIGTERM);
+	}
+}
 #endif
 
 /*
@@ -335,6 +384,54 @@ tablespace_list_append(const char *arg)
 	tablespace_dirs.tail = cell;
 }
 
+/*
+ * Read the start location of the plain-format backup in 'dir' from its
+ * backup_label, to use as the reference for an incremental backup.
+ */
+static char *
+read_backup_start_lsn(const char *dir)
+{
+	char		filename[MAXPGPATH];
+	char		line[MAXPGPATH];
+	FILE	   *fp;
+	uint32		hi,
+				lo;
+	char	   *result = NULL;
+
+	snprintf(filename, sizeof(filename), "%s/backup_label", dir);
+	fp = fopen(filename, "r");
+	if (fp == NULL)
+	{
+		pg_log_error("could not open file \"%s\": %m", filename);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+		{
+			result = psprintf("%X/%X", hi, lo);
+			break;
+		}
+	}
+
+	if (ferror(fp))
+	{
+		pg_log_error("could not read file \"%s\": %m", filename);
+		exit(1);
+	}
+	fclose(fp);
+
+	if (result == NULL)
+	{
+		pg_log_error("could not find backup start location in file \"%s\"",
+					 filename);
+		exit(1);
+	}
+
+	return result;
+}
+
 
 #ifdef HAVE_LIBZ
 static const char *
@@ -372,10 +469,15 @@ usage(void)
 			 "                         include required WAL files with specified method\n"));
 	printf(_("  -z, --gzip             compress tar output\n"));
 	printf(_("  -Z, --compress=0-9     compress tar output with given compression level\n"));
+	printf(_("      --server-compress=METHOD[:LEVEL]\n"
+			 "                         compress tar output on the server with gzip, lz4 or zstd\n"));
 	printf(_("\nGeneral options:\n"));
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread checkpointing\n"));
 	printf(_("  -C, --create-slot      create replication slot\n"));
+	printf(_("      --incremental=OLDDIR\n"
+			 "                         take an incremental backup relative to the backup in OLDDIR\n"));
+	printf(_("  -j, --jobs=NUM         use this many parallel connections to receive tablespaces\n"));
 	printf(_("  -l, --label=LABEL      set backup label\n"));
 	printf(_("  -n, --no-clean         do not clean up after errors\n"));
 	printf(_("  -N, --no-sync          do not wait for changes to be written safely to disk\n"));
@@ -682,6 +784,164 @@ StartLogStreamer(char *startpos, uint32 timeline, char *sysidentifier)
 #endif
 }
 
+#ifndef WIN32
+/*
+ * Start the background processes receiving the tablespaces of a parallel
+ * backup, except for the main data directory which is received by the main
+ * process.  Each worker uses a connection of its own, and receives its share
+ * of the tablespaces one after the other while the server stays in backup
+ * mode.
+ */
+static void
+StartTablespaceWorkers(PGresult *res, const char *startpos,
+					   const char *options)
+{
+	int			nworkers;
+	int			i;
+
+	/* The main data directory is always the last row */
+	nworkers = Min(num_jobs - 1, PQntuples(res) - 1);
+	tablespace_workers = pg_malloc0(sizeof(pid_t) * nworkers);
+	atexit(kill_tablespace_workers_atexit);
+
+	if (verbose)
+		pg_log_info("starting %d background tablespace receivers", nworkers);
+
+	for (i = 0; i < nworkers; i++)
+	{
+		pid_t		pid;
+
+		/* Make sure buffered output isn't written twice */
+		fflush(stdout);
+		fflush(stderr);
+
+		pid = fork();
+		if (pid == 0)
+		{
+			/* in child process */
+			exit(TablespaceWorkerMain(res, i, nworkers, startpos, options));
+		}
+		else if (pid < 0)
+		{
+			pg_log_error("could not create background process: %m");
+			exit(1);
+		}
+
+		tablespace_workers[num_tablespace_workers++] = pid;
+	}
+}
+
+/*
+ * Main loop of a background process receiving tablespaces.  Returns the exit
+ * code of the process.
+ */
+static int
+TablespaceWorkerMain(PGresult *res, int worker, int nworkers,
+					 const char *startpos, const char *options)
+{
+	int			i;
+
+	in_tablespace_worker = true;
+
+	/*
+	 * The parent's connection, WAL streamer and other workers are none of
+	 * our business; don't let the exit callbacks touch them.
+	 */
+	bgchild = -1;
+	num_tablespace_workers = 0;
+	conn = GetConnection();
+	if (!conn)
+		/* Error message already written in GetConnection() */
+		return 1;
+
+	for (i = worker; i < PQntuples(res); i += nworkers)
+	{
+		PGresult   *cmdres;
+		char	   *cmd;
+
+		if (PQgetisnull(res, i, 0))
+			continue;
+
+		cmd = psprintf("BASE_BACKUP TABLESPACE %s START_LSN '%s' %s",
+					   PQgetvalue(res, i, 0), startpos, options);
+		if (PQsendQuery(conn, cmd) == 0)
+		{
+			pg_log_error("could not send replication command \"%s\": %s",
+						 "BASE_BACKUP", PQerrorMessage(conn));
+			return 1;
+		}
+		pg_free(cmd);
+
+		if (format == 't')
+			ReceiveTarFile(conn, res, i);
+		else
+			ReceiveAndUnpackTarFile(conn, res, i);
+
+		cmdres = PQgetResult(conn);
+		if (PQresultStatus(cmdres) != PGRES_COMMAND_OK)
+		{
+			const char *sqlstate = PQresultErrorField(cmdres, PG_DIAG_SQLSTATE);
+
+			pg_log_error("could not receive tablespace %s: %s",
+						 PQgetvalue(res, i, 0), PQerrorMessage(conn));
+			if (sqlstate &&
+				strcmp(sqlstate, ERRCODE_DATA_CORRUPTED) == 0)
+				return TABLESPACE_WORKER_CHECKSUM_FAILURE;
+			return 1;
+		}
+		PQclear(cmdres);
+
+		if (verbose)
+			pg_log_info("received tablespace %s", PQgetvalue(res, i, 0));
+	}
+
+	PQfinish(conn);
+	conn = NULL;
+
+	return 0;
+}
+
+/*
+ * Wait for all the background tablespace receivers to finish.
+ */
+static void
+WaitForTablespaceWorkers(void)
+{
+	int			i;
+
+	if (verbose && num_tablespace_workers > 0)
+		pg_log_info("waiting for background tablespace receivers to finish ...");
+
+	for (i = 0; i < num_tablespace_workers; i++)
+	{
+		int			status;
+		pid_t		r;
+
+		r = waitpid(tablespace_workers[i], &status, 0);
+		if (r == (pid_t) -1)
+		{
+			pg_log_error("could not wait for child process: %m");
+			exit(1);
+		}
+		tablespace_workers[i] = -1;
+
+		if (WIFEXITED(status) &&
+			WEXITSTATUS(status) == TABLESPACE_WORKER_CHECKSUM_FAILURE)
+		{
+			pg_log_error("checksum error occurred");
+			checksum_failure = true;
+			exit(1);
+		}
+		if (status != 0)
+		{
+			pg_log_error("background tablespace receiver failed: %s",
+						 wait_result_to_str(status));
+			exit(1);
+		}
+	}
+}
+#endif
+
 /*
  * Verify that the given directory exists and is empty. If it does not
  * exist, it is created. If it exists but is not empty, an error will
@@ -989,7 +1249,9 @@ writeTarData(WriteTarState *state, char *buf, int r)
  * enabled, the data will be compressed while written to the file.
  *
  * The file will be named base.tar[.gz] if it's for the main data directory
- * or <tablespaceoid>.tar[.gz] if it's for another tablespace.
+ * or <tablespaceoid>.tar[.gz] if it's for another tablespace.  If the server
+ * compresses the data, it's written out as is, with a suffix matching the
+ * compression method.
  *
  * No attempt to inspect or validate the contents of the file is done.
  */
@@ -1056,7 +1318,7 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 #endif
 			{
 				snprintf(state.filename, sizeof(state.filename),
-						 "%s/base.tar", basedir);
+						 "%s/base.tar%s", basedir, server_compression_suffix);
 				state.tarfile = fopen(state.filename, "wb");
 			}
 		}
@@ -1084,8 +1346,9 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 		else
 #endif
 		{
-			snprintf(state.filename, sizeof(state.filename), "%s/%s.tar",
-					 basedir, PQgetvalue(res, rownum, 0));
+			snprintf(state.filename, sizeof(state.filename), "%s/%s.tar%s",
+					 basedir, PQgetvalue(res, rownum, 0),
+					 server_compression_suffix);
 			state.tarfile = fopen(state.filename, "wb");
 		}
 	}
@@ -1170,8 +1433,12 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 		}
 	}
 
-	/* 2 * 512 bytes empty data at end of file */
-	writeTarData(&state, zerobuf, sizeof(zerobuf));
+	/*
+	 * 2 * 512 bytes empty data at end of file.  A stream compressed by the
+	 * server already includes them.
+	 */
+	if (server_compression == NULL)
+		writeTarData(&state, zerobuf, sizeof(zerobuf));
 
 #ifdef HAVE_LIBZ
 	if (state.ztarfile != NULL)
@@ -1651,6 +1918,8 @@ BaseBackup(void)
 	char	   *basebkp;
 	char		escaped_label[MAXPGPATH];
 	char	   *maxrate_clause = NULL;
+	char	   *compression_clause = NULL;
+	char	   *incremental_clause = NULL;
 	int			i;
 	char		xlogstart[64];
 	char		xlogend[64];
@@ -1692,6 +1961,29 @@ BaseBackup(void)
 		exit(1);
 	}
 
+	if (server_compression &&
+		serverVersion < MINIMUM_VERSION_FOR_SERVER_COMPRESSION)
+	{
+		pg_log_error("server-side compression is not supported by server version %s",
+					 PQparameterStatus(conn, "server_version"));
+		exit(1);
+	}
+
+	if (num_jobs > 1 && serverVersion < MINIMUM_VERSION_FOR_PARALLEL_BACKUP)
+	{
+		pg_log_error("parallel backups are not supported by server version %s",
+					 PQparameterStatus(conn, "server_version"));
+		exit(1);
+	}
+
+	if (incremental_lsn &&
+		serverVersion < MINIMUM_VERSION_FOR_INCREMENTAL_BACKUP)
+	{
+		pg_log_error("incremental backups are not supported by server version %s",
+					 PQparameterStatus(conn, "server_version"));
+		exit(1);
+	}
+
 	/*
 	 * Build contents of configuration file if requested
 	 */
@@ -1712,6 +2004,16 @@ BaseBackup(void)
 	if (maxrate > 0)
 		maxrate_clause = psprintf("MAX_RATE %u", maxrate);
 
+	if (server_compression && server_compression_level > 0)
+		compression_clause = psprintf("COMPRESSION '%s' COMPRESSION_LEVEL %d",
+									  server_compression,
+									  server_compression_level);
+	else if (server_compression)
+		compression_clause = psprintf("COMPRESSION '%s'", server_compression);
+
+	if (incremental_lsn)
+		incremental_clause = psprintf("INCREMENTAL '%s'", incremental_lsn);
+
 	if (verbose)
 		pg_log_info("initiating base backup, waiting for checkpoint to complete");
 
@@ -1725,7 +2027,7 @@ BaseBackup(void)
 	}
 
 	basebkp =
-		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s",
+		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s %s %s",
 				 escaped_label,
 				 showprogress ? "PROGRESS" : "",
 				 includewal == FETCH_WAL ? "WAL" : "",
@@ -1733,7 +2035,10 @@ BaseBackup(void)
 				 includewal == NO_WAL ? "" : "NOWAIT",
 				 maxrate_clause ? maxrate_clause : "",
 				 format == 't' ? "TABLESPACE_MAP" : "",
-				 verify_checksums ? "" : "NOVERIFY_CHECKSUMS");
+				 verify_checksums ? "" : "NOVERIFY_CHECKSUMS",
+				 compression_clause ? compression_clause : "",
+				 num_jobs > 1 ? "PARALLEL" : "",
+				 incremental_clause ? incremental_clause : "");
 
 	if (PQsendQuery(conn, basebkp) == 0)
 	{
@@ -1839,11 +2144,34 @@ BaseBackup(void)
 		StartLogStreamer(xlogstart, starttli, sysidentifier);
 	}
 
+#ifndef WIN32
+
+	/*
+	 * In a parallel backup, the tablespaces other than the main data
+	 * directory are received by background processes, over connections of
+	 * their own.
+	 */
+	if (num_jobs > 1 && PQntuples(res) > 1)
+	{
+		char	   *options;
+
+		options = psprintf("%s %s %s",
+						   maxrate_clause ? maxrate_clause : "",
+						   verify_checksums ? "" : "NOVERIFY_CHECKSUMS",
+						   compression_clause ? compression_clause : "");
+		StartTablespaceWorkers(res, xlogstart, options);
+	}
+#endif
+
 	/*
 	 * Start receiving chunks
 	 */
 	for (i = 0; i < PQntuples(res); i++)
 	{
+		/* Only the main data directory is sent here in a parallel backup */
+		if (num_jobs > 1 && !PQgetisnull(res, i, 0))
+			continue;
+
 		if (format == 't')
 			ReceiveTarFile(conn, res, i);
 		else
@@ -1859,6 +2187,44 @@ BaseBackup(void)
 
 	PQclear(res);
 
+#ifndef WIN32
+	if (num_jobs > 1)
+	{
+		/*
+		 * The server leaves a parallel backup running once the main data
+		 * directory is sent.  Stop it when all the tablespaces are in.
+		 */
+		res = PQgetResult(conn);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		{
+			const char *sqlstate = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+
+			if (sqlstate &&
+				strcmp(sqlstate, ERRCODE_DATA_CORRUPTED) == 0)
+			{
+				pg_log_error("checksum error occurred");
+				checksum_failure = true;
+			}
+			else
+			{
+				pg_log_error("could not receive data directory: %s",
+							 PQerrorMessage(conn));
+			}
+			exit(1);
+		}
+		PQclear(res);
+
+		WaitForTablespaceWorkers();
+
+		if (PQsendQuery(conn, includewal == NO_WAL ? "STOP_BACKUP" : "STOP_BACKUP NOWAIT") == 0)
+		{
+			pg_log_error("could not send replication command \"%s\": %s",
+						 "STOP_BACKUP", PQerrorMessage(conn));
+			exit(1);
+		}
+	}
+#endif
+
 	/*
 	 * Get the stop position
 	 */
@@ -2037,6 +2403,7 @@ main(int argc, char **argv)
 		{"wal-method", required_argument, NULL, 'X'},
 		{"gzip", no_argument, NULL, 'z'},
 		{"compress", required_argument, NULL, 'Z'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"label", required_argument, NULL, 'l'},
 		{"no-clean", no_argument, NULL, 'n'},
 		{"no-sync", no_argument, NULL, 'N'},
@@ -2052,6 +2419,8 @@ main(int argc, char **argv)
 		{"waldir", required_argument, NULL, 1},
 		{"no-slot", no_argument, NULL, 2},
 		{"no-verify-checksums", no_argument, NULL, 3},
+		{"server-compress", required_argument, NULL, 4},
+		{"incremental", required_argument, NULL, 5},
 		{NULL, 0, NULL, 0}
 	};
 	int			c;
@@ -2079,7 +2448,7 @@ main(int argc, char **argv)
 
 	atexit(cleanup_directories_atexit);
 
-	while ((c = getopt_long(argc, argv, "CD:F:r:RS:T:X:l:nNzZ:d:c:h:p:U:s:wWkvP",
+	while ((c = getopt_long(argc, argv, "CD:F:r:RS:T:X:l:nNzZ:j:d:c:h:p:U:s:wWkvP",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -2173,6 +2542,48 @@ main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 4:
+				{
+					char	   *sep = strchr(optarg, ':');
+
+					server_compression = pg_strdup(optarg);
+					if (sep != NULL)
+					{
+						server_compression[sep - optarg] = '\0';
+						server_compression_level = atoi(sep + 1);
+						if (server_compression_level <= 0)
+						{
+							pg_log_error("invalid compression level \"%s\"",
+										 sep + 1);
+							exit(1);
+						}
+					}
+
+					if (strcmp(server_compression, "gzip") == 0)
+						server_compression_suffix = ".gz";
+					else if (strcmp(server_compression, "lz4") == 0)
+						server_compression_suffix = ".lz4";
+					else if (strcmp(server_compression, "zstd") == 0)
+						server_compression_suffix = ".zst";
+					else
+					{
+						pg_log_error("invalid compression method \"%s\", must be \"gzip\", \"lz4\" or \"zstd\"",
+									 server_compression);
+						exit(1);
+					}
+				}
+				break;
+			case 5:
+				incremental_lsn = read_backup_start_lsn(optarg);
+				break;
+			case 'j':
+				num_jobs = atoi(optarg);
+				if (num_jobs <= 0)
+				{
+					pg_log_error("invalid number of parallel jobs \"%s\"", optarg);
+					exit(1);
+				}
+				break;
 			case 'c':
 				if (pg_strcasecmp(optarg, "fast") == 0)
 					fastcheckpoint = true;
@@ -2265,6 +2676,64 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (server_compression)
+	{
+		if (format == 'p')
+		{
+			pg_log_error("only tar mode backups can be compressed");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+
+		if (compresslevel != 0)
+		{
+			pg_log_error("--server-compress cannot be used with --gzip or --compress");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+
+		if (writerecoveryconf)
+		{
+			pg_log_error("--server-compress cannot be used with --write-recovery-conf");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+	}
+
+	if (num_jobs > 1)
+	{
+#ifdef WIN32
+		pg_log_error("parallel backups are not supported on this platform");
+		exit(1);
+#endif
+		if (includewal == FETCH_WAL)
+		{
+			pg_log_error("--jobs cannot be used with --wal-method=fetch");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+
+		if (showprogress)
+		{
+			pg_log_error("--jobs cannot be used with --progress");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+
+		if (incremental_lsn)
+		{
+			pg_log_error("--jobs cannot be used with --incremental");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+	}
+
 	if (format == 't' && includewal == STREAM_WAL && strcmp(basedir, "-") == 0)
 	{
 		pg_log_error("cannot stream write-ahead logs in tar mode to stdout");
@@ -6,7 +6,7 @@ use File::Basename qw(basename dirname);
 use File::Path qw(rmtree);
 use PostgresNode;
 use TestLib;
-use Test::More tests => 106;
+use Test::More tests => 112;
 
 program_help_ok('pg_basebackup');
 program_version_ok('pg_basebackup');
@@ -174,6 +174,35 @@ $node->command_ok([ 'pg_basebackup', '-D', "$tempdir/tarbackup", '-Ft' ],
 ok(-f "$tempdir/tarbackup/base.tar", 'backup tar was created');
 rmtree("$tempdir/tarbackup");
 
+$node->command_fails(
+	[
+		'pg_basebackup', '-D', "$tempdir/backup_foo", '-Ft',
+		'--server-compress=foo'
+	],
+	'server-side compression with invalid method fails');
+$node->command_fails(
+	[
+		'pg_basebackup', '-D', "$tempdir/backup_foo", '-Fp',
+		'--server-compress=gzip'
+	],
+	'server-side compression in plain format fails');
+
+SKIP:
+{
+	skip "postgres was not built with ZLIB support", 2
+	  if (!check_pg_config("#define HAVE_LIBZ 1"));
+
+	$node->command_ok(
+		[
+			'pg_basebackup', '-D', "$tempdir/tarbackupgz", '-Ft',
+			'--server-compress=gzip'
+		],
+		'tar format with server-side gzip compression');
+	ok(-f "$tempdir/tarbackupgz/base.tar.gz",
+		'compressed backup tar was created');
+	rmtree("$tempdir/tarbackupgz");
+}
+
 $node->command_fails(
 	[ 'pg_basebackup', '-D', "$tempdir/backup_foo", '-Fp', "-T=/foo" ],
 	'-T with empty old directory fails');
@@ -212,7 +241,7 @@ unlink "$pgdata/$superlongname";
 # skip on Windows.
 SKIP:
 {
-	skip "symlinks not supported on Windows", 18 if ($windows_os);
+	skip "symlinks not supported on Windows", 20 if ($windows_os);
 
 	# Move pg_replslot out of $pgdata and create a symlink to it.
 	$node->stop;
@@ -249,6 +278,13 @@ SKIP:
 	is(scalar(@tblspc_tars), 1, 'one tablespace tar was created');
 	rmtree("$tempdir/tarbackup2");
 
+	$node->command_ok(
+		[ 'pg_basebackup', '-D', "$tempdir/tarbackup3", '-Ft', '-j', '2' ],
+		'parallel tar format with tablespaces');
+	@tblspc_tars = glob "$tempdir/tarbackup3/[0-9]*.tar";
+	is(scalar(@tblspc_tars), 1, 'tablespace tar was received in parallel');
+	rmtree("$tempdir/tarbackup3");
+
 	# Create an unlogged table to test that forks other than init are not copied.
 	$node->safe_psql('postgres',
 		'CREATE UNLOGGED TABLE tblspc1_unlogged (id int) TABLESPACE tblspc1;'
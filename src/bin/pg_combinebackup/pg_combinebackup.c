@@ -0,0 +1,955 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_combinebackup.c
+ *	  Reconstruct a full backup from an incremental backup and the chain
+ *	  of backups it is based on
+ *
+ * Copyright (c) 2010-2019, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/bin/pg_combinebackup/pg_combinebackup.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catalog/pg_control.h"
+#include "common/controldata_utils.h"
+#include "common/file_perm.h"
+#include "common/file_utils.h"
+#include "common/logging.h"
+#include "getopt_long.h"
+#include "replication/basebackup_incremental.h"
+
+/* A backup given on the command line */
+typedef struct BackupInfo
+{
+	char	   *dir;
+	XLogRecPtr	start_lsn;		/* START WAL LOCATION */
+	XLogRecPtr	incremental_from;	/* INCREMENTAL FROM LSN, or invalid */
+	uint64		system_identifier;
+} BackupInfo;
+
+typedef struct TablespaceListCell
+{
+	struct TablespaceListCell *next;
+	char		old_dir[MAXPGPATH];
+	char		new_dir[MAXPGPATH];
+} TablespaceListCell;
+
+typedef struct TablespaceList
+{
+	TablespaceListCell *head;
+	TablespaceListCell *tail;
+} TablespaceList;
+
+static const char *progname;
+
+/* Backups to combine, oldest first */
+static BackupInfo *backups;
+static int	nbackups;
+
+static char *output_dir = NULL;
+static TablespaceList tablespace_dirs = {NULL, NULL};
+static bool do_sync = true;
+static bool verbose = false;
+
+static int64 files_copied = 0;
+static int64 files_reconstructed = 0;
+
+static void usage(void);
+static void tablespace_list_append(const char *arg);
+static const char *get_tablespace_mapping(const char *dir);
+static char *slurp_file(const char *filename, size_t *len);
+static void read_backup_info(BackupInfo *backup);
+static void check_backup_chain(void);
+static void create_output_directory(char *dir);
+static void process_directory(const char *relpath);
+static void process_tablespace_link(const char *relpath, const char *srcpath);
+static void copy_file(const char *srcpath, const char *dstpath);
+static void write_backup_label(const char *srcpath, const char *dstpath);
+static bool read_incremental_header(const char *path, int *fd,
+									IncrementalFileHeader *hdr,
+									BlockNumber **blocknums);
+static void reconstruct_file(const char *reldir, const char *filename);
+
+
+static void
+usage(void)
+{
+	printf(_("%s reconstructs a full backup from an incremental backup and the backups it is based on.\n\n"),
+		   progname);
+	printf(_("Usage:\n"));
+	printf(_("  %s [OPTION]... DIRECTORY...\n"), progname);
+	printf(_("\nOptions:\n"));
+	printf(_("  -o, --output=DIRECTORY  write the reconstructed backup into DIRECTORY\n"));
+	printf(_("  -T, --tablespace-mapping=OLDDIR=NEWDIR\n"
+			 "                          relocate tablespace in OLDDIR to NEWDIR\n"));
+	printf(_("  -N, --no-sync           do not wait for changes to be written safely to disk\n"));
+	printf(_("  -v, --verbose           output verbose messages\n"));
+	printf(_("  -V, --version           output version information, then exit\n"));
+	printf(_("  -?, --help              show this help, then exit\n"));
+	printf(_("\nThe backups must be given in the order they were taken, starting with a\n"
+			 "full backup, each of the following ones having been taken incrementally\n"
+			 "relative to the one before it.  All of them must be in plain format.\n\n"));
+	printf(_("Report bugs to <pgsql-bugs@lists.postgresql.org>.\n"));
+}
+
+/*
+ * Split argument into old_dir and new_dir and append to tablespace mapping
+ * list.  The syntax is the same as for pg_basebackup's -T option.
+ */
+static void
+tablespace_list_append(const char *arg)
+{
+	TablespaceListCell *cell = (TablespaceListCell *) pg_malloc0(sizeof(TablespaceListCell));
+	char	   *dst;
+	char	   *dst_ptr;
+	const char *arg_ptr;
+
+	dst_ptr = dst = cell->old_dir;
+	for (arg_ptr = arg; *arg_ptr; arg_ptr++)
+	{
+		if (dst_ptr - dst >= MAXPGPATH)
+		{
+			pg_log_error("directory name too long");
+			exit(1);
+		}
+
+		if (*arg_ptr == '\\' && *(arg_ptr + 1) == '=')
+			;					/* skip backslash escaping = */
+		else if (*arg_ptr == '=' && (arg_ptr == arg || *(arg_ptr - 1) != '\\'))
+		{
+			if (*cell->new_dir)
+			{
+				pg_log_error("multiple \"=\" signs in tablespace mapping");
+				exit(1);
+			}
+			else
+				dst = dst_ptr = cell->new_dir;
+		}
+		else
+			*dst_ptr++ = *arg_ptr;
+	}
+
+	if (!*cell->old_dir || !*cell->new_dir)
+	{
+		pg_log_error("invalid tablespace mapping format \"%s\", must be \"OLDDIR=NEWDIR\"", arg);
+		exit(1);
+	}
+
+	if (!is_absolute_path(cell->old_dir))
+	{
+		pg_log_error("old directory is not an absolute path in tablespace mapping: %s",
+					 cell->old_dir);
+		exit(1);
+	}
+
+	if (!is_absolute_path(cell->new_dir))
+	{
+		pg_log_error("new directory is not an absolute path in tablespace mapping: %s",
+					 cell->new_dir);
+		exit(1);
+	}
+
+	canonicalize_path(cell->old_dir);
+	canonicalize_path(cell->new_dir);
+
+	if (tablespace_dirs.tail)
+		tablespace_dirs.tail->next = cell;
+	else
+		tablespace_dirs.head = cell;
+	tablespace_dirs.tail = cell;
+}
+
+/*
+ * Retrieve tablespace path, either relocated or original depending on whether
+ * -T was passed or not.  Returns NULL if it wasn't relocated.
+ */
+static const char *
+get_tablespace_mapping(const char *dir)
+{
+	TablespaceListCell *cell;
+	char		canon_dir[MAXPGPATH];
+
+	strlcpy(canon_dir, dir, sizeof(canon_dir));
+	canonicalize_path(canon_dir);
+
+	for (cell = tablespace_dirs.head; cell; cell = cell->next)
+		if (strcmp(canon_dir, cell->old_dir) == 0)
+			return cell->new_dir;
+
+	return NULL;
+}
+
+/*
+ * Read a whole file into a palloc'd, null-terminated buffer.
+ */
+static char *
+slurp_file(const char *filename, size_t *len)
+{
+	int			fd;
+	struct stat statbuf;
+	char	   *buf;
+	int			rb;
+
+	if ((fd = open(filename, O_RDONLY | PG_BINARY, 0)) < 0)
+	{
+		pg_log_error("could not open file \"%s\" for reading: %m", filename);
+		exit(1);
+	}
+	if (fstat(fd, &statbuf) < 0)
+	{
+		pg_log_error("could not stat file \"%s\": %m", filename);
+		exit(1);
+	}
+
+	buf = pg_malloc(statbuf.st_size + 1);
+	rb = read(fd, buf, statbuf.st_size);
+	if (rb != statbuf.st_size)
+	{
+		if (rb < 0)
+			pg_log_error("could not read file \"%s\": %m", filename);
+		else
+			pg_log_error("could not read file \"%s\": read %d of %zu",
+						 filename, rb, (size_t) statbuf.st_size);
+		exit(1);
+	}
+	buf[statbuf.st_size] = '\0';
+	close(fd);
+
+	*len = statbuf.st_size;
+	return buf;
+}
+
+/*
+ * Read the start location and, for an incremental backup, the location of
+ * the backup it is based on from the backup's backup_label, and its system
+ * identifier from its control file.
+ */
+static void
+read_backup_info(BackupInfo *backup)
+{
+	char		filename[MAXPGPATH];
+	char	   *label;
+	char	   *line;
+	size_t		len;
+	bool		found_start = false;
+	ControlFileData *control_file;
+	bool		crc_ok;
+
+	snprintf(filename, sizeof(filename), "%s/backup_label", backup->dir);
+	label = slurp_file(filename, &len);
+
+	backup->incremental_from = InvalidXLogRecPtr;
+	for (line = label; line != NULL && *line != '\0';)
+	{
+		char	   *next = strchr(line, '\n');
+		uint32		hi,
+					lo;
+
+		if (next != NULL)
+			*next++ = '\0';
+
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+		{
+			backup->start_lsn = ((uint64) hi) << 32 | lo;
+			found_start = true;
+		}
+		else if (strncmp(line, INCREMENTAL_LABEL_LINE,
+						 strlen(INCREMENTAL_LABEL_LINE)) == 0 &&
+				 sscanf(line + strlen(INCREMENTAL_LABEL_LINE), "%X/%X",
+						&hi, &lo) == 2)
+			backup->incremental_from = ((uint64) hi) << 32 | lo;
+
+		line = next;
+	}
+	pg_free(label);
+
+	if (!found_start)
+	{
+		pg_log_error("could not find backup start location in file \"%s\"",
+					 filename);
+		exit(1);
+	}
+
+	control_file = get_controlfile(backup->dir, &crc_ok);
+	if (!crc_ok)
+	{
+		pg_log_error("pg_control CRC value is incorrect in backup \"%s\"",
+					 backup->dir);
+		exit(1);
+	}
+	if (control_file->pg_control_version != PG_CONTROL_VERSION)
+	{
+		pg_log_error("backup \"%s\" is not compatible with this version of pg_combinebackup",
+					 backup->dir);
+		exit(1);
+	}
+	if (control_file->blcksz != BLCKSZ || control_file->relseg_size != RELSEG_SIZE)
+	{
+		pg_log_error("backup \"%s\" is not compatible with this version of pg_combinebackup",
+					 backup->dir);
+		fprintf(stderr, _("The database cluster was initialized with block size %u and segment size %u, but pg_combinebackup was compiled with block size %u and segment size %u.\n"),
+				control_file->blcksz, control_file->relseg_size,
+				BLCKSZ, RELSEG_SIZE);
+		exit(1);
+	}
+	backup->system_identifier = control_file->system_identifier;
+	pg_free(control_file);
+}
+
+/*
+ * Check that the backups form a chain: the first one is a full backup, and
+ * each of the others was taken incrementally relative to the one before it.
+ */
+static void
+check_backup_chain(void)
+{
+	int			i;
+
+	if (!XLogRecPtrIsInvalid(backups[0].incremental_from))
+	{
+		pg_log_error("backup \"%s\" is an incremental backup, but the first backup must be a full backup",
+					 backups[0].dir);
+		exit(1);
+	}
+
+	for (i = 1; i < nbackups; i++)
+	{
+		if (backups[i].system_identifier != backups[0].system_identifier)
+		{
+			pg_log_error("backup \"%s\" is from a different system than backup \"%s\"",
+						 backups[i].dir, backups[0].dir);
+			exit(1);
+		}
+
+		if (XLogRecPtrIsInvalid(backups[i].incremental_from))
+		{
+			pg_log_error("backup \"%s\" is a full backup, but only the first backup may be a full backup",
+						 backups[i].dir);
+			exit(1);
+		}
+
+		if (backups[i].incremental_from != backups[i - 1].start_lsn)
+		{
+			pg_log_error("backup \"%s\" is based on the backup starting at %X/%X, but backup \"%s\" starts at %X/%X",
+						 backups[i].dir,
+						 (uint32) (backups[i].incremental_from >> 32),
+						 (uint32) backups[i].incremental_from,
+						 backups[i - 1].dir,
+						 (uint32) (backups[i - 1].start_lsn >> 32),
+						 (uint32) backups[i - 1].start_lsn);
+			exit(1);
+		}
+	}
+}
+
+/*
+ * Create a directory that must not exist yet, or be empty.
+ */
+static void
+create_output_directory(char *dir)
+{
+	switch (pg_check_dir(dir))
+	{
+		case 0:
+			if (pg_mkdir_p(dir, pg_dir_create_mode) == -1)
+			{
+				pg_log_error("could not create directory \"%s\": %m", dir);
+				exit(1);
+			}
+			break;
+		case 1:
+			/* Exists and is empty; fix permissions */
+			if (chmod(dir, pg_dir_create_mode) != 0)
+			{
+				pg_log_error("could not change permissions of directory \"%s\": %m",
+							 dir);
+				exit(1);
+			}
+			break;
+		case 2:
+		case 3:
+		case 4:
+			pg_log_error("directory \"%s\" exists but is not empty", dir);
+			exit(1);
+		case -1:
+			pg_log_error("could not access directory \"%s\": %m", dir);
+			exit(1);
+	}
+}
+
+/*
+ * Reconstruct the directory 'relpath' (relative to the top of the backups)
+ * in the output directory, using the newest backup as the list of files.
+ */
+static void
+process_directory(const char *relpath)
+{
+	const char *newest = backups[nbackups - 1].dir;
+	char		srcdir[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *de;
+
+	if (*relpath == '\0')
+		strlcpy(srcdir, newest, sizeof(srcdir));
+	else
+		snprintf(srcdir, sizeof(srcdir), "%s/%s", newest, relpath);
+
+	dir = opendir(srcdir);
+	if (dir == NULL)
+	{
+		pg_log_error("could not open directory \"%s\": %m", srcdir);
+		exit(1);
+	}
+
+	while (errno = 0, (de = readdir(dir)) != NULL)
+	{
+		char		childrel[MAXPGPATH];
+		char		srcpath[MAXPGPATH];
+		char		dstpath[MAXPGPATH];
+		struct stat st;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		if (*relpath == '\0')
+			strlcpy(childrel, de->d_name, sizeof(childrel));
+		else
+			snprintf(childrel, sizeof(childrel), "%s/%s", relpath, de->d_name);
+		snprintf(srcpath, sizeof(srcpath), "%s/%s", newest, childrel);
+		snprintf(dstpath, sizeof(dstpath), "%s/%s", output_dir, childrel);
+
+		if (lstat(srcpath, &st) < 0)
+		{
+			pg_log_error("could not stat file \"%s\": %m", srcpath);
+			exit(1);
+		}
+
+#ifndef WIN32
+		if (S_ISLNK(st.st_mode))
+#else
+		if (pgwin32_is_junction(srcpath))
+#endif
+		{
+			if (strcmp(relpath, "pg_tblspc") == 0)
+			{
+				process_tablespace_link(childrel, srcpath);
+				continue;
+			}
+
+			/* Other links, like pg_wal, are reconstructed as directories */
+			if (stat(srcpath, &st) < 0)
+			{
+				pg_log_error("could not stat file \"%s\": %m", srcpath);
+				exit(1);
+			}
+		}
+
+		if (S_ISDIR(st.st_mode))
+		{
+			if (mkdir(dstpath, pg_dir_create_mode) != 0)
+			{
+				pg_log_error("could not create directory \"%s\": %m", dstpath);
+				exit(1);
+			}
+			process_directory(childrel);
+		}
+		else if (S_ISREG(st.st_mode))
+		{
+			if (strncmp(de->d_name, INCREMENTAL_PREFIX,
+						INCREMENTAL_PREFIX_LENGTH) == 0)
+				reconstruct_file(relpath, de->d_name + INCREMENTAL_PREFIX_LENGTH);
+			else if (strcmp(childrel, "backup_label") == 0)
+				write_backup_label(srcpath, dstpath);
+			else
+				copy_file(srcpath, dstpath);
+		}
+		else
+			pg_log_warning("skipping special file \"%s\"", srcpath);
+	}
+
+	if (errno)
+	{
+		pg_log_error("could not read directory \"%s\": %m", srcdir);
+		exit(1);
+	}
+
+	if (closedir(dir))
+	{
+		pg_log_error("could not close directory \"%s\": %m", srcdir);
+		exit(1);
+	}
+}
+
+/*
+ * Reconstruct a tablespace.  It must be relocated with -T, since the
+ * location used by the newest backup is already taken by that backup.
+ */
+static void
+process_tablespace_link(const char *relpath, const char *srcpath)
+{
+	char		linkpath[MAXPGPATH];
+	char		dstpath[MAXPGPATH];
+	char	   *newpath;
+	const char *mapped;
+	int			rllen;
+
+	rllen = readlink(srcpath, linkpath, sizeof(linkpath));
+	if (rllen < 0)
+	{
+		pg_log_error("could not read symbolic link \"%s\": %m", srcpath);
+		exit(1);
+	}
+	if (rllen >= sizeof(linkpath))
+	{
+		pg_log_error("symbolic link \"%s\" target is too long", srcpath);
+		exit(1);
+	}
+	linkpath[rllen] = '\0';
+
+	mapped = get_tablespace_mapping(linkpath);
+	if (mapped == NULL)
+	{
+		pg_log_error("tablespace in directory \"%s\" must be relocated with -T",
+					 linkpath);
+		exit(1);
+	}
+
+	newpath = pg_strdup(mapped);
+	create_output_directory(newpath);
+
+	snprintf(dstpath, sizeof(dstpath), "%s/%s", output_dir, relpath);
+	if (symlink(newpath, dstpath) != 0)
+	{
+		pg_log_error("could not create symbolic link from \"%s\" to \"%s\": %m",
+					 dstpath, newpath);
+		exit(1);
+	}
+	pg_free(newpath);
+
+	process_directory(relpath);
+}
+
+/*
+ * Copy a file that the newest backup contains in full.
+ */
+static void
+copy_file(const char *srcpath, const char *dstpath)
+{
+	char		buf[65536];
+	int			srcfd;
+	int			dstfd;
+	int			rb;
+
+	if ((srcfd = open(srcpath, O_RDONLY | PG_BINARY, 0)) < 0)
+	{
+		pg_log_error("could not open file \"%s\" for reading: %m", srcpath);
+		exit(1);
+	}
+	if ((dstfd = open(dstpath, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY,
+					  pg_file_create_mode)) < 0)
+	{
+		pg_log_error("could not create file \"%s\": %m", dstpath);
+		exit(1);
+	}
+
+	while ((rb = read(srcfd, buf, sizeof(buf))) > 0)
+	{
+		errno = 0;
+		if (write(dstfd, buf, rb) != rb)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (errno == 0)
+				errno = ENOSPC;
+			pg_log_error("could not write file \"%s\": %m", dstpath);
+			exit(1);
+		}
+	}
+	if (rb < 0)
+	{
+		pg_log_error("could not read file \"%s\": %m", srcpath);
+		exit(1);
+	}
+
+	close(srcfd);
+	if (close(dstfd) != 0)
+	{
+		pg_log_error("could not close file \"%s\": %m", dstpath);
+		exit(1);
+	}
+
+	files_copied++;
+}
+
+/*
+ * Copy the newest backup's backup_label, without the line that marks it as
+ * an incremental backup.
+ */
+static void
+write_backup_label(const char *srcpath, const char *dstpath)
+{
+	char	   *label;
+	char	   *line;
+	size_t		len;
+	FILE	   *fp;
+
+	label = slurp_file(srcpath, &len);
+
+	fp = fopen(dstpath, PG_BINARY_W);
+	if (fp == NULL)
+	{
+		pg_log_error("could not create file \"%s\": %m", dstpath);
+		exit(1);
+	}
+
+	for (line = label; line != NULL && *line != '\0';)
+	{
+		char	   *next = strchr(line, '\n');
+
+		if (next != NULL)
+			*next++ = '\0';
+
+		if (strncmp(line, INCREMENTAL_LABEL_LINE,
+					strlen(INCREMENTAL_LABEL_LINE)) != 0)
+			fprintf(fp, "%s\n", line);
+
+		line = next;
+	}
+
+	if (fclose(fp) != 0)
+	{
+		pg_log_error("could not write file \"%s\": %m", dstpath);
+		exit(1);
+	}
+	pg_free(label);
+}
+
+/*
+ * Open an incremental file and read its header and block numbers.  Returns
+ * false if the file doesn't exist.  The file is left open in *fd.
+ */
+static bool
+read_incremental_header(const char *path, int *fd, IncrementalFileHeader *hdr,
+						BlockNumber **blocknums)
+{
+	struct stat st;
+	size_t		arraysize;
+	int			rb;
+
+	if ((*fd = open(path, O_RDONLY | PG_BINARY, 0)) < 0)
+	{
+		if (errno == ENOENT)
+			return false;
+		pg_log_error("could not open file \"%s\" for reading: %m", path);
+		exit(1);
+	}
+
+	rb = read(*fd, hdr, sizeof(IncrementalFileHeader));
+	if (rb != sizeof(IncrementalFileHeader))
+	{
+		if (rb < 0)
+			pg_log_error("could not read file \"%s\": %m", path);
+		else
+			pg_log_error("could not read file \"%s\": read %d of %zu",
+						 path, rb, sizeof(IncrementalFileHeader));
+		exit(1);
+	}
+
+	if (hdr->magic != INCREMENTAL_MAGIC ||
+		hdr->nblocks > RELSEG_SIZE ||
+		hdr->truncation_block_length > RELSEG_SIZE ||
+		fstat(*fd, &st) < 0 ||
+		st.st_size != sizeof(IncrementalFileHeader) +
+		(off_t) hdr->nblocks * (sizeof(BlockNumber) + BLCKSZ))
+	{
+		pg_log_error("file \"%s\" is not a valid incremental file", path);
+		exit(1);
+	}
+
+	arraysize = sizeof(BlockNumber) * hdr->nblocks;
+	*blocknums = pg_malloc(Max(arraysize, 1));
+	rb = read(*fd, *blocknums, arraysize);
+	if (rb != arraysize)
+	{
+		if (rb < 0)
+			pg_log_error("could not read file \"%s\": %m", path);
+		else
+			pg_log_error("could not read file \"%s\": read %d of %zu",
+						 path, rb, arraysize);
+		exit(1);
+	}
+
+	return true;
+}
+
+/*
+ * Reconstruct relation segment 'filename' in directory 'reldir', which the
+ * newest backup has only incrementally.
+ *
+ * Each block is taken from the newest backup that contains it, going back
+ * until a backup that contains the whole file.  A block that none of the
+ * backups contain didn't exist as of the oldest backup that still had the
+ * file, nor was it modified since, so it must be all zeroes; the same goes
+ * for a file that went missing in an older backup.
+ */
+static void
+reconstruct_file(const char *reldir, const char *filename)
+{
+	int		   *fds;
+	int		   *source;
+	off_t	   *offset;
+	BlockNumber truncation_block_length = 0;
+	BlockNumber limit = 0;
+	BlockNumber blkno;
+	char		dstpath[MAXPGPATH];
+	int			dstfd;
+	int			i;
+	PGAlignedBlock buf;
+
+	fds = pg_malloc(sizeof(int) * nbackups);
+	for (i = 0; i < nbackups; i++)
+		fds[i] = -1;
+	source = NULL;
+	offset = NULL;
+
+	for (i = nbackups - 1; i >= 0; i--)
+	{
+		char		path[MAXPGPATH];
+		IncrementalFileHeader hdr;
+		BlockNumber *blocknums;
+		struct stat st;
+		uint32		j;
+
+		snprintf(path, sizeof(path), "%s/%s%s%s%s", backups[i].dir,
+				 reldir, *reldir ? "/" : "", INCREMENTAL_PREFIX, filename);
+		if (read_incremental_header(path, &fds[i], &hdr, &blocknums))
+		{
+			if (i == 0)
+			{
+				pg_log_error("full backup \"%s\" contains incremental file \"%s\"",
+							 backups[i].dir, path);
+				exit(1);
+			}
+
+			/* The newest backup determines the length of the result */
+			if (i == nbackups - 1)
+			{
+				truncation_block_length = limit = hdr.truncation_block_length;
+				source = pg_malloc(sizeof(int) * Max(limit, 1));
+				offset = pg_malloc(sizeof(off_t) * Max(limit, 1));
+				for (blkno = 0; blkno < limit; blkno++)
+					source[blkno] = -1;
+			}
+
+			for (j = 0; j < hdr.nblocks; j++)
+			{
+				if (blocknums[j] < limit && source[blocknums[j]] < 0)
+				{
+					source[blocknums[j]] = i;
+					offset[blocknums[j]] = sizeof(IncrementalFileHeader) +
+						sizeof(BlockNumber) * hdr.nblocks +
+						(off_t) BLCKSZ * j;
+				}
+			}
+			pg_free(blocknums);
+
+			/*
+			 * Blocks beyond the length the file had back then didn't exist
+			 * in any older backup either.
+			 */
+			limit = Min(limit, hdr.truncation_block_length);
+			continue;
+		}
+
+		/* No incremental file, so look for the full one */
+		snprintf(path, sizeof(path), "%s/%s%s%s", backups[i].dir,
+				 reldir, *reldir ? "/" : "", filename);
+		if ((fds[i] = open(path, O_RDONLY | PG_BINARY, 0)) < 0)
+		{
+			if (errno == ENOENT)
+				break;
+			pg_log_error("could not open file \"%s\" for reading: %m", path);
+			exit(1);
+		}
+		if (fstat(fds[i], &st) < 0)
+		{
+			pg_log_error("could not stat file \"%s\": %m", path);
+			exit(1);
+		}
+
+		limit = Min(limit, st.st_size / BLCKSZ);
+		for (blkno = 0; blkno < limit; blkno++)
+		{
+			if (source[blkno] < 0)
+			{
+				source[blkno] = i;
+				offset[blkno] = (off_t) BLCKSZ * blkno;
+			}
+		}
+		break;
+	}
+
+	snprintf(dstpath, sizeof(dstpath), "%s/%s%s%s", output_dir,
+			 reldir, *reldir ? "/" : "", filename);
+	if ((dstfd = open(dstpath, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY,
+					  pg_file_create_mode)) < 0)
+	{
+		pg_log_error("could not create file \"%s\": %m", dstpath);
+		exit(1);
+	}
+
+	for (blkno = 0; blkno < truncation_block_length; blkno++)
+	{
+		if (source[blkno] < 0)
+			memset(buf.data, 0, BLCKSZ);
+		else
+		{
+			int			rb;
+
+			rb = pg_pread(fds[source[blkno]], buf.data, BLCKSZ,
+						  offset[blkno]);
+			if (rb != BLCKSZ)
+			{
+				if (rb < 0)
+					pg_log_error("could not read block %u of file \"%s\" in backup \"%s\": %m",
+								 blkno, filename, backups[source[blkno]].dir);
+				else
+					pg_log_error("could not read block %u of file \"%s\" in backup \"%s\": read %d of %d",
+								 blkno, filename, backups[source[blkno]].dir,
+								 rb, BLCKSZ);
+				exit(1);
+			}
+		}
+
+		errno = 0;
+		if (write(dstfd, buf.data, BLCKSZ) != BLCKSZ)
+		{
+			/* if write didn't set errno, assume problem is no disk space */
+			if (errno == 0)
+				errno = ENOSPC;
+			pg_log_error("could not write file \"%s\": %m", dstpath);
+			exit(1);
+		}
+	}
+
+	if (close(dstfd) != 0)
+	{
+		pg_log_error("could not close file \"%s\": %m", dstpath);
+		exit(1);
+	}
+	for (i = 0; i < nbackups; i++)
+		if (fds[i] >= 0)
+			close(fds[i]);
+
+	pg_free(fds);
+	pg_free(source);
+	pg_free(offset);
+
+	files_reconstructed++;
+}
+
+int
+main(int argc, char *argv[])
+{
+	static struct option long_options[] = {
+		{"output", required_argument, NULL, 'o'},
+		{"tablespace-mapping", required_argument, NULL, 'T'},
+		{"no-sync", no_argument, NULL, 'N'},
+		{"verbose", no_argument, NULL, 'v'},
+		{NULL, 0, NULL, 0}
+	};
+
+	int			c;
+	int			option_index;
+	int			i;
+
+	pg_logging_init(argv[0]);
+	set_pglocale_pgservice(argv[0], PG_TEXTDOMAIN("pg_combinebackup"));
+	progname = get_progname(argv[0]);
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+		{
+			usage();
+			exit(0);
+		}
+		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
+		{
+			puts("pg_combinebackup (PostgreSQL) " PG_VERSION);
+			exit(0);
+		}
+	}
+
+	while ((c = getopt_long(argc, argv, "o:T:Nv", long_options, &option_index)) != -1)
+	{
+		switch (c)
+		{
+			case 'o':
+				output_dir = pg_strdup(optarg);
+				break;
+			case 'T':
+				tablespace_list_append(optarg);
+				break;
+			case 'N':
+				do_sync = false;
+				break;
+			case 'v':
+				verbose = true;
+				break;
+			default:
+				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
+				exit(1);
+		}
+	}
+
+	if (optind >= argc)
+	{
+		pg_log_error("no backup directories specified");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
+		exit(1);
+	}
+
+	if (output_dir == NULL)
+	{
+		pg_log_error("no output directory specified");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
+		exit(1);
+	}
+	canonicalize_path(output_dir);
+
+	nbackups = argc - optind;
+	backups = pg_malloc0(sizeof(BackupInfo) * nbackups);
+	for (i = 0; i < nbackups; i++)
+	{
+		backups[i].dir = pg_strdup(argv[optind + i]);
+		canonicalize_path(backups[i].dir);
+		read_backup_info(&backups[i]);
+	}
+	check_backup_chain();
+
+	create_output_directory(output_dir);
+	process_directory("");
+
+	if (do_sync)
+	{
+		if (verbose)
+			pg_log_info("syncing data to disk");
+		fsync_pgdata(output_dir, PG_VERSION_NUM);
+	}
+
+	if (verbose)
+		pg_log_info("%s files copied, %s files reconstructed",
+					psprintf(INT64_FORMAT, files_copied),
+					psprintf(INT64_FORMAT, files_reconstructed));
+
+	return 0;
+}
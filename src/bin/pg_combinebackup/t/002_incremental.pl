@@ -0,0 +1,107 @@
+# Take a full backup and a chain of incremental backups, combine them, and
+# check that a server started from the result sees the latest data.
+
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 12;
+
+my $node = get_new_node('main');
+$node->init(allows_streaming => 1);
+$node->append_conf('postgresql.conf', 'wal_keep_segments = 64');
+$node->start;
+
+my $backupdir = $node->backup_dir;
+
+$node->safe_psql(
+	'postgres', q{
+	CREATE TABLE t1 (a int, b text) WITH (autovacuum_enabled = off);
+	INSERT INTO t1 SELECT g, 'initial' FROM generate_series(1, 20000) g;
+	CREATE TABLE t2 (a int) WITH (autovacuum_enabled = off);
+	INSERT INTO t2 SELECT generate_series(1, 10000);
+});
+
+$node->command_ok(
+	[ 'pg_basebackup', '-D', "$backupdir/full", '--no-sync', '-c', 'fast' ],
+	'full backup');
+
+$node->command_fails(
+	[
+		'pg_basebackup', '-D', "$backupdir/bogus", '--no-sync',
+		'--incremental', "$backupdir/nonexistent"
+	],
+	'incremental backup fails without a reference backup');
+
+$node->safe_psql(
+	'postgres', q{
+	UPDATE t1 SET b = 'updated' WHERE a % 1000 = 0;
+	TRUNCATE t2;
+	INSERT INTO t2 SELECT generate_series(1, 100);
+	CREATE TABLE t3 AS SELECT generate_series(1, 1000) AS a;
+});
+
+$node->command_ok(
+	[
+		'pg_basebackup', '-D', "$backupdir/incr1", '--no-sync', '-c', 'fast',
+		'--incremental', "$backupdir/full"
+	],
+	'first incremental backup');
+
+like(
+	slurp_file("$backupdir/incr1/backup_label"),
+	qr/^INCREMENTAL FROM LSN: /m,
+	'backup_label of incremental backup is marked');
+
+my $t1path = $node->safe_psql('postgres', q{SELECT pg_relation_filepath('t1')});
+my $t3path = $node->safe_psql('postgres', q{SELECT pg_relation_filepath('t3')});
+my ($t1dir, $t1file) = $t1path =~ m{^(.*)/([^/]*)$};
+
+ok(-f "$backupdir/incr1/$t1dir/INCREMENTAL.$t1file",
+	'modified relation is sent incrementally');
+ok(!-f "$backupdir/incr1/$t1path", 'modified relation is not sent in full');
+ok(-f "$backupdir/incr1/$t3path", 'new relation is sent in full');
+
+$node->safe_psql(
+	'postgres', q{
+	DELETE FROM t1 WHERE a > 15000;
+	INSERT INTO t1 SELECT g, 'added' FROM generate_series(20001, 20500) g;
+	INSERT INTO t3 SELECT generate_series(1001, 2000);
+});
+
+$node->command_ok(
+	[
+		'pg_basebackup', '-D', "$backupdir/incr2", '--no-sync', '-c', 'fast',
+		'--incremental', "$backupdir/incr1"
+	],
+	'second incremental backup');
+
+my $query = q{
+	SELECT (SELECT count(*) || ':' || sum(a) || ':' || count(*) FILTER (WHERE b = 'updated') FROM t1),
+		   (SELECT count(*) FROM t2),
+		   (SELECT sum(a) FROM t3)};
+my $expected = $node->safe_psql('postgres', $query);
+
+$node->command_fails(
+	[
+		'pg_combinebackup', '-o', "$backupdir/wrongorder",
+		"$backupdir/full", "$backupdir/incr2", "$backupdir/incr1"
+	],
+	'pg_combinebackup fails with backups out of order');
+
+$node->command_ok(
+	[
+		'pg_combinebackup', '-N', '-o', "$backupdir/combined",
+		"$backupdir/full", "$backupdir/incr1", "$backupdir/incr2"
+	],
+	'pg_combinebackup succeeds');
+
+ok(!-f "$backupdir/combined/$t1dir/INCREMENTAL.$t1file",
+	'combined backup contains no incremental files');
+
+my $restored = get_new_node('restored');
+$restored->init_from_backup($node, 'combined');
+$restored->start;
+
+is($restored->safe_psql('postgres', $query),
+	$expected, 'server started from combined backup sees the latest data');
@@ -26,7 +26,7 @@
  * RmgrNames is an array of resource manager names, to make error messages
  * a bit nicer.
  */
-#define PG_RMGR(symname,name,redo,desc,identify,startup,cleanup,mask) \
+#define PG_RMGR(symname,name,redo,desc,identify,startup,cleanup,mask,parallel_safe) \
   name,
 
 static const char *RmgrNames[RM_MAX_ID + 1] = {
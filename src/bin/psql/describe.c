@@ -5959,6 +5959,14 @@ describeSubscriptions(const char *pattern, bool verbose)
 
 	if (verbose)
 	{
+		/* Binary mode and streaming are only supported in v13+ */
+		if (pset.sversion >= 130000)
+			appendPQExpBuffer(&buf,
+							  ",  subbinary AS \"%s\"\n"
+							  ",  substream AS \"%s\"\n",
+							  gettext_noop("Binary"),
+							  gettext_noop("Streaming"));
+
 		appendPQExpBuffer(&buf,
 						  ",  subsynccommit AS \"%s\"\n"
 						  ",  subconninfo AS \"%s\"\n",
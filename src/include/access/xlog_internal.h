@@ -31,7 +31,7 @@
 /*
  * Each page of XLOG file has a header like this:
  */
-#define XLOG_PAGE_MAGIC 0xD102	/* can be used as WAL version indicator */
+#define XLOG_PAGE_MAGIC 0xD105	/* can be used as WAL version indicator */
 
 typedef struct XLogPageHeaderData
 {
@@ -288,6 +288,12 @@ typedef enum
  * rm_mask takes as input a page modified by the resource manager and masks
  * out bits that shouldn't be flagged by wal_consistency_checking.
  *
+ * rm_parallel_safe, if provided, returns true for records that may be
+ * replayed by a redo worker concurrently with records that don't touch the
+ * same blocks.  Such records must only modify the pages of their registered
+ * blocks (plus visibility map and FSM pages, which are locked as usual), and
+ * must not wait for or resolve recovery conflicts.  See xlogredoworker.c.
+ *
  * RmgrTable[] is indexed by RmgrId values (see rmgrlist.h).
  */
 typedef struct RmgrData
@@ -299,10 +305,13 @@ typedef struct RmgrData
 	void		(*rm_startup) (void);
 	void		(*rm_cleanup) (void);
 	void		(*rm_mask) (char *pagedata, BlockNumber blkno);
+	bool		(*rm_parallel_safe) (XLogReaderState *record);
 } RmgrData;
 
 extern const RmgrData RmgrTable[];
 
+extern void rm_redo_error_callback(void *arg);
+
 /*
  * Exported to support xlog switching from checkpointer
  */
@@ -0,0 +1,35 @@
+/*
+ * xlogprefetch.h
+ *
+ * Prefetching of data blocks referenced by upcoming WAL records during
+ * recovery.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/xlogprefetch.h
+ */
+#ifndef XLOGPREFETCH_H
+#define XLOGPREFETCH_H
+
+#include "access/xlogdefs.h"
+
+/* GUCs */
+extern bool recovery_prefetch;
+extern int	recovery_prefetch_distance;
+
+struct XLogPrefetcher;
+typedef struct XLogPrefetcher XLogPrefetcher;
+
+extern Size XLogPrefetchShmemSize(void);
+extern void XLogPrefetchShmemInit(void);
+
+extern void XLogPrefetchRequestReset(void);
+
+extern XLogPrefetcher *XLogPrefetcherAllocate(XLogRecPtr lsn, TimeLineID tli);
+extern void XLogPrefetcherFree(XLogPrefetcher *prefetcher);
+extern void XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher,
+									XLogRecPtr replaying_lsn,
+									TimeLineID tli);
+
+#endif							/* XLOGPREFETCH_H */
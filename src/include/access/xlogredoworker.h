@@ -0,0 +1,28 @@
+/*
+ * xlogredoworker.h
+ *
+ * Parallel replay of WAL records by redo workers.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/xlogredoworker.h
+ */
+#ifndef XLOGREDOWORKER_H
+#define XLOGREDOWORKER_H
+
+#include "access/xlogreader.h"
+
+/* GUCs */
+extern int	max_redo_workers;
+
+/* Is this process a redo worker? */
+extern bool am_redo_worker;
+
+extern bool RedoWorkersDispatch(XLogReaderState *record);
+extern void RedoWorkersWaitAll(void);
+extern void RedoWorkersShutdown(void);
+
+extern void RedoWorkerMain(Datum main_arg);
+
+#endif							/* XLOGREDOWORKER_H */
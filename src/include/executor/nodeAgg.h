@@ -280,6 +280,19 @@ typedef struct AggStatePerPhaseData
 	Sort	   *sortnode;		/* Sort node for input ordering for phase */
 
 	ExprState  *evaltrans;		/* evaluation of transition functions  */
+
+	/*----------
+	 * Cached variants of the transition function expression.
+	 *   evaltrans_cache[0][0]: outer slot type, no per-group NULL check
+	 *   evaltrans_cache[0][1]: outer slot type, with per-group NULL check
+	 *   evaltrans_cache[1][1]: minimal tuple slot (spilled input), hashed
+	 *                          grouping sets only, with per-group NULL check
+	 *
+	 * Hash aggregation switches between these when it starts spilling, and
+	 * when it reads spilled tuples back in.
+	 *----------
+	 */
+	ExprState  *evaltrans_cache[2][2];
 }			AggStatePerPhaseData;
 
 /*
@@ -310,5 +323,8 @@ extern void ExecEndAgg(AggState *node);
 extern void ExecReScanAgg(AggState *node);
 
 extern Size hash_agg_entry_size(int numAggs);
+extern void hash_agg_set_limits(double hashentrysize, double input_groups,
+								int used_bits, Size *mem_limit,
+								int *num_partitions);
 
 #endif							/* NODEAGG_H */
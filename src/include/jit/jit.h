@@ -29,6 +29,12 @@ typedef struct JitInstrumentation
 	/* number of emitted functions */
 	size_t		created_functions;
 
+	/* number of functions whose code was found in the code cache */
+	size_t		cached_functions;
+
+	/* number of functions evicted from the code cache */
+	size_t		evicted_functions;
+
 	/* accumulated time to generate code */
 	instr_time	generation_counter;
 
@@ -89,6 +95,8 @@ extern bool jit_tuple_deforming;
 extern double jit_above_cost;
 extern double jit_inline_above_cost;
 extern double jit_optimize_above_cost;
+extern int	jit_cache_size;
+extern int	jit_warmup_evaluations;
 
 
 extern void jit_reset_after_error(void);
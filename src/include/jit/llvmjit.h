@@ -33,6 +33,7 @@ extern "C"
 #include "access/tupdesc.h"
 #include "fmgr.h"
 #include "jit/jit.h"
+#include "lib/stringinfo.h"
 #include "nodes/pg_list.h"
 
 typedef struct LLVMJitContext
@@ -53,8 +54,14 @@ typedef struct LLVMJitContext
 
 	/* list of handles for code emitted via Orc */
 	List	   *handles;
+
+	/* list of code cache entries pinned by this context */
+	List	   *cache_entries;
 } LLVMJitContext;
 
+/* entry in the backend-local cache of emitted code, see llvmjit.c */
+typedef struct LLVMJitCacheEntry LLVMJitCacheEntry;
+
 
 /* type and struct definitions */
 extern LLVMTypeRef TypeParamBool;
@@ -105,6 +112,12 @@ extern LLVMValueRef llvm_function_reference(LLVMJitContext *context,
 						LLVMBuilderRef builder,
 						LLVMModuleRef mod,
 						FunctionCallInfo fcinfo);
+extern LLVMJitCacheEntry *llvm_cache_module(LLVMJitContext *context,
+											StringInfo key,
+											LLVMModuleRef mod,
+											const char *funcname);
+extern void *llvm_cache_get_function(LLVMJitContext *context,
+									 LLVMJitCacheEntry *entry);
 
 extern void llvm_inline(LLVMModuleRef mod);
 
@@ -17,6 +17,7 @@
 #include "access/tupconvert.h"
 #include "executor/instrument.h"
 #include "fmgr.h"
+#include "lib/ilist.h"
 #include "lib/pairingheap.h"
 #include "nodes/params.h"
 #include "nodes/plannodes.h"
@@ -94,8 +95,17 @@ typedef struct ExprState
 	Expr	   *expr;
 
 	/* private state for an evalfunc */
+#define FIELDNO_EXPRSTATE_EVALFUNC_PRIVATE 8
 	void	   *evalfunc_private;
 
+	/*
+	 * For expressions that are JIT compiled only after a number of
+	 * evaluations: the evaluations left, and the function interpreting the
+	 * expression until then.
+	 */
+	int			warmup_evals_left;
+	ExprStateEvalFunc interp_evalfunc;
+
 	/*
 	 * XXX: following fields only needed during "compilation" (ExecInitExpr);
 	 * could be thrown away afterwards.
@@ -978,6 +988,9 @@ typedef struct PlanState
 	ExprContext *ps_ExprContext;	/* node's expression-evaluation context */
 	ProjectionInfo *ps_ProjInfo;	/* info for doing tuple projection */
 
+	/* expressions waiting to be JIT compiled, see jit_compile_expr() */
+	List	   *jit_warmup_exprs;
+
 	/*
 	 * Scanslot's descriptor if known. This is a bit of a hack, but otherwise
 	 * it's hard for expression compilation to optimize based on the
@@ -1341,6 +1354,14 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	/* these fields are used only if the plan has bloomkeys: */
+	struct HashState *bloom_source; /* Hash node building the filter, if it
+									 * runs in this process */
+	List	   *bloom_keys;		/* list of ExprState nodes */
+	FmgrInfo   *bloom_hashfunctions;	/* outer hash function for each key */
+	Oid		   *bloom_collations;	/* collation for each key */
+	bool	   *bloom_strict;	/* is each key's operator strict? */
+	struct ParallelSeqScanBloom *bloom_shared;	/* filter in parallel DSM */
 } SeqScanState;
 
 /* ----------------
@@ -1972,6 +1993,56 @@ typedef struct MaterialState
 	Tuplestorestate *tuplestorestate;
 } MaterialState;
 
+/* ----------------
+ *	 ResultCacheState information
+ *
+ *		resultcache nodes cache the tuples of the underlying plan for each
+ *		distinct set of parameter values, so that rescans with previously
+ *		seen parameters can be answered from the cache.
+ * ----------------
+ */
+struct ResultCacheEntry;
+struct ResultCacheTuple;
+
+typedef struct ResultCacheInstrumentation
+{
+	uint64		cache_hits;		/* number of rescans where the parameter
+								 * values were found in the cache */
+	uint64		cache_misses;	/* number of rescans where they were not */
+	uint64		cache_evictions;	/* number of entries removed to free
+									 * memory */
+	uint64		cache_overflows;	/* number of times a scan's tuples did
+									 * not fit in the cache at all */
+	uint64		mem_peak;		/* peak memory usage in bytes */
+} ResultCacheInstrumentation;
+
+typedef struct ResultCacheState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	int			rc_status;		/* state of the ExecResultCache machine */
+	int			nkeys;			/* number of cache keys */
+	struct resultcache_hash *hashtable; /* hash table of cache entries */
+	TupleDesc	hashkeydesc;	/* tuple descriptor for cache keys */
+	TupleTableSlot *tableslot;	/* min tuple slot for existing cache keys */
+	TupleTableSlot *probeslot;	/* virtual slot used for hash lookups */
+	ExprState  *cache_eq_expr;	/* compares probeslot to tableslot */
+	ExprState **param_exprs;	/* exprs computing the parameter values */
+	Bitmapset  *keyparamids;	/* PARAM_EXEC ids used by param_exprs */
+	FmgrInfo   *hashfunctions;	/* hash functions, nkeys in size */
+	Oid		   *collations;		/* collations, nkeys in size */
+	uint64		mem_used;		/* bytes of memory used by the cache */
+	uint64		mem_limit;		/* memory limit in bytes for the cache */
+	MemoryContext tableContext; /* memory context holding the cache */
+	dlist_head	lru_list;		/* entries, least recently used first */
+	struct ResultCacheTuple *last_tuple;	/* last tuple returned on a cache
+											 * hit, or stored while filling */
+	struct ResultCacheEntry *entry; /* entry 'last_tuple' belongs to, or NULL */
+	bool		singlerow;		/* mark entries complete after the first
+								 * tuple? */
+	bool		binary_mode;	/* compare keys by their binary images? */
+	ResultCacheInstrumentation stats;	/* execution statistics */
+} ResultCacheState;
+
 /* ----------------
  *	 Shared memory container for per-worker sort information
  * ----------------
@@ -2000,6 +2071,61 @@ typedef struct SortState
 	SharedSortInfo *shared_info;	/* one entry per worker */
 } SortState;
 
+/* ----------------
+ *	 Instrumentation information for IncrementalSort
+ *
+ * Space figures are in kB; sortMethods is a bitmask of (1 << TuplesortMethod)
+ * values for every method used by any of the group sorts.
+ * ----------------
+ */
+typedef struct IncrementalSortInfo
+{
+	int64		groupCount;		/* number of sort batches performed */
+	long		maxDiskSpaceUsed;
+	long		totalDiskSpaceUsed;
+	long		maxMemorySpaceUsed;
+	long		totalMemorySpaceUsed;
+	bits32		sortMethods;
+} IncrementalSortInfo;
+
+/* ----------------
+ *	 Shared memory container for per-worker incremental sort information
+ * ----------------
+ */
+typedef struct SharedIncrementalSortInfo
+{
+	int			num_workers;
+	IncrementalSortInfo sinfo[FLEXIBLE_ARRAY_MEMBER];
+} SharedIncrementalSortInfo;
+
+/* ----------------
+ *	 IncrementalSortState information
+ * ----------------
+ */
+typedef enum
+{
+	INCSORT_LOADTUPLES,			/* loading the next batch into the sort */
+	INCSORT_READTUPLES			/* returning tuples from a sorted batch */
+} IncrementalSortExecutionStatus;
+
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	int64		bound_Done;		/* number of tuples returned so far */
+	bool		outerNodeDone;	/* finished fetching tuples from outer node */
+	IncrementalSortExecutionStatus execution_status;
+	void	   *tuplesortstate; /* private state of tuplesort.c */
+	TupleTableSlot *group_pivot;	/* tuple whose presorted keys close the
+									 * current batch */
+	TupleTableSlot *transfer_tuple; /* first tuple of the next batch */
+	ExprState  *presorted_eq;	/* equality test on presorted columns */
+	IncrementalSortInfo incsort_info;	/* instrumentation */
+	bool		am_worker;		/* are we a worker? */
+	SharedIncrementalSortInfo *shared_info; /* one entry per worker */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * ---------------------
@@ -2074,9 +2200,24 @@ typedef struct AggState
 	AggStatePerHash perhash;	/* array of per-hashtable data */
 	AggStatePerGroup *hash_pergroup;	/* grouping set indexed array of
 										 * per-group pointers */
+	MemoryContext hash_metacxt; /* memory for hash table bucket arrays */
+	struct HashAggSpill *hash_spills;	/* HashAggSpill for each grouping set,
+										 * exists only during first pass */
+	TupleTableSlot *hash_spill_slot;	/* for reading spill files */
+	List	   *hash_batches;	/* hash batches remaining to be processed */
+	bool		hash_ever_spilled;	/* ever spilled during this execution? */
+	bool		hash_spill_mode;	/* we hit a limit during the current batch
+									 * and we must not create new groups */
+	Size		hash_mem_limit; /* limit before spilling hash table */
+	Size		hash_mem_peak;	/* peak hash table memory usage */
+	double		hashentrysize;	/* estimated size of one hash table entry */
+	uint64		hash_ngroups_current;	/* number of groups currently in
+										 * memory in all hash tables */
+	uint64		hash_disk_used; /* kB of disk space written to spill files */
+	int			hash_batches_used;	/* batches used during entire execution */
 
 	/* support for evaluation of agg input expressions: */
-#define FIELDNO_AGGSTATE_ALL_PERGROUPS 34
+#define FIELDNO_AGGSTATE_ALL_PERGROUPS 46
 	AggStatePerGroup *all_pergroups;	/* array of first ->pergroups, than
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
@@ -2276,6 +2417,10 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	/* Bloom filter over the hash values, if an outer scan can use it */
+	bool		build_bloom;	/* build the filter? */
+	struct bloom_filter *bloom; /* the filter, once built */
 } HashState;
 
 /* ----------------
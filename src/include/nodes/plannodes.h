@@ -343,9 +343,21 @@ typedef struct Scan
 
 /* ----------------
  *		sequential scan node
+ *
+ * If bloomkeys isn't NIL, the scan is the outer (probe) side of a hash join,
+ * and may skip tuples that the Bloom filter built by the join's Hash node
+ * shows to have no join partner.  bloomkeys are the join's outer hash keys,
+ * and bloomoperators and bloomcollations the corresponding hash operators
+ * and collations, as in HashJoin.
  * ----------------
  */
-typedef Scan SeqScan;
+typedef struct SeqScan
+{
+	Scan		scan;
+	List	   *bloomkeys;		/* expressions to probe the filter with */
+	List	   *bloomoperators; /* hash operators for each key */
+	List	   *bloomcollations;	/* collations for each key */
+} SeqScan;
 
 /* ----------------
  *		table sample scan node
@@ -756,6 +768,31 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		result cache node
+ *
+ * Caches the rows returned by the subplan for each distinct set of values
+ * of param_exprs, so that rescans with parameter values seen before can
+ * skip executing the subplan.
+ * ----------------
+ */
+typedef struct ResultCache
+{
+	Plan		plan;
+	int			numKeys;		/* size of the two arrays below */
+	Oid		   *hashOperators;	/* hash operators for each key */
+	Oid		   *collations;		/* collations for each key */
+	List	   *param_exprs;	/* exprs containing parameters */
+	bool		binary_mode;	/* true if the keys must be compared bitwise,
+								 * not with the hash operators */
+	bool		singlerow;		/* true if the cache entry should be marked as
+								 * complete after we store the first tuple in
+								 * it. */
+	uint32		est_entries;	/* The maximum number of entries that the
+								 * planner expects will fit in the cache, or 0
+								 * if unknown */
+} ResultCache;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -770,6 +807,20 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ * The input is known to be sorted on the first nPresortedCols sort keys,
+ * so only groups of tuples with equal values in those columns need to be
+ * sorted on the remaining keys.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			nPresortedCols; /* number of presorted columns */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
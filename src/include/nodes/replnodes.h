@@ -45,6 +45,17 @@ typedef struct BaseBackupCmd
 } BaseBackupCmd;
 
 
+/* ----------------------
+ *		STOP_BACKUP command
+ * ----------------------
+ */
+typedef struct StopBackupCmd
+{
+	NodeTag		type;
+	bool		nowait;
+} StopBackupCmd;
+
+
 /* ----------------------
  *		CREATE_REPLICATION_SLOT command
  * ----------------------
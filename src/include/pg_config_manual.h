@@ -157,6 +157,13 @@
 #define USE_PREFETCH
 #endif
 
+/*
+ * Alignment required for buffers used with direct I/O (see io_direct).  The
+ * kernel typically wants I/O buffers aligned to the logical block size of
+ * the underlying device, which is 4kB or less on all common hardware.
+ */
+#define PG_IO_ALIGN_SIZE		4096
+
 /*
  * Default and maximum values for backend_flush_after, bgwriter_flush_after
  * and checkpoint_flush_after; measured in blocks.  Currently, these are
@@ -30,6 +30,7 @@ typedef struct
 } tablespaceinfo;
 
 extern void SendBaseBackup(BaseBackupCmd *cmd);
+extern void SendStopBackup(StopBackupCmd *cmd);
 
 extern int64 sendTablespace(char *path, bool sizeonly);
 
@@ -0,0 +1,68 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_incremental.h
+ *	  Block-level incremental base backups.
+ *
+ * An incremental base backup sends only those blocks of each relation
+ * segment that were modified since the start of an earlier backup, which
+ * are determined by scanning the WAL written in between.  The format of
+ * the files it produces is shared with pg_combinebackup, which
+ * reconstructs a full backup from a chain of incremental ones.
+ *
+ * Portions Copyright (c) 2010-2019, PostgreSQL Global Development Group
+ *
+ * src/include/replication/basebackup_incremental.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BASEBACKUP_INCREMENTAL_H
+#define BASEBACKUP_INCREMENTAL_H
+
+#include "access/xlogdefs.h"
+#include "common/relpath.h"
+#include "nodes/bitmapset.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+/*
+ * A relation segment sent incrementally is stored as a file with this
+ * prefix prepended to the segment's file name.
+ */
+#define INCREMENTAL_PREFIX			"INCREMENTAL."
+#define INCREMENTAL_PREFIX_LENGTH	(sizeof(INCREMENTAL_PREFIX) - 1)
+
+#define INCREMENTAL_MAGIC			0xd3ae1f0d
+
+/*
+ * An incremental file starts with this header, followed by 'nblocks' block
+ * numbers (relative to the start of the segment, in ascending order), and
+ * then the contents of those blocks, in the same order.
+ *
+ * 'truncation_block_length' is the length of the segment, in blocks, at the
+ * time it was backed up.  Blocks below that length that are not included
+ * are to be taken from the backup the incremental one was based on.
+ */
+typedef struct IncrementalFileHeader
+{
+	uint32		magic;
+	uint32		nblocks;
+	uint32		truncation_block_length;
+} IncrementalFileHeader;
+
+/* Line added to the backup_label file of an incremental backup */
+#define INCREMENTAL_LABEL_LINE		"INCREMENTAL FROM LSN: "
+
+#ifndef FRONTEND
+
+struct IncrementalBackupInfo;
+typedef struct IncrementalBackupInfo IncrementalBackupInfo;
+
+extern IncrementalBackupInfo *BuildIncrementalBackupInfo(XLogRecPtr prior_lsn,
+														 XLogRecPtr start_lsn);
+extern bool GetModifiedBlocks(IncrementalBackupInfo *ib,
+							  const RelFileNode *rnode, ForkNumber forknum,
+							  BlockNumber segno, Bitmapset **blocks);
+
+#endif							/* FRONTEND */
+
+#endif							/* BASEBACKUP_INCREMENTAL_H */
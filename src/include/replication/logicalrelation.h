@@ -23,6 +23,8 @@ typedef struct LogicalRepRelMapEntry
 	Relation	localrel;		/* relcache entry */
 	AttrNumber *attrmap;		/* map of local attributes to remote ones */
 	bool		updatable;		/* Can apply updates/deletes? */
+	Bitmapset  *parallel_keys;	/* remote key columns to detect conflicts
+								 * of parallel apply by, or NULL */
 
 	/* Sync state. */
 	char		state;
@@ -35,6 +37,7 @@ extern LogicalRepRelMapEntry *logicalrep_rel_open(LogicalRepRelId remoteid,
 												  LOCKMODE lockmode);
 extern void logicalrep_rel_close(LogicalRepRelMapEntry *rel,
 								 LOCKMODE lockmode);
+extern Bitmapset *logicalrep_rel_parallel_keys(LogicalRepRelId remoteid);
 
 extern void logicalrep_typmap_update(LogicalRepTyp *remotetyp);
 extern char *logicalrep_typmap_gettypname(Oid remoteid);
@@ -25,6 +25,8 @@ typedef struct PGOutputData
 
 	List	   *publication_names;
 	List	   *publications;
+	bool		binary;			/* send values in binary format? */
+	bool		streaming;		/* stream in-progress transactions? */
 } PGOutputData;
 
 #endif							/* PGOUTPUT_H */
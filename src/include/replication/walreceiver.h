@@ -162,6 +162,8 @@ typedef struct
 		{
 			uint32		proto_version;	/* Logical protocol version */
 			List	   *publication_names;	/* String list of publications */
+			bool		binary;		/* Ask publisher to use binary */
+			bool		streaming;	/* Stream in-progress transactions */
 		}			logical;
 	}			proto;
 } WalRcvStreamOptions;
@@ -17,6 +17,7 @@
 #include "access/xlogdefs.h"
 #include "catalog/pg_subscription.h"
 #include "datatype/timestamp.h"
+#include "lib/stringinfo.h"
 #include "storage/lock.h"
 
 typedef struct LogicalRepWorker
@@ -48,6 +49,9 @@ typedef struct LogicalRepWorker
 	XLogRecPtr	relstate_lsn;
 	slock_t		relmutex;
 
+	/* Applies transactions handed over by the subscription's apply worker. */
+	bool		parallel_apply;
+
 	/* Stats. */
 	XLogRecPtr	last_lsn;
 	TimestampTz last_send_time;
@@ -59,11 +63,15 @@ typedef struct LogicalRepWorker
 /* Main memory context for apply worker. Permanent during worker lifetime. */
 extern MemoryContext ApplyContext;
 
+/* Memory context reset after each replication protocol message. */
+extern MemoryContext ApplyMessageContext;
+
 /* libpqreceiver connection */
 extern struct WalReceiverConn *wrconn;
 
 /* Worker and subscription objects. */
 extern Subscription *MySubscription;
+extern bool MySubscriptionValid;
 extern LogicalRepWorker *MyLogicalRepWorker;
 
 extern bool in_remote_transaction;
@@ -85,6 +93,17 @@ extern char *LogicalRepSyncTableStart(XLogRecPtr *origin_startpos);
 void		process_syncing_tables(XLogRecPtr current_lsn);
 void		invalidate_syncing_table_states(Datum arg, int cacheid,
 											uint32 hashvalue);
+extern bool AllTablesyncsReady(void);
+
+extern void apply_dispatch(StringInfo s);
+extern void store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn);
+
+extern bool parallel_apply_dispatch(StringInfo s);
+extern void parallel_apply_reap(void);
+extern bool parallel_apply_in_progress(void);
+extern void parallel_apply_wait_for_turn(void);
+extern void parallel_apply_mark_done(XLogRecPtr remote_end,
+									 XLogRecPtr local_end);
 
 static inline bool
 am_tablesync_worker(void)
@@ -92,4 +111,10 @@ am_tablesync_worker(void)
 	return OidIsValid(MyLogicalRepWorker->relid);
 }
 
+static inline bool
+am_parallel_apply_worker(void)
+{
+	return MyLogicalRepWorker->parallel_apply;
+}
+
 #endif							/* WORKER_INTERNAL_H */
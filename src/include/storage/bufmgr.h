@@ -23,6 +23,9 @@
 
 typedef void *Block;
 
+/* forward declared, to avoid having to expose smgr.h here */
+struct SMgrRelationData;
+
 /* Possible arguments for GetAccessStrategy() */
 typedef enum BufferAccessStrategyType
 {
@@ -68,13 +71,14 @@ extern PGDLLIMPORT char *BufferBlocks;
 
 /* in guc.c */
 extern int	effective_io_concurrency;
+extern int	maintenance_io_concurrency;
 
 /* in localbuf.c */
 extern PGDLLIMPORT int NLocBuffer;
 extern PGDLLIMPORT Block *LocalBufferBlockPointers;
 extern PGDLLIMPORT int32 *LocalRefCount;
 
-/* upper limit for effective_io_concurrency */
+/* upper limit for effective_io_concurrency and maintenance_io_concurrency */
 #define MAX_IO_CONCURRENCY 1000
 
 /* special block number for ReadBuffer() */
@@ -162,6 +166,9 @@ extern PGDLLIMPORT int32 *LocalRefCount;
  * prototypes for functions in bufmgr.c
  */
 extern bool ComputeIoConcurrency(int io_concurrency, double *target);
+extern bool PrefetchSharedBuffer(struct SMgrRelationData *smgr_reln,
+								 ForkNumber forkNum,
+								 BlockNumber blockNum);
 extern void PrefetchBuffer(Relation reln, ForkNumber forkNum,
 						   BlockNumber blockNum);
 extern Buffer ReadBuffer(Relation reln, BlockNumber blockNum);
@@ -48,6 +48,11 @@ typedef int File;
 /* GUC parameter */
 extern PGDLLIMPORT int max_files_per_process;
 extern PGDLLIMPORT bool data_sync_retry;
+extern PGDLLIMPORT int io_direct_flags;
+
+/* Flags for io_direct_flags, set from the io_direct GUC */
+#define IO_DIRECT_DATA			0x01
+#define IO_DIRECT_WAL			0x02
 
 /*
  * This is private to fd.c, but exported for save/restore_backend_variables()
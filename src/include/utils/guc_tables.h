@@ -71,6 +71,7 @@ enum config_group
 	WAL_ARCHIVING,
 	WAL_ARCHIVE_RECOVERY,
 	WAL_RECOVERY_TARGET,
+	WAL_RECOVERY,
 	REPLICATION,
 	REPLICATION_SENDING,
 	REPLICATION_MASTER,
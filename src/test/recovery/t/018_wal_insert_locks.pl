@@ -0,0 +1,48 @@
+# Test WAL insertion with non-default numbers of WAL insertion locks
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 8;
+
+# Several pgbench clients insert concurrently, each through whichever lock
+# it gets.  After a crash, replay must find every row, which it can only do
+# if the records were chained together correctly.
+foreach my $nlocks (1, 3)
+{
+	my $node = get_new_node("locks_$nlocks");
+	$node->init;
+	$node->append_conf('postgresql.conf', "wal_insert_locks = $nlocks");
+	$node->start;
+
+	is($node->safe_psql('postgres', 'SHOW wal_insert_locks'),
+		$nlocks, "wal_insert_locks is $nlocks");
+
+	$node->safe_psql('postgres', 'CREATE TABLE ins (id int, filler text)');
+
+	my $script = $node->basedir . '/insert.sql';
+	append_to_file($script,
+		"INSERT INTO ins SELECT :client_id, repeat('x', 100) FROM generate_series(1, 10);\n"
+	);
+	$node->command_ok(
+		[ 'pgbench', '-n', '-c', '8', '-j', '4', '-t', '100', '-f', $script, 'postgres' ],
+		"concurrent inserts with $nlocks WAL insertion locks");
+
+	$node->stop('immediate');
+	$node->start;
+
+	is($node->safe_psql('postgres', 'SELECT count(*) FROM ins'),
+		'8000', "all rows replayed with $nlocks WAL insertion locks");
+
+	$node->stop;
+}
+
+# Zero locks is not a valid setting
+my $node = get_new_node('locks_0');
+$node->init;
+$node->append_conf('postgresql.conf', 'wal_insert_locks = 0');
+ok(!$node->start(fail_ok => 1), 'server does not start with wal_insert_locks = 0');
+like(
+	slurp_file($node->logfile),
+	qr/invalid value for parameter "wal_insert_locks": 0/,
+	'wal_insert_locks = 0 is rejected');
@@ -0,0 +1,82 @@
+# Test running with io_direct enabled for both relation files and WAL
+use strict;
+use warnings;
+use Fcntl;
+use PostgresNode;
+use TestLib;
+use Test::More;
+
+# Not every platform or file system supports O_DIRECT (tmpfs doesn't, for
+# example), so check that we can use it where the test will run.
+my $o_direct = eval { Fcntl::O_DIRECT() };
+my $probe = TestLib::tempdir . '/probe';
+if (!defined $o_direct || $o_direct == 0)
+{
+	plan skip_all => 'O_DIRECT is not supported on this platform';
+}
+elsif (!sysopen(my $fh, $probe, O_RDWR | O_CREAT | $o_direct))
+{
+	plan skip_all => "O_DIRECT is not supported by the file system: $!";
+}
+else
+{
+	close $fh;
+	plan tests => 5;
+}
+
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+
+# Small shared_buffers, so that the table doesn't fit and pages really are
+# read and written directly
+$node_master->append_conf(
+	'postgresql.conf', qq{
+io_direct = 'data, wal'
+shared_buffers = 1MB
+});
+$node_master->start;
+
+is($node_master->safe_psql('postgres', 'SHOW io_direct'),
+	'data, wal', 'io_direct is set');
+
+# Index builds write pages from private memory, which have to be bounced
+# through an aligned buffer
+$node_master->safe_psql(
+	'postgres', q{
+CREATE TABLE t (id int, filler text);
+INSERT INTO t SELECT g, repeat('x', 100) FROM generate_series(1, 20000) g;
+CREATE INDEX t_id ON t (id);
+});
+
+my $query = q{SELECT count(*), sum(id) FROM t WHERE id % 7 = 0};
+my $expected = '2857|28578571';
+is($node_master->safe_psql('postgres', $query), $expected,
+	'table readable with direct I/O');
+
+# A standby inherits io_direct, and must be able to open standby.signal
+$node_master->backup('my_backup');
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, 'my_backup',
+	has_streaming => 1);
+$node_standby->start;
+
+$node_master->safe_psql('postgres',
+	q{INSERT INTO t SELECT g, repeat('y', 100) FROM generate_series(20001, 21000) g}
+);
+$expected = '3000|31510500';
+is($node_master->safe_psql('postgres', $query), $expected,
+	'rows added with direct I/O');
+
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+is($node_standby->safe_psql('postgres', $query), $expected,
+	'standby replays with direct I/O');
+
+# Crash recovery reads the WAL back with direct I/O
+$node_master->stop('immediate');
+$node_master->start;
+is($node_master->safe_psql('postgres', $query), $expected,
+	'crash recovery with direct I/O');
+
+$node_standby->stop;
+$node_master->stop;
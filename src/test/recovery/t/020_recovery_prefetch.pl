@@ -0,0 +1,81 @@
+# Test prefetching of referenced blocks during recovery
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More;
+
+# Without full page images, replaying changes to existing pages makes the
+# standby read them, which is what the prefetcher is there for.
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->append_conf(
+	'postgresql.conf', qq{
+full_page_writes = off
+autovacuum = off
+});
+$node_master->start;
+
+# Without posix_fadvise(), maintenance_io_concurrency must be 0, and
+# nothing is ever prefetched
+if ($node_master->safe_psql('postgres', 'SHOW maintenance_io_concurrency') eq
+	'0')
+{
+	plan skip_all => 'prefetching is not supported on this platform';
+}
+else
+{
+	plan tests => 4;
+}
+
+$node_master->safe_psql('postgres',
+	q{CREATE TABLE t (id int, filler text) WITH (autovacuum_enabled = off);
+	  INSERT INTO t SELECT g, repeat('x', 100) FROM generate_series(1, 10000) g;
+	  CHECKPOINT});
+
+# The standby starts with none of the table's pages in shared buffers
+$node_master->backup('my_backup');
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, 'my_backup',
+	has_streaming => 1);
+$node_standby->append_conf(
+	'postgresql.conf', qq{
+recovery_prefetch = on
+shared_buffers = 1MB
+});
+$node_standby->start;
+
+# Every page of the table is referenced, mostly several times
+$node_master->safe_psql('postgres', 'UPDATE t SET id = id + 1');
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+
+my $stats = q{SELECT prefetch > 0, hit > 0 FROM pg_stat_recovery_prefetch};
+is($node_standby->safe_psql('postgres', $stats),
+	't|t', 'blocks prefetched and found in shared buffers');
+is($node_standby->safe_psql('postgres', 'SELECT sum(id) FROM t'),
+	'50015000', 'standby replayed the update');
+
+# A reset requested during recovery is carried out by the startup process
+# before it looks at the next record.  The records that follow have no block
+# references, so the counters must stay at zero.
+my $reset_time = $node_standby->safe_psql('postgres',
+	'SELECT stats_reset FROM pg_stat_recovery_prefetch');
+$node_standby->safe_psql('postgres',
+	"SELECT pg_stat_reset_shared('recovery_prefetch')");
+$node_master->safe_psql('postgres', 'CHECKPOINT');
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+
+is( $node_standby->safe_psql(
+		'postgres',
+		"SELECT stats_reset > '$reset_time' FROM pg_stat_recovery_prefetch"),
+	't',
+	'reset time advanced');
+is( $node_standby->safe_psql(
+		'postgres', 'SELECT prefetch, hit FROM pg_stat_recovery_prefetch'),
+	'0|0',
+	'counters reset');
+
+$node_standby->stop;
+$node_master->stop;
@@ -0,0 +1,131 @@
+# Test replay of WAL by redo workers on hot standbys
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 12;
+
+# A standby's max_worker_processes can't be lower than the primary's, so keep
+# it low on the primary to be able to starve the second standby of slots.
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->append_conf('postgresql.conf', 'max_worker_processes = 2');
+$node_master->start;
+
+$node_master->safe_psql(
+	'postgres', q{
+CREATE TABLE t (id int, filler text);
+CREATE INDEX t_id ON t (id);
+CREATE INDEX t_filler ON t (filler);
+CREATE TABLE trunc (id int);
+INSERT INTO trunc SELECT generate_series(1, 1000);
+CREATE TABLE dropme (id int PRIMARY KEY);
+INSERT INTO dropme SELECT generate_series(1, 1000);
+});
+
+$node_master->backup('my_backup');
+
+# The first standby gets all the workers it asks for
+my $node_standby_1 = get_new_node('standby_1');
+$node_standby_1->init_from_backup($node_master, 'my_backup',
+	has_streaming => 1);
+$node_standby_1->append_conf(
+	'postgresql.conf', qq{
+max_redo_workers = 4
+log_min_messages = debug1
+});
+$node_standby_1->start;
+
+# The second one has fewer worker slots than it asks for
+my $node_standby_2 = get_new_node('standby_2');
+$node_standby_2->init_from_backup($node_master, 'my_backup',
+	has_streaming => 1);
+$node_standby_2->append_conf(
+	'postgresql.conf', qq{
+max_redo_workers = 4
+max_worker_processes = 2
+});
+$node_standby_2->start;
+
+# Compare what the standbys see with the primary, through the indexes too
+my $query = q{
+SELECT count(*), sum(id), md5(string_agg(id || filler, ',' ORDER BY id, filler))
+  FROM t;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM t WHERE id > 0;
+SELECT count(*) FROM t WHERE filler > '';
+SELECT count(*), sum(id) FROM trunc;
+SELECT to_regclass('dropme') IS NULL;
+};
+
+sub check_standbys
+{
+	my ($name) = @_;
+	my $expected = $node_master->safe_psql('postgres', $query);
+
+	foreach my $node ($node_standby_1, $node_standby_2)
+	{
+		$node_master->wait_for_catchup($node, 'replay',
+			$node_master->lsn('insert'));
+		is($node->safe_psql('postgres', $query),
+			$expected, "$name on " . $node->name);
+	}
+	return;
+}
+
+# Concurrent heap and B-tree insertions.  The heap and its indexes are
+# extended by whichever workers replay the records for their new pages.
+my $script = $node_master->basedir . '/insert.sql';
+append_to_file($script,
+	    "INSERT INTO t SELECT :client_id * 100000 + g, md5(g::text) "
+	  . "FROM generate_series(1, 20) g;\n");
+$node_master->command_ok(
+	[ 'pgbench', '-n', '-c', '8', '-j', '4', '-t', '100', '-f', $script, 'postgres' ],
+	'concurrent inserts');
+check_standbys('concurrent inserts');
+
+# Barriers, including records that remove files the workers may have open
+$node_master->safe_psql(
+	'postgres', q{
+UPDATE t SET filler = filler || 'x' WHERE id % 10 = 0;
+TRUNCATE trunc;
+INSERT INTO trunc SELECT generate_series(1, 500);
+DROP TABLE dropme;
+INSERT INTO t SELECT g, md5(g::text) FROM generate_series(1, 5000) g;
+});
+check_standbys('truncation and drop');
+
+# Replay can be paused while workers are in use
+$node_standby_1->safe_psql('postgres', 'SELECT pg_wal_replay_pause()');
+my $before = $node_standby_1->safe_psql('postgres', 'SELECT count(*) FROM t');
+$node_master->safe_psql('postgres',
+	q{INSERT INTO t SELECT g, md5(g::text) FROM generate_series(1, 1000) g});
+$node_master->wait_for_catchup($node_standby_1, 'flush',
+	$node_master->lsn('insert'));
+is($node_standby_1->safe_psql('postgres', 'SELECT count(*) FROM t'),
+	$before, 'nothing replayed while paused');
+$node_standby_1->safe_psql('postgres', 'SELECT pg_wal_replay_resume()');
+check_standbys('resumed replay');
+
+like(
+	slurp_file($node_standby_1->logfile),
+	qr/started 4 redo workers/,
+	'all redo workers started');
+like(
+	slurp_file($node_standby_2->logfile),
+	qr/started [0-9] of 4 redo workers/,
+	'fewer redo workers started than requested');
+
+# Workers are shut down at promotion, after replaying everything sent to them
+my $expected = $node_master->safe_psql('postgres', $query);
+$node_standby_1->promote;
+$node_standby_1->poll_query_until('postgres',
+	'SELECT NOT pg_is_in_recovery()')
+  or die "Timed out while waiting for promotion";
+is($node_standby_1->safe_psql('postgres', $query),
+	$expected, 'promoted standby has all changes');
+$node_standby_1->safe_psql('postgres',
+	q{INSERT INTO t VALUES (0, 'after promotion')});
+is($node_standby_1->safe_psql('postgres', 'SELECT count(*) FROM t WHERE id = 0'),
+	'1', 'promoted standby is writable');
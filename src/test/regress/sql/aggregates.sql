@@ -1017,3 +1017,39 @@ select v||'a', case when v||'a' = 'aa' then 1 else 0 end, count(*)
 explain (costs off)
   select 1 from tenk1
    where (hundred, thousand) in (select twothousand, twothousand from onek);
+
+--
+-- Hash Aggregation Spill tests
+--
+
+set enable_sort=false;
+set work_mem='64kB';
+
+-- check that spilled groups produce the same results as in-memory groups
+create table agg_hash_1 as
+select g % 10000 as c1, sum(g::numeric) as c2, count(*) as c3,
+       array_agg(g) as c4
+  from generate_series(0, 49999) g
+  group by g % 10000;
+
+set enable_sort=true;
+set enable_hashagg=false;
+
+create table agg_group_1 as
+select g % 10000 as c1, sum(g::numeric) as c2, count(*) as c3,
+       array_agg(g) as c4
+  from generate_series(0, 49999) g
+  group by g % 10000;
+
+reset enable_hashagg;
+reset work_mem;
+reset enable_sort;
+
+(select c1, c2, c3 from agg_hash_1 except select c1, c2, c3 from agg_group_1)
+  union all
+(select c1, c2, c3 from agg_group_1 except select c1, c2, c3 from agg_hash_1);
+
+select count(*) from agg_hash_1 where cardinality(c4) <> 5;
+
+drop table agg_hash_1;
+drop table agg_group_1;
@@ -122,6 +122,32 @@ create index btree_tall_idx on btree_tall_tbl (t, id) with (fillfactor = 10);
 insert into btree_tall_tbl select g, repeat('x', 250)
 from generate_series(1, 130) g;
 
+--
+-- Test B-tree deduplication
+--
+create table btree_dedup_tbl(a int, b int);
+create index btree_dedup_idx on btree_dedup_tbl (a);
+-- Many duplicates per value force deduplication passes on leaf pages
+insert into btree_dedup_tbl select g % 10, g from generate_series(1, 10000) g;
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+select count(*) from btree_dedup_tbl where a = 5;
+select a, b from btree_dedup_tbl where a = 9 order by a desc, b desc limit 3;
+-- Remove some (but not all) heap TIDs from posting lists
+delete from btree_dedup_tbl where a = 5 and b % 20 = 5;
+vacuum btree_dedup_tbl;
+select count(*) from btree_dedup_tbl where a = 5;
+-- CREATE INDEX deduplicates too
+reindex index btree_dedup_idx;
+select count(*) from btree_dedup_tbl where a = 5;
+reset enable_seqscan;
+reset enable_bitmapscan;
+-- Storage parameter
+alter index btree_dedup_idx set (deduplicate_items = off);
+select reloptions from pg_class WHERE oid = 'btree_dedup_idx'::regclass;
+create index btree_dedup_err on btree_dedup_tbl (a) with (deduplicate_items = 'maybe');
+drop table btree_dedup_tbl;
+
 --
 -- Test vacuum_cleanup_index_scale_factor
 --
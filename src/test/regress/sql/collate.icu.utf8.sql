@@ -721,6 +721,27 @@ INSERT INTO test33 VALUES (2, 'DEF');
 -- they end up in the same partition (but it's platform-dependent which one)
 SELECT (SELECT count(*) FROM test33_0) <> (SELECT count(*) FROM test33_1);
 
+-- Result Cache keys must be compared using the join clause's collation,
+-- not that of the outer side
+CREATE TABLE test34ci (x text COLLATE case_insensitive);
+CREATE TABLE test34c (x text COLLATE "C");
+INSERT INTO test34ci SELECT CASE WHEN g % 2 = 0 THEN 'abc' ELSE 'ABC' END
+  FROM generate_series(1, 100) g;
+INSERT INTO test34c VALUES ('abc'), ('ABC');
+CREATE INDEX ON test34c (x);
+ANALYZE test34ci, test34c;
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+SET enable_material = off;
+SET enable_seqscan = off;
+SELECT a.x COLLATE "C" AS a, b.x AS b, count(*)
+  FROM test34ci a JOIN test34c b ON b.x COLLATE "C" = a.x
+  GROUP BY 1, 2 ORDER BY 1, 2;
+RESET enable_hashjoin;
+RESET enable_mergejoin;
+RESET enable_material;
+RESET enable_seqscan;
+
 
 -- cleanup
 RESET search_path;
@@ -0,0 +1,29 @@
+-- When we have to sort the entire table, incremental sort will
+-- be slower than plain sort, so it should not be used.
+explain (costs off)
+select * from (select * from tenk1 order by four) t order by four, ten;
+
+-- When there is a LIMIT clause, incremental sort is beneficial because
+-- it only has to sort some of the groups, and not the entire table.
+explain (costs off)
+select * from (select * from tenk1 order by four) t order by four, ten
+limit 1;
+
+-- Check results across batch boundaries, with presorted groups both
+-- larger and smaller than the minimum batch size.
+create table incsort (a int, b int);
+insert into incsort select i / 50, (i * 37) % 101 from generate_series(1, 1000) i;
+insert into incsort select 100 + i / 5, (i * 37) % 101 from generate_series(1, 200) i;
+analyze incsort;
+
+-- disabling plain sorts makes the incremental sort the cheaper choice
+set enable_sort = off;
+
+explain (costs off)
+select * from (select * from incsort order by a) s order by a, b limit 12 offset 44;
+select * from (select * from incsort order by a) s order by a, b limit 12 offset 44;
+select * from (select * from incsort order by a) s order by a, b limit 12 offset 1000;
+
+reset enable_sort;
+
+drop table incsort;
@@ -0,0 +1,102 @@
+-- Perform tests on JIT compilation.
+
+-- Whether, and how much, code is JIT compiled depends on the build, so only
+-- the JIT statistics of queries are checked.  Without JIT support they are
+-- all NULL (see jit_1.out).  Only the query passed in is JIT compiled, not
+-- the query calling the function, whose code would end up in the cache too.
+create function jit_stats(query text,
+    out functions int, out cached int, out evicted int)
+language plpgsql
+set jit = on
+set jit_above_cost = 0
+set jit_optimize_above_cost = -1
+set jit_inline_above_cost = -1
+as
+$$
+declare
+    plan json;
+begin
+    execute format('explain (analyze, format json, summary off, timing off) %s',
+        query) into plan;
+    functions := plan->0->'JIT'->>'Functions';
+    cached := plan->0->'JIT'->>'Cached Functions';
+    evicted := plan->0->'JIT'->>'Evicted Functions';
+end;
+$$;
+
+create table jit_a (a int, b text);
+insert into jit_a select g, g::text from generate_series(1, 1000) g;
+create table jit_b (a int, b text);
+insert into jit_b select g, g::text from generate_series(1, 1000) g;
+analyze jit_a, jit_b;
+
+-- Parallel workers would have caches of their own.
+set force_parallel_mode = off;
+set max_parallel_workers_per_gather = 0;
+
+-- Caching of compiled expressions
+set jit_cache_size = 100;
+
+-- Nothing is cached yet.
+select functions > 0 as compiled, cached, evicted
+from jit_stats('select count(*), sum(a) from jit_a where a % 7 = 3');
+-- The code is reused for other constants, and other tables with the same
+-- row type.
+select functions > 0 as compiled, cached > 0 as reused, evicted
+from jit_stats('select count(*), sum(a) from jit_a where a % 7 = 4');
+select functions > 0 as compiled, cached > 0 as reused, evicted
+from jit_stats('select count(*), sum(a) from jit_b where a % 7 = 5');
+
+-- The reused code computes the right results.
+set jit_above_cost = 0;
+select count(*), sum(a) from jit_a where a % 7 = 3;
+select count(*), sum(a) from jit_a where a % 7 = 4;
+select count(*), sum(a) from jit_b where a % 7 = 5;
+reset jit_above_cost;
+
+-- With a smaller cache, the code of earlier queries is evicted.
+set jit_cache_size = 1;
+select functions > 0 as compiled, cached, evicted > 0 as evicted
+from jit_stats('select count(*) from jit_a where length(b) = 2');
+
+-- Disabling the cache empties it.
+set jit_cache_size = 0;
+select functions > 0 as compiled, cached, evicted
+from jit_stats('select count(*), sum(a) from jit_a where a % 7 = 3');
+set jit_cache_size = 100;
+select functions > 0 as compiled, cached, evicted
+from jit_stats('select count(*) from jit_a where length(b) = 2');
+select functions > 0 as compiled, cached > 0 as reused, evicted
+from jit_stats('select count(*) from jit_a where length(b) = 2');
+
+reset jit_cache_size;
+
+-- With jit_warmup_evaluations, expressions are interpreted until one of them
+-- has been evaluated that many times.  Then all expressions of its plan node
+-- are compiled.  The scan's qual is evaluated 1000 times, its projection only
+-- 10 times.
+select coalesce(functions, 0) as functions_eager
+from jit_stats('select a + 1 from jit_a where a <= 10') \gset
+select :functions_eager > 0 as compiled;
+set jit_warmup_evaluations = 1;
+select coalesce(functions, 0) = :functions_eager as all_compiled
+from jit_stats('select a + 1 from jit_a where a <= 10');
+set jit_warmup_evaluations = 100;
+select coalesce(functions, 0) = :functions_eager as all_compiled
+from jit_stats('select a + 1 from jit_a where a <= 10');
+set jit_warmup_evaluations = 2000;
+select coalesce(functions, 0) as functions
+from jit_stats('select a + 1 from jit_a where a <= 10');
+
+-- Switching to compiled code during the query doesn't change the results.
+set jit_warmup_evaluations = 100;
+set jit_above_cost = 0;
+select count(*), sum(a + 1) from jit_a where a % 7 = 3;
+reset jit_above_cost;
+reset jit_warmup_evaluations;
+
+reset max_parallel_workers_per_gather;
+reset force_parallel_mode;
+
+drop table jit_a, jit_b;
+drop function jit_stats(text);
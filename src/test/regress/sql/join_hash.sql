@@ -538,3 +538,43 @@ WHERE
     AND hjtest_1.a <> hjtest_2.b;
 
 ROLLBACK;
+
+--
+-- Bloom filters built by the Hash node for the outer scan
+--
+begin;
+
+set local enable_hashjoin_bloom_filter = on;
+set local max_parallel_workers_per_gather = 0;
+
+create table bloom_outer (id int, a int);
+insert into bloom_outer select g, g % 1000 from generate_series(1, 10000) g;
+create table bloom_inner (a int, t text);
+insert into bloom_inner select g, 'inner ' || g from generate_series(1, 10) g;
+analyze bloom_outer, bloom_inner;
+
+-- Show the Bloom filter lines of an explain analyze plan.
+create function bloom_filter_lines(query text)
+returns setof text language plpgsql
+as
+$$
+declare
+  ln text;
+begin
+  for ln in
+    execute format('explain (analyze, costs off, summary off, timing off) %s',
+                   query)
+  loop
+    if ln like '%Bloom Filter%' then
+      return next ltrim(ln);
+    end if;
+  end loop;
+end;
+$$;
+
+explain (costs off)
+  select count(*) from bloom_outer o join bloom_inner i using (a);
+select count(*) from bloom_outer o join bloom_inner i using (a);
+select bloom_filter_lines('select count(*) from bloom_outer o join bloom_inner i using (a)');
+
+rollback;
@@ -0,0 +1,114 @@
+-- Perform tests on the Result Cache node.
+
+-- The cache hits/misses/evictions from the Result Cache node can vary between
+-- machines.  Let's just replace the number with an 'N'.  In order to allow us
+-- to perform validation when the measure was zero, we replace a zero value
+-- with "Zero".  All other numbers are replaced with 'N'.
+create function explain_resultcache(query text, hide_hitmiss bool) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        if hide_hitmiss = true then
+                ln := regexp_replace(ln, 'Hits: 0', 'Hits: Zero');
+                ln := regexp_replace(ln, 'Hits: \d+', 'Hits: N');
+                ln := regexp_replace(ln, 'Misses: 0', 'Misses: Zero');
+                ln := regexp_replace(ln, 'Misses: \d+', 'Misses: N');
+        end if;
+        ln := regexp_replace(ln, 'Evictions: 0', 'Evictions: Zero');
+        ln := regexp_replace(ln, 'Evictions: \d+', 'Evictions: N');
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        ln := regexp_replace(ln, 'Heap Fetches: \d+', 'Heap Fetches: N');
+        ln := regexp_replace(ln, 'loops=\d+', 'loops=N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+-- Ensure we get a result cache on the inner side of the nested loop
+SET enable_resultcache TO on;
+SET enable_hashjoin TO off;
+SET enable_bitmapscan TO off;
+
+SELECT explain_resultcache('
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.twenty
+WHERE t2.unique1 < 1000;', false);
+
+-- And check we get the expected results.
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.twenty
+WHERE t2.unique1 < 1000;
+
+-- Try with LATERAL joins
+SELECT explain_resultcache('
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
+WHERE t1.unique1 < 1000;', false);
+
+-- And check we get the expected results.
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
+WHERE t1.unique1 < 1000;
+
+-- Reduce work_mem so that we see some cache evictions
+SET work_mem TO '64kB';
+SET enable_mergejoin TO off;
+-- Ensure we get some evictions.  We're unable to validate the hits and misses
+-- here as the number of entries that fit in the cache at once will vary
+-- between different machines.
+SELECT explain_resultcache('
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.thousand
+WHERE t2.unique1 < 1200;', true);
+
+-- The results must not depend on the evictions.
+SELECT COUNT(*),AVG(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.thousand
+WHERE t2.unique1 < 1200;
+
+-- Keys that the hash operators find equal, such as numeric 1.0 and 1.00 or
+-- float8 0 and -0, must not share cache entries when the inner side can tell
+-- them apart, as a LATERAL subquery returning them can.
+CREATE TABLE rc_keys (n numeric, f float8);
+INSERT INTO rc_keys
+SELECT CASE WHEN g % 2 = 0 THEN 1.0 ELSE 1.00 END,
+       CASE WHEN g % 2 = 0 THEN '0'::float8 ELSE '-0'::float8 END
+FROM generate_series(1, 100) g;
+CREATE INDEX rc_keys_f ON rc_keys (f);
+ANALYZE rc_keys;
+SELECT trim(ln) AS result_cache FROM explain_resultcache('
+SELECT * FROM rc_keys t1,
+LATERAL (SELECT t1.n::text AS s, count(*) FROM tenk1 t2 WHERE t2.unique1 < 100) t2;', false) ln
+WHERE ln LIKE '%Hits:%';
+SELECT COUNT(DISTINCT t2.s) FROM rc_keys t1,
+LATERAL (SELECT t1.n::text AS s, count(*) FROM tenk1 t2 WHERE t2.unique1 < 100) t2;
+SELECT trim(ln) AS result_cache FROM explain_resultcache('
+SELECT * FROM rc_keys t1,
+LATERAL (SELECT t1.f::text AS s, count(*) FROM tenk1 t2 WHERE t2.unique1 < 100) t2;', false) ln
+WHERE ln LIKE '%Hits:%';
+SELECT COUNT(DISTINCT t2.s) FROM rc_keys t1,
+LATERAL (SELECT t1.f::text AS s, count(*) FROM tenk1 t2 WHERE t2.unique1 < 100) t2;
+
+-- A join clause using the hash operator can't tell them apart, so there they
+-- share cache entries.
+SET enable_seqscan TO off;
+SELECT trim(ln) AS result_cache FROM explain_resultcache('
+SELECT * FROM rc_keys t1 INNER JOIN rc_keys t2 ON t1.f = t2.f;', false) ln
+WHERE ln LIKE '%Hits:%';
+SELECT COUNT(*) FROM rc_keys t1 INNER JOIN rc_keys t2 ON t1.f = t2.f;
+RESET enable_seqscan;
+DROP TABLE rc_keys;
+
+RESET enable_mergejoin;
+RESET work_mem;
+RESET enable_bitmapscan;
+RESET enable_hashjoin;
+RESET enable_resultcache;
+
+DROP FUNCTION explain_resultcache(text, bool);
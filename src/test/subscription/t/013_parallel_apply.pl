@@ -0,0 +1,178 @@
+# Test applying transactions in parallel apply workers
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 7;
+
+# setup
+
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->append_conf('postgresql.conf',
+	"max_parallel_apply_workers_per_subscription = 2");
+$node_subscriber->start;
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+
+# tab_key can be applied in parallel, tab_uniq only exclusively because of
+# its second unique constraint
+foreach my $node ($node_publisher, $node_subscriber)
+{
+	$node->safe_psql('postgres',
+		"CREATE TABLE tab_key (a int PRIMARY KEY, b text)");
+	$node->safe_psql('postgres',
+		"CREATE TABLE tab_uniq (a int PRIMARY KEY, b int UNIQUE)");
+}
+
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab_key, tab_uniq");
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+
+# Wait for initial sync to finish
+my $synced_query =
+  "SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('r', 's');";
+$node_subscriber->poll_query_until('postgres', $synced_query)
+  or die "Timed out while waiting for subscriber to synchronize data";
+
+# many small transactions, some of them changing the same rows
+
+$node_publisher->safe_psql(
+	'postgres', q{
+DO $$
+BEGIN
+  FOR i IN 1..200 LOOP
+    INSERT INTO tab_key VALUES (i, 'insert ' || i);
+    COMMIT;
+    UPDATE tab_key SET b = 'update ' || i WHERE a = i / 2;
+    COMMIT;
+    IF i % 10 = 0 THEN
+      DELETE FROM tab_key WHERE a = i - 5;
+      COMMIT;
+    END IF;
+  END LOOP;
+END
+$$;
+});
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+my $query = "SELECT count(*), sum(a), string_agg(b, ',' ORDER BY a) FROM tab_key";
+my $expected = $node_publisher->safe_psql('postgres', $query);
+my $result = $node_subscriber->safe_psql('postgres', $query);
+is($result, $expected, 'parallel apply of inserts, updates and deletes');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) > 0 FROM pg_stat_activity WHERE backend_type = 'logical replication parallel apply worker'"
+);
+is($result, qq(t), 'parallel apply workers are running');
+
+# changing the primary key of rows
+
+$node_publisher->safe_psql(
+	'postgres', q{
+DO $$
+BEGIN
+  FOR i IN 1..50 LOOP
+    UPDATE tab_key SET a = a + 1000 WHERE a = i;
+    COMMIT;
+    UPDATE tab_key SET b = 'moved ' || a WHERE a = i + 1000;
+    COMMIT;
+  END LOOP;
+END
+$$;
+});
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+$expected = $node_publisher->safe_psql('postgres', $query);
+$result = $node_subscriber->safe_psql('postgres', $query);
+is($result, $expected, 'parallel apply of key updates');
+
+# a table whose rows can conflict by another unique constraint
+
+$node_publisher->safe_psql(
+	'postgres', q{
+DO $$
+BEGIN
+  FOR i IN 1..100 LOOP
+    INSERT INTO tab_uniq VALUES (i, i);
+    COMMIT;
+    IF i % 2 = 0 THEN
+      DELETE FROM tab_uniq WHERE a = i;
+      COMMIT;
+      INSERT INTO tab_uniq VALUES (i + 1000, i);
+      COMMIT;
+    END IF;
+  END LOOP;
+END
+$$;
+});
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+$query = "SELECT count(*), sum(a), sum(b) FROM tab_uniq";
+$expected = $node_publisher->safe_psql('postgres', $query);
+$result = $node_subscriber->safe_psql('postgres', $query);
+is($result, $expected, 'exclusive apply of table with other unique constraint');
+
+# TRUNCATE in between other transactions
+
+$node_publisher->safe_psql(
+	'postgres', q{
+DO $$
+BEGIN
+  FOR i IN 1..20 LOOP
+    INSERT INTO tab_key VALUES (i + 2000, 'before truncate');
+    COMMIT;
+  END LOOP;
+  TRUNCATE tab_key;
+  COMMIT;
+  FOR i IN 1..20 LOOP
+    INSERT INTO tab_key VALUES (i, 'after truncate');
+    COMMIT;
+  END LOOP;
+END
+$$;
+});
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), min(a), max(a), min(b) FROM tab_key");
+is($result, qq(20|1|20|after truncate), 'truncate applied in order');
+
+# the workers stop when the setting is turned off
+
+$node_subscriber->safe_psql('postgres',
+	"ALTER SYSTEM SET max_parallel_apply_workers_per_subscription = 0");
+$node_subscriber->reload;
+
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_key VALUES (100, 'serial')");
+$node_publisher->wait_for_catchup('tap_sub');
+
+$node_subscriber->poll_query_until('postgres',
+	"SELECT count(*) = 0 FROM pg_stat_activity WHERE backend_type = 'logical replication parallel apply worker'"
+) or die "Timed out while waiting for parallel apply workers to stop";
+
+$node_publisher->safe_psql('postgres',
+	"UPDATE tab_key SET b = 'serial update' WHERE a <= 10");
+$node_publisher->wait_for_catchup('tap_sub');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) FROM tab_key WHERE b = 'serial update'");
+is($result, qq(10), 'changes applied after stopping parallel apply workers');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT b FROM tab_key WHERE a = 100");
+is($result, qq(serial), 'insert applied while stopping parallel apply workers');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');
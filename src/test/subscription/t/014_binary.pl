@@ -0,0 +1,109 @@
+# Binary mode logical replication test
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 5;
+
+# setup
+
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->start;
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+
+# column b has a different type on the subscriber, so it can't be received
+# in binary format directly
+my $ddl = qq(
+	CREATE TABLE public.test_numerical (
+		a INTEGER PRIMARY KEY,
+		c NUMERIC,
+		d FLOAT,
+		e TIMESTAMPTZ,
+		f INT[],
+		g TEXT);
+	CREATE TYPE public.test_enum AS ENUM ('x', 'y', 'z'););
+
+$node_publisher->safe_psql('postgres', $ddl);
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE public.test_mixed (a INTEGER PRIMARY KEY, b BIGINT, c public.test_enum)");
+$node_subscriber->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE public.test_mixed (a INTEGER PRIMARY KEY, b NUMERIC, c public.test_enum)");
+
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tpub FOR ALL TABLES");
+
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tsub CONNECTION '$publisher_connstr' PUBLICATION tpub WITH (binary = true)"
+);
+
+# Ensure nodes are in sync with each other
+$node_publisher->wait_for_catchup('tsub');
+$node_subscriber->poll_query_until('postgres',
+	"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('s', 'r');"
+) or die "Timed out while waiting for subscriber to synchronize data";
+
+# Insert some content and make sure it's replicated across
+$node_publisher->safe_psql(
+	'postgres', qq(
+	INSERT INTO public.test_numerical (a, c, d, e, f, g) VALUES
+		(1, 1.2, 1.3, '2019-11-22 10:00:00+01', '{1,2,3}', 'one'),
+		(2, 2.2, 2.3, '2019-11-22 11:00:00+01', '{4,5,NULL}', 'two'),
+		(3, 3.2, 3.3, '2019-11-22 12:00:00+01', NULL, NULL);
+	INSERT INTO public.test_mixed VALUES (1, 10, 'x'), (2, 20, 'y');
+	));
+
+$node_publisher->wait_for_catchup('tsub');
+
+my $query =
+  "SELECT a, c, d, e, f, g FROM public.test_numerical ORDER BY a";
+my $expected = $node_publisher->safe_psql('postgres', $query);
+my $result = $node_subscriber->safe_psql('postgres', $query);
+is($result, $expected, 'insert of built-in types in binary format');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b, c FROM public.test_mixed ORDER BY a");
+is( $result, '1|10|x
+2|20|y', 'insert of different local type and of non-built-in type');
+
+# Test updates and deletes as well
+$node_publisher->safe_psql(
+	'postgres', qq(
+	UPDATE public.test_numerical SET c = c * 2, f = f || 7, e = e + '1 day';
+	UPDATE public.test_mixed SET b = b + 1, c = 'z' WHERE a = 2;
+	DELETE FROM public.test_numerical WHERE a = 3;
+	DELETE FROM public.test_mixed WHERE a = 1;
+	));
+
+$node_publisher->wait_for_catchup('tsub');
+
+$expected = $node_publisher->safe_psql('postgres', $query);
+$result = $node_subscriber->safe_psql('postgres', $query);
+is($result, $expected, 'update and delete in binary format');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b, c FROM public.test_mixed ORDER BY a");
+is($result, '2|21|z', 'update and delete with different local type');
+
+# Switch binary mode off and make sure changes still arrive
+$node_subscriber->safe_psql('postgres',
+	"ALTER SUBSCRIPTION tsub SET (binary = false)");
+
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO public.test_numerical VALUES (4, 4.2, 4.3, '2019-11-22 13:00:00+01', '{8}', 'four')"
+);
+
+$node_publisher->wait_for_catchup('tsub');
+
+$expected = $node_publisher->safe_psql('postgres', $query);
+$result = $node_subscriber->safe_psql('postgres', $query);
+is($result, $expected, 'insert in text format after disabling binary mode');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');